@@ -0,0 +1,589 @@
+#include "stb_dxt.h"
+
+#include "ThreadPool.h"
+#include "Image.h"
+#include "BlockCompressor.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSOR_SSE
+#include <emmintrin.h>
+#endif
+
+namespace SunEngine
+{
+	//Copies the 4x4 block at (blockX, blockY) row by row, texels past the right and bottom edge repeat the last column and row
+	static void LoadBlock(const BlockCompressor::Level& level, uint blockX, uint blockY, Pixel* pBlock)
+	{
+		uint x = blockX * 4;
+		uint y = blockY * 4;
+		if (x + 4 <= level.Width && y + 4 <= level.Height)
+		{
+			const Pixel* pRow = &level.pPixels[y * level.Width + x];
+			for (uint i = 0; i < 4; i++, pRow += level.Width)
+				memcpy(&pBlock[i * 4], pRow, sizeof(Pixel) * 4);
+		}
+		else
+		{
+			for (uint i = 0; i < 4; i++)
+			{
+				uint iy = y + i < level.Height ? y + i : level.Height - 1;
+				for (uint j = 0; j < 4; j++)
+				{
+					uint jx = x + j < level.Width ? x + j : level.Width - 1;
+					pBlock[i * 4 + j] = level.pPixels[iy * level.Width + jx];
+				}
+			}
+		}
+	}
+
+#ifdef BLOCK_COMPRESSOR_SSE
+	//Pixel in the low 32 bits of a register, bytes are in memory order so R is the lowest
+	static Pixel ToPixel(__m128i packed)
+	{
+		uint rgba = (uint)_mm_cvtsi128_si32(packed);
+		Pixel color;
+		color.R = (uchar)(rgba & 0xFF);
+		color.G = (uchar)((rgba >> 8) & 0xFF);
+		color.B = (uchar)((rgba >> 16) & 0xFF);
+		color.A = (uchar)(rgba >> 24);
+		return color;
+	}
+#endif
+
+	//Per channel min and max of the 16 texels
+	static void GetBlockBounds(const Pixel* pBlock, Pixel& minColor, Pixel& maxColor)
+	{
+#ifdef BLOCK_COMPRESSOR_SSE
+		__m128i row0 = _mm_loadu_si128((const __m128i*)&pBlock[0]);
+		__m128i row1 = _mm_loadu_si128((const __m128i*)&pBlock[4]);
+		__m128i row2 = _mm_loadu_si128((const __m128i*)&pBlock[8]);
+		__m128i row3 = _mm_loadu_si128((const __m128i*)&pBlock[12]);
+
+		__m128i minRows = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+		__m128i maxRows = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+		minRows = _mm_min_epu8(minRows, _mm_shuffle_epi32(minRows, _MM_SHUFFLE(1, 0, 3, 2)));
+		maxRows = _mm_max_epu8(maxRows, _mm_shuffle_epi32(maxRows, _MM_SHUFFLE(1, 0, 3, 2)));
+		minRows = _mm_min_epu8(minRows, _mm_shuffle_epi32(minRows, _MM_SHUFFLE(2, 3, 0, 1)));
+		maxRows = _mm_max_epu8(maxRows, _mm_shuffle_epi32(maxRows, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		minColor = ToPixel(minRows);
+		maxColor = ToPixel(maxRows);
+#else
+		minColor = pBlock[0];
+		maxColor = pBlock[0];
+		for (uint i = 1; i < 16; i++)
+		{
+			const uchar* pTexel = &pBlock[i].R;
+			uchar* pMin = &minColor.R;
+			uchar* pMax = &maxColor.R;
+			for (uint c = 0; c < 4; c++)
+			{
+				pMin[c] = pTexel[c] < pMin[c] ? pTexel[c] : pMin[c];
+				pMax[c] = pTexel[c] > pMax[c] ? pTexel[c] : pMax[c];
+			}
+		}
+#endif
+	}
+
+	static ushort To565(const Pixel& color)
+	{
+		return (ushort)(((color.R >> 3) << 11) | ((color.G >> 2) << 5) | (color.B >> 3));
+	}
+
+	static void From565(ushort color, int* pRGB)
+	{
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		pRGB[0] = (r << 3) | (r >> 2);
+		pRGB[1] = (g << 2) | (g >> 4);
+		pRGB[2] = (b << 3) | (b >> 2);
+	}
+
+	//BC1 color block with endpoints on the bounding box of the block, inset by 1/16 of its extent so they sit closer to the texels
+	static void EncodeColorFast(const Pixel* pBlock, const Pixel& minColor, const Pixel& maxColor, uchar* pDst)
+	{
+		Pixel lo = minColor;
+		Pixel hi = maxColor;
+		uchar* pLo = &lo.R;
+		uchar* pHi = &hi.R;
+		for (uint c = 0; c < 3; c++)
+		{
+			int inset = (pHi[c] - pLo[c]) >> 4;
+			pLo[c] = (uchar)(pLo[c] + inset);
+			pHi[c] = (uchar)(pHi[c] - inset);
+		}
+
+		//color0 > color1 selects the four color mode, which BC3 always uses
+		ushort color0 = To565(hi);
+		ushort color1 = To565(lo);
+		if (color0 < color1)
+		{
+			ushort tmp = color0;
+			color0 = color1;
+			color1 = tmp;
+		}
+
+		uint indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			From565(color0, palette[0]);
+			From565(color1, palette[1]);
+			for (uint c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (uint i = 0; i < 16; i++)
+			{
+				const Pixel& texel = pBlock[i];
+				uint bestIndex = 0;
+				int bestDist = 3 * 256 * 256;
+				for (uint p = 0; p < 4; p++)
+				{
+					int dr = texel.R - palette[p][0];
+					int dg = texel.G - palette[p][1];
+					int db = texel.B - palette[p][2];
+					int dist = dr * dr + dg * dg + db * db;
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (i * 2);
+			}
+		}
+
+		pDst[0] = (uchar)(color0 & 0xff);
+		pDst[1] = (uchar)(color0 >> 8);
+		pDst[2] = (uchar)(color1 & 0xff);
+		pDst[3] = (uchar)(color1 >> 8);
+		for (uint i = 0; i < 4; i++)
+			pDst[4 + i] = (uchar)(indices >> (i * 8));
+	}
+
+	//BC3 alpha and BC4 block in the eight value mode with the range of one channel as endpoints, channel indexes RGBA
+	static void EncodeChannelFast(const Pixel* pBlock, uint channel, uchar minValue, uchar maxValue, uchar* pDst)
+	{
+		pDst[0] = maxValue;
+		pDst[1] = minValue;
+
+		unsigned long long indices = 0;
+		int range = maxValue - minValue;
+		if (range)
+		{
+			for (uint i = 0; i < 16; i++)
+			{
+				//position on the ramp from min (0) to max (7), index 0 is value0 = max, 1 is value1 = min and 2-7 step from max to min
+				int step = (((&pBlock[i].R)[channel] - minValue) * 14 + range) / (2 * range);
+				unsigned long long index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+				indices |= index << (i * 3);
+			}
+		}
+
+		for (uint i = 0; i < 6; i++)
+			pDst[2 + i] = (uchar)(indices >> (i * 8));
+	}
+
+	//BC4 and BC5 blocks through stb's fit, which searches both the six and eight value modes
+	static void EncodeChannelStb(const Pixel* pBlock, uint channel, uchar* pDst)
+	{
+		uchar values[16];
+		for (uint i = 0; i < 16; i++)
+			values[i] = (&pBlock[i].R)[channel];
+		stb_compress_bc4_block(pDst, values);
+	}
+
+	//BC7 mode 6 stores one RGBA line per block with 7 bit endpoints, a p-bit per endpoint and 4 bit indices
+	static const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BC7Endpoints
+	{
+		int Quantized[2][4]; //7 bit
+		int PBits[2];
+		int Values[2][4]; //8 bit values the quantized endpoints decode to
+	};
+
+	//Picks the p-bit of an endpoint that lands all four channels closest to the unquantized values
+	static void QuantizeBC7Endpoint(const float* pValue, int* pQuantized, int& pBit, int* pDecoded)
+	{
+		float bestError = FLT_MAX;
+		for (int p = 0; p < 2; p++)
+		{
+			int quantized[4];
+			float error = 0.0f;
+			for (uint c = 0; c < 4; c++)
+			{
+				int q = (int)floorf((pValue[c] - p) * 0.5f + 0.5f);
+				quantized[c] = q < 0 ? 0 : (q > 127 ? 127 : q);
+				float diff = (float)((quantized[c] << 1) | p) - pValue[c];
+				error += diff * diff;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				for (uint c = 0; c < 4; c++)
+				{
+					pQuantized[c] = quantized[c];
+					pDecoded[c] = (quantized[c] << 1) | p;
+				}
+			}
+		}
+	}
+
+	//Assigns every texel its closest palette entry and returns the squared error of the block
+	static uint FindBC7Indices(const Pixel* pBlock, const BC7Endpoints& endpoints, uint* pIndices)
+	{
+		int palette[16][4];
+		for (uint i = 0; i < 16; i++)
+		{
+			for (uint c = 0; c < 4; c++)
+				palette[i][c] = ((64 - BC7Weights[i]) * endpoints.Values[0][c] + BC7Weights[i] * endpoints.Values[1][c] + 32) >> 6;
+		}
+
+		int axis[4];
+		int axisLengthSq = 0;
+		for (uint c = 0; c < 4; c++)
+		{
+			axis[c] = endpoints.Values[1][c] - endpoints.Values[0][c];
+			axisLengthSq += axis[c] * axis[c];
+		}
+
+		uint totalError = 0;
+		for (uint i = 0; i < 16; i++)
+		{
+			const uchar* pTexel = &pBlock[i].R;
+
+			//projecting onto the line gives the nearest index up to rounding of the palette, so only its neighbours are compared
+			int guess = 0;
+			if (axisLengthSq)
+			{
+				int dot = 0;
+				for (uint c = 0; c < 4; c++)
+					dot += (pTexel[c] - endpoints.Values[0][c]) * axis[c];
+				guess = (int)floorf(dot * 15.0f / axisLengthSq + 0.5f);
+				guess = guess < 0 ? 0 : (guess > 15 ? 15 : guess);
+			}
+
+			uint bestIndex = guess;
+			uint bestError = UINT_MAX;
+			for (int index = guess - 1; index <= guess + 1; index++)
+			{
+				if (index < 0 || index > 15)
+					continue;
+
+				uint error = 0;
+				for (uint c = 0; c < 4; c++)
+				{
+					int diff = pTexel[c] - palette[index][c];
+					error += diff * diff;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = index;
+				}
+			}
+
+			pIndices[i] = bestIndex;
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	//Least squares fit of the endpoints to the texels for fixed indices, returns false when every texel uses the same index
+	static bool RefineBC7Endpoints(const Pixel* pBlock, const uint* pIndices, float* pEndpoint0, float* pEndpoint1)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (uint i = 0; i < 16; i++)
+		{
+			float b = BC7Weights[pIndices[i]] / 64.0f;
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint c = 0; c < 4; c++)
+			{
+				ax[c] += a * (&pBlock[i].R)[c];
+				bx[c] += b * (&pBlock[i].R)[c];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f)
+			return false;
+
+		float invDet = 1.0f / det;
+		for (uint c = 0; c < 4; c++)
+		{
+			pEndpoint0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) * invDet, 0.0f), 255.0f);
+			pEndpoint1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) * invDet, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	static void WriteBits(uchar* pDst, uint& bitOffset, uint value, uint bitCount)
+	{
+		for (uint i = 0; i < bitCount; i++, bitOffset++)
+		{
+			if (value & (1u << i))
+				pDst[bitOffset >> 3] |= (uchar)(1u << (bitOffset & 7));
+		}
+	}
+
+	static void EncodeBC7(const Pixel* pBlock, BlockCompressor::Quality quality, uchar* pDst)
+	{
+		float endpoints[2][4];
+		if (quality == BlockCompressor::QUALITY_FAST)
+		{
+			Pixel minColor, maxColor;
+			GetBlockBounds(pBlock, minColor, maxColor);
+			for (uint c = 0; c < 4; c++)
+			{
+				endpoints[0][c] = (&minColor.R)[c];
+				endpoints[1][c] = (&maxColor.R)[c];
+			}
+		}
+		else
+		{
+			//endpoints start at the extent of the texels along the principal axis of the block
+			float mean[4] = {};
+			for (uint i = 0; i < 16; i++)
+			{
+				for (uint c = 0; c < 4; c++)
+					mean[c] += (&pBlock[i].R)[c] / 16.0f;
+			}
+
+			float covariance[4][4] = {};
+			for (uint i = 0; i < 16; i++)
+			{
+				float d[4];
+				for (uint c = 0; c < 4; c++)
+					d[c] = (&pBlock[i].R)[c] - mean[c];
+				for (uint r = 0; r < 4; r++)
+				{
+					for (uint c = 0; c < 4; c++)
+						covariance[r][c] += d[r] * d[c];
+				}
+			}
+
+			float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			for (uint iteration = 0; iteration < 8; iteration++)
+			{
+				float next[4] = {};
+				float lengthSq = 0.0f;
+				for (uint r = 0; r < 4; r++)
+				{
+					for (uint c = 0; c < 4; c++)
+						next[r] += covariance[r][c] * axis[c];
+					lengthSq += next[r] * next[r];
+				}
+
+				if (lengthSq < 1e-12f)
+					break;
+
+				float invLength = 1.0f / sqrtf(lengthSq);
+				for (uint c = 0; c < 4; c++)
+					axis[c] = next[c] * invLength;
+			}
+
+			float minT = FLT_MAX, maxT = -FLT_MAX;
+			for (uint i = 0; i < 16; i++)
+			{
+				float t = 0.0f;
+				for (uint c = 0; c < 4; c++)
+					t += ((&pBlock[i].R)[c] - mean[c]) * axis[c];
+				minT = fminf(minT, t);
+				maxT = fmaxf(maxT, t);
+			}
+
+			for (uint c = 0; c < 4; c++)
+			{
+				endpoints[0][c] = fminf(fmaxf(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+				endpoints[1][c] = fminf(fmaxf(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+			}
+		}
+
+		BC7Endpoints best;
+		uint bestIndices[16];
+		QuantizeBC7Endpoint(endpoints[0], best.Quantized[0], best.PBits[0], best.Values[0]);
+		QuantizeBC7Endpoint(endpoints[1], best.Quantized[1], best.PBits[1], best.Values[1]);
+		uint bestError = FindBC7Indices(pBlock, best, bestIndices);
+
+		uint refinements = quality == BlockCompressor::QUALITY_HIGH ? 3 : (quality == BlockCompressor::QUALITY_NORMAL ? 1 : 0);
+		for (uint i = 0; i < refinements && bestError; i++)
+		{
+			if (!RefineBC7Endpoints(pBlock, bestIndices, endpoints[0], endpoints[1]))
+				break;
+
+			BC7Endpoints candidate;
+			uint indices[16];
+			QuantizeBC7Endpoint(endpoints[0], candidate.Quantized[0], candidate.PBits[0], candidate.Values[0]);
+			QuantizeBC7Endpoint(endpoints[1], candidate.Quantized[1], candidate.PBits[1], candidate.Values[1]);
+			uint error = FindBC7Indices(pBlock, candidate, indices);
+			if (error >= bestError)
+				break;
+
+			best = candidate;
+			bestError = error;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+
+		//the first index drops its top bit, so the endpoints are swapped when it is set
+		if (bestIndices[0] & 8)
+		{
+			for (uint c = 0; c < 4; c++)
+			{
+				int tmp = best.Quantized[0][c];
+				best.Quantized[0][c] = best.Quantized[1][c];
+				best.Quantized[1][c] = tmp;
+			}
+
+			int tmp = best.PBits[0];
+			best.PBits[0] = best.PBits[1];
+			best.PBits[1] = tmp;
+
+			for (uint i = 0; i < 16; i++)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		memset(pDst, 0, 16);
+		uint bitOffset = 0;
+		WriteBits(pDst, bitOffset, 1 << 6, 7);
+		for (uint c = 0; c < 4; c++)
+		{
+			WriteBits(pDst, bitOffset, best.Quantized[0][c], 7);
+			WriteBits(pDst, bitOffset, best.Quantized[1][c], 7);
+		}
+		WriteBits(pDst, bitOffset, best.PBits[0], 1);
+		WriteBits(pDst, bitOffset, best.PBits[1], 1);
+		for (uint i = 0; i < 16; i++)
+			WriteBits(pDst, bitOffset, bestIndices[i], i == 0 ? 3 : 4);
+	}
+
+	static void EncodeDXT(const Pixel* pBlock, bool alpha, BlockCompressor::Quality quality, uchar* pDst)
+	{
+		if (quality == BlockCompressor::QUALITY_FAST)
+		{
+			Pixel minColor, maxColor;
+			GetBlockBounds(pBlock, minColor, maxColor);
+			if (alpha)
+			{
+				EncodeChannelFast(pBlock, 3, minColor.A, maxColor.A, pDst);
+				pDst += 8;
+			}
+			EncodeColorFast(pBlock, minColor, maxColor, pDst);
+		}
+		else
+		{
+			stb_compress_dxt_block(pDst, &pBlock[0].R, alpha ? 1 : 0, quality == BlockCompressor::QUALITY_HIGH ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL);
+		}
+	}
+
+	//BC4 encodes red, BC5 encodes red and then green as two BC4 blocks
+	static void EncodeChannels(const Pixel* pBlock, uint channelCount, BlockCompressor::Quality quality, uchar* pDst)
+	{
+		Pixel minColor, maxColor;
+		if (quality == BlockCompressor::QUALITY_FAST)
+			GetBlockBounds(pBlock, minColor, maxColor);
+
+		for (uint c = 0; c < channelCount; c++, pDst += 8)
+		{
+			if (quality == BlockCompressor::QUALITY_FAST)
+				EncodeChannelFast(pBlock, c, (&minColor.R)[c], (&maxColor.R)[c], pDst);
+			else
+				EncodeChannelStb(pBlock, c, pDst);
+		}
+	}
+
+	static void EncodeBlock(const Pixel* pBlock, uint format, BlockCompressor::Quality quality, uchar* pDst)
+	{
+		switch (format)
+		{
+		case ImageData::COMPRESSED_BC1:
+			EncodeDXT(pBlock, false, quality, pDst);
+			break;
+		case ImageData::COMPRESSED_BC3:
+			EncodeDXT(pBlock, true, quality, pDst);
+			break;
+		case ImageData::COMPRESSED_BC4:
+			EncodeChannels(pBlock, 1, quality, pDst);
+			break;
+		case ImageData::COMPRESSED_BC5:
+			EncodeChannels(pBlock, 2, quality, pDst);
+			break;
+		case ImageData::COMPRESSED_BC7:
+			EncodeBC7(pBlock, quality, pDst);
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool BlockCompressor::Compress(const Level* pLevels, uint levelCount, uint format, Quality quality, bool threaded)
+	{
+		uint pixelsPerBlock = GetCompressedPixelCount(format, 4, 4);
+		if (pixelsPerBlock == 0)
+			return false;
+
+		//block rows of all levels are numbered one after another, firstRows[i] is the first row of level i
+		Vector<uint> firstRows;
+		firstRows.resize(levelCount + 1);
+		firstRows[0] = 0;
+		for (uint i = 0; i < levelCount; i++)
+			firstRows[i + 1] = firstRows[i] + (pLevels[i].Height + 3) / 4;
+
+		auto compressRows = [&](uint, uint begin, uint end) -> void {
+			Pixel block[16];
+			uint levelIndex = 0;
+			for (uint row = begin; row < end; row++)
+			{
+				while (row >= firstRows[levelIndex + 1])
+					levelIndex++;
+
+				const Level& level = pLevels[levelIndex];
+				uint blockY = row - firstRows[levelIndex];
+				uint blocksX = (level.Width + 3) / 4;
+				Pixel* pDst = &level.pBlocks[blockY * blocksX * pixelsPerBlock];
+				for (uint blockX = 0; blockX < blocksX; blockX++, pDst += pixelsPerBlock)
+				{
+					LoadBlock(level, blockX, blockY, block);
+					EncodeBlock(block, format, quality, &pDst->R);
+				}
+			}
+		};
+
+		if (threaded)
+			ThreadPool::Get().ParallelForRange(0, firstRows[levelCount], 1, compressRows);
+		else
+			ThreadPool::Get().RunOnCallingThread([&](uint threadIndex) -> void { compressRows(threadIndex, 0, firstRows[levelCount]); });
+
+		return true;
+	}
+
+	uint BlockCompressor::GetCompressedPixelCount(uint format, uint width, uint height)
+	{
+		//a block is 8 bytes for BC1 and BC4 and 16 bytes for the rest, each Pixel is 4 bytes
+		uint blockCount = ((width + 3) / 4) * ((height + 3) / 4);
+		switch (format)
+		{
+		case ImageData::COMPRESSED_BC1:
+		case ImageData::COMPRESSED_BC4:
+			return blockCount * 2;
+		case ImageData::COMPRESSED_BC3:
+		case ImageData::COMPRESSED_BC5:
+		case ImageData::COMPRESSED_BC7:
+			return blockCount * 4;
+		default:
+			return 0;
+		}
+	}
+}
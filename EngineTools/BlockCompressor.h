@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Pixel.h"
+
+namespace SunEngine
+{
+	class BlockCompressor
+	{
+	public:
+		//Fast fits endpoints to the block's bounding box. For BC1/BC3/BC4/BC5 normal and high run stb's fits, for BC7 they
+		//fit the principal axis and refine the endpoints by least squares once or three times
+		enum Quality
+		{
+			QUALITY_FAST,
+			QUALITY_NORMAL,
+			QUALITY_HIGH,
+		};
+
+		//Uncompressed source texels and the blocks they are written to, pBlocks holds GetCompressedPixelCount texels
+		struct Level
+		{
+			const Pixel* pPixels;
+			uint Width;
+			uint Height;
+			Pixel* pBlocks;
+		};
+
+		//format is one of the ImageData::COMPRESSED_BC flags, block rows of every level are split across the
+		//pool together so the small levels of a mip chain don't run one after another
+		static bool Compress(const Level* pLevels, uint levelCount, uint format, Quality quality, bool threaded = true);
+
+		//Size of the compressed image in texels with the dimensions padded up to whole blocks
+		static uint GetCompressedPixelCount(uint format, uint width, uint height);
+	};
+}
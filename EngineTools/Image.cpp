@@ -13,9 +13,22 @@
 #include "FileBase.h"
 #include "StringUtil.h"
 #include "MemBuffer.h"
+#include "PixelKernels.h"
+#include "ThreadPool.h"
 
 #include "Image.h"
 
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define IMAGE_F16C
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_SSE
+#include <emmintrin.h>
+#endif
+
 namespace SunEngine
 {
 	typedef uint(*QueryCompressedSize)(uint width, uint height);
@@ -25,7 +38,13 @@ namespace SunEngine
 		{ ImageData::NONE, [](uint width, uint height) -> uint { return width * height; } },
 		{ ImageData::COMPRESSED_BC1, [](uint width, uint height) -> uint { return (width * height / 16) * 2; } },
 		{ ImageData::COMPRESSED_BC3, [](uint width, uint height) -> uint { return (width * height / 16) * 4; } },
+		{ ImageData::COMPRESSED_BC4, [](uint width, uint height) -> uint { return (width * height / 16) * 2; } },
+		{ ImageData::COMPRESSED_BC5, [](uint width, uint height) -> uint { return (width * height / 16) * 4; } },
+		{ ImageData::COMPRESSED_BC7, [](uint width, uint height) -> uint { return (width * height / 16) * 4; } },
 		{ ImageData::SAMPLED_TEXTURE_R32G32B32A32F, [](uint width, uint height) -> uint { return (width * height) * 4; } },
+		{ ImageData::SAMPLED_TEXTURE_R16G16B16A16F, [](uint width, uint height) -> uint { return (width * height) * 2; } },
+		{ ImageData::SAMPLED_TEXTURE_R16, [](uint width, uint height) -> uint { return (width * height + 1) / 2; } },
+		{ ImageData::SAMPLED_TEXTURE_R8G8, [](uint width, uint height) -> uint { return (width * height + 1) / 2; } },
 	};
 
 	struct TGAHeader
@@ -49,6 +68,7 @@ namespace SunEngine
 		_width = 0;
 		_height = 0;
 		_pixels = 0;
+		_ownsPixels = true;
 		_internalFlags = 0;
 	}
 
@@ -61,6 +81,26 @@ namespace SunEngine
 	bool Image::Load(const String& filename)
 	{
 		int width, height, comp;
+		if (stbi_is_hdr(filename.data()))
+		{
+			float* values = stbi_loadf(filename.data(), &width, &height, &comp, STBI_rgb_alpha);
+			if (values == 0)
+				return false;
+
+			//half floats keep the range of the file at half the size of floats
+			Pixel* halfs = (Pixel*)STBI_MALLOC(FormatSizeFuncs.at(ImageData::SAMPLED_TEXTURE_R16G16B16A16F)(width, height) * sizeof(Pixel));
+			FloatToHalf(values, (ushort*)halfs, (uint)(width * height * 4));
+			STBI_FREE(values);
+
+			CleanUp();
+			_pixels = halfs;
+			_width = (uint)width;
+			_height = (uint)height;
+			_internalFlags &= ~(ImageData::SRGB | ImageData::SAMPLED_TEXTURE_R32G32B32A32F);
+			_internalFlags |= ImageData::SAMPLED_TEXTURE_R16G16B16A16F;
+			return true;
+		}
+
 		stbi_uc* pixels = stbi_load(filename.data(), &width, &height, &comp, STBI_rgb_alpha);
 
 		if (pixels == 0)
@@ -135,7 +175,7 @@ namespace SunEngine
 		if (data.Pixels == _pixels)
 		{
 			//null out member so we don't delete it
-			resizing = true;
+			resizing = _ownsPixels;
 			_pixels = 0;
 		}
 
@@ -179,12 +219,34 @@ namespace SunEngine
 		return true;
 	}
 
-	bool Image::Resize(uint width, uint height)
+	bool Image::Resize(uint width, uint height, ImageResampler::Filter filter, bool threaded)
 	{
 		if (width == _width && height == _height)
 			return true;
 
-		return CreateFrom(ImageData(), width, height);
+		if (_pixels == 0 || width == 0 || height == 0)
+			return false;
+
+		if (_internalFlags & (SunEngine::ImageData::SAMPLED_TEXTURE_R16 | SunEngine::ImageData::SAMPLED_TEXTURE_R8G8))
+			return false;
+
+		if (IsCompressed() || (_internalFlags & (SunEngine::ImageData::COLOR_BUFFER_RGBA16F | SunEngine::ImageData::SAMPLED_TEXTURE_R32F)))
+			return CreateFrom(ImageData(), width, height);
+
+		uint bufferSize = FormatSizeFuncs.at(GetImageFormat(_internalFlags))(width, height) * sizeof(Pixel);
+		SunEngine::ImageData resized(width, height, (Pixel*)STBI_MALLOC(bufferSize), _internalFlags);
+		uint modes = (_internalFlags & SunEngine::ImageData::SRGB) ? ImageResampler::MODE_SRGB : ImageResampler::MODE_DEFAULT;
+		if (!ImageResampler::Resample(ImageData(), resized, filter, modes, threaded))
+		{
+			STBI_FREE(resized.Pixels);
+			return false;
+		}
+
+		CleanUp();
+		_pixels = resized.Pixels;
+		_width = width;
+		_height = height;
+		return true;
 	}
 
 	bool Image::TransferFrom(SunEngine::ImageData& data)
@@ -203,14 +265,90 @@ namespace SunEngine
 	void Image::SwapRB()
 	{
 		if (_pixels)
+			PixelKernels::SwapRB(_pixels, _width * _height);
+	}
+
+	//Reads count texels of an RGBA8, RGBA16F or RGBA32F buffer starting at texel index as 4 floats each
+	static void ReadTexels(const Pixel* pPixels, uint format, uint index, uint count, const float* pByteToFloat, float* pOut)
+	{
+		if (format == ImageData::SAMPLED_TEXTURE_R32G32B32A32F)
+		{
+			memcpy(pOut, (const float*)pPixels + index * 4, count * 4 * sizeof(float));
+		}
+		else if (format == ImageData::SAMPLED_TEXTURE_R16G16B16A16F)
+		{
+			HalfToFloat((const ushort*)pPixels + index * 4, pOut, count * 4);
+		}
+		else
 		{
-			for (uint i = 0; i < _width * _height; i++)
+			const uchar* pBytes = &pPixels[index].R;
+			for (uint i = 0; i < count * 4; i++)
+				pOut[i] = pByteToFloat[pBytes[i]];
+		}
+	}
+
+	static void WriteTexels(const float* pIn, uint count, uint format, uint index, Pixel* pPixels)
+	{
+		if (format == ImageData::SAMPLED_TEXTURE_R32G32B32A32F)
+		{
+			memcpy((float*)pPixels + index * 4, pIn, count * 4 * sizeof(float));
+		}
+		else if (format == ImageData::SAMPLED_TEXTURE_R16G16B16A16F)
+		{
+			FloatToHalf(pIn, (ushort*)pPixels + index * 4, count * 4);
+		}
+		else
+		{
+			uchar* pBytes = &pPixels[index].R;
+			for (uint i = 0; i < count * 4; i++)
+				pBytes[i] = (uchar)lrintf(fmaxf(fminf(pIn[i], 1.0f), 0.0f) * 255.0f);
+		}
+	}
+
+	bool Image::ConvertFormat(uint format, bool threaded)
+	{
+		if (format != 0 && format != ImageData::SAMPLED_TEXTURE_R16G16B16A16F && format != ImageData::SAMPLED_TEXTURE_R32G32B32A32F)
+			return false;
+
+		//blocks, single floats and two byte texels don't hold four channels to convert
+		if (_pixels == 0 || IsCompressed() || (_internalFlags & (ImageData::SAMPLED_TEXTURE_R32F | ImageData::SAMPLED_TEXTURE_R16 | ImageData::SAMPLED_TEXTURE_R8G8)))
+			return false;
+
+		uint current = GetImageFormat(_internalFlags);
+		if (current == format)
+			return true;
+
+		float byteToFloat[256];
+		for (uint i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			byteToFloat[i] = (_internalFlags & ImageData::SRGB) ? (c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f)) : c;
+		}
+
+		Pixel* pConverted = (Pixel*)STBI_MALLOC(FormatSizeFuncs.at(format)(_width, _height) * sizeof(Pixel));
+		PerThreadData<Vector<float>> rows;
+		auto convertRows = [&](uint threadIndex, uint begin, uint end) -> void {
+			Vector<float>& row = rows[threadIndex];
+			row.resize(_width * 4);
+			for (uint y = begin; y < end; y++)
 			{
-				uchar tmp = _pixels[i].R;
-				_pixels[i].R = _pixels[i].B;
-				_pixels[i].B = tmp;
+				ReadTexels(_pixels, current, y * _width, _width, byteToFloat, row.data());
+				WriteTexels(row.data(), _width, format, y * _width, pConverted);
 			}
-		}
+		};
+
+		if (threaded)
+			ThreadPool::Get().ParallelForRange(0, _height, 16, convertRows);
+		else
+			ThreadPool::Get().RunOnCallingThread([&](uint threadIndex) -> void { convertRows(threadIndex, 0, _height); });
+
+		if (_ownsPixels)
+			STBI_FREE(_pixels);
+		_pixels = pConverted;
+		_ownsPixels = true;
+		_internalFlags &= ~(ImageData::SRGB | ImageData::SAMPLED_TEXTURE_R16G16B16A16F | ImageData::SAMPLED_TEXTURE_R32G32B32A32F);
+		_internalFlags |= format;
+		return true;
 	}
 		 
 	uint Image::Width() const
@@ -292,15 +430,9 @@ namespace SunEngine
 
 		Vector<Pixel> filePixels;
 		filePixels.resize(_width * _height);
+		static const uchar bgra[4] = { 2, 1, 0, 3 };
 		for (uint y = 0; y < _height; y++)
-		{
-			for (uint x = 0; x < _width; x++)
-			{
-				Pixel p = GetPixel(x, _height - y - 1);
-				p.SwapRB();
-				filePixels[y * _width + x] = p;
-			}
-		}
+			PixelKernels::Swizzle(&_pixels[(_height - y - 1) * _width], &filePixels[y * _width], _width, bgra);
 		fw.Write(filePixels.data(), sizeof(Pixel) * filePixels.size());
 
 		fw.Close();
@@ -327,10 +459,12 @@ namespace SunEngine
 	{
 		if (_pixels)
 		{
-			STBI_FREE(_pixels);
+			if (_ownsPixels)
+				STBI_FREE(_pixels);
 			_pixels = 0;
 		}
 
+		_ownsPixels = true;
 		_width = 0;
 		_height = 0;
 	}
@@ -378,6 +512,23 @@ namespace SunEngine
 		if (!stream.Read(_internalFlags))
 			return false;
 
+		if (_width && _height)
+		{
+			uint bufferSize = FormatSizeFuncs.at(GetImageFormat(_internalFlags))(_width, _height) * sizeof(Pixel);
+			const void* pView = stream.ReadView(bufferSize);
+			if (pView)
+			{
+				uint width = _width;
+				uint height = _height;
+				CleanUp();
+				_pixels = (Pixel*)pView;
+				_ownsPixels = false;
+				_width = width;
+				_height = height;
+				return true;
+			}
+		}
+
 		Allocate(_width, _height, 0, _internalFlags);
 		if (_pixels)
 		{
@@ -389,76 +540,80 @@ namespace SunEngine
 		return true;
 	}
 
-	bool Image::Compress()
+	bool Image::Compress(BlockCompressor::Quality quality, bool threaded, uint format)
+	{
+		Image* pThis = this;
+		return CompressChain(&pThis, 1, quality, threaded, format);
+	}
+
+	bool Image::CompressChain(Image* const* ppImages, uint count, BlockCompressor::Quality quality, bool threaded, uint format)
 	{
-		uint widthPadded = 4 * ((_width + 3) / 4);
-		uint heightPadded = 4 * ((_height + 3) / 4);
+		if (count == 0 || ppImages[0]->_pixels == 0 || ppImages[0]->IsCompressed() || ppImages[0]->IsFloat())
+			return false;
+
+		if (ppImages[0]->_internalFlags & (ImageData::SAMPLED_TEXTURE_R16 | ImageData::SAMPLED_TEXTURE_R8G8))
+			return false;
 
-		uchar alpha = _pixels[0].A;
-		int compressAlpha = 0;
-		for (uint i = 1; i < _width * _height; i++)
+		//the base image picks the format so every level of the chain matches
+		if (format == 0)
 		{
-			if (alpha != _pixels[i].A)
+			const Image* pBase = ppImages[0];
+			uchar alpha = pBase->_pixels[0].A;
+			format = ImageData::COMPRESSED_BC1;
+			for (uint i = 1; i < pBase->_width * pBase->_height; i++)
 			{
-				compressAlpha = 1;
-				break;
+				if (alpha != pBase->_pixels[i].A)
+				{
+					format = ImageData::COMPRESSED_BC3;
+					break;
+				}
 			}
 		}
 
-		//compressAlpha = 1 - compressAlpha;
-
-		if (compressAlpha == 0)
-			_internalFlags |= ImageData::COMPRESSED_BC1;
-		else
-			_internalFlags |= ImageData::COMPRESSED_BC3;
-
-		Pixel srcBlock[16];
-		Pixel dstBlock[4]; //2 = no alpha, 4 = alpha
-
-		uint compressedPixelCount = FormatSizeFuncs.at(GetImageFormat(_internalFlags))(widthPadded, heightPadded);
-		Pixel* dstPixels = new Pixel[compressedPixelCount];
-		//dstPixels.resize(compressedSize);
-		uint compressedCounter = 0;
-
-		uint pixelsPerBlock = FormatSizeFuncs.at(GetImageFormat(_internalFlags))(4, 4);
+		if (BlockCompressor::GetCompressedPixelCount(format, 4, 4) == 0)
+			return false;
 
-		for (uint y = 0; y < heightPadded; y += 4)
+		Vector<BlockCompressor::Level> levels;
+		levels.resize(count);
+		for (uint i = 0; i < count; i++)
 		{
-			for (uint x = 0; x < widthPadded; x += 4)
-			{
-				for (uint i = 0; i < 4; i++)
-				{
-					uint iy = i + y;
-					if (iy >= _height) iy = _height - 1;
-					for (uint j = 0; j < 4; j++)
-					{
-						uint jx = j + x;
-						if (jx >= _width) jx = _width - 1;
-							
-						srcBlock[i * 4 + j] = GetPixel(jx, iy);
-					}
-				}
+			const Image* pImage = ppImages[i];
+			levels[i].pPixels = pImage->_pixels;
+			levels[i].Width = pImage->_width;
+			levels[i].Height = pImage->_height;
+			levels[i].pBlocks = (Pixel*)STBI_MALLOC(BlockCompressor::GetCompressedPixelCount(format, pImage->_width, pImage->_height) * sizeof(Pixel));
+		}
 
-				stb_compress_dxt_block(&dstBlock[0].R, &srcBlock[0].R, compressAlpha, STB_DXT_HIGHQUAL);
+		if (!BlockCompressor::Compress(levels.data(), count, format, quality, threaded))
+		{
+			for (uint i = 0; i < count; i++)
+				STBI_FREE(levels[i].pBlocks);
+			return false;
+		}
 
-				for (uint i = 0; i < pixelsPerBlock; i++)
-				{
-					dstPixels[compressedCounter++] = dstBlock[i];
-				}
-			}
+		for (uint i = 0; i < count; i++)
+		{
+			Image* pImage = ppImages[i];
+			if (pImage->_ownsPixels)
+				STBI_FREE(pImage->_pixels);
+			pImage->_pixels = levels[i].pBlocks;
+			pImage->_ownsPixels = true;
+			pImage->_width = 4 * ((pImage->_width + 3) / 4);
+			pImage->_height = 4 * ((pImage->_height + 3) / 4);
+			pImage->_internalFlags |= format;
 		}
-		
-		delete[] _pixels;
-		_pixels = dstPixels;
-		_width = widthPadded;
-		_height = heightPadded;
 
 		return true;
 	}
 
 	bool Image::IsCompressed() const
 	{
-		return _internalFlags & (ImageData::COMPRESSED_BC1 | ImageData::COMPRESSED_BC3);
+		return _internalFlags & (ImageData::COMPRESSED_BC1 | ImageData::COMPRESSED_BC3 | ImageData::COMPRESSED_BC4 | ImageData::COMPRESSED_BC5 | ImageData::COMPRESSED_BC7);
+	}
+
+	bool Image::IsFloat() const
+	{
+		return _internalFlags & (ImageData::SAMPLED_TEXTURE_R16G16B16A16F | ImageData::SAMPLED_TEXTURE_R32F | ImageData::SAMPLED_TEXTURE_R32G32B32A32F);
 	}
 
 	bool Image::CanLoad(const String& path)
@@ -508,10 +663,28 @@ namespace SunEngine
 
 		if (flags & ImageData::COMPRESSED_BC3)
 			return ImageData::COMPRESSED_BC3;
+
+		if (flags & ImageData::COMPRESSED_BC4)
+			return ImageData::COMPRESSED_BC4;
+
+		if (flags & ImageData::COMPRESSED_BC5)
+			return ImageData::COMPRESSED_BC5;
+
+		if (flags & ImageData::COMPRESSED_BC7)
+			return ImageData::COMPRESSED_BC7;
 	
 		if (flags & ImageData::SAMPLED_TEXTURE_R32G32B32A32F)
 			return ImageData::SAMPLED_TEXTURE_R32G32B32A32F;
 
+		if (flags & ImageData::SAMPLED_TEXTURE_R16G16B16A16F)
+			return ImageData::SAMPLED_TEXTURE_R16G16B16A16F;
+
+		if (flags & ImageData::SAMPLED_TEXTURE_R16)
+			return ImageData::SAMPLED_TEXTURE_R16;
+
+		if (flags & ImageData::SAMPLED_TEXTURE_R8G8)
+			return ImageData::SAMPLED_TEXTURE_R8G8;
+
 		return 0;
 	}
 
@@ -525,20 +698,109 @@ namespace SunEngine
 		}
 	}
 
+	//Float of every half, built from the bits so NaNs come out quiet like the hardware conversions
+	struct HalfTable
+	{
+		HalfTable()
+		{
+			for (uint i = 0; i < 65536; i++)
+			{
+				uint sign = (i & 0x8000) << 16;
+				uint e = (i >> 10) & 0x1F;
+				uint m = i & 0x3FF;
+				if (e == 0x1F)
+					Values[i] = as_float(sign | 0x7F800000 | (m ? 0x00400000 | (m << 13) : 0)); // infinity : NaN
+				else if (e)
+					Values[i] = as_float(sign | ((e + 112) << 23) | (m << 13)); // normalized
+				else
+					Values[i] = as_float(sign | as_uint(m * (1.0f / 16777216.0f))); // denormalized, exact as a float
+			}
+		}
+
+		float Values[65536];
+	};
+
+	static const float* GetHalfTable()
+	{
+		static const HalfTable table;
+		return table.Values;
+	}
+
 	float HalfToFloat(ushort x)
 	{
-		const uint e = (x & 0x7C00) >> 10; // exponent
-		const uint m = (x & 0x03FF) << 13; // mantissa
-		const uint v = as_uint((float)m) >> 23; // evil log2 bit hack to count leading zeros in denormalized format
-		return as_float((x & 0x8000) << 16 | (e != 0) * ((e + 112) << 23 | m) | ((e == 0) & (m != 0)) * ((v - 37) << 23 | ((m << (150 - v)) & 0x007FE000))); // sign : normalized : denormalized
+		return GetHalfTable()[x];
 	}
 
 	ushort FloatToHalf(float x)
 	{
-		const uint b = as_uint(x) + 0x00001000; // round-to-nearest-even: add last bit after truncated mantissa
-		const uint e = (b & 0x7F800000) >> 23; // exponent
-		const uint m = b & 0x007FFFFF; // mantissa; in line below: 0x007FF000 = 0x00800000-0x00001000 = decimal indicator flag - initial rounding
-		return (b & 0x80000000) >> 16 | (e > 112) * ((((e - 112) << 10) & 0x7C00) | m >> 13) | ((e < 113) & (e > 101)) * ((((0x007FF000 + m) >> (125 - e)) + 1) >> 1) | (e > 143) * 0x7FFF; // sign : normalized : denormalized : saturate
+		uint f = as_uint(x);
+		uint sign = (f >> 16) & 0x8000;
+		f &= 0x7FFFFFFF;
+		if (f >= 0x47800000) // 65536 and up is infinity, NaNs keep the top of their payload
+			return (ushort)(sign | (f > 0x7F800000 ? 0x7E00 | ((f >> 13) & 0x3FF) : 0x7C00));
+		if (f < 0x38800000) // adding 0.5 lines the mantissa up with a denormalized half and rounds it to nearest even
+			return (ushort)(sign | (as_uint(as_float(f) + 0.5f) - 0x3F000000));
+		f += 0xC8000FFF + ((f >> 13) & 1); // rebias the exponent, round to nearest even
+		return (ushort)(sign | (f >> 13));
+	}
+
+#ifdef IMAGE_SSE
+	//FloatToHalf on 4 values, the halfs are in the low 16 bits of each lane
+	static __m128i FloatToHalf4(__m128 x)
+	{
+		__m128i f = _mm_castps_si128(x);
+		__m128i sign = _mm_srli_epi32(_mm_and_si128(f, _mm_set1_epi32((int)0x80000000)), 16);
+		f = _mm_and_si128(f, _mm_set1_epi32(0x7FFFFFFF));
+
+		__m128i isNaN = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x7F800000));
+		__m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_or_si128(_mm_set1_epi32(0x200), _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(0x3FF)))));
+		__m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3F000000));
+		__m128i normal = _mm_add_epi32(_mm_add_epi32(f, _mm_set1_epi32((int)0xC8000FFF)), _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1)));
+		normal = _mm_srli_epi32(normal, 13);
+
+		__m128i isDenormal = _mm_cmplt_epi32(f, _mm_set1_epi32(0x38800000));
+		__m128i isSpecial = _mm_cmpgt_epi32(f, _mm_set1_epi32(0x477FFFFF));
+		__m128i h = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+		h = _mm_or_si128(_mm_and_si128(isSpecial, special), _mm_andnot_si128(isSpecial, h));
+		return _mm_or_si128(h, sign);
+	}
+#endif
+
+	void HalfToFloat(const ushort* pSrc, float* pDst, uint count)
+	{
+		uint i = 0;
+#if defined(IMAGE_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(pSrc + i))));
+#elif defined(IMAGE_NEON)
+		for (; i + 4 <= count; i += 4)
+			vst1q_f32(pDst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(pSrc + i))));
+#endif
+		const float* pTable = GetHalfTable();
+		for (; i < count; i++)
+			pDst[i] = pTable[pSrc[i]];
+	}
+
+	void FloatToHalf(const float* pSrc, ushort* pDst, uint count)
+	{
+		uint i = 0;
+#if defined(IMAGE_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128((__m128i*)(pDst + i), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(IMAGE_NEON)
+		for (; i + 4 <= count; i += 4)
+			vst1_u16(pDst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(pSrc + i))));
+#elif defined(IMAGE_SSE)
+		for (; i + 8 <= count; i += 8)
+		{
+			//sign extending the low 16 bits lets the signed pack through without saturating
+			__m128i lo = _mm_srai_epi32(_mm_slli_epi32(FloatToHalf4(_mm_loadu_ps(pSrc + i)), 16), 16);
+			__m128i hi = _mm_srai_epi32(_mm_slli_epi32(FloatToHalf4(_mm_loadu_ps(pSrc + i + 4)), 16), 16);
+			_mm_storeu_si128((__m128i*)(pDst + i), _mm_packs_epi32(lo, hi));
+		}
+#endif
+		for (; i < count; i++)
+			pDst[i] = FloatToHalf(pSrc[i]);
 	}
 
 	uint ImageData::GetImageSize() const
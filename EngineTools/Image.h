@@ -2,6 +2,8 @@
 
 #include  "Pixel.h"
 #include "Serializable.h"
+#include "BlockCompressor.h"
+#include "ImageResampler.h"
 
 namespace SunEngine
 {
@@ -23,6 +25,12 @@ namespace SunEngine
 			MULTI_SAMPLES_8 = 1 << 10,
 			CUBEMAP = 1 << 11,
 			WRITABLE = 1 << 12,
+			COMPRESSED_BC4 = 1 << 13,
+			COMPRESSED_BC5 = 1 << 14,
+			COMPRESSED_BC7 = 1 << 15,
+			SAMPLED_TEXTURE_R16G16B16A16F = 1 << 16,
+			SAMPLED_TEXTURE_R16 = 1 << 17,
+			SAMPLED_TEXTURE_R8G8 = 1 << 18,
 		};
 
 		ImageData()
@@ -52,8 +60,11 @@ namespace SunEngine
 	bool ReadBufferAs16BitGrayscaleImage(const void* pData, uint size, int& width, int& height, Vector<ushort>& output);
 	uint GetImageFormat(uint flags);
 
+	//Conversions round to nearest even and keep infinities and NaNs, the runs use F16C or NEON when the target has them
 	float HalfToFloat(ushort x);
 	ushort FloatToHalf(float x);
+	void HalfToFloat(const ushort* pSrc, float* pDst, uint count);
+	void FloatToHalf(const float* pSrc, ushort* pDst, uint count);
 
 	class Image final : public Serializable
 	{
@@ -63,15 +74,21 @@ namespace SunEngine
 		Image & operator = (const Image&) = delete;
 		~Image();
 
+		//Radiance .hdr files are stored as SAMPLED_TEXTURE_R16G16B16A16F, everything else as RGBA8
 		bool Load(const String& filename);
 		bool Allocate(uint width, uint height, const Pixel* pixels = 0, uint flags = 0);
 		bool CreateFrom(const Image* pOther, uint width, uint height);
 		bool CreateFrom(const ImageData& data, uint width, uint height);
-		bool Resize(uint width, uint height);
+		//SAMPLED_TEXTURE_R32F texels take the nearest texel, compressed and two byte (R16, R8G8) images can't be resized
+		bool Resize(uint width, uint height, ImageResampler::Filter filter = ImageResampler::FILTER_LANCZOS3, bool threaded = true);
 		bool TransferFrom(ImageData& data);
 
 		void SwapRB();
 
+		//Converts between RGBA8 (format 0), SAMPLED_TEXTURE_R16G16B16A16F and SAMPLED_TEXTURE_R32G32B32A32F. Floats are
+		//linear, SRGB bytes are decoded on the way to floats and lose the flag, floats are clamped to [0, 1] on the way to bytes
+		bool ConvertFormat(uint format, bool threaded = true);
+
 		uint Width() const;
 		uint Height() const;
 		Pixel* Pixels() const;
@@ -87,20 +104,29 @@ namespace SunEngine
 		ImageData ImageData() const;
 
 		bool Write(StreamBase& stream) override;
+		//Pixels are used in place when the stream hands out a view, the stream must then outlive the image's pixels
 		bool Read(StreamBase& stream) override;
 
-		bool Compress();
+		//Compresses with block rows split across the thread pool, format 0 picks BC1, or BC3 when alpha varies
+		bool Compress(BlockCompressor::Quality quality = BlockCompressor::QUALITY_HIGH, bool threaded = true, uint format = 0);
 		bool IsCompressed() const;
+		bool IsFloat() const;
 
 		inline uint GetFlags() const { return _internalFlags; }
 		inline void SetFlags(uint flags) { _internalFlags |= flags; }
 
 		static bool CanLoad(const String& path);
 
-	private:
+		//Compresses a mip chain in one pass over the pool, format 0 is picked from the first image for every level
+		static bool CompressChain(Image* const* ppImages, uint count, BlockCompressor::Quality quality = BlockCompressor::QUALITY_HIGH, bool threaded = true, uint format = 0);
+
+		//Frees the pixels, or stops viewing them when they were read in place, and leaves the image empty
 		void CleanUp();
 
+	private:
+
 		Pixel* _pixels;
+		bool _ownsPixels;
 		uint _width;
 		uint _height;
 		uint _internalFlags;
@@ -0,0 +1,443 @@
+#include "ThreadPool.h"
+#include "Image.h"
+#include "ImageResampler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLER_SSE
+#include <emmintrin.h>
+#endif
+
+//images are split into tiles of output texels so the filtered rows a tile needs stay in cache
+#define RESAMPLE_TILE_ROWS 32
+#define RESAMPLE_TILE_COLUMNS 256
+
+namespace SunEngine
+{
+	//Source texels and weights of every output texel along one axis, each output has the same tap count
+	//so short footprints are padded with zero weights. Indices are clamped to the source edge
+	struct FilterTaps
+	{
+		uint tapCount;
+		Vector<uint> indices;
+		Vector<float> weights;
+	};
+
+	static float Sinc(float x)
+	{
+		if (fabsf(x) < 0.00001f)
+			return 1.0f;
+
+		x *= 3.14159265f;
+		return sinf(x) / x;
+	}
+
+	static float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		float halfX = x * 0.5f;
+		for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	//Radius in output texels when shrinking, in source texels when enlarging
+	static float GetFilterRadius(ImageResampler::Filter filter)
+	{
+		switch (filter)
+		{
+		case ImageResampler::FILTER_BILINEAR:
+			return 1.0f;
+		case ImageResampler::FILTER_BICUBIC:
+		case ImageResampler::FILTER_KAISER:
+			return 2.0f;
+		case ImageResampler::FILTER_LANCZOS3:
+			return 3.0f;
+		default:
+			return 0.5f;
+		}
+	}
+
+	//x is the distance from the output texel center in the units of GetFilterRadius
+	static float GetFilterWeight(ImageResampler::Filter filter, float x)
+	{
+		const float KaiserAlpha = 4.0f;
+
+		float radius = GetFilterRadius(filter);
+		x = fabsf(x);
+		if (x > radius)
+			return 0.0f;
+
+		switch (filter)
+		{
+		case ImageResampler::FILTER_BILINEAR:
+			return 1.0f - x;
+		case ImageResampler::FILTER_BICUBIC:
+			return x < 1.0f ? (1.5f * x - 2.5f) * x * x + 1.0f : ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+		case ImageResampler::FILTER_KAISER:
+		{
+			float t = x / radius;
+			return Sinc(x) * BesselI0(KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(KaiserAlpha);
+		}
+		case ImageResampler::FILTER_LANCZOS3:
+			return Sinc(x) * Sinc(x / radius);
+		default:
+			return 1.0f;
+		}
+	}
+
+	static void BuildFilterTaps(ImageResampler::Filter filter, uint srcSize, uint dstSize, FilterTaps& taps)
+	{
+		//the filter is stretched over the source footprint of an output texel, enlarging keeps it at one source texel
+		float scale = (float)srcSize / (float)dstSize;
+		float filterScale = scale > 1.0f ? scale : 1.0f;
+		float radius = GetFilterRadius(filter) * filterScale;
+
+		Vector<Vector<Pair<uint, float>>> footprints(dstSize);
+		taps.tapCount = 1;
+		for (uint o = 0; o < dstSize; o++)
+		{
+			float center = (o + 0.5f) * scale;
+			int first = (int)floorf(center - radius);
+			int last = (int)ceilf(center + radius);
+
+			float sum = 0.0f;
+			auto& footprint = footprints[o];
+			for (int s = first; s <= last; s++)
+			{
+				float w = GetFilterWeight(filter, (s + 0.5f - center) / filterScale);
+				if (w == 0.0f)
+					continue;
+
+				uint index = (uint)(s < 0 ? 0 : (s >= (int)srcSize ? srcSize - 1 : s));
+				if (footprint.size() && footprint.back().first == index)
+					footprint.back().second += w;
+				else
+					footprint.push_back(Pair<uint, float>(index, w));
+				sum += w;
+			}
+
+			for (auto& tap : footprint)
+				tap.second /= sum;
+
+			taps.tapCount = footprint.size() > taps.tapCount ? footprint.size() : taps.tapCount;
+		}
+
+		taps.indices.resize(dstSize * taps.tapCount);
+		taps.weights.resize(dstSize * taps.tapCount);
+		for (uint o = 0; o < dstSize; o++)
+		{
+			const auto& footprint = footprints[o];
+			for (uint t = 0; t < taps.tapCount; t++)
+			{
+				taps.indices[o * taps.tapCount + t] = t < footprint.size() ? footprint[t].first : footprint.back().first;
+				taps.weights[o * taps.tapCount + t] = t < footprint.size() ? footprint[t].second : 0.0f;
+			}
+		}
+	}
+
+	//sRGB bytes to linear values in [0, 255] and linear values back to sRGB bytes, the encode table is indexed by linear * 4095 / 255
+	struct SRGBTables
+	{
+		SRGBTables()
+		{
+			for (uint i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				ToLinear[i] = 255.0f * (c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f));
+			}
+
+			for (uint i = 0; i < 4096; i++)
+			{
+				float c = i / 4095.0f;
+				c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+				ToSRGB[i] = (uchar)lrintf(fmaxf(fminf(c * 255.0f, 255.0f), 0.0f));
+			}
+		}
+
+		float ToLinear[256];
+		uchar ToSRGB[4096];
+	};
+
+	static const SRGBTables& GetSRGBTables()
+	{
+		static const SRGBTables tables;
+		return tables;
+	}
+
+	//Filters columns [colBegin, colEnd) of one source row into 4 floats per texel, pToLinear decodes rgb when set
+	static void FilterRow(const Pixel* pSrcRow, const FilterTaps& taps, uint colBegin, uint colEnd, const float* pToLinear, float* pOut)
+	{
+		uint tapCount = taps.tapCount;
+		for (uint x = colBegin; x < colEnd; x++, pOut += 4)
+		{
+			const uint* pIndices = &taps.indices[x * tapCount];
+			const float* pWeights = &taps.weights[x * tapCount];
+#ifdef RESAMPLER_SSE
+			__m128i zero = _mm_setzero_si128();
+			__m128 sum = _mm_setzero_ps();
+			if (pToLinear)
+			{
+				for (uint t = 0; t < tapCount; t++)
+				{
+					const Pixel& texel = pSrcRow[pIndices[t]];
+					__m128 value = _mm_setr_ps(pToLinear[texel.R], pToLinear[texel.G], pToLinear[texel.B], (float)texel.A);
+					sum = _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(pWeights[t])));
+				}
+			}
+			else
+			{
+				for (uint t = 0; t < tapCount; t++)
+				{
+					int rgba;
+					memcpy(&rgba, &pSrcRow[pIndices[t]], sizeof(int));
+					__m128i texel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(rgba), zero), zero);
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(texel), _mm_set1_ps(pWeights[t])));
+				}
+			}
+			_mm_storeu_ps(pOut, sum);
+#else
+			float sum[4] = {};
+			for (uint t = 0; t < tapCount; t++)
+			{
+				const Pixel& texel = pSrcRow[pIndices[t]];
+				sum[0] += (pToLinear ? pToLinear[texel.R] : texel.R) * pWeights[t];
+				sum[1] += (pToLinear ? pToLinear[texel.G] : texel.G) * pWeights[t];
+				sum[2] += (pToLinear ? pToLinear[texel.B] : texel.B) * pWeights[t];
+				sum[3] += texel.A * pWeights[t];
+			}
+			memcpy(pOut, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	//Filters columns [colBegin, colEnd) of one row of 4 floats per texel that starts at source column firstColumn
+	static void FilterRowFloat(const float* pSrcRow, uint firstColumn, const FilterTaps& taps, uint colBegin, uint colEnd, float* pOut)
+	{
+		uint tapCount = taps.tapCount;
+		for (uint x = colBegin; x < colEnd; x++, pOut += 4)
+		{
+			const uint* pIndices = &taps.indices[x * tapCount];
+			const float* pWeights = &taps.weights[x * tapCount];
+#ifdef RESAMPLER_SSE
+			__m128 sum = _mm_setzero_ps();
+			for (uint t = 0; t < tapCount; t++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrcRow + (pIndices[t] - firstColumn) * 4), _mm_set1_ps(pWeights[t])));
+			_mm_storeu_ps(pOut, sum);
+#else
+			float sum[4] = {};
+			for (uint t = 0; t < tapCount; t++)
+			{
+				const float* pTexel = pSrcRow + (pIndices[t] - firstColumn) * 4;
+				for (uint c = 0; c < 4; c++)
+					sum[c] += pTexel[c] * pWeights[t];
+			}
+			memcpy(pOut, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	//Rescales the xyz of count texels in [0, 255] back to unit length, alpha is left alone
+	static void RenormalizeRow(float* pRow, uint count)
+	{
+		for (uint i = 0; i < count; i++, pRow += 4)
+		{
+#ifdef RESAMPLER_SSE
+			__m128 texel = _mm_loadu_ps(pRow);
+			__m128 n = _mm_sub_ps(_mm_mul_ps(texel, _mm_set1_ps(1.0f / 127.5f)), _mm_set1_ps(1.0f));
+			__m128 sq = _mm_mul_ps(n, n);
+			__m128 lenSq = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+			float len = _mm_cvtss_f32(_mm_sqrt_ss(lenSq));
+			if (len > 0.0f)
+			{
+				float alpha = pRow[3];
+				_mm_storeu_ps(pRow, _mm_mul_ps(_mm_add_ps(_mm_div_ps(n, _mm_set1_ps(len)), _mm_set1_ps(1.0f)), _mm_set1_ps(127.5f)));
+				pRow[3] = alpha;
+			}
+#else
+			float n[3] = { pRow[0] / 127.5f - 1.0f, pRow[1] / 127.5f - 1.0f, pRow[2] / 127.5f - 1.0f };
+			float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (len > 0.0f)
+			{
+				pRow[0] = (n[0] / len + 1.0f) * 127.5f;
+				pRow[1] = (n[1] / len + 1.0f) * 127.5f;
+				pRow[2] = (n[2] / len + 1.0f) * 127.5f;
+			}
+#endif
+		}
+	}
+
+	//Encodes the rgb of count linear texels with the sRGB table, alpha is rounded like StoreRow
+	static void StoreRowSRGB(const float* pRow, uint count, const uchar* pToSRGB, Pixel* pDst)
+	{
+		const float ToIndex = 4095.0f / 255.0f;
+		for (uint i = 0; i < count; i++, pRow += 4)
+		{
+			pDst[i].R = pToSRGB[(uint)lrintf(fmaxf(fminf(pRow[0] * ToIndex, 4095.0f), 0.0f))];
+			pDst[i].G = pToSRGB[(uint)lrintf(fmaxf(fminf(pRow[1] * ToIndex, 4095.0f), 0.0f))];
+			pDst[i].B = pToSRGB[(uint)lrintf(fmaxf(fminf(pRow[2] * ToIndex, 4095.0f), 0.0f))];
+			pDst[i].A = (uchar)lrintf(fmaxf(fminf(pRow[3], 255.0f), 0.0f));
+		}
+	}
+
+	//Rounds to nearest even like the SSE conversion and clamps count texels of 4 floats to RGBA8
+	static void StoreRow(const float* pRow, uint count, Pixel* pDst)
+	{
+		uint i = 0;
+#ifdef RESAMPLER_SSE
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i t0 = _mm_cvtps_epi32(_mm_loadu_ps(pRow + i * 4 + 0));
+			__m128i t1 = _mm_cvtps_epi32(_mm_loadu_ps(pRow + i * 4 + 4));
+			__m128i t2 = _mm_cvtps_epi32(_mm_loadu_ps(pRow + i * 4 + 8));
+			__m128i t3 = _mm_cvtps_epi32(_mm_loadu_ps(pRow + i * 4 + 12));
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(t0, t1), _mm_packs_epi32(t2, t3));
+			_mm_storeu_si128((__m128i*)&pDst[i], packed);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const float* pTexel = pRow + i * 4;
+			pDst[i].R = (uchar)lrintf(fmaxf(fminf(pTexel[0], 255.0f), 0.0f));
+			pDst[i].G = (uchar)lrintf(fmaxf(fminf(pTexel[1], 255.0f), 0.0f));
+			pDst[i].B = (uchar)lrintf(fmaxf(fminf(pTexel[2], 255.0f), 0.0f));
+			pDst[i].A = (uchar)lrintf(fmaxf(fminf(pTexel[3], 255.0f), 0.0f));
+		}
+	}
+
+	static void ResampleTile(const ImageData& src, ImageData& dst, uint format, const FilterTaps& xTaps, const FilterTaps& yTaps, uint modes, uint tileX, uint tileY, Vector<float>& scratch)
+	{
+		uint colBegin = tileX * RESAMPLE_TILE_COLUMNS;
+		uint colEnd = colBegin + RESAMPLE_TILE_COLUMNS < dst.Width ? colBegin + RESAMPLE_TILE_COLUMNS : dst.Width;
+		uint rowBegin = tileY * RESAMPLE_TILE_ROWS;
+		uint rowEnd = rowBegin + RESAMPLE_TILE_ROWS < dst.Height ? rowBegin + RESAMPLE_TILE_ROWS : dst.Height;
+		uint tileWidth = colEnd - colBegin;
+		uint rowFloats = tileWidth * 4;
+
+		//source rows the tile reads, each is filtered horizontally once
+		uint srcBegin = src.Height;
+		uint srcEnd = 0;
+		for (uint t = rowBegin * yTaps.tapCount; t < rowEnd * yTaps.tapCount; t++)
+		{
+			srcBegin = yTaps.indices[t] < srcBegin ? yTaps.indices[t] : srcBegin;
+			srcEnd = yTaps.indices[t] + 1 > srcEnd ? yTaps.indices[t] + 1 : srcEnd;
+		}
+
+		//and the source columns, float rows are read from there on
+		uint firstColumn = src.Width;
+		uint lastColumn = 0;
+		for (uint t = colBegin * xTaps.tapCount; t < colEnd * xTaps.tapCount; t++)
+		{
+			firstColumn = xTaps.indices[t] < firstColumn ? xTaps.indices[t] : firstColumn;
+			lastColumn = xTaps.indices[t] + 1 > lastColumn ? xTaps.indices[t] + 1 : lastColumn;
+		}
+
+		bool halfs = format == ImageData::SAMPLED_TEXTURE_R16G16B16A16F;
+		uint spanFloats = (lastColumn - firstColumn) * 4;
+		scratch.resize((srcEnd - srcBegin + 1) * rowFloats + (halfs ? spanFloats : 0));
+		float* pFiltered = scratch.data();
+		float* pSum = pFiltered + (srcEnd - srcBegin) * rowFloats;
+		float* pSpan = pSum + rowFloats;
+
+		bool srgb = !format && (modes & ImageResampler::MODE_SRGB) && !(modes & ImageResampler::MODE_NORMAL_MAP);
+		if (format)
+		{
+			for (uint y = srcBegin; y < srcEnd; y++)
+			{
+				const float* pRow = 0;
+				if (halfs)
+				{
+					HalfToFloat((const ushort*)src.Pixels + (y * src.Width + firstColumn) * 4, pSpan, spanFloats);
+					pRow = pSpan;
+				}
+				else
+				{
+					pRow = (const float*)src.Pixels + (y * src.Width + firstColumn) * 4;
+				}
+				FilterRowFloat(pRow, firstColumn, xTaps, colBegin, colEnd, pFiltered + (y - srcBegin) * rowFloats);
+			}
+		}
+		else
+		{
+			const float* pToLinear = srgb ? GetSRGBTables().ToLinear : 0;
+			for (uint y = srcBegin; y < srcEnd; y++)
+				FilterRow(&src.Pixels[y * src.Width], xTaps, colBegin, colEnd, pToLinear, pFiltered + (y - srcBegin) * rowFloats);
+		}
+
+		for (uint y = rowBegin; y < rowEnd; y++)
+		{
+			const uint* pIndices = &yTaps.indices[y * yTaps.tapCount];
+			const float* pWeights = &yTaps.weights[y * yTaps.tapCount];
+
+			memset(pSum, 0, sizeof(float) * rowFloats);
+			for (uint t = 0; t < yTaps.tapCount; t++)
+			{
+				const float* pRow = pFiltered + (pIndices[t] - srcBegin) * rowFloats;
+				uint i = 0;
+#ifdef RESAMPLER_SSE
+				__m128 w = _mm_set1_ps(pWeights[t]);
+				for (; i < rowFloats; i += 4)
+					_mm_storeu_ps(pSum + i, _mm_add_ps(_mm_loadu_ps(pSum + i), _mm_mul_ps(_mm_loadu_ps(pRow + i), w)));
+#endif
+				for (; i < rowFloats; i++)
+					pSum[i] += pRow[i] * pWeights[t];
+			}
+
+			//floats are stored as filtered, bytes are clamped and rounded
+			if (halfs)
+			{
+				FloatToHalf(pSum, (ushort*)dst.Pixels + (y * dst.Width + colBegin) * 4, rowFloats);
+				continue;
+			}
+			else if (format)
+			{
+				memcpy((float*)dst.Pixels + (y * dst.Width + colBegin) * 4, pSum, sizeof(float) * rowFloats);
+				continue;
+			}
+
+			Pixel* pDst = &dst.Pixels[y * dst.Width + colBegin];
+			if (modes & ImageResampler::MODE_NORMAL_MAP)
+				RenormalizeRow(pSum, tileWidth);
+
+			if (srgb)
+				StoreRowSRGB(pSum, tileWidth, GetSRGBTables().ToSRGB, pDst);
+			else
+				StoreRow(pSum, tileWidth, pDst);
+		}
+	}
+
+	bool ImageResampler::Resample(const ImageData& src, ImageData& dst, Filter filter, uint modes, bool threaded)
+	{
+		if (src.Pixels == 0 || dst.Pixels == 0 || src.Width == 0 || src.Height == 0 || dst.Width == 0 || dst.Height == 0)
+			return false;
+
+		uint format = GetImageFormat(src.Flags);
+		if (format != GetImageFormat(dst.Flags))
+			return false;
+
+		if (format != 0 && format != ImageData::SAMPLED_TEXTURE_R16G16B16A16F && format != ImageData::SAMPLED_TEXTURE_R32G32B32A32F)
+			return false;
+
+		FilterTaps xTaps, yTaps;
+		BuildFilterTaps(filter, src.Width, dst.Width, xTaps);
+		BuildFilterTaps(filter, src.Height, dst.Height, yTaps);
+
+		PerThreadData<Vector<float>> scratch;
+		uint tilesX = (dst.Width + RESAMPLE_TILE_COLUMNS - 1) / RESAMPLE_TILE_COLUMNS;
+		uint tilesY = (dst.Height + RESAMPLE_TILE_ROWS - 1) / RESAMPLE_TILE_ROWS;
+		auto resampleTiles = [&](uint threadIndex, uint begin, uint end) -> void {
+			for (uint i = begin; i < end; i++)
+				ResampleTile(src, dst, format, xTaps, yTaps, modes, i % tilesX, i / tilesX, scratch[threadIndex]);
+		};
+
+		if (threaded)
+			ThreadPool::Get().ParallelForRange(0, tilesX * tilesY, 1, resampleTiles);
+		else
+			ThreadPool::Get().RunOnCallingThread([&](uint threadIndex) -> void { resampleTiles(threadIndex, 0, tilesX * tilesY); });
+
+		return true;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Types.h"
+
+namespace SunEngine
+{
+	struct ImageData;
+
+	class ImageResampler
+	{
+	public:
+		//Separable filters. Box averages the source texels under each output texel, which is nearest neighbour when enlarging,
+		//bicubic is Catmull-Rom and Kaiser and Lanczos3 are windowed sincs. Sharper filters can ring, bytes are clamped
+		enum Filter
+		{
+			FILTER_BOX,
+			FILTER_BILINEAR,
+			FILTER_BICUBIC,
+			FILTER_KAISER,
+			FILTER_LANCZOS3,
+		};
+
+		enum Mode
+		{
+			MODE_DEFAULT = 0,
+			MODE_SRGB = 1 << 0, //rgb is decoded to linear before filtering and encoded back after
+			MODE_NORMAL_MAP = 1 << 1, //rgb is a unit vector in [0, 255] and is renormalized after filtering, MODE_SRGB is ignored
+		};
+
+		//Filters the RGBA8, RGBA16F or RGBA32F texels of src into every texel of dst at dst's size, both in the same format.
+		//Modes only apply to RGBA8. The weights of each axis are computed once, tiles of output texels are split across the pool
+		static bool Resample(const ImageData& src, ImageData& dst, Filter filter, uint modes = MODE_DEFAULT, bool threaded = true);
+	};
+}
@@ -0,0 +1,176 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+
+#include "MappedFileStream.h"
+
+namespace SunEngine
+{
+	MappedFileStream::MappedFileStream()
+	{
+		_data = 0;
+		_size = 0;
+		_pos = 0;
+	}
+
+	MappedFileStream::~MappedFileStream()
+	{
+		Close();
+	}
+
+	bool MappedFileStream::Open(const char* filename)
+	{
+		Close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		//empty files can't be mapped but open fine as an empty stream
+		if (fileSize.QuadPart)
+		{
+			HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+			if (mapping)
+			{
+				_data = (uchar*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+
+			if (_data == 0)
+			{
+				CloseHandle(file);
+				return false;
+			}
+		}
+
+		//the view keeps the file and mapping alive on its own
+		CloseHandle(file);
+		_size = (usize)fileSize.QuadPart;
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd == -1)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		if (info.st_size)
+		{
+			void* pMapping = mmap(0, (usize)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (pMapping == MAP_FAILED)
+			{
+				close(fd);
+				return false;
+			}
+			_data = (uchar*)pMapping;
+		}
+
+		close(fd);
+		_size = (usize)info.st_size;
+#endif
+
+		_pos = 0;
+		return true;
+	}
+
+	bool MappedFileStream::Close()
+	{
+		bool closed = true;
+		if (_data)
+		{
+#ifdef _WIN32
+			closed = UnmapViewOfFile(_data) != 0;
+#else
+			closed = munmap(_data, _size) == 0;
+#endif
+			_data = 0;
+		}
+
+		_size = 0;
+		_pos = 0;
+		return closed;
+	}
+
+	const void* MappedFileStream::ReadView(const usize size)
+	{
+		if (_pos + size > _size)
+			return 0;
+
+		const void* pView = _data + _pos;
+		_pos += size;
+		return pView;
+	}
+
+	const uchar* MappedFileStream::GetData() const
+	{
+		return _data;
+	}
+
+	usize MappedFileStream::GetSize() const
+	{
+		return _size;
+	}
+
+	uint MappedFileStream::Tell() const
+	{
+		return (uint)_pos;
+	}
+
+	bool MappedFileStream::Seek(const uint offset, const Position pos)
+	{
+		usize newPos = _pos;
+		switch (pos)
+		{
+		case Position::CURRENT:
+			newPos = _pos + offset;
+			break;
+		case Position::START:
+			newPos = offset;
+			break;
+		case Position::END:
+			newPos = _size + offset;
+			break;
+		default:
+			break;
+		}
+
+		if (newPos > _size)
+			return false;
+
+		_pos = newPos;
+		return true;
+	}
+
+	bool MappedFileStream::DerivedWrite(const void*, const usize)
+	{
+		return false;
+	}
+
+	bool MappedFileStream::DerivedRead(void* pBuffer, const usize size)
+	{
+		if (_pos + size > _size)
+			return false;
+
+		memcpy(pBuffer, _data + _pos, size);
+		_pos += size;
+		return true;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "StreamBase.h"
+
+namespace SunEngine
+{
+	//Read only stream over a memory mapped file. Pages are mapped copy on write so data viewed in place can still be
+	//modified by its owner without touching the file
+	class MappedFileStream final : public StreamBase
+	{
+	public:
+		MappedFileStream();
+		~MappedFileStream();
+
+		bool Open(const char* filename);
+		bool Close();
+
+		//Pointer into the mapping at the current position, advances past size bytes. Valid until Close
+		const void* ReadView(const usize size) override;
+
+		const uchar* GetData() const;
+		usize GetSize() const;
+
+	private:
+		uint Tell() const override;
+		bool Seek(const uint offset, const Position pos) override;
+		bool DerivedWrite(const void* pBuffer, const usize size) override;
+		bool DerivedRead(void* pBuffer, const usize size) override;
+
+		uchar* _data;
+		usize _size;
+		usize _pos;
+	};
+}
@@ -1,107 +1,115 @@
-#include <thread>
+#include "ThreadPool.h"
+#include "ImageResampler.h"
 #include "MipMapGenerator.h"
 
 namespace SunEngine
 {
-	//using namespace RMath;
-
-	//Vector<Vec4> MipLayerColors =
-	//{
-	//	Vec4(255, 0, 0, 255),
-	//	Vec4(0, 255, 0, 255),
-	//	Vec4(0, 0, 255, 255),
-	//	Vec4(255, 255, 0, 255),
-	//	Vec4(255, 0, 255, 255),
-	//	Vec4(0, 255, 255, 255),
-	//	Vec4(255, 255, 255, 255),
-	//	Vec4(0, 0, 0, 255),
-	//};
-
-	struct GenMipMapData
+	static ImageResampler::Filter GetResampleFilter(MipMapGenerator::Filter filter)
 	{
-		int baseWidth;
-		int baseHeight;
+		switch (filter)
+		{
+		case MipMapGenerator::FILTER_KAISER:
+			return ImageResampler::FILTER_KAISER;
+		case MipMapGenerator::FILTER_LANCZOS:
+			return ImageResampler::FILTER_LANCZOS3;
+		default:
+			return ImageResampler::FILTER_BOX;
+		}
+	}
 
-		int mipWidth;
-		int mipHeight;
+	//Counts the values of one channel over every texel
+	static void BuildAlphaHistogram(const ImageData& image, uint channel, bool threaded, uint* pHistogram)
+	{
+		PerThreadData<Array<uint, 256>> histograms;
+		for (auto& histogram : histograms)
+			histogram.fill(0);
+
+		auto countRows = [&](uint threadIndex, uint begin, uint end) -> void {
+			Array<uint, 256>& histogram = histograms[threadIndex];
+			for (uint i = begin * image.Width; i < end * image.Width; i++)
+				++histogram[(&image.Pixels[i].R)[channel]];
+		};
+
+		if (threaded)
+			ThreadPool::Get().ParallelForRange(0, image.Height, 64, countRows);
+		else
+			ThreadPool::Get().RunOnCallingThread([&](uint threadIndex) -> void { countRows(threadIndex, 0, image.Height); });
 
-		int kernelSize;
-		int mipLevel;
+		memset(pHistogram, 0, sizeof(uint) * 256);
+		for (auto& histogram : histograms)
+		{
+			for (uint i = 0; i < 256; i++)
+				pHistogram[i] += histogram[i];
+		}
+	}
 
-		Pixel* basePixels;
-		Pixel** mipPixels;
-	};
+	static uchar ScaleAlpha(uint alpha, float scale)
+	{
+		return (uchar)lrintf(fminf(alpha * scale, 255.0f));
+	}
 
-	void GenMips(const Vector<GenMipMapData>& mipWork)
+	//Number of texels whose alpha passes the cutoff after being multiplied by scale
+	static uint GetAlphaCoverage(const uint* pHistogram, float scale, float cutoff)
 	{
-		for (uint w = 0; w < mipWork.size(); w++)
+		uint covered = 0;
+		for (uint i = 0; i < 256; i++)
 		{
-			const GenMipMapData& data = mipWork.at(w);
-			Pixel* mipPixels = new Pixel[data.mipWidth * data.mipHeight];
-
-			float remapX = (float)data.baseWidth / (float)data.mipWidth;
-			float remapY = (float)data.baseHeight / (float)data.mipHeight;
+			if (ScaleAlpha(i, scale) > cutoff)
+				covered += pHistogram[i];
+		}
+		return covered;
+	}
 
-			int k = data.kernelSize;
+	//Scales the alpha of a level so the fraction of texels passing the cutoff is as close as possible to coverage
+	static void PreserveAlphaCoverage(ImageData& image, uint channel, float coverage, float cutoff, bool threaded)
+	{
+		uint histogram[256];
+		BuildAlphaHistogram(image, channel, threaded, histogram);
 
-			for (int y = 0; y < data.mipHeight; y++)
-			{
-				int yIdx = (int)((float)y * remapY);
-				for (int x = 0; x < data.mipWidth; x++)
-				{
-					int xIdx = (int)((float)x * remapX);
-
-					float avgColor[4] = {};
-					float samples = 0.0f;
-
-					for (int i = -k; i <= k; i++)
-					{
-						int iy = yIdx + i;
-						if (iy > -1 && iy < data.baseHeight)
-						{
-							for (int j = -k; j <= k; j++)
-							{
-								int jx = j + xIdx;
-								if (jx > -1 && jx < data.baseWidth)
-								{
-									Pixel pixel = data.basePixels[(iy * data.baseWidth + jx)];
-									avgColor[0] += pixel.R;
-									avgColor[1] += pixel.G;
-									avgColor[2] += pixel.B;
-									avgColor[3] += pixel.A;
-									samples++;
-								}
-							}
-						}
-					}
-
-					avgColor[0] /= samples;
-					avgColor[1] /= samples;
-					avgColor[2] /= samples;
-					avgColor[3] /= samples;
-
-#if 0
-					if (data.mipLevel < (int)MipLayerColors.size())
-					{
-						float t = 0.5f;
-						float alpha = avgColor.w;
-						avgColor = avgColor * (1.0f - t) + MipLayerColors[data.mipLevel] * t;
-						avgColor.w = alpha;
-					}
-#endif
-
-					int pixelIndex = (y * data.mipWidth + x);
-					mipPixels[pixelIndex].R = (uchar)fmax(fmin(avgColor[0], 255.0f), 0.0f);
-					mipPixels[pixelIndex].G = (uchar)fmax(fmin(avgColor[1], 255.0f), 0.0f);
-					mipPixels[pixelIndex].B = (uchar)fmax(fmin(avgColor[2], 255.0f), 0.0f);
-					mipPixels[pixelIndex].A = (uchar)fmax(fmin(avgColor[3], 255.0f), 0.0f);
-
-				}
-			}
-			*data.mipPixels = mipPixels;
+		float target = coverage * image.Width * image.Height;
+		float minScale = 0.0f;
+		float maxScale = 4.0f;
+		for (uint i = 0; i < 16; i++)
+		{
+			float mid = (minScale + maxScale) * 0.5f;
+			if (GetAlphaCoverage(histogram, mid, cutoff) < target)
+				minScale = mid;
+			else
+				maxScale = mid;
 		}
+
+		float scale = fabsf(GetAlphaCoverage(histogram, minScale, cutoff) - target) < fabsf(GetAlphaCoverage(histogram, maxScale, cutoff) - target) ? minScale : maxScale;
+		if (scale == 1.0f)
+			return;
+
+		uchar alphaTable[256];
+		for (uint i = 0; i < 256; i++)
+			alphaTable[i] = ScaleAlpha(i, scale);
+
+		auto scaleRows = [&](uint, uint begin, uint end) -> void {
+			for (uint i = begin * image.Width; i < end * image.Width; i++)
+				(&image.Pixels[i].R)[channel] = alphaTable[(&image.Pixels[i].R)[channel]];
+		};
+
+		if (threaded)
+			ThreadPool::Get().ParallelForRange(0, image.Height, 64, scaleRows);
+		else
+			scaleRows(0, 0, image.Height);
+	}
+
+	MipMapGenerator::Options MakeDefaultMipOptions()
+	{
+		MipMapGenerator::Options opt;
+		opt.Kernel = MipMapGenerator::FILTER_BOX;
+		opt.Modes = MipMapGenerator::MODE_DEFAULT;
+		opt.AlphaCutoff = 0.5f;
+		opt.CoverageChannel = 3;
+
+		return opt;
 	}
 
+	const MipMapGenerator::Options MipMapGenerator::Options::Default = MakeDefaultMipOptions();
+
 	MipMapGenerator::MipMapGenerator()
 	{
 	}
@@ -117,7 +125,7 @@ namespace SunEngine
 		_mipMaps.clear();
 	}
 
-	bool MipMapGenerator::Create(const ImageData &baseImage, bool threaded)
+	bool MipMapGenerator::Create(const ImageData &baseImage, bool threaded, const Options& options)
 	{
 		int width = baseImage.Width;
 		int height = baseImage.Height;
@@ -138,56 +146,47 @@ namespace SunEngine
 			width = baseImage.Width;
 			height = baseImage.Height;
 
-			const uint NUM_THREADS = threaded ? std::thread::hardware_concurrency() : 1;
-			Vector<Vector<GenMipMapData>> threadData(NUM_THREADS);
+			//each level is filtered from the one above it, so the work per level drops by 4x instead of every level reading the base image
+			const ImageData* pSrc = &baseImage;
+
+			//float levels keep the format of the base image, the modes are for RGBA8 content
+			uint format = GetImageFormat(baseImage.Flags);
+			uint modes = format ? (uint)MODE_DEFAULT : options.Modes;
+			uint resampleModes = 0;
+			resampleModes |= (modes & MODE_SRGB) ? (uint)ImageResampler::MODE_SRGB : 0u;
+			resampleModes |= (modes & MODE_NORMAL_MAP) ? (uint)ImageResampler::MODE_NORMAL_MAP : 0u;
+			uint channel = options.CoverageChannel < 4 ? options.CoverageChannel : 3;
+			float cutoff = options.AlphaCutoff * 255.0f;
+			float coverage = 0.0f;
+			if (modes & MODE_ALPHA_COVERAGE)
+			{
+				uint histogram[256];
+				BuildAlphaHistogram(baseImage, channel, threaded, histogram);
+				coverage = (float)GetAlphaCoverage(histogram, 1.0f, cutoff) / (baseImage.Width * baseImage.Height);
 
-			float minKernel = 1;
-			float maxKernel = 4;
+				//nothing to preserve when every texel passes or fails the test
+				if (coverage == 0.0f || coverage == 1.0f)
+					modes &= ~MODE_ALPHA_COVERAGE;
+			}
 
-			uint threadIdx = 0;
 			for (int i = 0; i < numMips; i++)
 			{
-				int mipLevel = i;
-
 				width /= 2;
 				height /= 2;
 
 				height = height < MIN_MIP_SIZE ? MIN_MIP_SIZE : height;
 				width = width < MIN_MIP_SIZE ? MIN_MIP_SIZE : width;
 
-				_mipMaps[mipLevel].Width = width;
-				_mipMaps[mipLevel].Height = height;
-
-				GenMipMapData data;
-				data.baseWidth = baseImage.Width;
-				data.baseHeight = baseImage.Height;
-				data.basePixels = baseImage.Pixels;
-				data.mipWidth = width;
-				data.mipHeight = height;
-				data.kernelSize = (int)(minKernel + (((float)(i+1) / numMips) * (maxKernel - minKernel)));
-				data.mipLevel = mipLevel;
-				data.mipPixels = &_mipMaps[mipLevel].Pixels;
-
-				threadData[threadIdx].push_back(data);
-				threadIdx = (threadIdx + 1) % NUM_THREADS;
-			}
+				_mipMaps[i].Width = width;
+				_mipMaps[i].Height = height;
+				_mipMaps[i].Flags = format;
+				_mipMaps[i].Pixels = new Pixel[_mipMaps[i].GetImageSize() / sizeof(Pixel)];
 
-			if (NUM_THREADS > 1)
-			{
-				Vector<std::thread> threads;
-				for (uint i = 0; i < NUM_THREADS; i++)
-				{
-					threads.push_back(std::thread(GenMips, threadData[i]));
-				}
-
-				for (uint i = 0; i < NUM_THREADS; i++)
-				{
-					threads[i].join();
-				}
-			}
-			else
-			{
-				GenMips(threadData[0]);
+				if (!ImageResampler::Resample(*pSrc, _mipMaps[i], GetResampleFilter(options.Kernel), resampleModes, threaded))
+					return false;
+				if (modes & MODE_ALPHA_COVERAGE)
+					PreserveAlphaCoverage(_mipMaps[i], channel, coverage, cutoff, threaded);
+				pSrc = &_mipMaps[i];
 			}
 
 			return true;
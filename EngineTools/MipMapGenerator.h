@@ -7,10 +7,38 @@ namespace SunEngine
 	class MipMapGenerator
 	{
 	public:
+		//Separable filters each level is downsampled with, box averages 2x2 texels, Kaiser and Lanczos are sharper windowed sincs
+		enum Filter
+		{
+			FILTER_BOX,
+			FILTER_KAISER,
+			FILTER_LANCZOS,
+		};
+
+		//Flags for content that shouldn't be filtered as plain linear RGBA
+		enum Mode
+		{
+			MODE_DEFAULT = 0,
+			MODE_SRGB = 1 << 0, //rgb is decoded to linear before filtering and encoded back after
+			MODE_ALPHA_COVERAGE = 1 << 1, //CoverageChannel of each level is scaled so the fraction of texels passing AlphaCutoff matches the base image
+			MODE_NORMAL_MAP = 1 << 2, //rgb is a unit vector in [0, 255] and is renormalized after filtering, MODE_SRGB is ignored
+		};
+
+		struct Options
+		{
+			Filter Kernel;
+			uint Modes;
+			float AlphaCutoff;
+			uint CoverageChannel; //0-3 for RGBA
+
+			static const Options Default;
+		};
+
 		MipMapGenerator();
 		~MipMapGenerator();
 
-		bool Create(const ImageData &baseImage, bool threaded = true);
+		//Levels of SAMPLED_TEXTURE_R16G16B16A16F and SAMPLED_TEXTURE_R32G32B32A32F images are filtered as linear floats and ignore the modes
+		bool Create(const ImageData &baseImage, bool threaded = true, const Options& options = Options::Default);
 
 		uint GetMipLevels() const;
 		ImageData* GetMipMaps() const;
@@ -21,4 +49,4 @@ namespace SunEngine
 		Vector<ImageData> _mipMaps;
 
 	};
-}
+}
\ No newline at end of file
@@ -36,7 +36,7 @@ namespace SunEngine
 
 		inline uchar Grayscale()  const
 		{
-			return (uchar)((((float)R + (float)G + (float)B) / 3.0f));
+			return (uchar)(((uint)R + (uint)G + (uint)B) / 3);
 		}
 
 		void Set(float r, float g, float b, float a)
@@ -0,0 +1,455 @@
+#include <string.h>
+
+#include "PixelKernels.h"
+
+#if defined(__AVX2__)
+#define PIXEL_KERNELS_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_KERNELS_SSE
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define PIXEL_KERNELS_NEON
+#endif
+
+#if defined(PIXEL_KERNELS_AVX2) || defined(PIXEL_KERNELS_SSE)
+#include <immintrin.h>
+#endif
+
+#ifdef PIXEL_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+//(s * 43691) >> 17 is s / 3 rounded down for every sum of three bytes
+#define PIXEL_THIRD_MUL 43691
+
+namespace SunEngine
+{
+#ifdef PIXEL_KERNELS_SSE
+	//R + G + B of four pixels, one per 32 bit lane
+	static inline __m128i SumRGB(const Pixel* pPixels)
+	{
+		__m128i mask = _mm_set1_epi32(0xFF);
+		__m128i p = _mm_loadu_si128((const __m128i*)pPixels);
+		__m128i r = _mm_and_si128(p, mask);
+		__m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+		return _mm_add_epi32(_mm_add_epi32(r, g), b);
+	}
+#endif
+
+#ifdef PIXEL_KERNELS_AVX2
+	static inline __m256i SumRGB8(const Pixel* pPixels)
+	{
+		__m256i mask = _mm256_set1_epi32(0xFF);
+		__m256i p = _mm256_loadu_si256((const __m256i*)pPixels);
+		__m256i r = _mm256_and_si256(p, mask);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+		__m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+		return _mm256_add_epi32(_mm256_add_epi32(r, g), b);
+	}
+
+	//Narrows four vectors of 32 bit values no larger than 255 to bytes in their original order,
+	//the packs work within 16 byte lanes so the groups of four are put back in order afterwards
+	static inline __m256i PackBytes(__m256i a, __m256i b, __m256i c, __m256i d)
+	{
+		__m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+	}
+#endif
+
+#ifdef PIXEL_KERNELS_NEON
+	static inline uint8x8_t DivideBy3(uint16x8_t sums)
+	{
+		uint16x4_t third = vdup_n_u16(PIXEL_THIRD_MUL);
+		uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(sums), third), 16);
+		uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(sums), third), 16);
+		return vmovn_u16(vshrq_n_u16(vcombine_u16(lo, hi), 1));
+	}
+#endif
+
+	void PixelKernels::Swizzle(const Pixel* pSrc, Pixel* pDst, uint count, const uchar order[4])
+	{
+		uint i = 0;
+
+#if defined(PIXEL_KERNELS_AVX2)
+		//the shuffle picks bytes within each 16 byte lane, indices with the top bit set write 0 which the or turns into 255
+		uchar shuffle[32];
+		uchar ones[32];
+		for (uint b = 0; b < 32; b++)
+		{
+			uint c = b & 3;
+			shuffle[b] = order[c] < 4 ? (uchar)((b & 12) + order[c]) : 0x80;
+			ones[b] = order[c] < 4 ? 0 : 0xFF;
+		}
+
+		__m256i shuffleMask = _mm256_loadu_si256((const __m256i*)shuffle);
+		__m256i onesMask = _mm256_loadu_si256((const __m256i*)ones);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i p = _mm256_loadu_si256((const __m256i*)&pSrc[i]);
+			_mm256_storeu_si256((__m256i*)&pDst[i], _mm256_or_si256(_mm256_shuffle_epi8(p, shuffleMask), onesMask));
+		}
+#elif defined(PIXEL_KERNELS_SSE)
+		//SSE2 has no byte shuffle, channels moving by the same distance are masked together and shifted into place
+		uint groupMasks[7] = {};
+		uint ones = 0;
+		for (uint c = 0; c < 4; c++)
+		{
+			if (order[c] < 4)
+				groupMasks[c - order[c] + 3] |= 0xFFu << (order[c] * 8);
+			else
+				ones |= 0xFFu << (c * 8);
+		}
+
+		//groups 3 to 6 move towards A, 0 to 2 towards R
+		__m128i leftMasks[4];
+		__m128i leftShifts[4];
+		__m128i rightMasks[3];
+		__m128i rightShifts[3];
+		uint leftCount = 0;
+		uint rightCount = 0;
+		for (uint g = 0; g < 7; g++)
+		{
+			if (!groupMasks[g])
+				continue;
+
+			if (g >= 3)
+			{
+				leftMasks[leftCount] = _mm_set1_epi32((int)groupMasks[g]);
+				leftShifts[leftCount++] = _mm_cvtsi32_si128((g - 3) * 8);
+			}
+			else
+			{
+				rightMasks[rightCount] = _mm_set1_epi32((int)groupMasks[g]);
+				rightShifts[rightCount++] = _mm_cvtsi32_si128((3 - g) * 8);
+			}
+		}
+
+		__m128i onesMask = _mm_set1_epi32((int)ones);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)&pSrc[i]);
+			__m128i out = onesMask;
+			for (uint g = 0; g < leftCount; g++)
+				out = _mm_or_si128(out, _mm_sll_epi32(_mm_and_si128(p, leftMasks[g]), leftShifts[g]));
+			for (uint g = 0; g < rightCount; g++)
+				out = _mm_or_si128(out, _mm_srl_epi32(_mm_and_si128(p, rightMasks[g]), rightShifts[g]));
+			_mm_storeu_si128((__m128i*)&pDst[i], out);
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		uint8x16_t ones = vdupq_n_u8(255);
+		for (; i + 16 <= count; i += 16)
+		{
+			uint8x16x4_t p = vld4q_u8(&pSrc[i].R);
+			uint8x16x4_t out;
+			for (uint c = 0; c < 4; c++)
+				out.val[c] = order[c] < 4 ? p.val[order[c]] : ones;
+			vst4q_u8(&pDst[i].R, out);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			//copied first as pSrc may be pDst
+			Pixel src = pSrc[i];
+			const uchar* pIn = &src.R;
+			uchar* pOut = &pDst[i].R;
+			for (uint c = 0; c < 4; c++)
+				pOut[c] = order[c] < 4 ? pIn[order[c]] : 255;
+		}
+	}
+
+	void PixelKernels::SwapRB(Pixel* pPixels, uint count)
+	{
+		static const uchar order[4] = { 2, 1, 0, 3 };
+		Swizzle(pPixels, pPixels, count, order);
+	}
+
+	void PixelKernels::ExtractChannel(const Pixel* pSrc, uchar* pDst, uint count, uint channel)
+	{
+		uint i = 0;
+
+#if defined(PIXEL_KERNELS_AVX2)
+		__m256i mask = _mm256_set1_epi32(0xFF);
+		__m128i shift = _mm_cvtsi32_si128(channel * 8);
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i a = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)&pSrc[i]), shift), mask);
+			__m256i b = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)&pSrc[i + 8]), shift), mask);
+			__m256i c = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)&pSrc[i + 16]), shift), mask);
+			__m256i d = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)&pSrc[i + 24]), shift), mask);
+			_mm256_storeu_si256((__m256i*)&pDst[i], PackBytes(a, b, c, d));
+		}
+#elif defined(PIXEL_KERNELS_SSE)
+		__m128i mask = _mm_set1_epi32(0xFF);
+		__m128i shift = _mm_cvtsi32_si128(channel * 8);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)&pSrc[i]), shift), mask);
+			__m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)&pSrc[i + 4]), shift), mask);
+			__m128i c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)&pSrc[i + 8]), shift), mask);
+			__m128i d = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)&pSrc[i + 12]), shift), mask);
+			_mm_storeu_si128((__m128i*)&pDst[i], _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		for (; i + 16 <= count; i += 16)
+		{
+			uint8x16x4_t p = vld4q_u8(&pSrc[i].R);
+			vst1q_u8(&pDst[i], p.val[channel]);
+		}
+#endif
+
+		for (; i < count; i++)
+			pDst[i] = (&pSrc[i].R)[channel];
+	}
+
+	void PixelKernels::MergeChannels(const uchar* const pPlanes[4], Pixel* pDst, uint count)
+	{
+		uint i = 0;
+
+#if defined(PIXEL_KERNELS_SSE)
+		__m128i ones = _mm_set1_epi8((char)0xFF);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i r = pPlanes[0] ? _mm_loadu_si128((const __m128i*)&pPlanes[0][i]) : ones;
+			__m128i g = pPlanes[1] ? _mm_loadu_si128((const __m128i*)&pPlanes[1][i]) : ones;
+			__m128i b = pPlanes[2] ? _mm_loadu_si128((const __m128i*)&pPlanes[2][i]) : ones;
+			__m128i a = pPlanes[3] ? _mm_loadu_si128((const __m128i*)&pPlanes[3][i]) : ones;
+
+			__m128i rgLo = _mm_unpacklo_epi8(r, g);
+			__m128i rgHi = _mm_unpackhi_epi8(r, g);
+			__m128i baLo = _mm_unpacklo_epi8(b, a);
+			__m128i baHi = _mm_unpackhi_epi8(b, a);
+			_mm_storeu_si128((__m128i*)&pDst[i], _mm_unpacklo_epi16(rgLo, baLo));
+			_mm_storeu_si128((__m128i*)&pDst[i + 4], _mm_unpackhi_epi16(rgLo, baLo));
+			_mm_storeu_si128((__m128i*)&pDst[i + 8], _mm_unpacklo_epi16(rgHi, baHi));
+			_mm_storeu_si128((__m128i*)&pDst[i + 12], _mm_unpackhi_epi16(rgHi, baHi));
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		uint8x16_t ones = vdupq_n_u8(255);
+		for (; i + 16 <= count; i += 16)
+		{
+			uint8x16x4_t out;
+			for (uint c = 0; c < 4; c++)
+				out.val[c] = pPlanes[c] ? vld1q_u8(&pPlanes[c][i]) : ones;
+			vst4q_u8(&pDst[i].R, out);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			uchar* pOut = &pDst[i].R;
+			for (uint c = 0; c < 4; c++)
+				pOut[c] = pPlanes[c] ? pPlanes[c][i] : 255;
+		}
+	}
+
+	void PixelKernels::Invert(Pixel* pPixels, uint count)
+	{
+		uint i = 0;
+
+		//255 - x is the same as flipping every bit
+#if defined(PIXEL_KERNELS_AVX2)
+		__m256i ones = _mm256_set1_epi32(-1);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i p = _mm256_loadu_si256((const __m256i*)&pPixels[i]);
+			_mm256_storeu_si256((__m256i*)&pPixels[i], _mm256_xor_si256(p, ones));
+		}
+#elif defined(PIXEL_KERNELS_SSE)
+		__m128i ones = _mm_set1_epi32(-1);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)&pPixels[i]);
+			_mm_storeu_si128((__m128i*)&pPixels[i], _mm_xor_si128(p, ones));
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		for (; i + 4 <= count; i += 4)
+			vst1q_u8(&pPixels[i].R, vmvnq_u8(vld1q_u8(&pPixels[i].R)));
+#endif
+
+		for (; i < count; i++)
+			pPixels[i].Invert();
+	}
+
+	void PixelKernels::Fill(Pixel* pPixels, uint count, const Pixel& value)
+	{
+		uint i = 0;
+
+		int packed;
+		memcpy(&packed, &value, sizeof(Pixel));
+
+#if defined(PIXEL_KERNELS_AVX2)
+		__m256i p = _mm256_set1_epi32(packed);
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_si256((__m256i*)&pPixels[i], p);
+#elif defined(PIXEL_KERNELS_SSE)
+		__m128i p = _mm_set1_epi32(packed);
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128((__m128i*)&pPixels[i], p);
+#elif defined(PIXEL_KERNELS_NEON)
+		uint8x16_t p = vreinterpretq_u8_s32(vdupq_n_s32(packed));
+		for (; i + 4 <= count; i += 4)
+			vst1q_u8(&pPixels[i].R, p);
+#endif
+
+		for (; i < count; i++)
+			pPixels[i] = value;
+	}
+
+	void PixelKernels::Grayscale(const Pixel* pSrc, uchar* pDst, uint count)
+	{
+		uint i = 0;
+
+		//sums of three bytes fit the signed 16 bit packs
+#if defined(PIXEL_KERNELS_AVX2)
+		__m256i third = _mm256_set1_epi16((short)PIXEL_THIRD_MUL);
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i ab = _mm256_packs_epi32(SumRGB8(&pSrc[i]), SumRGB8(&pSrc[i + 8]));
+			__m256i cd = _mm256_packs_epi32(SumRGB8(&pSrc[i + 16]), SumRGB8(&pSrc[i + 24]));
+			ab = _mm256_srli_epi16(_mm256_mulhi_epu16(ab, third), 1);
+			cd = _mm256_srli_epi16(_mm256_mulhi_epu16(cd, third), 1);
+
+			__m256i bytes = _mm256_packus_epi16(ab, cd);
+			_mm256_storeu_si256((__m256i*)&pDst[i], _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+		}
+#elif defined(PIXEL_KERNELS_SSE)
+		__m128i third = _mm_set1_epi16((short)PIXEL_THIRD_MUL);
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i lo = _mm_packs_epi32(SumRGB(&pSrc[i]), SumRGB(&pSrc[i + 4]));
+			__m128i hi = _mm_packs_epi32(SumRGB(&pSrc[i + 8]), SumRGB(&pSrc[i + 12]));
+			lo = _mm_srli_epi16(_mm_mulhi_epu16(lo, third), 1);
+			hi = _mm_srli_epi16(_mm_mulhi_epu16(hi, third), 1);
+			_mm_storeu_si128((__m128i*)&pDst[i], _mm_packus_epi16(lo, hi));
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		for (; i + 16 <= count; i += 16)
+		{
+			uint8x16x4_t p = vld4q_u8(&pSrc[i].R);
+			uint16x8_t lo = vaddw_u8(vaddl_u8(vget_low_u8(p.val[0]), vget_low_u8(p.val[1])), vget_low_u8(p.val[2]));
+			uint16x8_t hi = vaddw_u8(vaddl_u8(vget_high_u8(p.val[0]), vget_high_u8(p.val[1])), vget_high_u8(p.val[2]));
+			vst1q_u8(&pDst[i], vcombine_u8(DivideBy3(lo), DivideBy3(hi)));
+		}
+#endif
+
+		for (; i < count; i++)
+			pDst[i] = pSrc[i].Grayscale();
+	}
+
+	//Sums rowCount rows of rowLength pixels that start stride pixels apart, the vector totals are only reduced once at the end
+	static void SumRows(const Pixel* pPixels, uint stride, uint rowLength, uint rowCount, uint64 sums[4])
+	{
+		//each channel is masked on its own, adding up the bytes of every 64 bit half then only counts that channel
+#if defined(PIXEL_KERNELS_AVX2)
+		const uint vectorWidth = 8;
+		__m256i zero = _mm256_setzero_si256();
+		__m256i masks[4];
+		__m256i totals[4];
+		for (uint c = 0; c < 4; c++)
+		{
+			masks[c] = _mm256_set1_epi32((int)(0xFFu << (c * 8)));
+			totals[c] = zero;
+		}
+
+		for (uint y = 0; y < rowCount; y++)
+		{
+			const Pixel* pRow = &pPixels[(usize)y * stride];
+			for (uint i = 0; i + vectorWidth <= rowLength; i += vectorWidth)
+			{
+				__m256i p = _mm256_loadu_si256((const __m256i*)&pRow[i]);
+				for (uint c = 0; c < 4; c++)
+					totals[c] = _mm256_add_epi64(totals[c], _mm256_sad_epu8(_mm256_and_si256(p, masks[c]), zero));
+			}
+		}
+
+		for (uint c = 0; c < 4; c++)
+		{
+			uint64 lanes[4];
+			_mm256_storeu_si256((__m256i*)lanes, totals[c]);
+			sums[c] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+#elif defined(PIXEL_KERNELS_SSE)
+		const uint vectorWidth = 4;
+		__m128i zero = _mm_setzero_si128();
+		__m128i masks[4];
+		__m128i totals[4];
+		for (uint c = 0; c < 4; c++)
+		{
+			masks[c] = _mm_set1_epi32((int)(0xFFu << (c * 8)));
+			totals[c] = zero;
+		}
+
+		for (uint y = 0; y < rowCount; y++)
+		{
+			const Pixel* pRow = &pPixels[(usize)y * stride];
+			for (uint i = 0; i + vectorWidth <= rowLength; i += vectorWidth)
+			{
+				__m128i p = _mm_loadu_si128((const __m128i*)&pRow[i]);
+				for (uint c = 0; c < 4; c++)
+					totals[c] = _mm_add_epi64(totals[c], _mm_sad_epu8(_mm_and_si128(p, masks[c]), zero));
+			}
+		}
+
+		for (uint c = 0; c < 4; c++)
+		{
+			uint64 lanes[2];
+			_mm_storeu_si128((__m128i*)lanes, totals[c]);
+			sums[c] += lanes[0] + lanes[1];
+		}
+#elif defined(PIXEL_KERNELS_NEON)
+		const uint vectorWidth = 16;
+		uint64x2_t totals[4];
+		for (uint c = 0; c < 4; c++)
+			totals[c] = vdupq_n_u64(0);
+
+		for (uint y = 0; y < rowCount; y++)
+		{
+			const Pixel* pRow = &pPixels[(usize)y * stride];
+			for (uint i = 0; i + vectorWidth <= rowLength; i += vectorWidth)
+			{
+				uint8x16x4_t p = vld4q_u8(&pRow[i].R);
+				for (uint c = 0; c < 4; c++)
+					totals[c] = vpadalq_u32(totals[c], vpaddlq_u16(vpaddlq_u8(p.val[c])));
+			}
+		}
+
+		for (uint c = 0; c < 4; c++)
+			sums[c] += vgetq_lane_u64(totals[c], 0) + vgetq_lane_u64(totals[c], 1);
+#else
+		const uint vectorWidth = 1;
+#endif
+
+		uint tail = rowLength - rowLength % vectorWidth;
+		for (uint y = 0; y < rowCount; y++)
+		{
+			const Pixel* pRow = &pPixels[(usize)y * stride];
+			for (uint i = tail; i < rowLength; i++)
+			{
+				sums[0] += pRow[i].R;
+				sums[1] += pRow[i].G;
+				sums[2] += pRow[i].B;
+				sums[3] += pRow[i].A;
+			}
+		}
+	}
+
+	void PixelKernels::Sum(const Pixel* pPixels, uint count, uint64 sums[4])
+	{
+		SumRows(pPixels, count, count, 1, sums);
+	}
+
+	void PixelKernels::BoxAverage(const Pixel* pPixels, uint width, uint x0, uint y0, uint x1, uint y1, float average[4])
+	{
+		uint64 sums[4] = {};
+		SumRows(&pPixels[(usize)y0 * width + x0], width, x1 - x0, y1 - y0, sums);
+
+		double count = (double)(x1 - x0) * (double)(y1 - y0) * 255.0;
+		for (uint c = 0; c < 4; c++)
+			average[c] = count > 0.0 ? (float)(sums[c] / count) : 0.0f;
+	}
+}
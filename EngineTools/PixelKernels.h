@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Pixel.h"
+
+namespace SunEngine
+{
+	//Operations over runs of pixels. They are built for AVX2, SSE2 or NEON when the target has them and fall back to
+	//plain loops otherwise, every path gives exactly the same result
+	class PixelKernels
+	{
+	public:
+		//Swizzle source that writes 255 instead of copying a channel
+		static const uchar ChannelOne = 4;
+
+		//Channel c of pDst[i] is channel order[c] of pSrc[i], 0 being R and 3 A, pSrc may be pDst
+		static void Swizzle(const Pixel* pSrc, Pixel* pDst, uint count, const uchar order[4]);
+		static void SwapRB(Pixel* pPixels, uint count);
+
+		//Copies channel (0 to 3) of every pixel into a plane of bytes
+		static void ExtractChannel(const Pixel* pSrc, uchar* pDst, uint count, uint channel);
+		//Interleaves one plane per channel, channels without a plane are set to 255
+		static void MergeChannels(const uchar* const pPlanes[4], Pixel* pDst, uint count);
+
+		static void Invert(Pixel* pPixels, uint count);
+		static void Fill(Pixel* pPixels, uint count, const Pixel& value);
+
+		//Same as Pixel::Grayscale for every pixel
+		static void Grayscale(const Pixel* pSrc, uchar* pDst, uint count);
+
+		//Adds every channel of the pixels onto sums, which are in RGBA order
+		static void Sum(const Pixel* pPixels, uint count, uint64 sums[4]);
+		//Average in [0, 1] of each channel over the columns [x0, x1) and rows [y0, y1) of a width wide image
+		static void BoxAverage(const Pixel* pPixels, uint width, uint x0, uint y0, uint x1, uint y1, float average[4]);
+	};
+}
@@ -71,6 +71,11 @@ namespace SunEngine
 		return Seek(0, Position::START);
 	}
 
+	const void* StreamBase::ReadView(const usize)
+	{
+		return 0;
+	}
+
 	NullStream::NullStream()
 	{
 		_pos = 0;
@@ -31,6 +31,10 @@ namespace SunEngine
 		bool WriteText(const String& buffer);
 
 		bool SeekStart();
+
+		//Streams over memory that stays valid after the read return a pointer at the current position and skip past
+		//size bytes, the memory may be written by the caller. Others return 0 and the data has to be read as a copy
+		virtual const void* ReadView(const usize size);
 	};
 
 	//Useful to determining the size of a object that can be streamed
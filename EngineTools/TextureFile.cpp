@@ -0,0 +1,151 @@
+#include <filesystem>
+
+#include "FileBase.h"
+
+#include "TextureFile.h"
+
+namespace SunEngine
+{
+	const char* TextureFile::Extension = ".stex";
+
+	uint64 TextureFile::Hash(const void* pData, usize size, uint64 seed)
+	{
+		const uchar* pBytes = static_cast<const uchar*>(pData);
+		uint64 hash = seed;
+		for (usize i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool TextureFile::Save(const String& filename, uint64 sourceHash, const SourceStamp& source, Image& image, const Vector<UniquePtr<Image>>& mips)
+	{
+		FileStream file;
+		if (!file.OpenForWrite(filename.c_str()))
+			return false;
+
+		//the hash is left zero until the payload is written so a partially written file never looks current
+		uint64 pendingHash = 0;
+		uint mipCount = mips.size();
+		if (!file.Write(Magic)) return false;
+		if (!file.Write(Version)) return false;
+		if (!file.Write(pendingHash)) return false;
+		if (!file.Write(source.Size)) return false;
+		if (!file.Write(source.Time)) return false;
+		if (!file.Write(source.Hash)) return false;
+		if (!file.Write(mipCount)) return false;
+
+		if (!image.Write(file))
+			return false;
+
+		for (uint i = 0; i < mipCount; i++)
+		{
+			if (!mips[i]->Write(file))
+				return false;
+		}
+
+		StreamBase& stream = file;
+		if (!stream.Seek(sizeof(Magic) + sizeof(Version), StreamBase::START))
+			return false;
+
+		if (!file.Write(sourceHash))
+			return false;
+
+		return file.Close();
+	}
+
+	bool TextureFile::Load(const String& filename, uint64 sourceHash, MappedFileStream& file, Image& image, Vector<UniquePtr<Image>>& mips)
+	{
+		//levels read from a previous load may still view the old mapping, they're dropped before reopening unmaps it
+		if (file.GetData())
+		{
+			image.CleanUp();
+			mips.clear();
+			file.Close();
+		}
+
+		if (!file.Open(filename.c_str()))
+			return false;
+
+		uint64 hash;
+		SourceStamp source;
+		uint mipCount;
+		if (!ReadHeader(file, hash, source, mipCount) || hash != sourceHash)
+		{
+			file.Close();
+			return false;
+		}
+
+		//the images view their pixels in the mapping, nothing is copied until a level is modified
+		if (!image.Read(file))
+			return false;
+
+		mips.clear();
+		for (uint i = 0; i < mipCount; i++)
+		{
+			Image* pMip = new Image();
+			mips.push_back(UniquePtr<Image>(pMip));
+			if (!pMip->Read(file))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool TextureFile::IsCurrent(const String& filename, uint64 sourceHash)
+	{
+		FileStream file;
+		if (!file.OpenForRead(filename.c_str()))
+			return false;
+
+		uint64 hash;
+		SourceStamp source;
+		uint mipCount;
+		return ReadHeader(file, hash, source, mipCount) && hash == sourceHash;
+	}
+
+	bool TextureFile::GetSourceStamp(const String& sourceFilename, SourceStamp& stamp)
+	{
+		std::error_code error;
+		std::filesystem::path path(sourceFilename);
+		uintmax_t size = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+
+		auto time = std::filesystem::last_write_time(path, error);
+		if (error)
+			return false;
+
+		stamp.Size = (uint64)size;
+		stamp.Time = (uint64)time.time_since_epoch().count();
+		stamp.Hash = 0;
+		return true;
+	}
+
+	bool TextureFile::ReadSourceStamp(const String& filename, SourceStamp& stamp)
+	{
+		FileStream file;
+		if (!file.OpenForRead(filename.c_str()))
+			return false;
+
+		//a file whose hash is still pending was never finished, its stamp can't be trusted
+		uint64 hash;
+		uint mipCount;
+		return ReadHeader(file, hash, stamp, mipCount) && hash != 0;
+	}
+
+	bool TextureFile::ReadHeader(StreamBase& stream, uint64& hash, SourceStamp& source, uint& mipCount)
+	{
+		uint magic, version;
+		if (!stream.Read(magic) || magic != Magic) return false;
+		if (!stream.Read(version) || version != Version) return false;
+		if (!stream.Read(hash)) return false;
+		if (!stream.Read(source.Size)) return false;
+		if (!stream.Read(source.Time)) return false;
+		if (!stream.Read(source.Hash)) return false;
+		if (!stream.Read(mipCount)) return false;
+		return true;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Image.h"
+#include "MappedFileStream.h"
+
+namespace SunEngine
+{
+	//Engine texture container, a header with the hash of the content the texture was built from followed by the
+	//final mip chain written with Image::Write so it loads by mapping the file, with no copy and no decode
+	class TextureFile
+	{
+	public:
+		static const char* Extension;
+
+		//Size and last write time of the file a container was built from along with the hash of its content, a source whose
+		//size and time still match the stamp in a container doesn't need to be read and hashed again
+		struct SourceStamp
+		{
+			uint64 Size;
+			uint64 Time;
+			uint64 Hash;
+		};
+
+		//FNV-1a, chain calls by passing the previous hash as seed
+		static uint64 Hash(const void* pData, usize size, uint64 seed = 14695981039346656037ull);
+
+		static bool Save(const String& filename, uint64 sourceHash, const SourceStamp& source, Image& image, const Vector<UniquePtr<Image>>& mips);
+		//The images point into file's mapping and are only valid while it stays open. When file is already open the images
+		//are emptied before it is remapped, even if the load then fails
+		static bool Load(const String& filename, uint64 sourceHash, MappedFileStream& file, Image& image, Vector<UniquePtr<Image>>& mips);
+
+		//Reads only the header, true when the file exists and was built from content with sourceHash
+		static bool IsCurrent(const String& filename, uint64 sourceHash);
+
+		//Fills the size and time of a source file from the file system, the hash is left to the caller
+		static bool GetSourceStamp(const String& sourceFilename, SourceStamp& stamp);
+		//Reads the stamp of the source a container was built from out of its header
+		static bool ReadSourceStamp(const String& filename, SourceStamp& stamp);
+
+	private:
+		static const uint Magic = 0x58455453; //STEX
+		static const uint Version = 2;
+
+		static bool ReadHeader(StreamBase& stream, uint64& hash, SourceStamp& source, uint& mipCount);
+	};
+}
@@ -0,0 +1,308 @@
+#include <assert.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ThreadPool.h"
+
+namespace SunEngine
+{
+    //Set on threads that are neither the main thread nor a worker while they aren't running tasks
+    static const uint ExternalThreadIndex = ~0u;
+
+    //the pool sets 0 on the thread that constructs it, workers overwrite this when they start
+    static thread_local uint g_CurrentThreadIndex = ExternalThreadIndex;
+
+    struct ThreadPool::Task
+    {
+        TaskCallback callback;
+        void* pData;
+        Counter* pCounter;
+    };
+
+    struct ThreadPool::ThreadData
+    {
+        //The owning thread pushes/pops at the back so recently spawned child tasks run first while still hot in cache,
+        //other threads steal the oldest (usually largest) tasks from the front
+        class TaskQueue
+        {
+        public:
+            void Push(const Task& task)
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                _tasks.push_back(task);
+            }
+
+            bool Pop(Task& task)
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                if (_tasks.empty())
+                    return false;
+
+                task = _tasks.back();
+                _tasks.pop_back();
+                return true;
+            }
+
+            bool Steal(Task& task)
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                if (_tasks.empty())
+                    return false;
+
+                task = _tasks.front();
+                _tasks.pop_front();
+                return true;
+            }
+
+        private:
+            std::mutex _mtx;
+            Deque<Task> _tasks;
+        };
+
+        ThreadData(uint queueCount)
+        {
+            pendingTasks = 0;
+            destroyed = false;
+
+            queues.resize(queueCount);
+            for (uint i = 0; i < queueCount; i++)
+                queues[i] = UniquePtr<TaskQueue>(new TaskQueue());
+        }
+
+        void NotifyWorkers(bool all)
+        {
+            //lock so a worker can't miss the notify between testing its wait condition and going to sleep
+            {
+                std::lock_guard<std::mutex> lock(sleepMtx);
+            }
+
+            if (all)
+                sleepCondition.notify_all();
+            else
+                sleepCondition.notify_one();
+        }
+
+        Vector<UniquePtr<TaskQueue>> queues;
+        //held by the external thread currently running tasks in the last slot
+        std::mutex externalMtx;
+        Counter defaultCounter;
+        std::atomic<uint> pendingTasks;
+        bool destroyed;
+        std::mutex sleepMtx;
+        std::condition_variable sleepCondition;
+    };
+
+    class ThreadPool::WorkerThread
+    {
+    public:
+        WorkerThread(uint index)
+        {
+            _pool = 0;
+            _index = index;
+        }
+
+        void Create(ThreadPool* pool)
+        {
+            _pool = pool;
+            _thread = std::thread(&ThreadPool::WorkerThread::Run, this);
+        }
+
+        void Destroy()
+        {
+            if (_thread.joinable())
+                _thread.join();
+        }
+
+        void Run()
+        {
+            g_CurrentThreadIndex = _index;
+            ThreadData* pData = _pool->_data.get();
+
+            while (true)
+            {
+                if (_pool->TryExecuteTask(_index))
+                    continue;
+
+                std::unique_lock<std::mutex> lock(pData->sleepMtx);
+                pData->sleepCondition.wait(lock, [pData]() -> bool { return pData->pendingTasks.load() != 0 || pData->destroyed; });
+                if (pData->destroyed)
+                    break;
+            }
+        }
+
+    private:
+        uint _index;
+        ThreadPool* _pool;
+        std::thread _thread;
+    };
+
+    ThreadPool::ThreadPool()
+    {
+        g_CurrentThreadIndex = 0;
+
+        //the main thread takes part in executing tasks while it waits, so it occupies one of the hardware threads
+        uint hardwareThreads = std::thread::hardware_concurrency();
+        uint workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+
+        //one queue per worker, the main thread and the external slot
+        _data = UniquePtr<ThreadData>(new ThreadData(workerCount + 2));
+
+        _threads.resize(workerCount);
+        for (uint i = 0; i < _threads.size(); i++)
+            _threads[i] = UniquePtr<WorkerThread>(new WorkerThread(i + 1));
+
+        for (uint i = 0; i < _threads.size(); i++)
+            _threads[i]->Create(this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        Wait();
+
+        {
+            std::lock_guard<std::mutex> lock(_data->sleepMtx);
+            _data->destroyed = true;
+        }
+        _data->sleepCondition.notify_all();
+
+        for (uint i = 0; i < _threads.size(); i++)
+        {
+            _threads[i]->Destroy();
+        }
+        _threads.clear();
+    }
+
+    ThreadPool& ThreadPool::Get()
+    {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    void ThreadPool::AddTask(TaskCallback callback, void* pData)
+    {
+        AddTask(callback, pData, &_data->defaultCounter);
+    }
+
+    void ThreadPool::AddTask(TaskCallback callback, void* pData, Counter* pCounter)
+    {
+        if (pCounter == 0)
+            pCounter = &_data->defaultCounter;
+
+        Task task;
+        task.callback = callback;
+        task.pData = pData;
+        task.pCounter = pCounter;
+
+        //count before queueing so the counter/pending values can never be observed lower than the real amount of work
+        pCounter->_count.fetch_add(1, std::memory_order_relaxed);
+        _data->pendingTasks.fetch_add(1);
+        uint queueIndex = g_CurrentThreadIndex == ExternalThreadIndex ? GetExternalThreadIndex() : g_CurrentThreadIndex;
+        _data->queues[queueIndex]->Push(task);
+        _data->NotifyWorkers(false);
+    }
+
+    void ThreadPool::Wait()
+    {
+        Wait(_data->defaultCounter);
+    }
+
+    void ThreadPool::Wait(Counter& counter)
+    {
+        uint threadIndex = g_CurrentThreadIndex;
+        if (threadIndex == ExternalThreadIndex)
+        {
+            WaitExternal(counter);
+            return;
+        }
+
+        while (!counter.Done())
+        {
+            //help out instead of blocking, the remaining tasks for this counter may be queued behind unrelated work
+            if (!TryExecuteTask(threadIndex))
+                std::this_thread::yield();
+        }
+    }
+
+    void ThreadPool::WaitExternal(Counter& counter)
+    {
+        //external threads take turns owning the last slot, it can't be left to the others since there may be no workers
+        while (!counter.Done())
+        {
+            std::unique_lock<std::mutex> lock(_data->externalMtx, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            g_CurrentThreadIndex = GetExternalThreadIndex();
+            while (!counter.Done())
+            {
+                if (!TryExecuteTask(g_CurrentThreadIndex))
+                    std::this_thread::yield();
+            }
+            g_CurrentThreadIndex = ExternalThreadIndex;
+        }
+    }
+
+    void ThreadPool::RunInline(TaskCallback callback, void* pData)
+    {
+        if (g_CurrentThreadIndex != ExternalThreadIndex)
+        {
+            callback(g_CurrentThreadIndex, pData);
+            return;
+        }
+
+        //same ownership of the last slot as WaitExternal, waits made by the callback run tasks in it without locking again
+        std::lock_guard<std::mutex> lock(_data->externalMtx);
+        g_CurrentThreadIndex = GetExternalThreadIndex();
+        callback(g_CurrentThreadIndex, pData);
+        g_CurrentThreadIndex = ExternalThreadIndex;
+    }
+
+    uint ThreadPool::GetCurrentThreadIndex() const
+    {
+        assert(g_CurrentThreadIndex != ExternalThreadIndex && "threads outside the pool only have a slot while running tasks");
+
+        //release builds fall back to the external slot rather than indexing past the end of per thread data
+        return g_CurrentThreadIndex == ExternalThreadIndex ? GetExternalThreadIndex() : g_CurrentThreadIndex;
+    }
+
+    uint ThreadPool::GetChunkCount(uint count, uint grainSize) const
+    {
+        //a few chunks per thread leaves room for stealing to even out chunks that take longer than others
+        const uint ChunksPerThread = 4;
+
+        if (grainSize == 0)
+            grainSize = 1;
+
+        uint chunkCount = (count + grainSize - 1) / grainSize;
+        uint maxChunks = GetThreadCount() * ChunksPerThread;
+        chunkCount = chunkCount < maxChunks ? chunkCount : maxChunks;
+        if (chunkCount <= 1)
+            return 1;
+
+        //recount with the rounded up chunk size so that every chunk is non empty
+        uint chunkSize = (count + chunkCount - 1) / chunkCount;
+        return (count + chunkSize - 1) / chunkSize;
+    }
+
+    bool ThreadPool::TryExecuteTask(uint threadIndex)
+    {
+        Task task;
+        bool found = _data->queues[threadIndex]->Pop(task);
+
+        uint queueCount = _data->queues.size();
+        for (uint i = 1; i < queueCount && !found; i++)
+            found = _data->queues[(threadIndex + i) % queueCount]->Steal(task);
+
+        if (!found)
+            return false;
+
+        _data->pendingTasks.fetch_sub(1);
+        task.callback(threadIndex, task.pData);
+        task.pCounter->_count.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include "Types.h"
+
+namespace SunEngine
+{
+	class ThreadPool
+	{
+	public:
+		typedef void(*TaskCallback)(uint threadIndex, void* pData);
+
+		//Tracks a group of tasks so they can be waited on independently of the rest of the pool
+		class Counter
+		{
+		public:
+			Counter() : _count(0) {}
+			Counter(const Counter&) = delete;
+			Counter& operator = (const Counter&) = delete;
+
+			bool Done() const { return _count.load(std::memory_order_acquire) == 0; }
+
+		private:
+			friend class ThreadPool;
+			std::atomic<uint> _count;
+		};
+
+		static ThreadPool& Get();
+
+		//Tasks begin executing as soon as they are added, tasks added from inside a running task go to that worker's own queue
+		void AddTask(TaskCallback callback, void* pData);
+		void AddTask(TaskCallback callback, void* pData, Counter* pCounter);
+
+		//Waits on every task added without a counter, the calling thread executes queued work while it waits
+		void Wait();
+		void Wait(Counter& counter);
+
+		//Includes the main thread (the one that first calls Get) which always runs with index 0
+		uint GetThreadCount() const { return _threads.size() + 1; }
+		//Use this to size per thread scratch data, adds a last slot used by any other thread while it runs tasks during a Wait
+		uint GetSlotCount() const { return _threads.size() + 2; }
+		//Only valid on the main thread, inside tasks and inside RunOnCallingThread, other threads don't own a slot outside of those
+		uint GetCurrentThreadIndex() const;
+
+		//Calls func(threadIndex) on the calling thread. Threads outside the pool hold the external slot for the call like they
+		//do while they wait, so serial paths can index PerThreadData from any thread
+		template<typename Func>
+		void RunOnCallingThread(const Func& func);
+
+		//Calls func(threadIndex, i) for every i in [begin, end), iterations are split into chunks of at least grainSize
+		template<typename Func>
+		void ParallelFor(uint begin, uint end, uint grainSize, const Func& func);
+
+		//Calls func(threadIndex, chunkBegin, chunkEnd) once per chunk, for loops that want to hoist per chunk setup
+		template<typename Func>
+		void ParallelForRange(uint begin, uint end, uint grainSize, const Func& func);
+
+		//func(threadIndex, i, partial) accumulates into a per chunk partial that starts as identity,
+		//partials are combined in chunk order with reduce(result, partial) so the result doesn't depend on scheduling
+		template<typename T, typename Func, typename ReduceFunc>
+		T ParallelReduce(uint begin, uint end, uint grainSize, const T& identity, const Func& func, const ReduceFunc& reduce);
+
+	private:
+		class WorkerThread;
+		struct ThreadData;
+		struct Task;
+
+		ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator= (const ThreadPool&) = delete;
+		~ThreadPool();
+
+		bool TryExecuteTask(uint threadIndex);
+		void RunInline(TaskCallback callback, void* pData);
+		void WaitExternal(Counter& counter);
+		uint GetExternalThreadIndex() const { return GetSlotCount() - 1; }
+		uint GetChunkCount(uint count, uint grainSize) const;
+
+		UniquePtr<ThreadData> _data;
+		Vector<UniquePtr<WorkerThread>> _threads;
+	};
+
+	//Scratch storage with one slot per pool thread, index it with the threadIndex handed to tasks
+	template<typename T>
+	class PerThreadData
+	{
+	public:
+		PerThreadData() { _data.resize(ThreadPool::Get().GetSlotCount()); }
+
+		T& operator[](uint threadIndex) { return _data[threadIndex]; }
+		const T& operator[](uint threadIndex) const { return _data[threadIndex]; }
+
+		uint GetCount() const { return _data.size(); }
+
+		typename Vector<T>::iterator begin() { return _data.begin(); }
+		typename Vector<T>::iterator end() { return _data.end(); }
+		typename Vector<T>::const_iterator begin() const { return _data.begin(); }
+		typename Vector<T>::const_iterator end() const { return _data.end(); }
+
+	private:
+		Vector<T> _data;
+	};
+
+	template<typename Func>
+	void ThreadPool::RunOnCallingThread(const Func& func)
+	{
+		RunInline([](uint threadIndex, void* pData) -> void {
+			(*static_cast<const Func*>(pData))(threadIndex);
+		}, const_cast<Func*>(&func));
+	}
+
+	template<typename Func>
+	void ThreadPool::ParallelForRange(uint begin, uint end, uint grainSize, const Func& func)
+	{
+		if (end <= begin)
+			return;
+
+		uint count = end - begin;
+		uint chunkCount = GetChunkCount(count, grainSize);
+		if (chunkCount == 1)
+		{
+			RunOnCallingThread([&](uint threadIndex) -> void { func(threadIndex, begin, end); });
+			return;
+		}
+
+		struct ChunkData
+		{
+			const Func* pFunc;
+			uint begin;
+			uint end;
+		};
+
+		uint chunkSize = (count + chunkCount - 1) / chunkCount;
+		Vector<ChunkData> chunks;
+		chunks.resize(chunkCount);
+
+		Counter counter;
+		for (uint i = 0; i < chunkCount; i++)
+		{
+			chunks[i].pFunc = &func;
+			chunks[i].begin = begin + i * chunkSize;
+			chunks[i].end = i == chunkCount - 1 ? end : chunks[i].begin + chunkSize;
+			AddTask([](uint threadIndex, void* pData) -> void {
+				ChunkData* pChunk = static_cast<ChunkData*>(pData);
+				(*pChunk->pFunc)(threadIndex, pChunk->begin, pChunk->end);
+			}, &chunks[i], &counter);
+		}
+
+		Wait(counter);
+	}
+
+	template<typename Func>
+	void ThreadPool::ParallelFor(uint begin, uint end, uint grainSize, const Func& func)
+	{
+		ParallelForRange(begin, end, grainSize, [&func](uint threadIndex, uint chunkBegin, uint chunkEnd) -> void {
+			for (uint i = chunkBegin; i < chunkEnd; i++)
+				func(threadIndex, i);
+		});
+	}
+
+	template<typename T, typename Func, typename ReduceFunc>
+	T ThreadPool::ParallelReduce(uint begin, uint end, uint grainSize, const T& identity, const Func& func, const ReduceFunc& reduce)
+	{
+		T result = identity;
+		if (end <= begin)
+			return result;
+
+		uint count = end - begin;
+		uint chunkCount = GetChunkCount(count, grainSize);
+		uint chunkSize = (count + chunkCount - 1) / chunkCount;
+
+		Vector<T> partials;
+		partials.resize(chunkCount, identity);
+
+		ParallelForRange(0, chunkCount, 1, [&](uint threadIndex, uint chunkBegin, uint chunkEnd) -> void {
+			for (uint c = chunkBegin; c < chunkEnd; c++)
+			{
+				uint first = begin + c * chunkSize;
+				uint last = c == chunkCount - 1 ? end : first + chunkSize;
+				for (uint i = first; i < last; i++)
+					func(threadIndex, i, partials[c]);
+			}
+		});
+
+		for (uint c = 0; c < chunkCount; c++)
+			reduce(result, partials[c]);
+
+		return result;
+	}
+}
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <vector>
 #include <list>
 #include <queue>
+#include <deque>
 #include <array>
 #include <stack>
 #include <unordered_set>
@@ -33,6 +34,9 @@ namespace SunEngine
 	template<typename T>
 	using Queue = std::queue<T>;
 
+	template<typename T>
+	using Deque = std::deque<T>;
+
 	template<typename K, typename V, typename Hash = std::hash<K>>
 	using Map = std::unordered_map<K, V, Hash>;
 
@@ -17,6 +17,7 @@
 #include "Terrain.h"
 #include "FilePathMgr.h"
 #include "Animation.h"
+#include "TextureStreamer.h"
 
 #include "GameEditor.h"
 
@@ -46,7 +47,7 @@ namespace SunEngine
 
 	GameEditor::~GameEditor()
 	{
-
+		TextureStreamer::Get().Clear();
 	}
 
 	bool GameEditor::CustomParseConfig(ConfigFile* pConfig)
@@ -155,6 +156,8 @@ namespace SunEngine
 
 	void GameEditor::CustomUpdate()
 	{
+		TextureStreamer::Get().Update();
+
 		Scene* pScene = SceneMgr::Get().GetActiveScene();
 		//for (SceneNode* node : TEST_NODES) node->Orientation.Angles.y += 5.0f;
 
@@ -170,20 +173,19 @@ namespace SunEngine
 			for (auto& node : gTestAnimNodes)
 			{
 				glm::vec3 fwd = node.pNode->GetWorld()[2];
-				glm::vec3 targetDir = glm::normalize((node.target - node.pNode->Position) * glm::vec3(1, 0, 1));
+				glm::vec3 targetDir = glm::normalize((node.target - node.pNode->GetPosition()) * glm::vec3(1, 0, 1));
 				if (glm::isinf(targetDir).x || glm::isnan(targetDir).x) targetDir = Vec3::Zero;
 
 				float d = glm::dot(fwd, targetDir);
 				if (d <= 0.0f)
 				{
 					node.target = glm::linearRand(glm::vec3(-gTestWorldSize, 0.0f, -gTestWorldSize) * 0.5f, glm::vec3(gTestWorldSize, 0.0f, gTestWorldSize) * 0.5f) * 0.5f;
-					node.pNode->Orientation.Mode = ORIENT_QUAT;
-					targetDir = glm::normalize((node.target - node.pNode->Position) * glm::vec3(1, 0, 1));
-					node.pNode->Orientation.Quat = glm::quatLookAt(-targetDir, Vec3::Up);
+					targetDir = glm::normalize((node.target - node.pNode->GetPosition()) * glm::vec3(1, 0, 1));
+					node.pNode->SetOrientation(glm::quatLookAt(-targetDir, Vec3::Up));
 				}
 				else
 				{
-					node.pNode->Position += targetDir * dt * node.pAnimator->GetSpeed();
+					node.pNode->SetPosition(node.pNode->GetPosition() + targetDir * dt * node.pAnimator->GetSpeed());
 				}
 			}
 		}
@@ -326,7 +328,7 @@ namespace SunEngine
 				TextureCube* pSkyCube = resMgr.AddTextureCube("DefaultSkybox");
 				String path = GetDirectory(GetConfig().GetFilename()) + "/" + skyPath + "/";
 				SkyModelSkybox* pSkybox = static_cast<SkyModelSkybox*>(pEnv->GetSkyModel(DefaultShaders::Skybox));
-				if (!(pSkyCube->LoadFromFile(path, skySides) && pSkyCube->RegisterToGPU() && pSkybox->SetSkybox(pSkyCube)))
+				if (!(pSkyCube->LoadFromFile(path, skySides) && pSkyCube->GenerateMips() && pSkyCube->RegisterToGPU() && pSkybox->SetSkybox(pSkyCube)))
 				{
 					spdlog::error("Failed to load skybox located at {}", path.c_str());
 					return false;
@@ -378,7 +380,7 @@ namespace SunEngine
 			pRenderer->SetMaterial(pTestMaterial);
 
 			SceneNode* pSceneNode = pAssetBlinnPhong->CreateSceneNode(pScene);
-			pSceneNode->Position = glm::vec3(+0.0f, 1.5f, 0.0f);
+			pSceneNode->SetPosition(glm::vec3(+0.0f, 1.5f, 0.0f));
 			//pSceneNode->Scale = glm::vec3(30, 1.0f, 30.0f);
 		}
 
@@ -419,12 +421,12 @@ namespace SunEngine
 					pRenderer->GetMaterial()->RegisterToGPU();
 					pRenderer->GetMaterial()->SetMaterialVar(MaterialStrings::DiffuseColor, glm::linearRand(Vec3::Zero, Vec3::One));
 
-					pCube->Position = glm::vec3(i * Offset - halfOffset, -1.5f, j * Offset - halfOffset);
-					pCube->Position = glm::linearRand(glm::vec3(-gTestWorldSize, 0.0f, -gTestWorldSize) * 0.5f, glm::vec3(gTestWorldSize, 0.0f, gTestWorldSize) * 0.5f);
-					pCube->Scale.y = 10;
+					pCube->SetPosition(glm::vec3(i * Offset - halfOffset, -1.5f, j * Offset - halfOffset));
+					pCube->SetPosition(glm::linearRand(glm::vec3(-gTestWorldSize, 0.0f, -gTestWorldSize) * 0.5f, glm::vec3(gTestWorldSize, 0.0f, gTestWorldSize) * 0.5f));
+					pCube->SetScale(glm::vec3(1.0f, 10.0f, 1.0f));
 					//pCubeSceneNode->Position.x += XStart;
 					//pCubeSceneNode->Scale = glm::linearRand(glm::vec3(0.0f), glm::vec3(1.0f));
-					pCube->Orientation.Angles.x = glm::linearRand((0.0f), (360.0f));
+					pCube->SetOrientation(glm::vec3(glm::linearRand((0.0f), (360.0f)), 0.0f, 0.0f), pCube->GetOrientation().Mode);
 				}
 			}
 			SceneNode* pNode =  pAssetTestCubes->CreateSceneNode(pScene);
@@ -543,6 +545,7 @@ namespace SunEngine
 
 		auto options = SunEngine::AssetImporter::Options::Default;
 		options.MaxTextureSize = 1024;
+		options.StreamTextures = true;
 		Asset* pAsset = 0;
 		pAsset = ImportAsset(strAsset, options);
 		if (pAsset)
@@ -611,7 +614,7 @@ namespace SunEngine
 			pRenderer->GetMaterial()->SetMaterialVar(MaterialStrings::Metallic, 500.0f);
 
 			SceneNode* pHelmet = pAsset->CreateSceneNode(pScene, 2);
-			pHelmet->Position = glm::vec3(3.0f, 2.0f, -3.0f);
+			pHelmet->SetPosition(glm::vec3(3.0f, 2.0f, -3.0f));
 		}
 
 		struct AnimTestData
@@ -20,6 +20,16 @@
 
 namespace SunEngine
 {
+	static void SetTerrainObserver(SceneNode* pNode, void* pData)
+	{
+		for (auto iter = pNode->BeginComponent(); iter != pNode->EndComponent(); ++iter)
+		{
+			Component* c = *iter;
+			if (c->GetType() == COMPONENT_RENDER_OBJECT && c->As<RenderObject>()->GetRenderType() == RO_TERRAIN)
+				c->As<Terrain>()->SetStreamingObserver(*static_cast<const glm::vec3*>(pData));
+		}
+	}
+
 	ICameraView::ICameraView(const String& name) : View(name), _camNode(0)
 	{
 		_camera = _camNode.AddComponent(new Camera())->As<Camera>();
@@ -37,8 +47,11 @@ namespace SunEngine
 
 		Camera* pCamera = GetCamera();
 		pCamera->SetProjection(GetFOV(), GetAspectRatio(), GetNearZ(), GetFarZ());
-		GetTransform(_camNode.Position, _camNode.Orientation.Quat);
-		_camNode.Orientation.Mode = ORIENT_QUAT;
+		glm::vec3 position;
+		glm::quat rotation;
+		GetTransform(position, rotation);
+		_camNode.SetPosition(position);
+		_camNode.SetOrientation(rotation);
 		_camNode.Update(dt, et);
 	}
 
@@ -48,6 +61,9 @@ namespace SunEngine
 		_renderer = pRenderer;
 		_shaderBufferUsageCount = 0;
 		_debugFrustum = 0;
+		_sculpt = false;
+		_sculptRadius = 32.0f;
+		_sculptStrength = 4.0f;
 	}
 
 	SceneView::~SceneView()
@@ -185,6 +201,10 @@ namespace SunEngine
 		ICameraView::Update(pWindow, pEvents, nEvents, dt, et);
 		SetVisible(true);
 
+		//streamed terrains keep their window around the editor camera
+		glm::vec3 observer = GetCameraData()->GetPosition();
+		SceneMgr::Get().GetActiveScene()->Traverse(SetTerrainObserver, &observer);
+
 #if 0
 		if (_debugFrustum == 0)
 		{
@@ -284,6 +304,13 @@ namespace SunEngine
 					if (pScene->Raycast(pCamData->GetPosition(), glm::normalize(glm::vec3(rayDir)), hit))
 					{
 						_selNodeName = hit.pHitNode->GetNode()->GetName();
+
+						RenderObject* pRenderObject = hit.pHitNode->GetRenderObject();
+						if (_sculpt && pRenderObject->GetRenderType() == RO_TERRAIN)
+						{
+							glm::vec3 localPos = glm::vec3(hit.pHitNode->GetInvWorldMatirx() * glm::vec4(hit.position, 1.0f));
+							static_cast<Terrain*>(pRenderObject)->Sculpt(localPos, _sculptRadius, _sculptStrength);
+						}
 						//spdlog::info("Hit: {}, pos: {},{},{}, norm: {},{},{}", hit.pHitNode->GetNode()->GetName(), hit.position.x, hit.position.y, hit.position.z, hit.normal.x, hit.normal.y, hit.normal.z);
 					}
 
@@ -470,9 +497,12 @@ namespace SunEngine
 			bool visible = pNode->GetVisible();
 			if (ImGui::Checkbox("Visible", &visible)) pNode->SetVisible(visible);
 
-			ImGui::DragFloat3("Position", &pNode->Position[0]);
-			ImGui::DragFloat3("Scale", &pNode->Scale[0]);
-			ImGui::DragFloat3("Angles", &pNode->Orientation.Angles[0]);
+			glm::vec3 position = pNode->GetPosition();
+			if (ImGui::DragFloat3("Position", &position[0])) pNode->SetPosition(position);
+			glm::vec3 scale = pNode->GetScale();
+			if (ImGui::DragFloat3("Scale", &scale[0])) pNode->SetScale(scale);
+			glm::vec3 angles = pNode->GetOrientation().Angles;
+			if (ImGui::DragFloat3("Angles", &angles[0])) pNode->SetOrientation(angles, pNode->GetOrientation().Mode);
 
 			for (auto iter = pNode->BeginComponent(); iter != pNode->EndComponent(); ++iter)
 			{
@@ -547,6 +577,22 @@ namespace SunEngine
 		Vector<Terrain::Biome*> biomes;
 		pTerrain->GetBiomes(biomes);
 
+		float LODDistance = pTerrain->GetLODDistance();
+		if (ImGui::DragFloat("LODDistance", &LODDistance, 1.0f, 16.0f, 4096.0f)) pTerrain->SetLODDistance(LODDistance);
+		bool PackedNormals = pTerrain->GetPackedNormals();
+		if (ImGui::Checkbox("PackedNormals", &PackedNormals)) pTerrain->SetPackedNormals(PackedNormals);
+		ImGui::Checkbox("Sculpt", &_sculpt);
+		ImGui::DragFloat("SculptRadius", &_sculptRadius, 0.5f, 1.0f, 512.0f);
+		ImGui::DragFloat("SculptStrength", &_sculptStrength, 0.1f, -64.0f, 64.0f);
+
+		if (pTerrain->IsTiled())
+		{
+			TerrainTileCache::Status status = pTerrain->GetTileStatus();
+			int TileBudgetMB = (int)(status.MemoryBudget / (1024 * 1024));
+			if (ImGui::DragInt("TileBudgetMB", &TileBudgetMB, 1.0f, 16, 16384)) pTerrain->SetTileMemoryBudget(uint64(TileBudgetMB) * 1024 * 1024);
+			ImGui::Text("Tiles: %u resident, %u loading, %.1f MB", status.Resident, status.Loading, status.ResidentBytes / (1024.0f * 1024.0f));
+		}
+
 		for (auto& biome : biomes)
 		{
 			if (ImGui::TreeNode(biome->GetName().c_str()))
@@ -128,6 +128,11 @@ namespace SunEngine
 		SceneNode* _debugFrustum;
 
 		bool _resizeOccured;
+
+		//middle clicks on a terrain sculpt it instead of only selecting it
+		bool _sculpt;
+		float _sculptRadius;
+		float _sculptStrength;
 	};
 
 	class ShadowMapView : public View
@@ -16,6 +16,7 @@
 #include "CascadedShadowMap.h"
 #include "GraphicsWindow.h"
 #include "Animation.h"
+#include "TextureStreamer.h"
 
 #include "SceneRenderer.h"
 
@@ -36,6 +37,7 @@ namespace SunEngine
 		_bInit = false;
 		_currentCamera = 0;
 		_currentEnvironment = 0;
+		_screenSizeScale = 0.0f;
 		_cameraBuffer = UniquePtr<UniformBufferData>(new UniformBufferData());
 		_environmentBuffer = UniquePtr<UniformBufferData>(new UniformBufferData());
 		_shadowBuffer = UniquePtr<UniformBufferData>(new UniformBufferData());
@@ -245,6 +247,7 @@ namespace SunEngine
 		camData.CameraData.row0.Set(0.0f, 0.0f, (float)pOutputTexture->GetWidth(), (float)pOutputTexture->GetHeight());
 		camData.CameraData.row1.Set(_currentCamera->C()->As<Camera>()->GetNearZ(), _currentCamera->C()->As<Camera>()->GetFarZ(), 0.0f, 0.0f);
 		cameraDataList.push_back(camData);
+		_screenSizeScale = proj[1][1] * 0.5f * (float)pOutputTexture->GetHeight();
 
 		static float rotation = 0;
 		//if (GraphicsWindow::KeyDown(KEY_V))
@@ -275,13 +278,20 @@ namespace SunEngine
 		//pos = pixelMtx * pos;
 		//pos /= pos.w;
 
+		//render nodes that passed culling for each view, the main camera is view 0 followed by the shadow cascades and the probe face being updated
+		Vector<const glm::vec4*> viewFrusta;
+		viewFrusta.push_back(_currentCamera->GetFrustumPlanes());
+
+		uint cascadeCount = 0;
 		if (EngineInfo::GetRenderer().ShadowsEnabled())
 		{
+			//subtrees inside the bounds found so far can't grow them, so only the outer part of the tree gets visited
 			_shadowCasterAABB.Reset();
 			pScene->TraverseRenderNodes(
-				[](const AABB&, void*) -> bool {
-				return true;
-			}, 0,
+				[](const AABB& aabb, void* pAABBData) -> bool {
+				const AABB* pCasterAABB = static_cast<const AABB*>(pAABBData);
+				return !pCasterAABB->IsValid() || !pCasterAABB->Contains(aabb);
+			}, &_shadowCasterAABB,
 				[](RenderNode* pNode, void* pNodeData) -> void {	
 				SceneRenderer* pThis = static_cast<SceneRenderer*>(pNodeData);
 				if (pThis->ShouldRender(pNode))
@@ -294,40 +304,39 @@ namespace SunEngine
 
 			UpdateShadowCascades(cameraDataList);
 
-			ThreadPool& tp = ThreadPool::Get();
-			struct ThreadData
+			if (EngineInfo::GetRenderer().CascadeShadowMapSplits())
 			{
-				SceneRenderer* pThis;
-				DepthRenderData* pDepthData;
-				Scene* pScene;
-			};
+				cascadeCount = _depthPasses.size();
+				for (uint i = 0; i < cascadeCount; i++)
+					viewFrusta.push_back(_depthPasses[i]->CameraData->GetFrustumPlanes());
+			}
+		}
 
-			Vector<ThreadData> threadDataList;
-			threadDataList.resize(EngineInfo::GetRenderer().CascadeShadowMapSplits());
-			for(uint i = 0; i < _depthPasses.size(); i++)
-			{
-				threadDataList[i].pDepthData = _depthPasses[i].get();
-				threadDataList[i].pScene = pScene;
-				threadDataList[i].pThis = this;
+		uint probeView = viewFrusta.size();
+		if (_envProbeData.NeedsUpdate)
+			viewFrusta.push_back(_envProbeData.CameraData->GetFrustumPlanes());
+
+		_viewRenderNodes.resize(viewFrusta.size());
+		for (auto& list : _viewRenderNodes)
+			list.clear();
 
-				tp.AddTask([](uint, void* pDataPtr) -> void 
+		pScene->TraverseRenderNodes((1u << viewFrusta.size()) - 1,
+			[](const AABBBatch& boxes, uint viewMask, uint* pViewMasks, void* pCullData) -> void { FrustumAABBIntersect(static_cast<const glm::vec4* const*>(pCullData), viewMask, boxes, pViewMasks); }, viewFrusta.data(),
+			[](RenderNode* pNode, uint viewMask, void* pNodeData) -> void {
+				Vector<Vector<RenderNode*>>& viewRenderNodes = *static_cast<Vector<Vector<RenderNode*>>*>(pNodeData);
+				for (uint i = 0; i < viewRenderNodes.size(); i++)
 				{
-					ThreadData* pData = static_cast<ThreadData*>(pDataPtr);
-					//ThreadData* pData = static_cast<ThreadData*>(&threadDataList[i]);
-					pData->pScene->TraverseRenderNodes(
-						[](const AABB& aabb, void* pAABBData) -> bool { 
-							//return FrustumAABBIntersect(static_cast<const glm::vec4*>(pAABBData), aabb);
-							return static_cast<DepthRenderData*>(pAABBData)->CameraData->FrustumIntersects(aabb);
-							//return true;
-						}, pData->pDepthData,
-						[](RenderNode* pNode, void* pNodeData) -> void { 
-							ThreadData* pData = static_cast<ThreadData*>(pNodeData); 
-							pData->pThis->ProcessDepthRenderNode(pNode, pData->pDepthData); 
-						}, pData);
+					if (viewMask & (1u << i))
+						viewRenderNodes[i].push_back(pNode);
 				}
-				, & threadDataList[i]);
-			}
-			tp.Wait();
+			}, &_viewRenderNodes);
+
+		if (cascadeCount)
+		{
+			ThreadPool::Get().ParallelFor(0, cascadeCount, 1, [this](uint, uint i) -> void {
+				for (RenderNode* pNode : _viewRenderNodes[1 + i])
+					ProcessDepthRenderNode(pNode, _depthPasses[i].get());
+			});
 
 			for (auto& pass : _depthPasses)
 			{
@@ -351,9 +360,7 @@ namespace SunEngine
 					GetPipeline(data, sorted, true);
 
 					ObjectBufferData objBuffer = {};
-					glm::mat4 itp = glm::transpose(glm::inverse(data.RenderNode->GetWorld()));
-					objBuffer.WorldMatrix.Set(&data.RenderNode->GetWorld());
-					objBuffer.InverseTransposeMatrix.Set(&itp);
+					FillObjectBuffer(data, objBuffer);
 					pass->ObjectBufferGroup.Update(&objBuffer, data.ObjectBufferIndex, &data.ObjectBindings, data.Pipeline->GetShader());
 
 					//TODO skinned shadow objects
@@ -371,9 +378,20 @@ namespace SunEngine
 			}
 		}
 
-		pScene->TraverseRenderNodes(
-			[](const AABB& aabb, void* pAABBData) -> bool { return static_cast<CameraComponentData*>(pAABBData)->FrustumIntersects(aabb); }, _currentCamera,
-			[](RenderNode* pNode, void* pNodeData) -> void { static_cast<SceneRenderer*>(pNodeData)->ProcessRenderNode(pNode); }, this);
+		if (_envProbeData.NeedsUpdate)
+		{
+			for (RenderNode* pNode : _viewRenderNodes[probeView])
+				ProcessEnvProbeRenderNode(pNode);
+
+			_envProbeData.ObjectBufferGroup.Flush();
+			_envProbeData.ObjectBufferGroup.Reset();
+
+			_envProbeData.SkinnedBonesBufferGroup.Flush();
+			_envProbeData.SkinnedBonesBufferGroup.Reset();
+		}
+
+		for (RenderNode* pNode : _viewRenderNodes[0])
+			ProcessRenderNode(pNode);
 
 		//push current udpates to buffer
 		_objectBufferGroup.Flush();
@@ -584,13 +602,14 @@ namespace SunEngine
 		if (!ShouldRender(pNode))
 			return;
 
-		SceneNode* pSceneNode = pNode->GetNode();
-		//if (!StrContains(pSceneNode->GetName(), "Frustum"))
-		{
-			if (!_currentCamera->FrustumIntersects(pNode->GetWorldAABB()))
-				return;
-		}
+		//the world bounds were already culled against the camera during the scene traversal
 
+		//screen coverage of the bounds decides how much of the material's streamed textures stays resident
+		const AABB& worldBox = pNode->GetWorldAABB();
+		float radius = glm::length(worldBox.Max - worldBox.Min) * 0.5f;
+		float distance = glm::max(glm::length(worldBox.GetCenter() - _currentCamera->GetPosition()), radius);
+		if (distance > 0.0f)
+			TextureStreamer::Get().SetScreenSize(pMaterial, 2.0f * radius * _screenSizeScale / distance);
 
 		bool sorted = false;
 		RenderNodeData data = {};
@@ -599,31 +618,37 @@ namespace SunEngine
 		GetPipeline(data, sorted);
 
 		BaseShader* pShader = pMaterial->GetShader()->GetBaseVariant(data.BaseVariantMask);
+		bool skinned = PerformSkinningCheck(pNode);
+		_currentShaders.insert(pShader);
 
-		ObjectBufferData objBuffer = {};
-		glm::mat4 itp = glm::transpose(glm::inverse(pNode->GetWorld()));
-		objBuffer.WorldMatrix.Set(&pNode->GetWorld());
-		objBuffer.InverseTransposeMatrix.Set(&itp);
-
-		_objectBufferGroup.Update(&objBuffer, data.ObjectBufferIndex, &data.ObjectBindings, pShader);
+		bool terrain = SelectTerrainPatches(pNode, _currentCamera->GetFrustumPlanes(), _terrainPatches);
+		uint drawCount = terrain ? _terrainPatches.size() : 1;
+		for (uint i = 0; i < drawCount; i++)
+		{
+			RenderNodeData drawData = data;
+			if (terrain)
+				drawData.TerrainPatch = _terrainPatches[i];
 
-		if (PerformSkinningCheck(pNode))
-			_skinnedBonesBufferGroup.Update(_skinnedBoneMatrixBlock.data(), data.SkinnedBoneBufferIndex, &data.SkinnedBoneBindings, pShader);
+			ObjectBufferData objBuffer = {};
+			FillObjectBuffer(drawData, objBuffer);
+			_objectBufferGroup.Update(&objBuffer, drawData.ObjectBufferIndex, &drawData.ObjectBindings, pShader);
 
-		_currentShaders.insert(pShader);
+			if (skinned)
+				_skinnedBonesBufferGroup.Update(_skinnedBoneMatrixBlock.data(), drawData.SkinnedBoneBufferIndex, &drawData.SkinnedBoneBindings, pShader);
 
-		if (!sorted)
-		{
-			if(data.BaseVariantMask & ShaderVariant::GBUFFER)
-				_gbufferRenderList.push_back(data);
+			if (!sorted)
+			{
+				if (drawData.BaseVariantMask & ShaderVariant::GBUFFER)
+					_gbufferRenderList.push_back(drawData);
+				else
+					_opaqueRenderList.push_back(drawData);
+			}
 			else
-				_opaqueRenderList.push_back(data);
-		}
-		else
-		{
-			glm::vec3 vDelta = pNode->GetWorldAABB().GetCenter() - _currentCamera->GetPosition();
-			data.SortingDistance = glm::dot(vDelta, vDelta);
-			_sortedRenderList.push_back(data);
+			{
+				glm::vec3 vDelta = pNode->GetWorldAABB().GetCenter() - _currentCamera->GetPosition();
+				drawData.SortingDistance = glm::dot(vDelta, vDelta);
+				_sortedRenderList.push_back(drawData);
+			}
 		}
 	}
 
@@ -641,9 +666,6 @@ namespace SunEngine
 		//if (!pDepthData->FrustumBox.Contains(box))
 		//	return;
 
-		if (!pDepthData->CameraData->FrustumIntersects(pNode->GetWorldAABB()))
-			return;
-
 		Material* pMaterial = pNode->GetMaterial();
 		uint64 variantMask = GetVariantMask(pNode);
 		uint64 depthVariantMask = (variantMask & ~ShaderVariant::GBUFFER) | ShaderVariant::DEPTH;
@@ -655,7 +677,20 @@ namespace SunEngine
 			depthNode.DepthHash = CalculateDepthVariantHash(pMaterial, depthVariantMask);
 			depthNode.BaseVariantMask = variantMask;
 			depthNode.RenderNode = pNode;
-			pDepthData->RenderList.push_back(depthNode);
+
+			//terrain LOD is still picked from the main camera, the cascade only culls the patches
+			if (SelectTerrainPatches(pNode, pDepthData->CameraData->GetFrustumPlanes(), pDepthData->TerrainPatches))
+			{
+				for (const Terrain::PatchInstance& patch : pDepthData->TerrainPatches)
+				{
+					depthNode.TerrainPatch = patch;
+					pDepthData->RenderList.push_back(depthNode);
+				}
+			}
+			else
+			{
+				pDepthData->RenderList.push_back(depthNode);
+			}
 		}
 	}
 
@@ -694,10 +729,11 @@ namespace SunEngine
 				renderData.SkinnedBoneBindings->ShaderBindings.at(pShader).Bind(cmdBuffer, &skinnedBoneBindData);
 			}
 
+			bool patch = renderData.TerrainPatch.IndexCount != 0;
 			cmdBuffer->DrawIndexed(
-				renderData.RenderNode->GetIndexCount(),
+				patch ? renderData.TerrainPatch.IndexCount : renderData.RenderNode->GetIndexCount(),
 				renderData.RenderNode->GetInstanceCount(),
-				renderData.RenderNode->GetFirstIndex(),
+				patch ? renderData.TerrainPatch.FirstIndex : renderData.RenderNode->GetFirstIndex(),
 				renderData.RenderNode->GetVertexOffset(),
 				0);
 
@@ -763,6 +799,30 @@ namespace SunEngine
 		return true;
 	}
 
+	bool SceneRenderer::SelectTerrainPatches(const RenderNode* pNode, const glm::vec4* pFrustumPlanes, Vector<Terrain::PatchInstance>& patches) const
+	{
+		if (pNode->GetRenderObject()->GetRenderType() != RO_TERRAIN)
+			return false;
+
+		//every view measures the LOD from the main camera so shadows and probes see the terrain that is drawn
+		static_cast<const Terrain*>(pNode->GetRenderObject())->SelectPatches(pNode, _currentCamera->GetPosition(), pFrustumPlanes, patches);
+		return true;
+	}
+
+	void SceneRenderer::FillObjectBuffer(const RenderNodeData& data, ObjectBufferData& objBuffer) const
+	{
+		objBuffer.WorldMatrix.Set(&data.RenderNode->GetWorld());
+		if (data.TerrainPatch.IndexCount)
+		{
+			objBuffer.InverseTransposeMatrix.Set(&data.TerrainPatch.PatchMatrix);
+		}
+		else
+		{
+			glm::mat4 itp = glm::transpose(glm::inverse(data.RenderNode->GetWorld()));
+			objBuffer.InverseTransposeMatrix.Set(&itp);
+		}
+	}
+
 	bool SceneRenderer::TryBindBuffer(CommandBuffer* cmdBuffer, BaseShader* pShader, UniformBufferData* buffer, IBindState* pBindState) const
 	{
 		auto found = buffer->ShaderBindings.find(pShader);
@@ -1029,9 +1089,8 @@ namespace SunEngine
 
 			SceneNode node(0);
 			glm::mat4 invView = reinterpret_cast<glm::mat4&>(cameraBuffer.InvViewMatrix);
-			node.Position = invView[3];
-			node.Orientation.Quat = glm::quat_cast(invView);
-			node.Orientation.Mode = ORIENT_QUAT;
+			node.SetPosition(invView[3]);
+			node.SetOrientation(glm::quat_cast(invView));
 			node.UpdateTransform();
 
 			camera.Update(&node, pDepthPass->CameraData.get(), 0, 0);
@@ -1160,9 +1219,8 @@ namespace SunEngine
 			camera.SetOrthoProjection(minExtents.x, maxExtents.x, minExtents.y, maxExtents.y, 0.0f, maxExtents.z - minExtents.z);
 			glm::mat4 invView = reinterpret_cast<glm::mat4&>(shadowCamData.InvViewMatrix);
 
-			node.Position = invView[3];
-			node.Orientation.Quat = glm::quat_cast(invView);
-			node.Orientation.Mode = ORIENT_QUAT;
+			node.SetPosition(invView[3]);
+			node.SetOrientation(glm::quat_cast(invView));
 			node.UpdateTransform();
 
 			camera.Update(&node, pDepthPass->CameraData.get(), 0, 0);
@@ -1243,11 +1301,12 @@ namespace SunEngine
 		if (_envProbeData.NeedsUpdate)
 		{
 			SceneNode node(0);
-			node.Position = _envProbeData.ProbeCenters[_envProbeData.CurrentUpdateProbe];
-			//node.Position = _currentCamera->GetPosition();
-			node.Orientation.Angles.x = EnvCubeRotations[_envProbeData.CurrentUpdateFace].y;
-			node.Orientation.Angles.y = EnvCubeRotations[_envProbeData.CurrentUpdateFace].x;
-			node.Orientation.Mode = ORIENT_XYZ;
+			node.SetPosition(_envProbeData.ProbeCenters[_envProbeData.CurrentUpdateProbe]);
+			//node.SetPosition(_currentCamera->GetPosition());
+			glm::vec3 angles = node.GetOrientation().Angles;
+			angles.x = EnvCubeRotations[_envProbeData.CurrentUpdateFace].y;
+			angles.y = EnvCubeRotations[_envProbeData.CurrentUpdateFace].x;
+			node.SetOrientation(angles, ORIENT_XYZ);
 			node.UpdateTransform();
 
 			static Camera reflectionCamera;
@@ -1269,51 +1328,45 @@ namespace SunEngine
 
 			_envProbeData.CameraIndex = cameraBuffersToFill.size();
 			cameraBuffersToFill.push_back(camData);
+		}
+	}
 
-			Scene* pScene = SceneMgr::Get().GetActiveScene();
-			pScene->TraverseRenderNodes(
-				[](const AABB& aabb, void* pAABBData) -> bool { return static_cast<CameraComponentData*>(pAABBData)->FrustumIntersects(aabb); }, _envProbeData.CameraData.get(),
-				[](RenderNode* pNode, void* pNodeData) -> void {
-				SceneRenderer* pThis = static_cast<SceneRenderer*>(pNodeData);
-				if (!pThis->ShouldRender(pNode))
-					return;
-
-				if (!pThis->_envProbeData.CameraData->FrustumIntersects(pNode->GetWorldAABB()))
-					return;
-
-				if (!pNode->GetMaterial()->GetShader()->ContainsVariants(ShaderVariant::SIMPLE_SHADING))
-					return;
-
-				bool sorted = false;
-				RenderNodeData data = {};
-				data.RenderNode = pNode;
-				data.BaseVariantMask = pThis->GetVariantMask(data.RenderNode);
-				data.BaseVariantMask &= ~ShaderVariant::GBUFFER;
-				data.BaseVariantMask |= ShaderVariant::SIMPLE_SHADING;
-				pThis->GetPipeline(data, sorted);
+	void SceneRenderer::ProcessEnvProbeRenderNode(RenderNode* pNode)
+	{
+		if (!ShouldRender(pNode))
+			return;
 
-				BaseShader* pShader = pNode->GetMaterial()->GetShader()->GetBaseVariant(data.BaseVariantMask);
+		if (!pNode->GetMaterial()->GetShader()->ContainsVariants(ShaderVariant::SIMPLE_SHADING))
+			return;
 
-				ObjectBufferData objBuffer = {};
-				glm::mat4 itp = glm::transpose(glm::inverse(pNode->GetWorld()));
-				objBuffer.WorldMatrix.Set(&pNode->GetWorld());
-				objBuffer.InverseTransposeMatrix.Set(&itp);
+		bool sorted = false;
+		RenderNodeData data = {};
+		data.RenderNode = pNode;
+		data.BaseVariantMask = GetVariantMask(data.RenderNode);
+		data.BaseVariantMask &= ~ShaderVariant::GBUFFER;
+		data.BaseVariantMask |= ShaderVariant::SIMPLE_SHADING;
+		GetPipeline(data, sorted);
 
-				pThis->_envProbeData.ObjectBufferGroup.Update(&objBuffer, data.ObjectBufferIndex, &data.ObjectBindings, pShader);
+		BaseShader* pShader = pNode->GetMaterial()->GetShader()->GetBaseVariant(data.BaseVariantMask);
+		bool skinned = PerformSkinningCheck(pNode);
+		_currentShaders.insert(pShader);
 
-				if (pThis->PerformSkinningCheck(pNode))
-					pThis->_envProbeData.SkinnedBonesBufferGroup.Update(pThis->_skinnedBoneMatrixBlock.data(), data.SkinnedBoneBufferIndex, &data.SkinnedBoneBindings, pShader);
+		bool terrain = SelectTerrainPatches(pNode, _envProbeData.CameraData->GetFrustumPlanes(), _terrainPatches);
+		uint drawCount = terrain ? _terrainPatches.size() : 1;
+		for (uint i = 0; i < drawCount; i++)
+		{
+			RenderNodeData drawData = data;
+			if (terrain)
+				drawData.TerrainPatch = _terrainPatches[i];
 
-				pThis->_currentShaders.insert(pShader);
-				pThis->_envProbeData.RenderList.push_back(data);
-			
-				}, this);
+			ObjectBufferData objBuffer = {};
+			FillObjectBuffer(drawData, objBuffer);
+			_envProbeData.ObjectBufferGroup.Update(&objBuffer, drawData.ObjectBufferIndex, &drawData.ObjectBindings, pShader);
 
-			_envProbeData.ObjectBufferGroup.Flush();
-			_envProbeData.ObjectBufferGroup.Reset();
+			if (skinned)
+				_envProbeData.SkinnedBonesBufferGroup.Update(_skinnedBoneMatrixBlock.data(), drawData.SkinnedBoneBufferIndex, &drawData.SkinnedBoneBindings, pShader);
 
-			_envProbeData.SkinnedBonesBufferGroup.Flush();
-			_envProbeData.SkinnedBonesBufferGroup.Reset();
+			_envProbeData.RenderList.push_back(drawData);
 		}
 	}
 
@@ -8,6 +8,7 @@
 #include "BaseShader.h"
 #include "Material.h"
 #include "RenderTarget.h"
+#include "Terrain.h"
 
 namespace SunEngine
 {
@@ -102,6 +103,9 @@ namespace SunEngine
 			uint64 DepthHash;
 
 			float SortingDistance;
+
+			//terrain nodes are drawn as patches, a patch with indices replaces the node's index range and normal matrix
+			Terrain::PatchInstance TerrainPatch;
 		};
 
 		struct DepthRenderData
@@ -114,6 +118,7 @@ namespace SunEngine
 			AABB FrustumBox;
 			UniquePtr<CameraComponentData> CameraData;
 			uint CameraIndex;
+			Vector<Terrain::PatchInstance> TerrainPatches;
 		};
 
 		struct ReflectionProbeData
@@ -135,8 +140,11 @@ namespace SunEngine
 
 		void ProcessRenderNode(RenderNode* pNode);
 		void ProcessDepthRenderNode(RenderNode* pNode, DepthRenderData* pDepthData);
+		void ProcessEnvProbeRenderNode(RenderNode* pNode);
 		void ProcessRenderList(CommandBuffer* cmdBuffer, LinkedList<RenderNodeData>& renderList, uint cameraUpdateIndex = 0, bool isDepth = false);
 		bool GetPipeline(RenderNodeData& node, bool& sorted, bool isShadow = false);
+		bool SelectTerrainPatches(const RenderNode* pNode, const glm::vec4* pFrustumPlanes, Vector<Terrain::PatchInstance>& patches) const;
+		void FillObjectBuffer(const RenderNodeData& data, ObjectBufferData& objBuffer) const;
 		bool TryBindBuffer(CommandBuffer* cmdBuffer, BaseShader* pShader, UniformBufferData* buffer, IBindState* pBindState = 0) const;
 		void RenderEnvironment(CommandBuffer* cmdBuffer);
 		void RenderCommand(CommandBuffer* cmdBuffer, GraphicsPipeline* pPipeline, ShaderBindings* pBindings, uint vertexCount = 6, uint cameraUpdateIndex = 0);
@@ -158,6 +166,7 @@ namespace SunEngine
 		UniformBufferGroup _skinnedBonesBufferGroup;
 		CameraComponentData* _currentCamera;
 		const Environment* _currentEnvironment;
+		float _screenSizeScale; //pixels covered by a unit diameter at unit distance from the current camera
 		HashSet<BaseShader*> _currentShaders;
 		LinkedList<RenderNodeData> _gbufferRenderList;
 		LinkedList<RenderNodeData> _opaqueRenderList;
@@ -175,6 +184,8 @@ namespace SunEngine
 		RenderTarget _envTarget;
 		ReflectionProbeData _envProbeData;
 		AABB _shadowCasterAABB;
+		Vector<Vector<RenderNode*>> _viewRenderNodes;
+		Vector<Terrain::PatchInstance> _terrainPatches;
 
 		HashSet<BaseShader*> _registeredShaders;
 	};
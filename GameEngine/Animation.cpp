@@ -1,8 +1,29 @@
 #include "SceneNode.h"
 #include "Animation.h"
 
+#define INVALID_BONE 0xFFFFFFFF
+#define POSE_CHANNEL_COUNT 10
+
 namespace SunEngine
 {
+	//pPose holds POSE_CHANNEL_COUNT arrays of boneCount floats, one for each transform component
+	static TransformBatch GetPoseBatch(float* pPose, uint boneCount)
+	{
+		TransformBatch batch;
+		batch.PosX = pPose + boneCount * 0;
+		batch.PosY = pPose + boneCount * 1;
+		batch.PosZ = pPose + boneCount * 2;
+		batch.ScaleX = pPose + boneCount * 3;
+		batch.ScaleY = pPose + boneCount * 4;
+		batch.ScaleZ = pPose + boneCount * 5;
+		batch.RotX = pPose + boneCount * 6;
+		batch.RotY = pPose + boneCount * 7;
+		batch.RotZ = pPose + boneCount * 8;
+		batch.RotW = pPose + boneCount * 9;
+		batch.Count = boneCount;
+		return batch;
+	}
+
 	AnimatorComponentData::AnimatorComponentData(Component* pComponent, SceneNode* pNode, uint boneCount) : ComponentData(pComponent, pNode)
 	{
 		_clip = 0;
@@ -12,7 +33,7 @@ namespace SunEngine
 		_speed = 1.0f;
 		_playing = false;
 		_loop = true;
-		_boneUpdateCount = 0;
+		_bonesSorted = false;
 		_boneData.resize(boneCount);
 	}
 
@@ -26,33 +47,56 @@ namespace SunEngine
 		_boneData[pBoneData->C()->As<AnimatedBone>()->GetBoneIndex()] = pBoneData;
 	}
 
-	void AnimatorComponentData::IncrementBoneUpdates()
+	void AnimatorComponentData::SortBones()
 	{
-		if (_boneUpdateCount < _boneData.size())
+		uint boneCount = _boneData.size();
+		_boneParents.resize(boneCount);
+		for (uint i = 0; i < boneCount; i++)
 		{
-			++_boneUpdateCount;
-			if (_boneUpdateCount == _boneData.size())
+			_boneParents[i] = INVALID_BONE;
+			if (!_boneData[i])
+				continue;
+
+			//bones parented to a node that isn't one of this animator's bones take that node's world matrix from the scene instead
+			SceneNode* pParent = _boneData[i]->GetNode()->GetParent();
+			Component* pParentBone = pParent ? pParent->GetComponentOfType(COMPONENT_ANIMATED_BONE) : 0;
+			if (pParentBone)
 			{
-				//This call will do nothing if the mesh hasn't been updated yet, but if it has then it will want the mesh bones updated
-				//because it couldn't do so at the point its update was called due to the bones being located after the mesh in the hierarchy
-				for (auto pMesh : _meshData)
-					pMesh->UpdateBoneMatrices();
+				AnimatedBoneComponentData* pParentData = pParent->GetComponentData<AnimatedBoneComponentData>(pParentBone);
+				if (pParentData && pParentData->GetAnimatorData() == this)
+					_boneParents[i] = pParentBone->As<AnimatedBone>()->GetBoneIndex();
 			}
 		}
-		else
+
+		//parents are evaluated before their children
+		Vector<Pair<uint, uint>> depths;
+		for (uint i = 0; i < boneCount; i++)
 		{
-			assert(false);
+			if (!_boneData[i])
+				continue;
+
+			uint depth = 0;
+			for (uint parent = _boneParents[i]; parent != INVALID_BONE && depth < boneCount; parent = _boneParents[parent])
+				++depth;
+			depths.push_back(Pair<uint, uint>(depth, i));
 		}
-	}
+		std::stable_sort(depths.begin(), depths.end(), [](const Pair<uint, uint>& lhs, const Pair<uint, uint>& rhs) -> bool { return lhs.first < rhs.first; });
 
-	glm::mat4 AnimatorComponentData::CalcSkinnedBoneMatrix(uint skinIndex, uint boneIndex) const
-	{
-		return _boneData[boneIndex]->GetNode()->GetWorld() * _boneData[boneIndex]->C()->As<AnimatedBone>()->GetSkinMatrix(skinIndex);
+		_boneOrder.clear();
+		for (auto& depth : depths)
+			_boneOrder.push_back(depth.second);
+
+		_pose.resize(boneCount * POSE_CHANNEL_COUNT);
+		_localMatrices.resize(boneCount);
+		_boneWorlds.resize(boneCount, Mat4::Identity);
+		_bonesSorted = true;
 	}
 
 	Animator::Animator()
 	{
 		_boneCount = 0;
+		_skinCount = 0;
+		_poseKeysBuilt = false;
 	}
 
 	Animator::~Animator()
@@ -63,10 +107,6 @@ namespace SunEngine
 	{
 		auto* data = pData->As<AnimatorComponentData>();
 
-		data->_boneUpdateCount = 0;
-		for (auto pMesh : data->_meshData)
-			pMesh->_bUpdateCalled = false;
-
 		if(!data->ShouldUpdate())
 			return;
 
@@ -88,6 +128,112 @@ namespace SunEngine
 
 		data->_percent = (data->_time - keyTime0) / (keyTime1 - keyTime0);
 		data->_time += dt * data->_speed;
+
+		EvaluatePose(data);
+	}
+
+	const glm::mat4* Animator::GetSkinMatrices(uint skinIndex) const
+	{
+		if (!_poseKeysBuilt.load(std::memory_order_acquire) || skinIndex >= _skinCount)
+			return 0;
+
+		return &_skinMatrices[skinIndex * _boneCount];
+	}
+
+	void Animator::BuildPoseKeys(const AnimatorComponentData* pData)
+	{
+		std::lock_guard<std::mutex> lock(_poseKeyMutex);
+		if (_poseKeysBuilt.load(std::memory_order_relaxed))
+			return;
+
+		uint boneCount = pData->_boneData.size();
+		_poseKeys.resize(_clips.size());
+		for (uint clip = 0; clip < _clips.size(); clip++)
+		{
+			uint keyCount = _clips[clip].GetKeyCount();
+			_poseKeys[clip].resize(keyCount * boneCount * POSE_CHANNEL_COUNT);
+			for (uint key = 0; key < keyCount; key++)
+			{
+				TransformBatch keyPose = GetPoseBatch(&_poseKeys[clip][key * boneCount * POSE_CHANNEL_COUNT], boneCount);
+				for (uint i = 0; i < boneCount; i++)
+				{
+					AnimatedBone::Transform transform;
+					const AnimatedBone* pBone = pData->_boneData[i] ? pData->_boneData[i]->C()->As<AnimatedBone>() : 0;
+					if (pBone && clip < pBone->GetTransforms().size() && key < pBone->GetTransforms()[clip].size())
+						transform = pBone->GetTransforms()[clip][key];
+
+					keyPose.PosX[i] = transform.position.x;
+					keyPose.PosY[i] = transform.position.y;
+					keyPose.PosZ[i] = transform.position.z;
+					keyPose.ScaleX[i] = transform.scale.x;
+					keyPose.ScaleY[i] = transform.scale.y;
+					keyPose.ScaleZ[i] = transform.scale.z;
+					keyPose.RotX[i] = transform.rotation.x;
+					keyPose.RotY[i] = transform.rotation.y;
+					keyPose.RotZ[i] = transform.rotation.z;
+					keyPose.RotW[i] = transform.rotation.w;
+				}
+			}
+		}
+
+		//skin matrices are stored skin major so a mesh reads one contiguous array
+		_skinCount = 0;
+		for (uint i = 0; i < boneCount; i++)
+		{
+			if (pData->_boneData[i])
+				_skinCount = glm::max(_skinCount, pData->_boneData[i]->C()->As<AnimatedBone>()->GetSkinMatrixCount());
+		}
+
+		_skinMatrices.assign(_skinCount * boneCount, Mat4::Identity);
+		for (uint i = 0; i < boneCount; i++)
+		{
+			if (!pData->_boneData[i])
+				continue;
+
+			const AnimatedBone* pBone = pData->_boneData[i]->C()->As<AnimatedBone>();
+			for (uint skin = 0; skin < pBone->GetSkinMatrixCount(); skin++)
+				_skinMatrices[skin * boneCount + i] = pBone->GetSkinMatrix(skin);
+		}
+
+		_poseKeysBuilt.store(true, std::memory_order_release);
+	}
+
+	void Animator::EvaluatePose(AnimatorComponentData* pData)
+	{
+		uint boneCount = pData->_boneData.size();
+		if (boneCount != _boneCount || pData->_clip >= _clips.size())
+			return;
+
+		if (!_poseKeysBuilt.load(std::memory_order_acquire))
+			BuildPoseKeys(pData);
+		if (!pData->_bonesSorted)
+			pData->SortBones();
+
+		uint keyCount = _clips[pData->_clip].GetKeyCount();
+		if (!keyCount)
+			return;
+
+		uint key0 = glm::min(pData->_key, keyCount - 1);
+		uint key1 = glm::min(key0 + 1, keyCount - 1);
+		float* pKeys = _poseKeys[pData->_clip].data();
+
+		TransformBatch pose = GetPoseBatch(pData->_pose.data(), boneCount);
+		BlendTransforms(GetPoseBatch(pKeys + key0 * boneCount * POSE_CHANNEL_COUNT, boneCount), GetPoseBatch(pKeys + key1 * boneCount * POSE_CHANNEL_COUNT, boneCount), pData->_percent, pose);
+		BuildTransformMatrices(pose, pData->_localMatrices.data());
+
+		for (uint i : pData->_boneOrder)
+		{
+			SceneNode* pNode = pData->_boneData[i]->GetNode();
+			uint parent = pData->_boneParents[i];
+			const glm::mat4& parentWorld = parent != INVALID_BONE ? pData->_boneWorlds[parent] : (pNode->GetParent() ? pNode->GetParent()->GetWorld() : Mat4::Identity);
+			MultiplyMatrix(parentWorld, pData->_localMatrices[i], pData->_boneWorlds[i]);
+
+			//the setters leave the bone dirty, the scene runs the transform hierarchy again after the animators so the node
+			//matrices and anything parented under a bone follow this frame's pose
+			pNode->SetPosition(glm::vec3(pose.PosX[i], pose.PosY[i], pose.PosZ[i]));
+			pNode->SetScale(glm::vec3(pose.ScaleX[i], pose.ScaleY[i], pose.ScaleZ[i]));
+			pNode->SetOrientation(glm::quat(pose.RotW[i], pose.RotX[i], pose.RotY[i], pose.RotZ[i]));
+		}
 	}
 
 	float AnimationClip::GetKeyTime(uint keyIndex) const
@@ -126,31 +272,6 @@ namespace SunEngine
 		return pBoneData;
 	}
 
-	void AnimatedBone::Update(SceneNode* pNode, ComponentData* pData, float, float)
-	{
-		auto* data = pData->As<AnimatedBoneComponentData>();
-
-		auto* animator = data->GetAnimatorData();
-		if (!animator->ShouldUpdate())
-			return;
-
-		uint clip = animator->GetClip();
-		uint key0 = animator->GetKey();
-		uint key1 = key0 + 1;
-		float percent = animator->GetKeyPercent();
-
-		const Transform& t0 = _boneTransforms[clip][key0];
-		const Transform& t1 = _boneTransforms[clip][key1];
-
-		pNode->Position = glm::mix(t0.position, t1.position, percent);
-		pNode->Scale = glm::mix(t0.scale, t1.scale, percent);
-		pNode->Orientation.Quat = glm::slerp(t0.rotation, t1.rotation, percent);
-		pNode->Orientation.Mode = ORIENT_QUAT;
-
-		pNode->UpdateTransform();
-		animator->IncrementBoneUpdates();
-	}
-
 	AnimatedBone::Transform::Transform()
 	{
 		position = Vec3::Zero;
@@ -178,32 +299,33 @@ namespace SunEngine
 		return pMeshData;
 	}
 
-	void SkinnedMesh::Update(SceneNode* pNode, ComponentData* pData, float, float)
+	void SkinnedMesh::Update(SceneNode*, ComponentData* pData, float, float)
 	{
 		auto data = pData->As<SkinnedMeshComponentData>();
 
-		data->_bUpdateCalled = true;
-
-		//The mesh is located after the skeleton hierarchy, need to update toe bones now as the call to UpdateBoneMatrices in the animator wouldn't have done anything
-		//due to the mesh not being updated yet
-		if (data->_animatorData->GetBoneUpdateCount() == data->_meshBoneMatrices.size())
+		//skinned meshes are updated after every animator has posed its bones
+		if (data->_animatorData->ShouldUpdate())
 			data->UpdateBoneMatrices();
 	}
 
 	SkinnedMeshComponentData::SkinnedMeshComponentData(Component* pComponent, SceneNode* pNode) : ComponentData(pComponent, pNode)
 	{
-		_bUpdateCalled = false;
 		_animatorData = 0;
 	}
 
 	void SkinnedMeshComponentData::UpdateBoneMatrices()
 	{
-		if (_bUpdateCalled)
+		const Vector<glm::mat4>& boneWorlds = _animatorData->GetBoneWorlds();
+		const glm::mat4* pSkinMatrices = _animatorData->C()->As<Animator>()->GetSkinMatrices(C()->As<SkinnedMesh>()->GetSkinIndex());
+		if (!pSkinMatrices || boneWorlds.size() != _meshBoneMatrices.size())
+			return;
+
+		glm::mat4 invMtx = glm::inverse(GetNode()->GetWorld());
+		glm::mat4 boneMtx;
+		for (uint i = 0; i < _meshBoneMatrices.size(); i++)
 		{
-			glm::mat4 invMtx = glm::inverse(GetNode()->GetWorld());
-			const SkinnedMesh* pMesh = C()->As <SkinnedMesh>();
-			for (uint i = 0; i < _meshBoneMatrices.size(); i++)
-				_meshBoneMatrices[i] = invMtx * _animatorData->CalcSkinnedBoneMatrix(pMesh->GetSkinIndex(), i);
+			MultiplyMatrix(boneWorlds[i], pSkinMatrices[i], boneMtx);
+			MultiplyMatrix(invMtx, boneMtx, _meshBoneMatrices[i]);
 		}
 	}
 }
\ No newline at end of file
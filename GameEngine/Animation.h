@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+#include <atomic>
 #include "AssetNode.h"
 
 namespace SunEngine
@@ -53,16 +55,16 @@ namespace SunEngine
 		void RegisterBone(AnimatedBoneComponentData* pBoneData);
 		uint GetBoneCount() const { return _boneData.size(); }
 
-		void IncrementBoneUpdates();
-		uint GetBoneUpdateCount() const { return _boneUpdateCount; }
-
 		void RegisterMesh(SkinnedMeshComponentData* pMeshData) { _meshData.push_back(pMeshData); }
 
-		glm::mat4 CalcSkinnedBoneMatrix(uint skinIndex, uint boneIndex) const;
+		//World matrices of the bones from the last pose the animator evaluated, empty until the first one
+		const Vector<glm::mat4>& GetBoneWorlds() const { return _boneWorlds; }
 
 	private:
 		friend class Animator;
 
+		void SortBones();
+
 		uint _clip;
 		uint _key;
 		float _time;
@@ -70,10 +72,15 @@ namespace SunEngine
 		float _speed;
 		bool _playing;
 		bool _loop;
-		uint _boneUpdateCount;
+		bool _bonesSorted;
 
 		Vector<AnimatedBoneComponentData*> _boneData;
 		Vector<SkinnedMeshComponentData*> _meshData;
+		Vector<uint> _boneOrder;
+		Vector<uint> _boneParents;
+		Vector<float> _pose;
+		Vector<glm::mat4> _localMatrices;
+		Vector<glm::mat4> _boneWorlds;
 	};
 
 	class Animator : public Component
@@ -86,17 +93,31 @@ namespace SunEngine
 		ComponentData* AllocData(SceneNode* pNode) override { return new AnimatorComponentData(this, pNode, _boneCount); }
 
 		uint GetClipCount() const { return _clips.size(); }
-		void SetClips(const Vector<AnimationClip>& clips) { _clips = clips; }
+		void SetClips(const Vector<AnimationClip>& clips) { _clips = clips; _poseKeysBuilt = false; }
 
 		uint GetBoneCount() const { return _boneCount; }
-		void SetBoneCount(uint count) { _boneCount = count; }
+		void SetBoneCount(uint count) { _boneCount = count; _poseKeysBuilt = false; }
 
 		void GetClipKeys(uint clipIndex, Vector<float>& keys) const { if (clipIndex < _clips.size()) _clips[clipIndex].GetKeys(keys); }
 
 		void Update(SceneNode* pNode, ComponentData* pData, float dt, float et) override;
+
+		//Skin matrices of every bone for one skin, null if no pose has been evaluated yet
+		const glm::mat4* GetSkinMatrices(uint skinIndex) const;
 	private:
+		void BuildPoseKeys(const AnimatorComponentData* pData);
+		void EvaluatePose(AnimatorComponentData* pData);
+
 		uint _boneCount;
 		Vector<AnimationClip> _clips;
+
+		//Bone transforms of every clip key gathered from the bone components, one array per transform component so keys can be blended with SIMD.
+		//Shared by all instances and built by the first one to play
+		std::mutex _poseKeyMutex;
+		std::atomic<bool> _poseKeysBuilt;
+		Vector<Vector<float>> _poseKeys;
+		Vector<glm::mat4> _skinMatrices;
+		uint _skinCount;
 	};
 
 	class AnimatedBoneComponentData : public ComponentData
@@ -133,9 +154,11 @@ namespace SunEngine
 
 		void SetSkinMatrices(const Vector<glm::mat4>& matrices) { _skinMatrices = matrices; }
 		const glm::mat4& GetSkinMatrix(const uint index) const { return _skinMatrices.at(index); }
+		uint GetSkinMatrixCount() const { return _skinMatrices.size(); }
 
+		//Bones are posed by their animator, these are the per clip key transforms it samples
 		void SetTransforms(const Vector<Vector<Transform>>& transforms) { _boneTransforms = transforms; }
-		void Update(SceneNode* pNode, ComponentData* pData, float dt, float et) override;
+		const Vector<Vector<Transform>>& GetTransforms() const { return _boneTransforms; }
 
 	private:
 		uint _boneIndex;
@@ -155,10 +178,8 @@ namespace SunEngine
 	private:
 
 		friend class SkinnedMesh;
-		friend class Animator;
 		AnimatorComponentData* _animatorData;
 		Vector<glm::mat4> _meshBoneMatrices;
-		bool _bUpdateCalled;
 	};
 
 	class SkinnedMesh : public Component
@@ -58,7 +58,7 @@ namespace SunEngine
 					auto childList = pAssetNode->_children;
 					for (AssetNode* child : childList)
 						child->ReParent(pScaleNode);
-					pScaleNode->Scale = glm::vec3(assetScale / maxAxis);
+					pScaleNode->SetScale(glm::vec3(assetScale / maxAxis));
 					pScaleNode->ReParent(pAssetNode);
 				}
 			}
@@ -75,9 +75,9 @@ namespace SunEngine
 		if(pCurrParent)
 			pNode->ReParent(pCurrParent);
 		
-		pNode->Position = pCurrNode->Position;
-		pNode->Scale = pCurrNode->Scale;
-		pNode->Orientation = pCurrNode->Orientation;
+		pNode->SetPosition(pCurrNode->GetPosition());
+		pNode->SetScale(pCurrNode->GetScale());
+		pNode->SetOrientation(pCurrNode->GetOrientation());
 
 		for (uint i = 0; i < COMPONENT_COUNT; i++)
 		{
@@ -216,14 +216,16 @@ namespace SunEngine
 
 			glm::vec3 skew;
 			glm::vec4 perspective;
-			if (glm::decompose(mtxLocal, pNode->Scale, pNode->Orientation.Quat, pNode->Position, skew, perspective))
+			glm::vec3 position, scale;
+			glm::quat quat;
+			if (glm::decompose(mtxLocal, scale, quat, position, skew, perspective))
 			{
-				//glm::mat4 rotMtx = glm::toMat4(pNode->Orientation.Quat);
-				//glm::extractEulerAngleXYZ(rotMtx, pNode->Orientation.Angles.x, pNode->Orientation.Angles.y, pNode->Orientation.Angles.z);
-				//pNode->Orientation.Angles = glm::degrees(pNode->Orientation.Angles);
-				//pNode->Orientation.Mode = ORIENT_XYZ;
-				pNode->Orientation.Quat = glm::conjugate(pNode->Orientation.Quat);
-				pNode->Orientation.Mode = ORIENT_QUAT;
+				//glm::mat4 rotMtx = glm::toMat4(quat);
+				//glm::extractEulerAngleXYZ(rotMtx, angles.x, angles.y, angles.z);
+				//pNode->SetOrientation(glm::degrees(angles), ORIENT_XYZ);
+				pNode->SetPosition(position);
+				pNode->SetScale(scale);
+				pNode->SetOrientation(glm::conjugate(quat));
 			}
 
 			if (iNode->GetType() == ModelImporter::Importer::MESH)
@@ -246,10 +248,11 @@ namespace SunEngine
 
 					auto pGeomNode = _asset->AddNode(iNode->Name + "MeshGeom");
 					_nodes.push_back(pGeomNode);
-					if (glm::decompose(mtxGeom, pGeomNode->Scale, pGeomNode->Orientation.Quat, pGeomNode->Position, skew, perspective))
+					if (glm::decompose(mtxGeom, scale, quat, position, skew, perspective))
 					{
-						pGeomNode->Orientation.Quat = glm::conjugate(pGeomNode->Orientation.Quat);
-						pGeomNode->Orientation.Mode = ORIENT_QUAT;
+						pGeomNode->SetPosition(position);
+						pGeomNode->SetScale(scale);
+						pGeomNode->SetOrientation(glm::conjugate(quat));
 					}
 					_asset->SetParent(pGeomNode->GetName(), pNode->GetName());
 
@@ -464,6 +467,10 @@ namespace SunEngine
 #include "Animation.h"
 #include "FileBase.h"
 #include "ThreadPool.h"
+#include "MappedFileStream.h"
+#include "TextureFile.h"
+#include "TextureStreamer.h"
+#include "PixelKernels.h"
 
 
 #include "AssetImporter.h"
@@ -481,11 +488,50 @@ namespace SunEngine
 		const String Invalid = "Invalid";
 	}
 
+	//Mip modes for the data a material texture holds, srgb is picked up from the texture itself
+	static MipMapGenerator::Options GetMipOptions(const String& texType)
+	{
+		MipMapGenerator::Options options = MipMapGenerator::Options::Default;
+		if (texType == MaterialStrings::NormalMap)
+		{
+			options.Modes |= MipMapGenerator::MODE_NORMAL_MAP;
+		}
+		else if (texType == MaterialStrings::AlphaMap)
+		{
+			//alpha maps are sampled from the red channel
+			options.Modes |= MipMapGenerator::MODE_ALPHA_COVERAGE;
+			options.CoverageChannel = 0;
+		}
+		return options;
+	}
+
+	//Block format for the data a material texture holds, the single channel maps are only sampled from red
+	static uint GetCompressFormat(const String& texType, bool preferBC7)
+	{
+		if (texType == MaterialStrings::NormalMap)
+			return ImageData::COMPRESSED_BC5;
+
+		if (texType == MaterialStrings::RoughnessMap ||
+			texType == MaterialStrings::MetallicMap ||
+			texType == MaterialStrings::AmbientOcclusionMap ||
+			texType == MaterialStrings::SpecularMap ||
+			texType == MaterialStrings::GlossMap ||
+			texType == MaterialStrings::AlphaMap)
+			return ImageData::COMPRESSED_BC4;
+
+		return preferBC7 ? ImageData::COMPRESSED_BC7 : 0;
+	}
+
 	AssetImporter::Options MakeDefaultImporterOptions()
 	{
 		AssetImporter::Options opt;
 		opt.CombineMaterials = false;
 		opt.MaxTextureSize = 4096;
+		opt.ResizeFilter = ImageResampler::FILTER_LANCZOS3;
+		opt.TextureCompression = BlockCompressor::QUALITY_HIGH;
+		opt.PreferBC7 = false;
+		opt.TextureContainers = true;
+		opt.StreamTextures = false;
 
 		return opt;
 	}
@@ -501,6 +547,116 @@ namespace SunEngine
 	{
 	}
 
+	class AssetImporter::TextureStreamJob : public TextureStreamer::Job
+	{
+	public:
+		TextureStreamJob(Texture2D* pTexture, const Vector<TextureLoadTask>& tasks, const Options& options)
+		{
+			_texture = pTexture;
+			_tasks = tasks;
+			_options = options;
+
+			for (auto& task : tasks)
+				Textures.push_back(task.Texture);
+		}
+
+		bool Load() override
+		{
+			return LoadTextureTasks(_texture, _tasks, _options);
+		}
+
+	private:
+		Texture2D* _texture;
+		Vector<TextureLoadTask> _tasks;
+		Options _options;
+	};
+
+	bool AssetImporter::LoadTextureTasks(Texture2D* pTexture, const Vector<TextureLoadTask>& tasks, const Options& options)
+	{
+		//every task's output is cached in its own container, the source is only decoded when one of them is stale
+		Vector<uint64> taskHashes;
+		TextureFile::SourceStamp source;
+		if (options.TextureContainers && tasks.size() && TextureFile::GetSourceStamp(pTexture->GetFilename(), source))
+		{
+			//the source is only hashed again when its size or write time differ from the ones stored with the first container
+			TextureFile::SourceStamp stored;
+			bool hashed = TextureFile::ReadSourceStamp(tasks[0].Texture->GetName() + TextureFile::Extension, stored) && stored.Size == source.Size && stored.Time == source.Time;
+			if (hashed)
+			{
+				source.Hash = stored.Hash;
+			}
+			else
+			{
+				//hashed straight from the mapping instead of reading the whole file into a copy
+				MappedFileStream sourceFile;
+				if (sourceFile.Open(pTexture->GetFilename().c_str()))
+				{
+					source.Hash = TextureFile::Hash(sourceFile.GetData(), sourceFile.GetSize());
+					hashed = true;
+				}
+			}
+
+			if (hashed)
+			{
+				for (uint i = 0; i < tasks.size(); i++)
+					taskHashes.push_back(GetTextureTaskHash(source.Hash, tasks[i], options));
+			}
+		}
+
+		if (taskHashes.size())
+		{
+			bool current = true;
+			for (uint i = 0; i < tasks.size() && current; i++)
+				current = TextureFile::IsCurrent(tasks[i].Texture->GetName() + TextureFile::Extension, taskHashes[i]);
+
+			if (current)
+			{
+				bool loaded = true;
+				for (uint i = 0; i < tasks.size(); i++)
+					loaded = tasks[i].Texture->LoadFromContainer(tasks[i].Texture->GetName() + TextureFile::Extension, taskHashes[i]) && loaded;
+
+				if (loaded)
+					return true;
+			}
+		}
+
+		if (!pTexture->LoadFromFile())
+			return false;
+
+		uint maxSize = options.MaxTextureSize;
+		if (pTexture->GetWidth() > maxSize || pTexture->GetHeight() > maxSize)
+		{
+			pTexture->Resize(glm::min(pTexture->GetWidth(), maxSize), glm::min(pTexture->GetHeight(), maxSize), options.ResizeFilter);
+		}
+
+		for (uint i = 0; i < tasks.size(); i++)
+		{
+			auto& task = tasks[i];
+			if (task.Texture != pTexture)
+			{
+				Texture2D* pSubTexture = task.Texture;
+				pSubTexture->Alloc(pTexture->GetWidth(), pTexture->GetHeight());
+
+				uchar order[4] = { (uchar)task.R, (uchar)task.G, (uchar)task.B, task.OpaqueAlpha ? PixelKernels::ChannelOne : (uchar)task.A };
+				PixelKernels::Swizzle(pTexture->GetImageData().Pixels, pSubTexture->GetImageData().Pixels, pTexture->GetWidth() * pTexture->GetHeight(), order);
+			}
+
+			//srgb first so the mips are filtered in linear space
+			if (task.SRGB)
+				task.Texture->SetSRGB();
+
+			task.Texture->GenerateMips(false, task.MipOptions);
+
+			if (task.Compress)
+				task.Texture->Compress(true, options.TextureCompression, task.CompressFormat);
+
+			if (taskHashes.size())
+				task.Texture->SaveToContainer(task.Texture->GetName() + TextureFile::Extension, taskHashes[i], source);
+		}
+
+		return true;
+	}
+
 	glm::vec3 FromAssimp(const aiVector3D& v)
 	{
 		return glm::vec3(v.x, v.y, v.z);
@@ -650,16 +806,26 @@ namespace SunEngine
 		return true;
 	}
 
-	void ClearPixelGBA(Pixel& p)
+	//Mixes everything that changes a task's output into the hash of its source bytes
+	uint64 AssetImporter::GetTextureTaskHash(uint64 sourceHash, const TextureLoadTask& task, const Options& options)
 	{
-		p.G = 0;
-		p.B = 0;
-		p.A = 255;
-	}
-
-	void ClearPixelA(Pixel& p)
-	{
-		p.A = 255;
+		uint64 hash = sourceHash;
+		hash = TextureFile::Hash(&task.R, sizeof(task.R), hash);
+		hash = TextureFile::Hash(&task.G, sizeof(task.G), hash);
+		hash = TextureFile::Hash(&task.B, sizeof(task.B), hash);
+		hash = TextureFile::Hash(&task.A, sizeof(task.A), hash);
+		hash = TextureFile::Hash(&task.OpaqueAlpha, sizeof(task.OpaqueAlpha), hash);
+		hash = TextureFile::Hash(&task.Compress, sizeof(task.Compress), hash);
+		hash = TextureFile::Hash(&task.SRGB, sizeof(task.SRGB), hash);
+		hash = TextureFile::Hash(&task.MipOptions.Kernel, sizeof(task.MipOptions.Kernel), hash);
+		hash = TextureFile::Hash(&task.MipOptions.Modes, sizeof(task.MipOptions.Modes), hash);
+		hash = TextureFile::Hash(&task.MipOptions.AlphaCutoff, sizeof(task.MipOptions.AlphaCutoff), hash);
+		hash = TextureFile::Hash(&task.MipOptions.CoverageChannel, sizeof(task.MipOptions.CoverageChannel), hash);
+		hash = TextureFile::Hash(&task.CompressFormat, sizeof(task.CompressFormat), hash);
+		hash = TextureFile::Hash(&options.MaxTextureSize, sizeof(options.MaxTextureSize), hash);
+		hash = TextureFile::Hash(&options.ResizeFilter, sizeof(options.ResizeFilter), hash);
+		hash = TextureFile::Hash(&options.TextureCompression, sizeof(options.TextureCompression), hash);
+		return hash;
 	}
 
 	bool AssetImporter::ChooseMaterial(void* pSrcPtr, Material*& pDst)
@@ -816,9 +982,9 @@ namespace SunEngine
 						Texture2D* pTextureMetal = needsLoad ? resMgr.AddTexture2D(strPath + ".METAL") : resMgr.GetTexture2D(strPath + ".METAL");
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTextureAO, TC_RED, TC_RED, TC_RED, TC_RED, true, false, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureRough, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureMetal, TC_BLUE, TC_BLUE, TC_BLUE, TC_BLUE, true, false, ClearPixelA));
+							tasks.push_back(TextureLoadTask(pTextureAO, TC_RED, TC_RED, TC_RED, TC_RED, true, false, true));
+							tasks.push_back(TextureLoadTask(pTextureRough, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, true));
+							tasks.push_back(TextureLoadTask(pTextureMetal, TC_BLUE, TC_BLUE, TC_BLUE, TC_BLUE, true, false, true));
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::AmbientOcclusionMap, pTextureAO });
 						_materialMapping[pDst].push_back({ MaterialStrings::RoughnessMap, pTextureRough });
@@ -830,8 +996,8 @@ namespace SunEngine
 						Texture2D* pTextureMetal = needsLoad ? resMgr.AddTexture2D(strPath + ".METAL") : resMgr.GetTexture2D(strPath + ".METAL");
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTextureRough, TC_RED, TC_RED, TC_RED, TC_RED, true, false, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureMetal, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, ClearPixelA));
+							tasks.push_back(TextureLoadTask(pTextureRough, TC_RED, TC_RED, TC_RED, TC_RED, true, false, true));
+							tasks.push_back(TextureLoadTask(pTextureMetal, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, true));
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::RoughnessMap, pTextureRough });
 						_materialMapping[pDst].push_back({ MaterialStrings::MetallicMap, pTextureMetal });
@@ -842,8 +1008,8 @@ namespace SunEngine
 						Texture2D* pTextureRough = needsLoad ? resMgr.AddTexture2D(strPath + ".ROUGHNESS") : resMgr.GetTexture2D(strPath + ".ROUGHNESS");
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTextureMetal, TC_RED, TC_RED, TC_RED, TC_RED, true, false, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureRough, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, ClearPixelA));
+							tasks.push_back(TextureLoadTask(pTextureMetal, TC_RED, TC_RED, TC_RED, TC_RED, true, false, true));
+							tasks.push_back(TextureLoadTask(pTextureRough, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, true));
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::MetallicMap, pTextureMetal });
 						_materialMapping[pDst].push_back({ MaterialStrings::RoughnessMap, pTextureRough });
@@ -854,8 +1020,9 @@ namespace SunEngine
 						Texture2D* pTextureRough = needsLoad ? resMgr.AddTexture2D(strPath + ".ROUGHNESS") : resMgr.GetTexture2D(strPath + ".ROUGHNESS");
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTextureDiffue, TC_RED, TC_GREEN, TC_BLUE, TC_ALPHA, true, true, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureRough, TC_ALPHA, TC_ALPHA, TC_ALPHA, TC_ALPHA, true, false, ClearPixelA));
+							tasks.push_back(TextureLoadTask(pTextureDiffue, TC_RED, TC_GREEN, TC_BLUE, TC_ALPHA, true, true, true));
+							tasks.back().CompressFormat = GetCompressFormat(MaterialStrings::DiffuseMap, _options.PreferBC7);
+							tasks.push_back(TextureLoadTask(pTextureRough, TC_ALPHA, TC_ALPHA, TC_ALPHA, TC_ALPHA, true, false, true));
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::DiffuseMap, pTextureDiffue });
 						_materialMapping[pDst].push_back({ MaterialStrings::RoughnessMap, pTextureRough });
@@ -866,6 +1033,7 @@ namespace SunEngine
 						if (needsLoad)
 						{
 							tasks.push_back(TextureLoadTask(pTextureRough, TC_RED, TC_GREEN, TC_BLUE, TC_ALPHA, true, false));
+							tasks.back().CompressFormat = GetCompressFormat(MaterialStrings::RoughnessMap, _options.PreferBC7);
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::RoughnessMap, pTextureRough });
 					}
@@ -875,8 +1043,8 @@ namespace SunEngine
 						Texture2D* pTextureGloss = needsLoad ? resMgr.AddTexture2D(strPath + ".GLOSS") : resMgr.GetTexture2D(strPath + ".GLOSS");
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTextureSpecular, TC_RED, TC_RED, TC_RED, TC_RED, true, false, ClearPixelA));
-							tasks.push_back(TextureLoadTask(pTextureGloss, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, ClearPixelA));
+							tasks.push_back(TextureLoadTask(pTextureSpecular, TC_RED, TC_RED, TC_RED, TC_RED, true, false, true));
+							tasks.push_back(TextureLoadTask(pTextureGloss, TC_GREEN, TC_GREEN, TC_GREEN, TC_GREEN, true, false, true));
 						}
 						_materialMapping[pDst].push_back({ MaterialStrings::SpecularMap, pTextureSpecular });
 						_materialMapping[pDst].push_back({ MaterialStrings::GlossMap, pTextureGloss });
@@ -885,7 +1053,9 @@ namespace SunEngine
 					{
 						if (needsLoad)
 						{
-							tasks.push_back(TextureLoadTask(pTexture, TC_RED, TC_GREEN, TC_BLUE, TC_ALPHA, texType != MaterialStrings::NormalMap, texType == MaterialStrings::DiffuseMap));
+							tasks.push_back(TextureLoadTask(pTexture, TC_RED, TC_GREEN, TC_BLUE, TC_ALPHA, true, texType == MaterialStrings::DiffuseMap));
+							tasks.back().MipOptions = GetMipOptions(texType);
+							tasks.back().CompressFormat = GetCompressFormat(texType, _options.PreferBC7);
 						}
 						_materialMapping[pDst].push_back({ texType, pTexture });
 					}
@@ -1089,18 +1259,19 @@ namespace SunEngine
 			memcpy(&mtxLocal, &aNode->mTransformation, sizeof(glm::mat4));
 			mtxLocal = glm::transpose(mtxLocal);
 
-			pNode->Position = mtxLocal[3];
-			pNode->Scale.x = glm::length(mtxLocal[0]);
-			pNode->Scale.y = glm::length(mtxLocal[1]);
-			pNode->Scale.z = glm::length(mtxLocal[2]);
+			glm::vec3 scale;
+			scale.x = glm::length(mtxLocal[0]);
+			scale.y = glm::length(mtxLocal[1]);
+			scale.z = glm::length(mtxLocal[2]);
+			pNode->SetPosition(mtxLocal[3]);
+			pNode->SetScale(scale);
 
-			mtxLocal[0]	/= pNode->Scale.x;
-			mtxLocal[1]	/= pNode->Scale.y;
-			mtxLocal[2]	/= pNode->Scale.z;
+			mtxLocal[0]	/= scale.x;
+			mtxLocal[1]	/= scale.y;
+			mtxLocal[2]	/= scale.z;
 			mtxLocal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-			pNode->Orientation.Quat = glm::quat_cast(mtxLocal);
-			pNode->Orientation.Mode = ORIENT_QUAT;
+			pNode->SetOrientation(glm::quat_cast(mtxLocal));
 
 			//glm::mat4 rebuilt = glm::transpose(pNode->BuildLocalMatrix());
 			//bool equal =  reinterpret_cast<aiMatrix4x4*>(&rebuilt)->Equal(aNode->mTransformation);
@@ -1108,9 +1279,9 @@ namespace SunEngine
 
 			if (aNode == pScene->mRootNode)
 			{
-				glm::extractEulerAngleXYZ(mtxLocal, pNode->Orientation.Angles.x, pNode->Orientation.Angles.y, pNode->Orientation.Angles.z);
-				pNode->Orientation.Angles = glm::degrees(pNode->Orientation.Angles);
-				pNode->Orientation.Mode = ORIENT_XYZ;
+				glm::vec3 angles;
+				glm::extractEulerAngleXYZ(mtxLocal, angles.x, angles.y, angles.z);
+				pNode->SetOrientation(glm::degrees(angles), ORIENT_XYZ);
 			}
 
 			for (uint m = 0; m < aNode->mNumMeshes; m++)
@@ -1248,10 +1419,10 @@ namespace SunEngine
 						for (uint key = 0; key < keys.size(); key++)
 						{
 							auto& transform = boneTransforms[anim][key];
-							transform.position = pNode->Position;
-							transform.scale = pNode->Scale;
-							assert(pNode->Orientation.Mode == ORIENT_QUAT);
-							transform.rotation = pNode->Orientation.Quat;
+							transform.position = pNode->GetPosition();
+							transform.scale = pNode->GetScale();
+							assert(pNode->GetOrientation().Mode == ORIENT_QUAT);
+							transform.rotation = pNode->GetOrientation().Quat;
 						}
 					}
 				}
@@ -1278,89 +1449,61 @@ namespace SunEngine
 			}
 		}
 
-		ThreadPool& tp = ThreadPool::Get();
+		if (_options.StreamTextures)
 		{
+			//materials keep their default textures until the smallest mips of each load are on the GPU
+			TextureStreamer& streamer = TextureStreamer::Get();
 			for (auto& texData : _textureLoadList)
+				streamer.Request(new TextureStreamJob(texData.first, _textureLoadTasks.at(texData.first), _options));
+
+			for (auto& mtlMap : _materialMapping)
 			{
-				Texture2D* pTexture = texData.first;
-				pTexture->SetUserDataPtr(this);
-				tp.AddTask([](uint, void* pData) -> void 
+				for (auto& tex : mtlMap.second)
 				{
-					Texture2D* pTexture = static_cast<Texture2D*>(pData);
-					AssetImporter* pThis = static_cast<AssetImporter*>(pTexture->GetUserDataPtr());
-					if (pTexture->LoadFromFile())
-					{
-						uint maxSize = pThis->_options.MaxTextureSize;
-						if (pTexture->GetWidth() > maxSize || pTexture->GetHeight() > maxSize)
-						{
-							pTexture->Resize(glm::min(pTexture->GetWidth(), maxSize), glm::min(pTexture->GetHeight(), maxSize));
-						}
-
-						auto& tasks = pThis->_textureLoadTasks.at(pTexture);
-
-						for (uint i = 0; i < tasks.size(); i++)
-						{
-							auto& task = tasks[i];
-							if (task.Texture != pTexture)
-							{
-								Texture2D* pSubTexture = task.Texture;
-								pSubTexture->Alloc(pTexture->GetWidth(), pTexture->GetHeight());
-
-								for (uint y = 0; y < pTexture->GetHeight(); y++)
-								{
-									for (uint x = 0; x < pTexture->GetWidth(); x++)
-									{
-										Pixel srcPixel;
-										pTexture->GetPixel(x, y, srcPixel);
-										uchar* pSrcPixel = &srcPixel.R;
-										Pixel dstPixel;
-										dstPixel.R = pSrcPixel[task.R];
-										dstPixel.G = pSrcPixel[task.G];
-										dstPixel.B = pSrcPixel[task.B];
-										dstPixel.A = pSrcPixel[task.A];
-										if (task.TransformFunc) 
-											task.TransformFunc(dstPixel);
-
-										pSubTexture->SetPixel(x, y, dstPixel);
-									}
-								}
-
-								pSubTexture->GenerateMips(false);
-							}
-							else
-							{
-								pTexture->GenerateMips(false);
-							}
-
-							if (task.Compress)
-								task.Texture->Compress();
-
-							if (task.SRGB)
-								task.Texture->SetSRGB();
-						}
-					}
-				}, pTexture);
+					//textures an earlier import loaded without streaming are already registered
+					if (streamer.GetState(tex.second) == TextureStreamer::STATE_UNKNOWN)
+						mtlMap.first->SetTexture2D(tex.first, tex.second);
+					else
+						streamer.Bind(mtlMap.first, tex.first, tex.second);
+				}
 			}
 		}
-		tp.Wait();
-
-		HashSet<Texture2D*> registeredTextures;
-		for (auto& mtlMap : _materialMapping)
+		else
 		{
-			auto pMaterial = mtlMap.first;
-			auto& textures = mtlMap.second;
-			for (auto& tex : textures)
+			ThreadPool& tp = ThreadPool::Get();
+			{
+				for (auto& texData : _textureLoadList)
+				{
+					Texture2D* pTexture = texData.first;
+					pTexture->SetUserDataPtr(this);
+					tp.AddTask([](uint, void* pData) -> void 
+					{
+						Texture2D* pTexture = static_cast<Texture2D*>(pData);
+						AssetImporter* pThis = static_cast<AssetImporter*>(pTexture->GetUserDataPtr());
+						LoadTextureTasks(pTexture, pThis->_textureLoadTasks.at(pTexture), pThis->_options);
+					}, pTexture);
+				}
+			}
+			tp.Wait();
+
+			HashSet<Texture2D*> registeredTextures;
+			for (auto& mtlMap : _materialMapping)
 			{
-				if (registeredTextures.count(tex.second) == 0)
+				auto pMaterial = mtlMap.first;
+				auto& textures = mtlMap.second;
+				for (auto& tex : textures)
 				{
-					if (!tex.second->RegisterToGPU())
+					if (registeredTextures.count(tex.second) == 0)
 					{
-						aiReleaseImport(pScene);
-						return false;
+						if (!tex.second->RegisterToGPU())
+						{
+							aiReleaseImport(pScene);
+							return false;
+						}
+						registeredTextures.insert(tex.second);
 					}
-					registeredTextures.insert(tex.second);
+					pMaterial->SetTexture2D(tex.first, tex.second);
 				}
-				pMaterial->SetTexture2D(tex.first, tex.second);
 			}
 		}
 
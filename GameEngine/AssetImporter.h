@@ -2,6 +2,7 @@
 
 #include "Types.h"
 #include "3DImporter.h"
+#include "MipMapGenerator.h"
 
 namespace SunEngine
 {
@@ -19,6 +20,11 @@ namespace SunEngine
 		{
 			bool CombineMaterials;
 			uint MaxTextureSize;
+			ImageResampler::Filter ResizeFilter; //shrinks textures larger than MaxTextureSize
+			BlockCompressor::Quality TextureCompression;
+			bool PreferBC7; //color textures use BC7 instead of BC1/BC3
+			bool TextureContainers; //processed textures are cached next to their source and reused while the source and settings match
+			bool StreamTextures; //textures load in the background through the TextureStreamer, call its Update every frame
 
 			static const Options Default;
 		};
@@ -46,9 +52,7 @@ namespace SunEngine
 
 		struct TextureLoadTask
 		{
-			typedef void(*TransformPixelFunc)(Pixel& p);
-
-			TextureLoadTask(Texture2D* pTexture, TextureChannel r, TextureChannel g, TextureChannel b, TextureChannel a, bool compress, bool srgb, TransformPixelFunc func = 0)
+			TextureLoadTask(Texture2D* pTexture, TextureChannel r, TextureChannel g, TextureChannel b, TextureChannel a, bool compress, bool srgb, bool opaqueAlpha = false)
 			{
 				Texture = pTexture;
 				R = r;
@@ -57,8 +61,11 @@ namespace SunEngine
 				A = a;
 				Compress = compress;
 				SRGB = srgb;
-				TransformFunc = func;
+				OpaqueAlpha = opaqueAlpha;
+				MipOptions = MipMapGenerator::Options::Default;
 
+				//one source channel spread over every channel is sampled from red, so BC4 keeps all of it
+				CompressFormat = r == g && g == b && b == a ? ImageData::COMPRESSED_BC4 : 0;
 			}
 
 			Texture2D* Texture;
@@ -68,10 +75,17 @@ namespace SunEngine
 			TextureChannel A;
 			bool Compress;
 			bool SRGB;
-			TransformPixelFunc TransformFunc;
+			bool OpaqueAlpha; //alpha is set to 255 instead of copied from channel A
+			MipMapGenerator::Options MipOptions;
+			uint CompressFormat; //0 lets the image pick BC1 or BC3 from its alpha
 		};
 
+		class TextureStreamJob;
+
 		bool ChooseMaterial(void* iMesh, Material*& pOutMtl);
+		static uint64 GetTextureTaskHash(uint64 sourceHash, const TextureLoadTask& task, const Options& options);
+		//Decodes pTexture, or loads the containers of its tasks, and fills every task's texture with its final mip chain
+		static bool LoadTextureTasks(Texture2D* pTexture, const Vector<TextureLoadTask>& tasks, const Options& options);
 
 		Options _options;
 		String _path;
@@ -28,9 +28,10 @@ namespace SunEngine
 		_parent = 0;
 		_visible = true;
 		_parentVisible = true;
-		Position = glm::vec3(0.0f);
-		Scale = glm::vec3(1.0f);
-		Orientation.Reset();
+		_position = glm::vec3(0.0f);
+		_scale = glm::vec3(1.0f);
+		_orientation.Reset();
+		_transformDirty = true;
 
 		_components.resize(COMPONENT_COUNT);
 	}
@@ -50,12 +51,26 @@ namespace SunEngine
 		return pComponent;
 	}
 
+	void AssetNode::SetOrientation(const glm::quat& quat)
+	{
+		_orientation.Quat = quat;
+		_orientation.Mode = ORIENT_QUAT;
+		MarkTransformDirty();
+	}
+
+	void AssetNode::SetOrientation(const glm::vec3& angles, OrientationMode mode)
+	{
+		_orientation.Angles = angles;
+		_orientation.Mode = mode;
+		MarkTransformDirty();
+	}
+
 	glm::mat4 AssetNode::BuildLocalMatrix() const
 	{
 		glm::mat4 mtxIden(1.0f);
-		glm::mat4 mtxRot = Orientation.BuildMatrix();
-		glm::mat4 mtxScale = glm::scale(mtxIden, Scale);
-		glm::mat4 mtxTrans = glm::translate(mtxIden, Position);
+		glm::mat4 mtxRot = _orientation.BuildMatrix();
+		glm::mat4 mtxScale = glm::scale(mtxIden, _scale);
+		glm::mat4 mtxTrans = glm::translate(mtxIden, _position);
 		return mtxTrans * mtxRot * mtxScale;
 	}
 
@@ -126,6 +141,11 @@ namespace SunEngine
 
 	}
 
+	void Component::Flush(SceneNode*, ComponentData*)
+	{
+
+	}
+
 	void Orientation::Reset()
 	{
 		Mode = ORIENT_XYZ;
@@ -153,4 +173,9 @@ namespace SunEngine
 			return mtxTable[rotOrder.z] * mtxTable[rotOrder.y] * mtxTable[rotOrder.x];
 		}
 	}
+
+	glm::quat Orientation::GetQuat() const
+	{
+		return Mode == ORIENT_QUAT ? Quat : glm::quat_cast(BuildMatrix());
+	}
 }
\ No newline at end of file
@@ -61,6 +61,9 @@ namespace SunEngine
 
 		virtual void Initialize(SceneNode* pNode, ComponentData* pData);
 		virtual void Update(SceneNode* pNode, ComponentData* pData, float dt, float et);
+		//Called on the thread updating the scene once every component is updated, for components that asked for it with
+		//Scene::RequestFlush during Update. Work that can't run on the thread pool, like GPU uploads, goes here
+		virtual void Flush(SceneNode* pNode, ComponentData* pData);
 		template<typename T>
 		T* As()
 		{
@@ -86,6 +89,7 @@ namespace SunEngine
 		const Component* GetBase() const override { return _base; }
 		void Initialize(SceneNode* pNode, ComponentData* pData) override  { _base->Initialize(pNode, pData); }
 		void Update(SceneNode* pNode, ComponentData* pData, float dt, float et) override { _base->Update(pNode, pData, dt, et); }
+		void Flush(SceneNode* pNode, ComponentData* pData) override { _base->Flush(pNode, pData); }
 	private:
 		ComponentRef() = delete;
 
@@ -108,6 +112,7 @@ namespace SunEngine
 	public:
 		void Reset();
 		glm::mat4 BuildMatrix() const;
+		glm::quat GetQuat() const;
 
 		OrientationMode Mode;
 		glm::vec3 Angles;
@@ -127,9 +132,16 @@ namespace SunEngine
 		uint GetComponentCount(ComponentType type) const { return _components.at(type).size(); }
 		const String& GetName() const { return _name; }
 
-		glm::vec3 Position;
-		glm::vec3 Scale;
-		Orientation Orientation;
+		const glm::vec3& GetPosition() const { return _position; }
+		const glm::vec3& GetScale() const { return _scale; }
+		const Orientation& GetOrientation() const { return _orientation; }
+
+		//The setters flag the node so a scene's transform hierarchy only rebuilds the matrices of nodes that were set
+		void SetPosition(const glm::vec3& position) { _position = position; MarkTransformDirty(); }
+		void SetScale(const glm::vec3& scale) { _scale = scale; MarkTransformDirty(); }
+		void SetOrientation(const Orientation& orientation) { _orientation = orientation; MarkTransformDirty(); }
+		void SetOrientation(const glm::quat& quat);
+		void SetOrientation(const glm::vec3& angles, OrientationMode mode);
 
 		glm::mat4 BuildLocalMatrix() const;
 		glm::mat4 BuildWorldMatrix() const;
@@ -158,8 +170,16 @@ namespace SunEngine
 		void ReParent(AssetNode* pParent);
 		virtual void OnAddComponent(Component*) {};
 
+		void MarkTransformDirty() { if (!_transformDirty) { _transformDirty = true; OnTransformDirty(); } }
+		//Called when the flag is raised after the last transform update cleared it
+		virtual void OnTransformDirty() {};
+
 		friend class Asset;
 		String _name;
+		glm::vec3 _position;
+		glm::vec3 _scale;
+		Orientation _orientation;
+		bool _transformDirty;
 		bool _visible;
 		bool _parentVisible;
 		AssetNode* _parent;
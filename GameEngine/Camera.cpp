@@ -155,4 +155,9 @@ namespace SunEngine
 	{
 		return FrustumAABBIntersect(_frustumPlanes, aabb);
 	}
+
+	void CameraComponentData::FrustumIntersects(const AABBBatch& boxes, uint* pVisibleMask) const
+	{
+		FrustumAABBIntersect(_frustumPlanes, boxes, pVisibleMask);
+	}
 }
\ No newline at end of file
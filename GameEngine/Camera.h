@@ -33,6 +33,8 @@ namespace SunEngine
 		CameraComponentData(Component* pComponent, SceneNode* pNode);
 
 		bool FrustumIntersects(const AABB& aabb) const;
+		//Tests every box in the batch, bit i of pVisibleMask is set if box i is visible
+		void FrustumIntersects(const AABBBatch& boxes, uint* pVisibleMask) const;
 
 		const glm::mat4& GetView() const { return _viewMatrix; }
 		const glm::mat4& GetInvView() const { return _invViewMatrix; }
@@ -42,6 +44,7 @@ namespace SunEngine
 		const glm::vec3& GetForward() const { return _forward; }
 
 		const glm::vec3& GetFrustumCorner(uint index) const { return _frustumCorners[index]; }
+		const glm::vec4* GetFrustumPlanes() const { return _frustumPlanes; }
 					  
 	private:
 		friend class Camera;
@@ -1,5 +1,17 @@
 #include "MathHelper.h"
 
+#if defined(__AVX__)
+#define MATH_HELPER_AVX
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_HELPER_SSE
+#endif
+
+#if defined(MATH_HELPER_AVX) || defined(MATH_HELPER_SSE)
+#include <immintrin.h>
+#endif
+
 namespace SunEngine
 {
 	const glm::vec4 Vec4::Zero = glm::vec4(0.0f);
@@ -31,4 +43,340 @@ namespace SunEngine
 	const glm::mat4 Mat4::Zero = glm::mat4(0.0f);
 
 	const glm::quat Quat::Identity = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+	//Only the corner closest to the inside of a plane is tested, if it's outside the plane so are the other 7 corners.
+	//The dot product is summed in the same order as glm::dot so every path gives the same answer as testing all corners
+	static bool FrustumBoxVisible(const glm::vec4* planes, const AABBBatch& boxes, uint i)
+	{
+		for (uint p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes[p];
+			float x = plane.x > 0.0f ? boxes.MinX[i] : boxes.MaxX[i];
+			float y = plane.y > 0.0f ? boxes.MinY[i] : boxes.MaxY[i];
+			float z = plane.z > 0.0f ? boxes.MinZ[i] : boxes.MaxZ[i];
+			if (!((x * plane.x + y * plane.y) + (z * plane.z + plane.w) < 0.0f))
+				return false;
+		}
+		return true;
+	}
+
+	static void FrustumCullScalar(const glm::vec4* planes, const AABBBatch& boxes, uint begin, uint end, uint* pVisibleMask)
+	{
+		for (uint i = begin; i < end; i++)
+		{
+			if (FrustumBoxVisible(planes, boxes, i))
+				pVisibleMask[i >> 5] |= 1u << (i & 31);
+		}
+	}
+
+	//the closest corner only depends on the plane, so for every box in a batch it comes from the same min or max arrays
+	struct FrustumCorners
+	{
+		FrustumCorners(const glm::vec4* planes, const AABBBatch& boxes)
+		{
+			for (uint p = 0; p < 6; p++)
+			{
+				X[p] = planes[p].x > 0.0f ? boxes.MinX : boxes.MaxX;
+				Y[p] = planes[p].y > 0.0f ? boxes.MinY : boxes.MaxY;
+				Z[p] = planes[p].z > 0.0f ? boxes.MinZ : boxes.MaxZ;
+			}
+		}
+
+		const float* X[6];
+		const float* Y[6];
+		const float* Z[6];
+	};
+
+#ifdef MATH_HELPER_SSE
+	//returns the visible bits of boxes i to i + 3
+	static uint FrustumCullSSE(const glm::vec4* planes, const FrustumCorners& corners, uint i)
+	{
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes[p];
+			__m128 xy = _mm_add_ps(
+				_mm_mul_ps(_mm_loadu_ps(corners.X[p] + i), _mm_set1_ps(plane.x)),
+				_mm_mul_ps(_mm_loadu_ps(corners.Y[p] + i), _mm_set1_ps(plane.y)));
+			__m128 zw = _mm_add_ps(
+				_mm_mul_ps(_mm_loadu_ps(corners.Z[p] + i), _mm_set1_ps(plane.z)),
+				_mm_set1_ps(plane.w));
+			inside = _mm_and_ps(inside, _mm_cmplt_ps(_mm_add_ps(xy, zw), _mm_setzero_ps()));
+		}
+		return (uint)_mm_movemask_ps(inside);
+	}
+#endif
+
+#ifdef MATH_HELPER_AVX
+	static uint FrustumCullAVX(const glm::vec4* planes, const FrustumCorners& corners, uint i)
+	{
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (uint p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes[p];
+			__m256 xy = _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(corners.X[p] + i), _mm256_set1_ps(plane.x)),
+				_mm256_mul_ps(_mm256_loadu_ps(corners.Y[p] + i), _mm256_set1_ps(plane.y)));
+			__m256 zw = _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(corners.Z[p] + i), _mm256_set1_ps(plane.z)),
+				_mm256_set1_ps(plane.w));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(xy, zw), _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+		return (uint)_mm256_movemask_ps(inside);
+	}
+#endif
+
+	static void ClearVisibleMask(uint count, uint* pVisibleMask)
+	{
+		for (uint i = 0; i < (count + 31) / 32; i++)
+			pVisibleMask[i] = 0;
+	}
+
+	void FrustumAABBIntersect(const glm::vec4* planes, const AABBBatch& boxes, uint* pVisibleMask)
+	{
+		ClearVisibleMask(boxes.Count, pVisibleMask);
+
+		FrustumCorners corners(planes, boxes);
+		uint i = 0;
+#ifdef MATH_HELPER_AVX
+		for (; i + 8 <= boxes.Count; i += 8)
+			pVisibleMask[i >> 5] |= FrustumCullAVX(planes, corners, i) << (i & 31);
+#endif
+
+#ifdef MATH_HELPER_SSE
+		for (; i + 4 <= boxes.Count; i += 4)
+			pVisibleMask[i >> 5] |= FrustumCullSSE(planes, corners, i) << (i & 31);
+#endif
+
+		FrustumCullScalar(planes, boxes, i, boxes.Count, pVisibleMask);
+	}
+
+	void FrustumAABBIntersectScalar(const glm::vec4* planes, const AABBBatch& boxes, uint* pVisibleMask)
+	{
+		ClearVisibleMask(boxes.Count, pVisibleMask);
+		FrustumCullScalar(planes, boxes, 0, boxes.Count, pVisibleMask);
+	}
+
+	void FrustumAABBIntersect(const glm::vec4* const* frusta, uint frustumMask, const AABBBatch& boxes, uint* pFrustumMasks)
+	{
+		uint i = 0;
+#ifdef MATH_HELPER_SSE
+		for (; i + 4 <= boxes.Count; i += 4)
+		{
+			uint masks[4] = {};
+			for (uint f = 0, remaining = frustumMask; remaining; f++, remaining >>= 1)
+			{
+				if (!(remaining & 1))
+					continue;
+
+				uint visibleMask = FrustumCullSSE(frusta[f], FrustumCorners(frusta[f], boxes), i);
+				for (uint j = 0; j < 4; j++)
+				{
+					if (visibleMask & (1u << j))
+						masks[j] |= 1u << f;
+				}
+			}
+
+			for (uint j = 0; j < 4; j++)
+				pFrustumMasks[i + j] = masks[j];
+		}
+#endif
+
+		//small batches like the two children of a tree node are tested one box at a time
+		for (; i < boxes.Count; i++)
+		{
+			uint mask = 0;
+			for (uint f = 0, remaining = frustumMask; remaining; f++, remaining >>= 1)
+			{
+				if ((remaining & 1) && FrustumBoxVisible(frusta[f], boxes, i))
+					mask |= 1u << f;
+			}
+			pFrustumMasks[i] = mask;
+		}
+	}
+
+	void MultiplyMatrix(const glm::mat4& lhs, const glm::mat4& rhs, glm::mat4& result)
+	{
+#ifdef MATH_HELPER_SSE
+		//columns are summed in the same order as glm's operator * so both give the same result
+		__m128 lhs0 = _mm_loadu_ps(&lhs[0][0]);
+		__m128 lhs1 = _mm_loadu_ps(&lhs[1][0]);
+		__m128 lhs2 = _mm_loadu_ps(&lhs[2][0]);
+		__m128 lhs3 = _mm_loadu_ps(&lhs[3][0]);
+
+		for (uint i = 0; i < 4; i++)
+		{
+			__m128 column = _mm_mul_ps(lhs0, _mm_set1_ps(rhs[i][0]));
+			column = _mm_add_ps(column, _mm_mul_ps(lhs1, _mm_set1_ps(rhs[i][1])));
+			column = _mm_add_ps(column, _mm_mul_ps(lhs2, _mm_set1_ps(rhs[i][2])));
+			column = _mm_add_ps(column, _mm_mul_ps(lhs3, _mm_set1_ps(rhs[i][3])));
+			_mm_storeu_ps(&result[i][0], column);
+		}
+#else
+		result = lhs * rhs;
+#endif
+	}
+
+	//Weights of a and b for a slerp along the shorter arc, d is dot(a, b). Nearly parallel rotations are lerped instead
+	//since sin(angle) goes to zero, the blended rotation is normalized afterwards in both cases
+	static void GetSlerpWeights(float d, float t, float& wa, float& wb)
+	{
+		float sign = d < 0.0f ? -1.0f : 1.0f;
+		d *= sign;
+		if (d > 1.0f - glm::epsilon<float>())
+		{
+			wa = 1.0f - t;
+			wb = t * sign;
+			return;
+		}
+
+		float angle = acosf(d);
+		float invSin = 1.0f / sinf(angle);
+		wa = sinf((1.0f - t) * angle) * invSin;
+		wb = sinf(t * angle) * invSin * sign;
+	}
+
+	static void BlendTransform(const TransformBatch& a, const TransformBatch& b, float t, const TransformBatch& result, uint i)
+	{
+		float s = 1.0f - t;
+		result.PosX[i] = a.PosX[i] * s + b.PosX[i] * t;
+		result.PosY[i] = a.PosY[i] * s + b.PosY[i] * t;
+		result.PosZ[i] = a.PosZ[i] * s + b.PosZ[i] * t;
+		result.ScaleX[i] = a.ScaleX[i] * s + b.ScaleX[i] * t;
+		result.ScaleY[i] = a.ScaleY[i] * s + b.ScaleY[i] * t;
+		result.ScaleZ[i] = a.ScaleZ[i] * s + b.ScaleZ[i] * t;
+
+		float d = a.RotX[i] * b.RotX[i] + a.RotY[i] * b.RotY[i] + a.RotZ[i] * b.RotZ[i] + a.RotW[i] * b.RotW[i];
+		float wa, wb;
+		GetSlerpWeights(d, t, wa, wb);
+		float x = a.RotX[i] * wa + b.RotX[i] * wb;
+		float y = a.RotY[i] * wa + b.RotY[i] * wb;
+		float z = a.RotZ[i] * wa + b.RotZ[i] * wb;
+		float w = a.RotW[i] * wa + b.RotW[i] * wb;
+		float len = sqrtf(x * x + y * y + z * z + w * w);
+		result.RotX[i] = x / len;
+		result.RotY[i] = y / len;
+		result.RotZ[i] = z / len;
+		result.RotW[i] = w / len;
+	}
+
+	static void BuildTransformMatrix(const TransformBatch& transforms, uint i, glm::mat4& m)
+	{
+		float qx = transforms.RotX[i], qy = transforms.RotY[i], qz = transforms.RotZ[i], qw = transforms.RotW[i];
+		float qxx = qx * qx, qyy = qy * qy, qzz = qz * qz;
+		float qxz = qx * qz, qxy = qx * qy, qyz = qy * qz;
+		float qwx = qw * qx, qwy = qw * qy, qwz = qw * qz;
+
+		m[0] = glm::vec4(1.0f - 2.0f * (qyy + qzz), 2.0f * (qxy + qwz), 2.0f * (qxz - qwy), 0.0f) * transforms.ScaleX[i];
+		m[1] = glm::vec4(2.0f * (qxy - qwz), 1.0f - 2.0f * (qxx + qzz), 2.0f * (qyz + qwx), 0.0f) * transforms.ScaleY[i];
+		m[2] = glm::vec4(2.0f * (qxz + qwy), 2.0f * (qyz - qwx), 1.0f - 2.0f * (qxx + qyy), 0.0f) * transforms.ScaleZ[i];
+		m[3] = glm::vec4(transforms.PosX[i], transforms.PosY[i], transforms.PosZ[i], 1.0f);
+	}
+
+	void BlendTransforms(const TransformBatch& a, const TransformBatch& b, float t, const TransformBatch& result)
+	{
+		uint i = 0;
+#ifdef MATH_HELPER_SSE
+		__m128 vt = _mm_set1_ps(t);
+		__m128 vs = _mm_set1_ps(1.0f - t);
+
+		const float* const pA[] = { a.PosX, a.PosY, a.PosZ, a.ScaleX, a.ScaleY, a.ScaleZ };
+		const float* const pB[] = { b.PosX, b.PosY, b.PosZ, b.ScaleX, b.ScaleY, b.ScaleZ };
+		float* const pResult[] = { result.PosX, result.PosY, result.PosZ, result.ScaleX, result.ScaleY, result.ScaleZ };
+
+		for (; i + 4 <= result.Count; i += 4)
+		{
+			for (uint c = 0; c < 6; c++)
+				_mm_storeu_ps(pResult[c] + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pA[c] + i), vs), _mm_mul_ps(_mm_loadu_ps(pB[c] + i), vt)));
+
+			__m128 ax = _mm_loadu_ps(a.RotX + i), ay = _mm_loadu_ps(a.RotY + i), az = _mm_loadu_ps(a.RotZ + i), aw = _mm_loadu_ps(a.RotW + i);
+			__m128 bx = _mm_loadu_ps(b.RotX + i), by = _mm_loadu_ps(b.RotY + i), bz = _mm_loadu_ps(b.RotZ + i), bw = _mm_loadu_ps(b.RotW + i);
+
+			//only the slerp weights need the angle between the quats, they are found per lane and the blend itself stays vectorized
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+			float dots[4], weightsA[4], weightsB[4];
+			_mm_storeu_ps(dots, d);
+			for (uint lane = 0; lane < 4; lane++)
+				GetSlerpWeights(dots[lane], t, weightsA[lane], weightsB[lane]);
+			__m128 wa = _mm_loadu_ps(weightsA);
+			__m128 wb = _mm_loadu_ps(weightsB);
+
+			__m128 x = _mm_add_ps(_mm_mul_ps(ax, wa), _mm_mul_ps(bx, wb));
+			__m128 y = _mm_add_ps(_mm_mul_ps(ay, wa), _mm_mul_ps(by, wb));
+			__m128 z = _mm_add_ps(_mm_mul_ps(az, wa), _mm_mul_ps(bz, wb));
+			__m128 w = _mm_add_ps(_mm_mul_ps(aw, wa), _mm_mul_ps(bw, wb));
+			__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+
+			_mm_storeu_ps(result.RotX + i, _mm_div_ps(x, len));
+			_mm_storeu_ps(result.RotY + i, _mm_div_ps(y, len));
+			_mm_storeu_ps(result.RotZ + i, _mm_div_ps(z, len));
+			_mm_storeu_ps(result.RotW + i, _mm_div_ps(w, len));
+		}
+#endif
+		for (; i < result.Count; i++)
+			BlendTransform(a, b, t, result, i);
+	}
+
+	void BuildTransformMatrices(const TransformBatch& transforms, glm::mat4* pMatrices)
+	{
+		uint i = 0;
+#ifdef MATH_HELPER_SSE
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+
+		for (; i + 4 <= transforms.Count; i += 4)
+		{
+			__m128 qx = _mm_loadu_ps(transforms.RotX + i), qy = _mm_loadu_ps(transforms.RotY + i), qz = _mm_loadu_ps(transforms.RotZ + i), qw = _mm_loadu_ps(transforms.RotW + i);
+			__m128 qxx = _mm_mul_ps(qx, qx), qyy = _mm_mul_ps(qy, qy), qzz = _mm_mul_ps(qz, qz);
+			__m128 qxz = _mm_mul_ps(qx, qz), qxy = _mm_mul_ps(qx, qy), qyz = _mm_mul_ps(qy, qz);
+			__m128 qwx = _mm_mul_ps(qw, qx), qwy = _mm_mul_ps(qw, qy), qwz = _mm_mul_ps(qw, qz);
+
+			//each register holds one matrix element of 4 transforms, transposing turns them into one column per transform
+			__m128 sx = _mm_loadu_ps(transforms.ScaleX + i);
+			__m128 c0 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qyy, qzz))), sx);
+			__m128 c1 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxy, qwz)), sx);
+			__m128 c2 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxz, qwy)), sx);
+			__m128 c3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(&pMatrices[i + 0][0][0], c0);
+			_mm_storeu_ps(&pMatrices[i + 1][0][0], c1);
+			_mm_storeu_ps(&pMatrices[i + 2][0][0], c2);
+			_mm_storeu_ps(&pMatrices[i + 3][0][0], c3);
+
+			__m128 sy = _mm_loadu_ps(transforms.ScaleY + i);
+			c0 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxy, qwz)), sy);
+			c1 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qzz))), sy);
+			c2 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qyz, qwx)), sy);
+			c3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(&pMatrices[i + 0][1][0], c0);
+			_mm_storeu_ps(&pMatrices[i + 1][1][0], c1);
+			_mm_storeu_ps(&pMatrices[i + 2][1][0], c2);
+			_mm_storeu_ps(&pMatrices[i + 3][1][0], c3);
+
+			__m128 sz = _mm_loadu_ps(transforms.ScaleZ + i);
+			c0 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxz, qwy)), sz);
+			c1 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qyz, qwx)), sz);
+			c2 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qyy))), sz);
+			c3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(&pMatrices[i + 0][2][0], c0);
+			_mm_storeu_ps(&pMatrices[i + 1][2][0], c1);
+			_mm_storeu_ps(&pMatrices[i + 2][2][0], c2);
+			_mm_storeu_ps(&pMatrices[i + 3][2][0], c3);
+
+			c0 = _mm_loadu_ps(transforms.PosX + i);
+			c1 = _mm_loadu_ps(transforms.PosY + i);
+			c2 = _mm_loadu_ps(transforms.PosZ + i);
+			c3 = one;
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(&pMatrices[i + 0][3][0], c0);
+			_mm_storeu_ps(&pMatrices[i + 1][3][0], c1);
+			_mm_storeu_ps(&pMatrices[i + 2][3][0], c2);
+			_mm_storeu_ps(&pMatrices[i + 3][3][0], c3);
+		}
+#endif
+		for (; i < transforms.Count; i++)
+			BuildTransformMatrix(transforms, i, pMatrices[i]);
+	}
 }
\ No newline at end of file
@@ -179,6 +179,12 @@ namespace SunEngine
 			return Min + GetExtent();
 		}
 
+		//false after Reset until something is expanded into the box
+		bool IsValid() const
+		{
+			return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z;
+		}
+
 		bool Contains(const AABB& rhs) const
 		{
 			return
@@ -286,8 +292,13 @@ namespace SunEngine
 
 		glm::vec3 n = glm::cross(p1p0, p2p0);
 
-		float t = 0.0f;
-		if (!RayPlaneIntersect(ray, p0, n, t))
+		//the parallel tolerance is relative to the length of n, otherwise small triangles (or a ray moved into the space of a small mesh) never hit
+		float dn = glm::dot(ray.Direction, n);
+		if (dn * dn < RAY_PLANE_TOL * RAY_PLANE_TOL * glm::dot(n, n))
+			return false;
+
+		float t = glm::dot(p0 - ray.Origin, n) / dn;
+		if (t < 0.0f)
 			return false;
 
 		if (t > tMinDist)
@@ -454,4 +465,52 @@ namespace SunEngine
 		}
 		return true;
 	}
+
+	//Bounds of many boxes with one array per component, the batch frustum test reads 4 or 8 boxes from each array at a time
+	struct AABBBatch
+	{
+		const float* MinX;
+		const float* MinY;
+		const float* MinZ;
+		const float* MaxX;
+		const float* MaxY;
+		const float* MaxZ;
+		uint Count;
+	};
+
+	//Sets bit i of pVisibleMask (32 boxes per uint) if box i is at least partially inside the planes, the result matches FrustumAABBIntersect.
+	//Uses AVX or SSE when the build enables them, boxes left over after the last full register go through the scalar path
+	void FrustumAABBIntersect(const glm::vec4* planes, const AABBBatch& boxes, uint* pVisibleMask);
+
+	//Scalar version of the batch test, also what the SIMD paths are checked against
+	void FrustumAABBIntersectScalar(const glm::vec4* planes, const AABBBatch& boxes, uint* pVisibleMask);
+
+	//Tests the batch against every frustum whose bit is set in frustumMask (frusta[i] is the 6 planes of frustum i),
+	//pFrustumMasks[i] gets the bits of the frusta box i is visible in
+	void FrustumAABBIntersect(const glm::vec4* const* frusta, uint frustumMask, const AABBBatch& boxes, uint* pFrustumMasks);
+
+	//result = lhs * rhs using SSE when available, result may be the same matrix as lhs or rhs
+	void MultiplyMatrix(const glm::mat4& lhs, const glm::mat4& rhs, glm::mat4& result);
+
+	//Position, scale and rotation of many transforms with one array per component, read 4 at a time by the SSE paths
+	struct TransformBatch
+	{
+		float* PosX;
+		float* PosY;
+		float* PosZ;
+		float* ScaleX;
+		float* ScaleY;
+		float* ScaleZ;
+		float* RotX;
+		float* RotY;
+		float* RotZ;
+		float* RotW;
+		uint Count;
+	};
+
+	//Lerps position and scale and slerps rotation along the shorter arc from a to b, result may be the same batch as a or b
+	void BlendTransforms(const TransformBatch& a, const TransformBatch& b, float t, const TransformBatch& result);
+
+	//pMatrices[i] = translate * rotate * scale of transform i, the same matrix AssetNode::BuildLocalMatrix gives for ORIENT_QUAT
+	void BuildTransformMatrices(const TransformBatch& transforms, glm::mat4* pMatrices);
 }
\ No newline at end of file
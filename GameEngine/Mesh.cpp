@@ -11,7 +11,7 @@ namespace SunEngine
 
 	const VertexDef StandardVertex::Definition = VertexDef(4, VertexDef::DEFAULT_TEX_COORD_INDEX, VertexDef::DEFAULT_NORMAL_INDEX, VertexDef::DEFAULT_TANGENT_INDEX);
 	const VertexDef SkinnedVertex::Definition = VertexDef(6, VertexDef::DEFAULT_TEX_COORD_INDEX, VertexDef::DEFAULT_NORMAL_INDEX, VertexDef::DEFAULT_TANGENT_INDEX);
-	const VertexDef TerrainVertex::Definition = VertexDef(2, VertexDef::DEFAULT_INVALID_INDEX, 1, VertexDef::DEFAULT_INVALID_INDEX);
+	const VertexDef TerrainVertex::Definition = VertexDef(1, VertexDef::DEFAULT_INVALID_INDEX, VertexDef::DEFAULT_INVALID_INDEX, VertexDef::DEFAULT_INVALID_INDEX);
 
 	Mesh::Mesh()
 	{
@@ -26,11 +26,13 @@ namespace SunEngine
 	{
 		_vertexDef = def;
 		_vertices.resize(numVerts * def.NumVars);
+		ClearTriangleBVHs();
 	}
 
 	void Mesh::AllocIndices(uint numIndices)
 	{
 		_indices.resize(numIndices);
+		ClearTriangleBVHs();
 	}
 
 	bool Mesh::RegisterToGPU()
@@ -339,6 +341,7 @@ namespace SunEngine
 	void Mesh::SetIndices(const uint* pIndices, uint indexOffset, uint indexCount)
 	{
 		memcpy(_indices.data() + indexOffset, pIndices, indexCount * sizeof(uint));
+		ClearTriangleBVHs();
 	}
 
 	glm::vec4 Mesh::GetVertexVar(uint vertexIndex, uint varIndex) const
@@ -360,6 +363,9 @@ namespace SunEngine
 
 	void Mesh::UpdateBoundingVolume()
 	{
+		//called whenever vertices were changed, triangle BVHs are rebuilt by the next raycast
+		ClearTriangleBVHs();
+
 		_aabb.Reset();
 		for (uint i = 0; i < GetVertexCount(); i++)
 		{
@@ -385,4 +391,91 @@ namespace SunEngine
 		UpdateBoundingVolume();
 		return true;
 	}
+
+	bool Mesh::Raycast(const Ray& ray, uint firstIndex, uint indexCount, uint vertexOffset, float& tMin, uint& triIndex, float weights[3])
+	{
+		if (_primitiveTopology != SE_PT_TRIANGLE_LIST || firstIndex + indexCount > _indices.size())
+			return false;
+
+		struct RayData
+		{
+			const Mesh* pMesh;
+			const TriangleBVH* pTriangleBVH;
+			float t;
+			uint triIndex;
+			float weights[3];
+		} data;
+
+		data.pMesh = this;
+		data.pTriangleBVH = GetTriangleBVH(firstIndex, indexCount, vertexOffset);
+		data.t = tMin;
+
+		bool hit = data.pTriangleBVH->bvh.Raycast(ray, tMin, [](const uint& tri, const Ray& ray, float& tMax, void* pDataPtr) -> bool {
+			RayData* pData = static_cast<RayData*>(pDataPtr);
+			const Mesh* pMesh = pData->pMesh;
+			const uint* pIndices = &pMesh->_indices[pData->pTriangleBVH->firstIndex + tri * 3];
+			uint vertexOffset = pData->pTriangleBVH->vertexOffset;
+			uint stride = pMesh->_vertexDef.NumVars;
+
+			glm::vec3 p0 = pMesh->_vertices[(pIndices[0] + vertexOffset) * stride];
+			glm::vec3 p1 = pMesh->_vertices[(pIndices[1] + vertexOffset) * stride];
+			glm::vec3 p2 = pMesh->_vertices[(pIndices[2] + vertexOffset) * stride];
+
+			float w[3];
+			if (!RayTriangleIntersect(ray, p0, p1, p2, tMax, w))
+				return false;
+
+			pData->t = tMax;
+			pData->triIndex = tri;
+			pData->weights[0] = w[0];
+			pData->weights[1] = w[1];
+			pData->weights[2] = w[2];
+			return true;
+		}, &data);
+
+		if (!hit)
+			return false;
+
+		tMin = data.t;
+		triIndex = data.triIndex;
+		weights[0] = data.weights[0];
+		weights[1] = data.weights[1];
+		weights[2] = data.weights[2];
+		return true;
+	}
+
+	const Mesh::TriangleBVH* Mesh::GetTriangleBVH(uint firstIndex, uint indexCount, uint vertexOffset)
+	{
+		//raycasts can run on several threads, the first one to need a range builds it while the others wait
+		std::lock_guard<std::mutex> lock(_triangleBVHMutex);
+		for (auto& pTriangleBVH : _triangleBVHs)
+		{
+			if (pTriangleBVH->firstIndex == firstIndex && pTriangleBVH->indexCount == indexCount && pTriangleBVH->vertexOffset == vertexOffset)
+				return pTriangleBVH.get();
+		}
+
+		TriangleBVH* pTriangleBVH = new TriangleBVH();
+		pTriangleBVH->firstIndex = firstIndex;
+		pTriangleBVH->indexCount = indexCount;
+		pTriangleBVH->vertexOffset = vertexOffset;
+
+		uint stride = _vertexDef.NumVars;
+		for (uint i = 0; i < indexCount / 3; i++)
+		{
+			AABB box;
+			for (uint j = 0; j < 3; j++)
+				box.Expand(glm::vec3(_vertices[(_indices[firstIndex + i * 3 + j] + vertexOffset) * stride]));
+			pTriangleBVH->bvh.Insert(i, box);
+		}
+		pTriangleBVH->bvh.Build();
+
+		_triangleBVHs.push_back(UniquePtr<TriangleBVH>(pTriangleBVH));
+		return pTriangleBVH;
+	}
+
+	void Mesh::ClearTriangleBVHs()
+	{
+		std::lock_guard<std::mutex> lock(_triangleBVHMutex);
+		_triangleBVHs.clear();
+	}
 }
\ No newline at end of file
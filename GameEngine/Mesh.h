@@ -1,7 +1,9 @@
 #pragma once
 
+#include <mutex>
 #include "BaseMesh.h"
 #include "GPUResource.h"
+#include "SpatialVolumes.h"
 
 namespace SunEngine
 {
@@ -56,6 +58,7 @@ namespace SunEngine
 		glm::vec4 Weights;
 	};
 
+	//Point on the terrain's patch grid, heights and normals are read from the terrain's textures in Terrain.vs
 	struct TerrainVertex
 	{
 		static const VertexDef Definition;
@@ -63,11 +66,9 @@ namespace SunEngine
 		TerrainVertex()
 		{
 			Position = Vec4::Point;
-			Normal = Vec4::Up;
 		}
 
 		glm::vec4 Position;
-		glm::vec4 Normal;
 	};
 
 	class Mesh : public GPUResource<BaseMesh>
@@ -115,15 +116,33 @@ namespace SunEngine
 
 		bool UpdateVertices();
 
+		//Tests the triangles of an index range against a ray in object space, hits closer than tMin lower it to the hit distance.
+		//A triangle BVH for the range is built the first time it's tested and kept until the vertices or indices change
+		bool Raycast(const Ray& ray, uint firstIndex, uint indexCount, uint vertexOffset, float& tMin, uint& triIndex, float weights[3]);
+
 		void SetPrimitiveToplogy(PrimitiveTopology topology) { _primitiveTopology = topology; }
 		PrimitiveTopology GetPrimitiveTopology() const { return _primitiveTopology; }
 
 	private:
+		struct TriangleBVH
+		{
+			uint firstIndex;
+			uint indexCount;
+			uint vertexOffset;
+			BVH<uint> bvh;
+		};
+
+		const TriangleBVH* GetTriangleBVH(uint firstIndex, uint indexCount, uint vertexOffset);
+		void ClearTriangleBVHs();
+
 		VertexDef _vertexDef;
 		Vector<glm::vec4> _vertices;
 		Vector<uint> _indices;
 		AABB _aabb;
 		Sphere _sphere;
 		PrimitiveTopology _primitiveTopology;
+
+		Vector<UniquePtr<TriangleBVH>> _triangleBVHs;
+		std::mutex _triangleBVHMutex;
 	};
 }
\ No newline at end of file
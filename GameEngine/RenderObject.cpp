@@ -19,10 +19,12 @@ namespace SunEngine
 
 	void RenderObject::Update(SceneNode* pNode, ComponentData* pData, float dt, float et)
 	{
+		Scene* pScene = pNode->GetScene();
 		RenderComponentData* pRenderData = pData->As<RenderComponentData>();
 		for (RenderNode& node : pRenderData->_renderNodes)
 		{
-			UpdateRenderNode(node, pRenderData);
+			if (UpdateRenderNode(node, pRenderData))
+				pScene->MarkRenderNodeDirty(&node);
 		}
 	}
 
@@ -44,7 +46,7 @@ namespace SunEngine
 		return &pData->_renderNodes.back();
 	}
 
-	void RenderObject::UpdateRenderNode(RenderNode& node, RenderComponentData* pRenderData)
+	bool RenderObject::UpdateRenderNode(RenderNode& node, RenderComponentData* pRenderData)
 	{
 		const glm::mat4* pMtx = NULL;
 		const AABB* pAABB = NULL;
@@ -66,7 +68,10 @@ namespace SunEngine
 		{
 			node._worldAABB = node._aabb;
 			node._worldAABB.Transform(node._worldMatrix);
+			return true;
 		}
+
+		return false;
 	}
 
 	RenderNode::RenderNode(SceneNode* pNode, RenderObject* pObject)
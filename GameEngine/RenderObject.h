@@ -88,6 +88,9 @@ namespace SunEngine
 
 		ComponentType GetType() const override { return CType; }
 		RenderObjectType GetRenderType() const { return _type; }
+
+		//The scene only updates render objects on nodes that moved, ones whose render nodes change on their own return true to be updated every frame
+		virtual bool RequiresUpdate() const { return false; }
 	protected:
 		RenderObject(RenderObjectType type);
 		virtual RenderComponentData* AllocRenderData(SceneNode* pNode) = 0;
@@ -96,7 +99,7 @@ namespace SunEngine
 		RenderNode* CreateRenderNode(RenderComponentData* pData);
 
 	private:
-		void UpdateRenderNode(RenderNode& node, RenderComponentData* pData);
+		bool UpdateRenderNode(RenderNode& node, RenderComponentData* pData);
 
 		RenderObjectType _type;
 	};
@@ -4,52 +4,17 @@
 #include "Mesh.h"
 #include "Timer.h"
 #include "Scene.h"
+#include "Terrain.h"
 
 #define SCENE_ROOT_NAME "SceneRoot"
-#define BOX_TREE_DEPTH 2
 
 namespace SunEngine
 {
-	struct Scene::BoxTreeSizeData
-	{
-		struct ThreadData
-		{
-			AABB aabb;
-			Vector<RenderNode*> nodes;
-			uint nodeCounter;
-		};
-
-		BoxTreeSizeData()
-		{
-			threadData.resize(ThreadPool::Get().GetThreadCount());
-		}
-
-		void Reset()
-		{
-			for (uint i = 0; i < threadData.size(); i++)
-			{
-				threadData[i].nodeCounter = 0;
-				threadData[i].aabb.Reset();
-			}
-		}
-
-		void Expand(AABB& sceneBounds)
-		{
-			for (uint i = 0; i < threadData.size(); i++)
-			{
-				if(threadData[i].nodeCounter)
-					sceneBounds.Expand(threadData[i].aabb);
-			}
-		}
-
-		Vector<ThreadData> threadData;
-	};
-
 	Scene::Scene()
 	{
 		_root = UniquePtr<SceneNode>(new SceneNode(this));
 		_root->_name = SCENE_ROOT_NAME;
-		_boxTreeSizeData = UniquePtr<BoxTreeSizeData>(new BoxTreeSizeData());
+		_componentPools.resize(COMPONENT_COUNT);
 	}
 
 	Scene::~Scene()
@@ -91,6 +56,7 @@ namespace SunEngine
 		if (found != _nodes.end() && (*found).second.get() == pNode)
 		{
 			pNode->SetParent(0);
+			HashSet<SceneNode*> removedNodes;
 			LinkedList<SceneNode*> nodesToRemove;
 			pNode->Traverse([](SceneNode* pRemoveNode, void* pNodeMap) -> bool {
 				static_cast<LinkedList<SceneNode*>*>(pNodeMap)->push_front(pRemoveNode);
@@ -110,14 +76,28 @@ namespace SunEngine
 						for (auto renderIter = pRenderData->BeginNode(); renderIter != pRenderData->EndNode(); ++renderIter)
 						{
 							RenderNode* pRenderNode = const_cast<RenderNode*>(&(*renderIter));
-							_boxTree.Remove(pRenderNode);
+							_bvh.Remove(pRenderNode);
+							for (auto& dirtyList : _dirtyRenderNodes)
+								dirtyList.erase(std::remove(dirtyList.begin(), dirtyList.end(), pRenderNode), dirtyList.end());
 						}
 					}
 				}
 
+				removedNodes.insert(pRemoveNode);
 				_nodes.erase(pRemoveNode->GetName());
 			}
 
+			for (auto& pool : _componentPools)
+			{
+				pool.erase(std::remove_if(pool.begin(), pool.end(), [&](const ComponentEntry& entry) -> bool {
+					return removedNodes.count(entry.pNode) != 0;
+				}), pool.end());
+			}
+
+			_continuousRenderObjects.erase(std::remove_if(_continuousRenderObjects.begin(), _continuousRenderObjects.end(), [&](const ComponentEntry& entry) -> bool {
+				return removedNodes.count(entry.pNode) != 0;
+			}), _continuousRenderObjects.end());
+
 			return true;
 		}
 		else
@@ -142,116 +122,189 @@ namespace SunEngine
 
 	void Scene::Update(float dt, float et)
 	{
-		CallUpdate(GetRoot(), dt, et);
-		RebuildBoxTree();
+		//components on the calling thread collect dirty render nodes and flush requests by thread index, a thread outside the
+		//pool holds the external slot for the whole update so it has one
+		ThreadPool::Get().RunOnCallingThread([&](uint) -> void {
+			_movedNodes.clear();
+			_transforms.Update(GetRoot(), &_movedNodes);
+			UpdateComponents(dt, et);
+			FlushComponents();
+			UpdateBVH();
+		});
 	}
 
-	void Scene::CallUpdate(SceneNode* pNode, float dt, float et)
+	void Scene::RegisterComponent(Component* pComponent, ComponentData* pData, SceneNode* pNode)
 	{
-		pNode->Update(dt, et);
-		for (auto iter = pNode->_children.begin(); iter != pNode->_children.end(); ++iter)
-		{
-			CallUpdate(static_cast<SceneNode*>((*iter)), dt, et);
-		}
+		//refs are resolved here so the update doesn't go through the extra virtual call each frame
+		ComponentEntry entry;
+		entry.pComponent = pComponent->GetBase();
+		entry.pData = pData;
+		entry.pNode = pNode;
+		_componentPools[pComponent->GetType()].push_back(entry);
+
+		if (pComponent->GetType() == COMPONENT_RENDER_OBJECT && static_cast<RenderObject*>(entry.pComponent)->RequiresUpdate())
+			_continuousRenderObjects.push_back(entry);
 	}
 
-	void Scene::Traverse(TraverseFunc func, void* pUserData) const
+	void Scene::UpdateComponents(float dt, float et)
 	{
-		if (func)
+		//each animator poses all of its bones, skinned meshes read the posed bones so they wait for every animator to finish
+		const Vector<ComponentEntry>& animators = _componentPools[COMPONENT_ANIMATOR];
+		ThreadPool::Get().ParallelForRange(0, animators.size(), 2, [&](uint, uint begin, uint end) -> void {
+			UpdateComponentPool(COMPONENT_ANIMATOR, begin, end, dt, et);
+		});
+
+		//posing leaves the bones dirty, this pass only walks the bone subtrees so nodes attached to bones use this frame's pose
+		if (!animators.empty())
+			_transforms.Update(GetRoot(), &_movedNodes);
+
+		const Vector<ComponentEntry>& skinnedMeshes = _componentPools[COMPONENT_SKINNED_MESH];
+		ThreadPool::Get().ParallelForRange(0, skinnedMeshes.size(), 16, [&](uint, uint begin, uint end) -> void {
+			UpdateComponentPool(COMPONENT_SKINNED_MESH, begin, end, dt, et);
+		});
+
+		//the remaining types only read world matrices and their own data so they are updated at the same time
+		struct UpdateData
 		{
-			CallTraverse(GetRoot(), func, pUserData);
-		}
-	}
+			Scene* pScene;
+			float dt;
+			float et;
+		} updateData = { this, dt, et };
+
+		ThreadPool::Counter counter;
+		ThreadPool::Get().AddTask([](uint, void* pData) -> void {
+			UpdateData* pUpdateData = static_cast<UpdateData*>(pData);
+			Scene* pScene = pUpdateData->pScene;
+			pScene->UpdateComponentPool(COMPONENT_CAMERA, 0, pScene->_componentPools[COMPONENT_CAMERA].size(), pUpdateData->dt, pUpdateData->et);
+			pScene->UpdateComponentPool(COMPONENT_LIGHT, 0, pScene->_componentPools[COMPONENT_LIGHT].size(), pUpdateData->dt, pUpdateData->et);
+		}, &updateData, &counter);
+
+		//render nodes only need a refit when their scene node moved, so the cost follows the number of moving objects
+		GatherRenderUpdates();
+		ThreadPool::Get().ParallelForRange(0, _renderUpdates.size(), 64, [&](uint, uint begin, uint end) -> void {
+			for (uint i = begin; i < end; i++)
+			{
+				const ComponentEntry& entry = _renderUpdates[i];
+				entry.pComponent->Update(entry.pNode, entry.pData, dt, et);
+			}
+		});
 
+		//sky models are updated here, kept on the calling thread
+		UpdateComponentPool(COMPONENT_ENVIRONMENT, 0, _componentPools[COMPONENT_ENVIRONMENT].size(), dt, et);
 
-	void Scene::CallTraverse(SceneNode* pNode, TraverseFunc func, void* pUserData) const
+		ThreadPool::Get().Wait(counter);
+	}
+
+	void Scene::UpdateComponentPool(ComponentType type, uint begin, uint end, float dt, float et)
 	{
-		func(pNode, pUserData);
-		for (auto iter = pNode->_children.begin(); iter != pNode->_children.end(); ++iter)
+		const Vector<ComponentEntry>& pool = _componentPools[type];
+		for (uint i = begin; i < end; i++)
 		{
-			CallTraverse(static_cast<SceneNode*>((*iter)), func, pUserData);
+			const ComponentEntry& entry = pool[i];
+			entry.pComponent->Update(entry.pNode, entry.pData, dt, et);
 		}
 	}
 
-	void Scene::RebuildBoxTree()
+	void Scene::RequestFlush(Component* pComponent, ComponentData* pData, SceneNode* pNode)
 	{
-		Timer timer;
-		//if (_pendingBoxTreeNodes.size() == 0)
-		//	return;
-
-		//Vector<RenderNode*> nodes;
-		//nodes.reserve(_pendingOctTreeNodes.size() + _boxTree.GetObjectCount());
-		//while (_pendingOctTreeNodes.size())
-		//{
-		//	nodes.push_back(_pendingOctTreeNodes.front());
-		//	_pendingOctTreeNodes.pop();
-		//}
-
-		timer.Start();
+		//components are updated on the thread pool, each thread collects into its own list like the dirty render nodes
+		ComponentEntry entry;
+		entry.pComponent = pComponent->GetBase();
+		entry.pData = pData;
+		entry.pNode = pNode;
+		_flushRequests[ThreadPool::Get().GetCurrentThreadIndex()].push_back(entry);
+	}
 
-		_boxTreeSizeData->Reset();
+	void Scene::GatherRenderUpdates()
+	{
+		//bones and nodes under them can be moved by both hierarchy passes
+		std::sort(_movedNodes.begin(), _movedNodes.end());
+		_movedNodes.erase(std::unique(_movedNodes.begin(), _movedNodes.end()), _movedNodes.end());
 
-		_boxTree.TraverseThreaded([](const IBoxTree<RenderNode*>::Node& node, void* pUserData, uint threadIndex) -> bool {
-			auto& threadData = static_cast<BoxTreeSizeData*>(pUserData)->threadData[threadIndex];
-			for (auto& rNode : node.objects)
+		_renderUpdates = _continuousRenderObjects;
+		for (SceneNode* pNode : _movedNodes)
+		{
+			for (auto iter = pNode->BeginComponent(); iter != pNode->EndComponent(); ++iter)
 			{
-				if (threadData.nodeCounter < threadData.nodes.size())
-					threadData.nodes[threadData.nodeCounter] = rNode;
-				else
-					threadData.nodes.push_back(rNode);
-
-				threadData.aabb.Expand(rNode->GetWorldAABB());
-				++threadData.nodeCounter;
+				Component* pComponent = (*iter);
+				if (pComponent->GetType() != COMPONENT_RENDER_OBJECT || static_cast<RenderObject*>(pComponent->GetBase())->RequiresUpdate())
+					continue;
+
+				ComponentEntry entry;
+				entry.pComponent = pComponent->GetBase();
+				entry.pData = pNode->GetComponentData<ComponentData>(pComponent);
+				entry.pNode = pNode;
+				_renderUpdates.push_back(entry);
 			}
-			return true;
-		}, _boxTreeSizeData.get());
-
-		AABB sceneBounds;
-		for (auto pending : _pendingBoxTreeNodes)
-			sceneBounds.Expand(pending->GetWorldAABB());
-
-		sceneBounds.Min.y = -10000000.0f;
-		sceneBounds.Max.y = -sceneBounds.Min.y;
-		_boxTreeSizeData->Expand(sceneBounds);
-		_boxTree.Create(sceneBounds, BOX_TREE_DEPTH);
+		}
+	}
 
-		for(auto& t : _boxTreeSizeData->threadData)
+	void Scene::FlushComponents()
+	{
+		for (auto& requests : _flushRequests)
 		{
-			for (uint n = 0; n < t.nodeCounter; n++)
-			{
-				if (!_boxTree.Insert(t.nodes[n], t.nodes[n]->GetWorldAABB()))
-				{
-					assert(false);
-				}
-			}
+			for (const ComponentEntry& entry : requests)
+				entry.pComponent->Flush(entry.pNode, entry.pData);
+			requests.clear();
 		}
+	}
 
-		for (auto pending : _pendingBoxTreeNodes)
+	void Scene::Traverse(TraverseFunc func, void* pUserData) const
+	{
+		if (func)
 		{
-			if (!_boxTree.Insert(pending, pending->GetWorldAABB()))
-			{
-				assert(false);
-			}
+			CallTraverse(GetRoot(), func, pUserData);
 		}
+	}
 
-		_boxTree.ComputeHeights([](RenderNode* const& pNode, float& minH, float& maxH) -> void { minH = pNode->GetWorldAABB().Min.y; maxH = pNode->GetWorldAABB().Max.y; });
 
-		_pendingBoxTreeNodes.clear();
+	void Scene::CallTraverse(SceneNode* pNode, TraverseFunc func, void* pUserData) const
+	{
+		func(pNode, pUserData);
+		for (auto iter = pNode->_children.begin(); iter != pNode->_children.end(); ++iter)
+		{
+			CallTraverse(static_cast<SceneNode*>((*iter)), func, pUserData);
+		}
+	}
 
-		double elapsed = timer.Tick();
-		//printf("%f\n", elapsed * 1000.0f);
+	void Scene::UpdateBVH()
+	{
+		//only render nodes whose bounds changed this frame are refit, the hierarchy is rebuilt when nodes were added/removed or enough of them moved
+		for (auto& dirtyList : _dirtyRenderNodes)
+		{
+			for (auto pNode : dirtyList)
+				_bvh.Update(pNode, pNode->GetWorldAABB());
+			dirtyList.clear();
+		}
 
+		_bvh.Build();
 	}
 
 	void Scene::Clear()
 	{
 		_root->_children.clear();
 		_nodes.clear();
+		_bvh.Clear();
+		for (auto& dirtyList : _dirtyRenderNodes)
+			dirtyList.clear();
+		for (auto& requests : _flushRequests)
+			requests.clear();
+		for (auto& pool : _componentPools)
+			pool.clear();
+		_continuousRenderObjects.clear();
+		_movedNodes.clear();
+		_transforms.MarkStructureDirty();
 	}
 
 	void Scene::RegisterRenderNode(RenderNode* pNode)
 	{
-		_pendingBoxTreeNodes.push_back(pNode);
+		_bvh.Insert(pNode, pNode->GetWorldAABB());
+	}
+
+	void Scene::MarkRenderNodeDirty(RenderNode* pNode)
+	{
+		//render objects are updated on the thread pool, each thread collects into its own list
+		_dirtyRenderNodes[ThreadPool::Get().GetCurrentThreadIndex()].push_back(pNode);
 	}
 
 	void Scene::RegisterLight(LightComponentData* pLight)
@@ -271,117 +324,108 @@ namespace SunEngine
 
 	void Scene::TraverseRenderNodes(TraverseAABBFunc aabbFunc, void* pAABBData, TraverseRenderNodeFunc nodeFunc, void* pNodeData) const
 	{
-		struct OctTreeData
-		{
-			TraverseAABBFunc aaabFunc;
-			TraverseRenderNodeFunc nodeFunc;
-			void* pAABBData;
-			void* pNodeData;
-		} oData;
-
-		oData.aaabFunc = aabbFunc;
-		oData.nodeFunc = nodeFunc;
-		oData.pAABBData = pAABBData;
-		oData.pNodeData = pNodeData;
-
-		_boxTree.Traverse([](const OctTree<RenderNode*>::Node& node, void*pDataPtr) -> bool {
-			if (node.children == 0 && node.objects.size() == 0) //dont test empty leafs
-				return true;
-			auto* octData = static_cast<OctTreeData*>(pDataPtr);
-			if (octData->aaabFunc(node.box, octData->pAABBData))
-			{
-				for (auto& rNode : node.objects)
-					octData->nodeFunc(rNode, octData->pNodeData);
-				return true;
-			}
-			else
-			{
-				return false;
-			}
-		}, &oData);
+		Pair<TraverseRenderNodeFunc, void*> nodeData = { nodeFunc, pNodeData };
+		_bvh.Traverse(aabbFunc, pAABBData, [](RenderNode* const& pNode, void* pDataPtr) -> void {
+			auto* pData = static_cast<Pair<TraverseRenderNodeFunc, void*>*>(pDataPtr);
+			pData->first(pNode, pData->second);
+		}, &nodeData);
 	}
 
-	bool Scene::Raycast(const glm::vec3& o, const glm::vec3& d, SceneRayHit& hit) const
+	void Scene::TraverseRenderNodes(CullAABBBatchFunc cullFunc, void* pCullData, TraverseRenderNodeFunc nodeFunc, void* pNodeData) const
 	{
-		hit.pHitNode = NULL;
+		Pair<TraverseRenderNodeFunc, void*> nodeData = { nodeFunc, pNodeData };
+		_bvh.Traverse(cullFunc, pCullData, [](RenderNode* const& pNode, void* pDataPtr) -> void {
+			auto* pData = static_cast<Pair<TraverseRenderNodeFunc, void*>*>(pDataPtr);
+			pData->first(pNode, pData->second);
+		}, &nodeData);
+	}
+
+	void Scene::TraverseRenderNodes(uint viewMask, CullAABBViewsFunc cullFunc, void* pCullData, TraverseRenderNodeViewsFunc nodeFunc, void* pNodeData) const
+	{
+		Pair<TraverseRenderNodeViewsFunc, void*> nodeData = { nodeFunc, pNodeData };
+		_bvh.Traverse(viewMask, cullFunc, pCullData, [](RenderNode* const& pNode, uint nodeViewMask, void* pDataPtr) -> void {
+			auto* pData = static_cast<Pair<TraverseRenderNodeViewsFunc, void*>*>(pDataPtr);
+			pData->first(pNode, nodeViewMask, pData->second);
+		}, &nodeData);
+	}
 
-		//TODO can this be threaded somehow?
+	bool Scene::Raycast(const glm::vec3& o, const glm::vec3& d, SceneRayHit& hit) const
+	{
 		Ray ray;
 		ray.Origin = o;
 		ray.Direction = d;
+		return Raycast(ray, hit);
+	}
 
-		Vector<Pair<RenderNode*, float>> possibleHits;
-		
-		Pair<Ray, Vector<Pair<RenderNode*, float>>*> renderNodeData = { ray, &possibleHits };
-		TraverseRenderNodes(
-			[](const AABB& box, void* pDataPtr) -> bool { return RayAABBIntersect(*static_cast<Ray*>(pDataPtr), box.Min, box.Max); }, &ray,
-			[](RenderNode* pRenderNode, void* pDataPtr) -> void { 
-				auto* pData = static_cast<Pair<Ray, Vector<Pair<RenderNode*, float>>*>*>(pDataPtr);
-				if (RayAABBIntersect(pData->first, pRenderNode->GetWorldAABB().Min, pRenderNode->GetWorldAABB().Max))
-				{
-					glm::vec3 v = pData->first.Origin - pRenderNode->GetWorldAABB().GetCenter();
-					pData->second->push_back({ pRenderNode, glm::dot(v,v) });
-				}
-		}, &renderNodeData);
-
+	bool Scene::Raycast(const Ray& ray, SceneRayHit& hit) const
+	{
+		hit.pHitNode = NULL;
 
-		//we sort by nodes closest to the ray so that many possible ray-tri intersections can be skipped by avoiding fully testing triangles that are farther than closest hit triangle
-		std::sort(possibleHits.begin(), possibleHits.end(), [](const Pair<RenderNode*, float>& left, const Pair<RenderNode*, float>& right) -> bool { return left.second < right.second; });
+		//the bvh visits render nodes front to back along the ray and skips any node beyond the closest triangle hit so far
+		_bvh.Raycast(ray, FLT_MAX, [](RenderNode* const& pRenderNode, const Ray& ray, float& tMin, void* pDataPtr) -> bool {
+			SceneRayHit& hit = *static_cast<SceneRayHit*>(pDataPtr);
 
-		float tMin = FLT_MAX;
-		for (auto& rnPair : possibleHits)
-		{
-			auto pRenderNode = rnPair.first;
+			//the ray is moved to object space instead of moving every triangle to world space. Its direction is normalized there so the
+			//triangle test behaves like it does in world space, distances are scaled by the length of the transformed direction to convert between the two
+			Ray objectRay = ray;
+			objectRay.Transform(pRenderNode->GetInvWorldMatirx());
+			float scale = glm::length(objectRay.Direction);
+			if (scale == 0.0f)
+				return false;
+			objectRay.Direction /= scale;
 
-			//ray.Origin = o;
-			//ray.Direction = d;
-			//ray.Transform(pRenderNode->GetInvWorldMatirx());
+			Mesh* pMesh = pRenderNode->GetMesh();
+			uint firstIndex = pRenderNode->GetFirstIndex();
+			uint vertexOffset = pRenderNode->GetVertexOffset();
 
-			//for ray-tri intersects we probably want to move the ray to the object space to avoid transforming every triangle, currently not doing this
-			//because the tMin value is messed up when the ray is in object space, need to figure out how to resolve this
+			float t = tMin * scale;
+			uint triIndex;
+			float w[3];
 
-			Mesh* pMesh = pRenderNode->GetMesh();
-			if (pMesh->GetPrimitiveTopology() != SE_PT_TRIANGLE_LIST)
-				continue;
+			//terrain meshes are a patch grid placed by the shader, the height field is tested instead
+			RenderObject* pRenderObject = pRenderNode->GetRenderObject();
+			if (pRenderObject->GetRenderType() == RO_TERRAIN)
+			{
+				glm::vec3 normal;
+				if (!static_cast<Terrain*>(pRenderObject)->Raycast(objectRay, t, triIndex, w, normal))
+					return false;
+
+				tMin = t / scale;
+				hit.pHitNode = pRenderNode;
+				hit.triIndex = triIndex;
+				hit.weights[0] = w[0];
+				hit.weights[1] = w[1];
+				hit.weights[2] = w[2];
+				hit.position = ray.Origin + ray.Direction * tMin;
+				hit.normal = glm::normalize(glm::vec3(glm::vec4(normal, 0.0f) * pRenderNode->GetInvWorldMatirx()));
+				return true;
+			}
 
-			auto& vtxDef = pMesh->GetVertexDef();
-			uint nIndex = vtxDef.NormalIndex;
+			if (!pMesh->Raycast(objectRay, firstIndex, pRenderNode->GetIndexCount(), vertexOffset, t, triIndex, w))
+				return false;
 
-			uint firstIndex = pRenderNode->GetFirstIndex();
-			uint vertexOffset = pRenderNode->GetVertexOffset();
+			tMin = t / scale;
+			hit.pHitNode = pRenderNode;
+			hit.triIndex = triIndex;
+			hit.weights[0] = w[0];
+			hit.weights[1] = w[1];
+			hit.weights[2] = w[2];
+			hit.position = ray.Origin + ray.Direction * tMin;
 
-			for (uint i = 0; i < pRenderNode->GetIndexCount() / 3; i++)
+			uint nIndex = pMesh->GetVertexDef().NormalIndex;
+			if (nIndex != VertexDef::DEFAULT_INVALID_INDEX)
 			{
-				//uint t0, t1, t2;
-				uint t0 = pMesh->GetIndex(i + firstIndex + 0);
-				uint t1 = pMesh->GetIndex(i + firstIndex + 1);
-				uint t2 = pMesh->GetIndex(i + firstIndex + 2);
-				t0 += vertexOffset;
-				t1 += vertexOffset;
-				t2 += vertexOffset;
-
-				glm::vec4 p0, p1, p2;
-				p0 = pMesh->GetVertexPos(t0);
-				p1 = pMesh->GetVertexPos(t1);
-				p2 = pMesh->GetVertexPos(t2);
-
-				p0 = pRenderNode->GetWorld() * p0;
-				p1 = pRenderNode->GetWorld() * p1;
-				p2 = pRenderNode->GetWorld() * p2;
-
-				float w[3];
-				if (RayTriangleIntersect(ray, p0, p1, p2, tMin, w))
-				{
-					hit.pHitNode = pRenderNode;
-					hit.position = p0 * w[0] + p1 * w[1] + p2 * w[2];
-					if (nIndex != VertexDef::DEFAULT_INVALID_INDEX)
-					{
-						hit.normal = pMesh->GetVertexVar(t0, nIndex) * w[0] + pMesh->GetVertexVar(t1, nIndex) * w[1] + pMesh->GetVertexVar(t2, nIndex) * w[2];
-					}
-					//break; //testing all render nodes, uncomment to only test for first hit
-				}
+				uint t0 = pMesh->GetIndex(triIndex * 3 + firstIndex + 0) + vertexOffset;
+				uint t1 = pMesh->GetIndex(triIndex * 3 + firstIndex + 1) + vertexOffset;
+				uint t2 = pMesh->GetIndex(triIndex * 3 + firstIndex + 2) + vertexOffset;
+				glm::vec4 normal = pMesh->GetVertexVar(t0, nIndex) * w[0] + pMesh->GetVertexVar(t1, nIndex) * w[1] + pMesh->GetVertexVar(t2, nIndex) * w[2];
+
+				//object to world for normals is the inverse transpose of the world matrix
+				normal.w = 0.0f;
+				hit.normal = glm::normalize(glm::vec3(normal * pRenderNode->GetInvWorldMatirx()));
 			}
-		}
+			return true;
+		}, &hit);
 
 		return hit.pHitNode != NULL;
 #if 0
@@ -461,4 +505,12 @@ namespace SunEngine
 #endif
 
 	}
+
+	void Scene::RaycastMany(const Ray* pRays, uint rayCount, SceneRayHit* pHits) const
+	{
+		//a ray costs a lot more than the scheduling so the rays are handed out in small groups
+		ThreadPool::Get().ParallelFor(0, rayCount, 4, [&](uint, uint i) -> void {
+			Raycast(pRays[i], pHits[i]);
+		});
+	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "SceneNode.h"
 #include "SpatialVolumes.h"
+#include "TransformHierarchy.h"
 
 namespace SunEngine
 {
@@ -25,6 +26,9 @@ namespace SunEngine
 		typedef void(*TraverseFunc)(SceneNode* pNode, void* pUserData);
 		typedef void(*TraverseRenderNodeFunc)(RenderNode* pNode, void* pUserData);
 		typedef bool(*TraverseAABBFunc)(const AABB& box, void* pUserData);
+		typedef void(*CullAABBBatchFunc)(const AABBBatch& boxes, uint* pVisibleMask, void* pUserData);
+		typedef void(*CullAABBViewsFunc)(const AABBBatch& boxes, uint viewMask, uint* pViewMasks, void* pUserData);
+		typedef void(*TraverseRenderNodeViewsFunc)(RenderNode* pNode, uint viewMask, void* pUserData);
 
 		Scene();
 		~Scene();
@@ -44,6 +48,15 @@ namespace SunEngine
 		void Clear();
 
 		void RegisterRenderNode(RenderNode* pNode);
+		//Called when the world bounds of a registered render node change, the BVH picks it up in the next Update
+		void MarkRenderNodeDirty(RenderNode* pNode);
+		//Called when nodes are reparented, the flattened transform hierarchy is rebuilt in the next Update
+		void MarkTransformHierarchyDirty() { _transforms.MarkStructureDirty(); }
+		void MarkTransformDirty(SceneNode* pNode) { _transforms.MarkDirty(pNode); }
+		//Adds a node's component to the pool of its type, the pools are updated a type at a time in Update
+		void RegisterComponent(Component* pComponent, ComponentData* pData, SceneNode* pNode);
+		//Called from a component's Update on any thread, its Flush runs on the thread calling Update after the component pools
+		void RequestFlush(Component* pComponent, ComponentData* pData, SceneNode* pNode);
 
 		void RegisterLight(LightComponentData* pLight);
 		const LinkedList<LightComponentData*>& GetLightList() const { return _lightList; }
@@ -55,27 +68,47 @@ namespace SunEngine
 		const LinkedList<EnvironmentComponentData*>& GetEnvironmentList() const { return _environmentList; }
 
 		void TraverseRenderNodes(TraverseAABBFunc aabbFunc, void* pAABBData, TraverseRenderNodeFunc nodeFunc, void* pNodeData) const;
+		//Culls tree nodes and render node bounds in batches, nodeFunc is only called for render nodes whose bounds passed cullFunc
+		void TraverseRenderNodes(CullAABBBatchFunc cullFunc, void* pCullData, TraverseRenderNodeFunc nodeFunc, void* pNodeData) const;
+		//Culls against several views (one bit each in viewMask) in a single walk of the tree, nodeFunc gets the views a render node is visible in
+		void TraverseRenderNodes(uint viewMask, CullAABBViewsFunc cullFunc, void* pCullData, TraverseRenderNodeViewsFunc nodeFunc, void* pNodeData) const;
 		bool Raycast(const glm::vec3& o, const glm::vec3& d, SceneRayHit& hit) const;
+		bool Raycast(const Ray& ray, SceneRayHit& hit) const;
+		//Casts every ray on the thread pool, pHits[i].pHitNode is NULL if ray i missed
+		void RaycastMany(const Ray* pRays, uint rayCount, SceneRayHit* pHits) const;
 	private:
 		//class SceneGrid;
 
 		//void CallInitialize(SceneNode* pNode);
-		void CallUpdate(SceneNode* pNode, float dt, float et);
+		struct ComponentEntry
+		{
+			Component* pComponent;
+			ComponentData* pData;
+			SceneNode* pNode;
+		};
+
+		void UpdateComponents(float dt, float et);
+		void UpdateComponentPool(ComponentType type, uint begin, uint end, float dt, float et);
+		void FlushComponents();
+		void GatherRenderUpdates();
 		void CallTraverse(SceneNode* pNode, TraverseFunc func, void* pUserData) const;
-		void RebuildBoxTree();
+		void UpdateBVH();
 
 		friend class SceneMgr;
 
 		String _name;
 		UniquePtr<SceneNode> _root;
 		StrMap<UniquePtr<SceneNode>> _nodes;
+		TransformHierarchy _transforms;
+		Vector<Vector<ComponentEntry>> _componentPools;
+		PerThreadData<Vector<ComponentEntry>> _flushRequests;
+		Vector<ComponentEntry> _continuousRenderObjects;
+		Vector<ComponentEntry> _renderUpdates;
+		Vector<SceneNode*> _movedNodes;
 		//UniquePtr<SceneGrid> _grid;
 
-		QuadTree<RenderNode*> _boxTree;
-		LinkedList<RenderNode*> _pendingBoxTreeNodes;
-
-		struct BoxTreeSizeData;
-		UniquePtr<BoxTreeSizeData> _boxTreeSizeData;
+		BVH<RenderNode*> _bvh;
+		PerThreadData<Vector<RenderNode*>> _dirtyRenderNodes;
 
 		LinkedList<LightComponentData*> _lightList;
 		LinkedList<CameraComponentData*> _cameraList;
@@ -1,3 +1,4 @@
+#include "Scene.h"
 #include "SceneNode.h"
 
 namespace SunEngine
@@ -9,6 +10,7 @@ namespace SunEngine
 		_scene = pScene;
 		_worldMatrix = g_MtxIden;
 		_localMatrix = g_MtxIden;
+		_hierarchyIndex = 0;
 		_bInitialized = false;
 	}
 
@@ -45,7 +47,9 @@ namespace SunEngine
 
 	void SceneNode::Update(float dt, float et)
 	{
-		UpdateTransform();
+		//nodes owned by a scene get their matrices from the scene's transform hierarchy and their components are updated from the scene's pools
+		if (!_scene)
+			UpdateTransform();
 
 		for (auto iter = _componentList.begin(); iter != _componentList.end(); ++iter)
 		{
@@ -61,6 +65,8 @@ namespace SunEngine
 	void SceneNode::SetParent(SceneNode* pNode)
 	{
 		ReParent(pNode);
+		if (_scene)
+			_scene->MarkTransformHierarchyDirty();
 	}
 
 	ComponentData* SceneNode::GetComponentDataInParent(ComponentType type) const
@@ -85,6 +91,15 @@ namespace SunEngine
 		{
 			_componentDataMap[pComponent] = UniquePtr<ComponentData>(pData);
 		}
+
+		if (_scene)
+			_scene->RegisterComponent(pComponent, pData, this);
+	}
+
+	void SceneNode::OnTransformDirty()
+	{
+		if (_scene)
+			_scene->MarkTransformDirty(this);
 	}
 
 	bool SceneNode::Traverse(bool(*NodeFunc)(SceneNode* pNode, void* pData), void* pData)
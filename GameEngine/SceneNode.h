@@ -58,14 +58,17 @@ namespace SunEngine
 
 	private:
 		void OnAddComponent(Component* pComponent) override;
+		void OnTransformDirty() override;
 
 		friend class Scene;
+		friend class TransformHierarchy;
 
 		Scene* _scene;
 		LinkedList<Component*> _componentList;
 		Map<Component*, UniquePtr<ComponentData>> _componentDataMap;
 		glm::mat4 _localMatrix;
 		glm::mat4 _worldMatrix;
+		uint _hierarchyIndex;
 		bool _bInitialized;
 	};
 }
\ No newline at end of file
@@ -1,343 +1,703 @@
 #pragma once
 
+#include <algorithm>
 #include "ThreadPool.h"
 
 namespace SunEngine
 {
+	//Bounding volume hierarchy stored as one flat node array, built top down with a binned surface area heuristic.
+	//Node bounds are kept as separate arrays per component so traversal only streams in the values it tests
 	template<typename T>
-	class IBoxTree
+	class BVH
 	{
 	public:
-		struct Node
+		typedef bool(*TraverseAABBFunc)(const AABB& box, void* pData);
+		typedef void(*TraverseObjectFunc)(const T& object, void* pData);
+		//Should return true when the object is hit closer than tMax and lower tMax to the hit distance
+		typedef bool(*RaycastObjectFunc)(const T& object, const Ray& ray, float& tMax, void* pData);
+		//Should set bit i of pVisibleMask for every box i in the batch that passes
+		typedef void(*CullBatchFunc)(const AABBBatch& boxes, uint* pVisibleMask, void* pData);
+		//Should set pViewMasks[i] to the bits of viewMask for the views box i passes in
+		typedef void(*CullViewsFunc)(const AABBBatch& boxes, uint viewMask, uint* pViewMasks, void* pData);
+		typedef void(*TraverseObjectViewsFunc)(const T& object, uint viewMask, void* pData);
+
+		BVH()
 		{
-			void Reset()
-			{
-				parent = 0;
-				children = 0;
-				objects.clear();
-			}
-
-			AABB box;
-			Node* parent;
-			Node* children;
-			LinkedList<T> objects;
-		};
-
-		typedef bool(*TraverseFunc)(const Node& node, void* pData);
-		typedef bool(*TraverseThreadedFunc)(const Node& node, void* pData, uint threadIndex);
+			_needsBuild = false;
+			_updatesSinceBuild = 0;
+		}
 
-		IBoxTree(uint childCount)
+		//Added objects are only part of queries after the next Build
+		bool Insert(const T& object, const AABB& box)
 		{
-			_depth = 0;
-			_objectCount = 0;
-			_childCount = childCount;
-			_nodeCount = 0;
+			if (_objectIndices.find(object) != _objectIndices.end())
+				return Update(object, box);
+
+			_objectIndices[object] = _objects.size();
+			_objects.push_back(object);
+			_objectBoxes.push_back(box);
+			_objectLeaves.push_back(INVALID_NODE);
+			_objectSlots.push_back(INVALID_OBJECT);
+			_needsBuild = true;
+			return true;
 		}
 
-		void Create(const AABB& box, uint depth)
+		bool Remove(const T& object)
 		{
-			_depth = depth;
+			auto found = _objectIndices.find(object);
+			if (found == _objectIndices.end())
+				return false;
 
-			_objectCount = 0;	
-			_nodeCount = 0;
-			for (uint i = 0; i <= depth; i++)
-				_nodeCount += (uint)powf((float)_childCount, (float)i);
+			//removed objects leave an empty slot in their leaf so queries stay valid until the next Build compacts the tree
+			uint index = (*found).second;
+			uint slot = _objectSlots[index];
+			if (slot != INVALID_OBJECT)
+			{
+				_nodeObjects[slot] = INVALID_OBJECT;
+				SetBounds(_objectBounds, slot, AABB());
+				Refit(_objectLeaves[index]);
+			}
 
-			_nodes.resize(_nodeCount);
-			for (uint i = 0; i < _nodeCount; i++)
+			uint last = _objects.size() - 1;
+			if (index != last)
 			{
-				_nodes[i].Reset();
+				_objects[index] = _objects[last];
+				_objectBoxes[index] = _objectBoxes[last];
+				_objectLeaves[index] = _objectLeaves[last];
+				_objectSlots[index] = _objectSlots[last];
+				_objectIndices[_objects[index]] = index;
+				if (_objectSlots[index] != INVALID_OBJECT)
+					_nodeObjects[_objectSlots[index]] = index;
 			}
 
-			uint nodeOffset = 1;
-			Create(GetRoot(), box, (int)depth, nodeOffset);
+			_objects.pop_back();
+			_objectBoxes.pop_back();
+			_objectLeaves.pop_back();
+			_objectSlots.pop_back();
+			_objectIndices.erase(found);
+			_needsBuild = true;
+			return true;
 		}
 
-		const AABB& GetAABB() const
+		//Refits the leaf holding the object and its parents, the tree is rebuilt after enough objects moved for the refitted bounds to get loose
+		bool Update(const T& object, const AABB& box)
 		{
-			return GetRoot()->box;
-		}
+			auto found = _objectIndices.find(object);
+			if (found == _objectIndices.end())
+				return Insert(object, box);
 
-		bool Insert(const T& object, const AABB& box)
-		{
-			if (Insert(GetRoot(), object, box))
-			{
-				++_objectCount;
-				return true;
-			}
-			else
+			uint index = (*found).second;
+			_objectBoxes[index] = box;
+
+			//objects added since the last Build aren't in the tree yet
+			if (_objectSlots[index] != INVALID_OBJECT)
 			{
-				return false;
+				SetBounds(_objectBounds, _objectSlots[index], box);
+				Refit(_objectLeaves[index]);
+				if (++_updatesSinceBuild > glm::max(MIN_UPDATES_BEFORE_REBUILD, (uint)_objects.size() / 2))
+					_needsBuild = true;
 			}
+			return true;
 		}
 
-		bool Remove(const T& object)
+		bool ContainsObject(const T& object) const
 		{
-			bool done = false;
-			Remove(GetRoot(), object, done);
-			if (done)
-			{
-				--_objectCount;
-				return true;
-			}
-			else
-			{
-				return false;
-			}
+			return _objectIndices.find(object) != _objectIndices.end();
 		}
 
-		void Traverse(TraverseFunc Func, void* pData = 0) const
+		void Clear()
 		{
-			if (Func == 0)
-				return;
-
-			Traverse(GetRoot(), Func, pData);
+			_objects.clear();
+			_objectBoxes.clear();
+			_objectLeaves.clear();
+			_objectSlots.clear();
+			_objectIndices.clear();
+			_needsBuild = true;
+			Build();
 		}
 
-		void TraverseThreaded(TraverseThreadedFunc Func, void* pData = 0) const
+		bool NeedsBuild() const { return _needsBuild; }
+
+		void Build()
 		{
-			if (Func == 0)
+			if (!_needsBuild)
 				return;
 
-			if (GetRoot() == 0)
-				return;
+			_needsBuild = false;
+			_updatesSinceBuild = 0;
+
+			uint objectCount = _objects.size();
+			_nodes.clear();
+			_nodes.reserve(objectCount * 2);
+			_nodeObjects.resize(objectCount);
+			_leafObjects.resize(objectCount);
+			_objectLeaves.resize(objectCount);
+			_objectSlots.resize(objectCount);
+
+			//boxes and centers are copied next to each other and partitioned in place so the build reads memory in order
+			Vector<BuildObject> buildObjects(objectCount);
+			BuildTask task;
+			for (uint i = 0; i < objectCount; i++)
+			{
+				BuildObject& object = buildObjects[i];
+				object.box = _objectBoxes[i];
+				object.center = object.box.IsValid() ? object.box.GetCenter() : glm::vec3(0.0f);
+				object.index = i;
+
+				if (object.box.IsValid())
+					task.bounds.Expand(object.box);
+				task.centerBounds.Expand(object.center);
+			}
 
-			Func(*GetRoot(), pData, 0);
-			ThreadPool& tp = ThreadPool::Get();
+			Vector<AABB> nodeBounds;
+			nodeBounds.reserve(objectCount * 2);
 
-			struct ThreadData
-			{
-				const IBoxTree* pTree;
-				uint childIndex;
-				TraverseThreadedFunc func;
-				void* pData;
-			} threadData[8];
-
-			Pair<TraverseThreadedFunc, void*> dataPair = { Func, pData };
-			for (uint i = 0; i < _childCount; i++)
+			Node root;
+			root.offset = 0;
+			root.count = objectCount;
+			root.parent = INVALID_NODE;
+			_nodes.push_back(root);
+			nodeBounds.push_back(AABB());
+
+			Stack<BuildTask> buildStack;
+			if (objectCount)
 			{
-				threadData[i].pTree = this;
-				threadData[i].childIndex = i;
-				threadData[i].func = Func;
-				threadData[i].pData = pData;
-				tp.AddTask([](uint threadIndex, void* pThreadDataPtr) -> void {
-					auto* pThreadData = static_cast<ThreadData*>(pThreadDataPtr);
-					pThreadData->pTree->Traverse(&pThreadData->pTree->GetRoot()->children[pThreadData->childIndex], pThreadData->func, pThreadData->pData, threadIndex);
-				}, &threadData[i]);
-			};
-
-			tp.Wait();
-		}
+				task.node = 0;
+				task.depth = 0;
+				buildStack.push(task);
+			}
 
-		uint GetObjectCount() const { return _objectCount; }
+			while (!buildStack.empty())
+			{
+				task = buildStack.top();
+				buildStack.pop();
 
-	private:
-		virtual AABB BuildChildBox(uint index, const AABB& parentBox) const = 0;
+				uint begin = _nodes[task.node].offset;
+				uint end = begin + _nodes[task.node].count;
+				nodeBounds[task.node] = task.bounds;
 
-		void Create(Node* node, const AABB& box, int depth, uint& nodeOffset)
-		{
-			node->box = box;
-	
-			//char spacing[64] = {};
-			//for (int i = 0; i < _depth - depth; i++)
-			//	spacing[i] = '\t';
-
-			//printf("%s%f %f %f    %f %f %f\n", spacing, box.Min.x, box.Min.y, box.Min.z, box.Max.x, box.Max.y, box.Max.z);
-			if (depth != 0)
-			{
-				node->children = &_nodes[nodeOffset];
-				nodeOffset += _childCount;
-				for (uint i = 0; i < _childCount; i++)
+				uint mid;
+				BuildTask children[2];
+				if (!FindSplit(buildObjects, begin, end, task, mid, children))
 				{
-					node->children[i].parent = node;
-					Create(&node->children[i], BuildChildBox(i, box), depth - 1, nodeOffset);
+					for (uint i = begin; i < end; i++)
+						_objectLeaves[buildObjects[i].index] = task.node;
+					continue;
 				}
+
+				//children are stored next to each other, offset of an inner node is the index of its left child
+				uint left = _nodes.size();
+				Node child;
+				child.parent = task.node;
+				child.offset = begin;
+				child.count = mid - begin;
+				_nodes.push_back(child);
+				child.offset = mid;
+				child.count = end - mid;
+				_nodes.push_back(child);
+				nodeBounds.push_back(AABB());
+				nodeBounds.push_back(AABB());
+
+				_nodes[task.node].offset = left;
+				_nodes[task.node].count = 0;
+
+				children[0].node = left;
+				children[1].node = left + 1;
+				children[0].depth = children[1].depth = task.depth + 1;
+				buildStack.push(children[1]);
+				buildStack.push(children[0]);
 			}
-		}
 
-		bool Insert(Node* node, const T& object, const AABB& box)
-		{
-			if (node->box.Contains(box))
+			//object bounds are also stored in leaf order so a leaf's objects can be culled as one batch
+			for (uint i = 0; i < 6; i++)
 			{
-				if (node->children)
-				{
-					for (uint i = 0; i < _childCount; i++)
-					{
-						if (Insert(&node->children[i], object, box))
-							return true;
-					}
-				}
-				node->objects.push_back(object);
-				return true;
+				_bounds[i].resize(_nodes.size());
+				_objectBounds[i].resize(objectCount);
 			}
-			else
+
+			for (uint i = 0; i < objectCount; i++)
 			{
-				return false;
+				_nodeObjects[i] = buildObjects[i].index;
+				_leafObjects[i] = _objects[buildObjects[i].index];
+				_objectSlots[buildObjects[i].index] = i;
+				SetBounds(_objectBounds, i, buildObjects[i].box);
 			}
+
+			for (uint i = 0; i < _nodes.size(); i++)
+				SetNodeBounds(i, nodeBounds[i]);
+		}
+
+		uint GetObjectCount() const { return _objects.size(); }
+		uint GetNodeCount() const { return _nodes.size(); }
+
+		AABB GetAABB() const
+		{
+			return _nodes.size() ? GetNodeBounds(0) : AABB();
 		}
 
-		void Remove(Node* node, const T& object, bool& done)
+		void Traverse(TraverseAABBFunc aabbFunc, void* pAABBData, TraverseObjectFunc objectFunc, void* pObjectData) const
 		{
-			if (done)
+			if (_objects.size() == 0 || _nodes.size() == 0)
 				return;
 
-			auto found = std::find(node->objects.begin(), node->objects.end(), object);
-			if (found != node->objects.end())
+			uint stack[MAX_STACK_SIZE];
+			uint stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize)
 			{
-				node->objects.erase(found);
-				done = true;
+				uint nodeIndex = stack[--stackSize];
+				AABB bounds = GetNodeBounds(nodeIndex);
+				if (!bounds.IsValid() || !aabbFunc(bounds, pAABBData))
+					continue;
+
+				const Node& node = _nodes[nodeIndex];
+				if (node.count)
+				{
+					for (uint i = node.offset; i < node.offset + node.count; i++)
+					{
+						if (_nodeObjects[i] != INVALID_OBJECT)
+							objectFunc(_leafObjects[i], pObjectData);
+					}
+				}
+				else
+				{
+					stack[stackSize++] = node.offset + 1;
+					stack[stackSize++] = node.offset;
+				}
 			}
 		}
 
-		void Traverse(const Node* node, TraverseFunc Func, void* pUserData) const
+		//Same as Traverse but both children of a node and the objects of a leaf are culled with one call, so the callback can test several boxes at once.
+		//Empty boxes are stored reset (min FLT_MAX, max -FLT_MAX) which a frustum test against the closest corner always rejects
+		void Traverse(CullBatchFunc cullFunc, void* pCullData, TraverseObjectFunc objectFunc, void* pObjectData) const
 		{
-			if (!Func(*node, pUserData))
+			if (_objects.size() == 0 || _nodes.size() == 0)
 				return;
 
-			if (node->children)
+			uint visibleMask;
+			cullFunc(GetBatch(_bounds, 0, 1), &visibleMask, pCullData);
+			if (!(visibleMask & 1))
+				return;
+
+			//only nodes that passed the cull are pushed
+			uint stack[MAX_STACK_SIZE];
+			uint stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize)
 			{
-				for (uint i = 0; i < _childCount; i++)
-					Traverse(&node->children[i], Func, pUserData);
+				const Node& node = _nodes[stack[--stackSize]];
+				if (node.count)
+				{
+					for (uint begin = node.offset; begin < node.offset + node.count; begin += 32)
+					{
+						uint count = glm::min(node.offset + node.count - begin, 32u);
+						cullFunc(GetBatch(_objectBounds, begin, count), &visibleMask, pCullData);
+						for (uint i = 0; i < count; i++)
+						{
+							if ((visibleMask & (1u << i)) && _nodeObjects[begin + i] != INVALID_OBJECT)
+								objectFunc(_leafObjects[begin + i], pObjectData);
+						}
+					}
+				}
+				else
+				{
+					cullFunc(GetBatch(_bounds, node.offset, 2), &visibleMask, pCullData);
+					if (visibleMask & 2)
+						stack[stackSize++] = node.offset + 1;
+					if (visibleMask & 1)
+						stack[stackSize++] = node.offset;
+				}
 			}
 		}
 
-		void Traverse(const Node* node, TraverseThreadedFunc Func, void* pUserData, uint threadIndex) const
+		//Culls against up to 32 views in one walk, each node is only tested against the views its parent passed in.
+		//objectFunc gets the mask of views the object is visible in
+		void Traverse(uint viewMask, CullViewsFunc cullFunc, void* pCullData, TraverseObjectViewsFunc objectFunc, void* pObjectData) const
 		{
-			if (!Func(*node, pUserData, threadIndex))
+			if (_objects.size() == 0 || _nodes.size() == 0 || viewMask == 0)
 				return;
 
-			if (node->children)
+			uint viewMasks[32];
+			cullFunc(GetBatch(_bounds, 0, 1), viewMask, viewMasks, pCullData);
+			if (viewMasks[0] == 0)
+				return;
+
+			struct StackEntry
 			{
-				for (uint i = 0; i < _childCount; i++)
-					Traverse(&node->children[i], Func, pUserData, threadIndex);
+				uint node;
+				uint viewMask;
+			} stack[MAX_STACK_SIZE];
+			uint stackSize = 0;
+			stack[stackSize++] = { 0, viewMasks[0] };
+
+			while (stackSize)
+			{
+				StackEntry entry = stack[--stackSize];
+				const Node& node = _nodes[entry.node];
+				if (node.count)
+				{
+					for (uint begin = node.offset; begin < node.offset + node.count; begin += 32)
+					{
+						uint count = glm::min(node.offset + node.count - begin, 32u);
+						cullFunc(GetBatch(_objectBounds, begin, count), entry.viewMask, viewMasks, pCullData);
+						for (uint i = 0; i < count; i++)
+						{
+							if (viewMasks[i] && _nodeObjects[begin + i] != INVALID_OBJECT)
+								objectFunc(_leafObjects[begin + i], viewMasks[i], pObjectData);
+						}
+					}
+				}
+				else
+				{
+					cullFunc(GetBatch(_bounds, node.offset, 2), entry.viewMask, viewMasks, pCullData);
+					if (viewMasks[1])
+						stack[stackSize++] = { node.offset + 1, viewMasks[1] };
+					if (viewMasks[0])
+						stack[stackSize++] = { node.offset, viewMasks[0] };
+				}
 			}
 		}
 
-	protected:
-		Node* GetRoot()
+		//Visits nodes front to back along the ray and skips everything beyond the closest hit so far, returns true if anything was hit
+		bool Raycast(const Ray& ray, float tMax, RaycastObjectFunc objectFunc, void* pData) const
 		{
-			return _nodes.data();
-		}
+			if (_objects.size() == 0 || _nodes.size() == 0)
+				return false;
 
-		const Node* GetRoot() const
-		{
-			return _nodes.data();
-		}
+			glm::vec3 invDir = 1.0f / ray.Direction;
 
-		uint _depth;
-		uint _objectCount;
-		uint _childCount;
-		uint _nodeCount;
-		Vector<Node> _nodes;
-	};
+			float tEntry;
+			if (!GetNodeBounds(0).IsValid() || !RayNodeIntersect(ray.Origin, invDir, 0, tMax, tEntry))
+				return false;
 
-	template<typename T>
-	class OctTree : public IBoxTree<T>
-	{
-	public:
-		OctTree() : IBoxTree(8)
-		{
+			struct StackEntry
+			{
+				uint node;
+				float tEntry;
+			} stack[MAX_STACK_SIZE];
+			uint stackSize = 0;
+			stack[stackSize++] = { 0, tEntry };
+
+			bool hit = false;
+			while (stackSize)
+			{
+				StackEntry entry = stack[--stackSize];
+				if (entry.tEntry > tMax)
+					continue;
 
+				const Node& node = _nodes[entry.node];
+				if (node.count)
+				{
+					//removed objects have empty bounds so they never pass the box test
+					for (uint i = node.offset; i < node.offset + node.count; i++)
+					{
+						AABB box = GetBounds(_objectBounds, i);
+						if (box.IsValid() && RayBoxIntersect(ray.Origin, invDir, box.Min, box.Max, tMax, tEntry) && objectFunc(_leafObjects[i], ray, tMax, pData))
+							hit = true;
+					}
+				}
+				else
+				{
+					float tLeft, tRight;
+					bool hitLeft = RayNodeIntersect(ray.Origin, invDir, node.offset, tMax, tLeft);
+					bool hitRight = RayNodeIntersect(ray.Origin, invDir, node.offset + 1, tMax, tRight);
+
+					//push the far child first so the near child is popped next
+					if (hitLeft && hitRight)
+					{
+						if (tLeft < tRight)
+						{
+							stack[stackSize++] = { node.offset + 1, tRight };
+							stack[stackSize++] = { node.offset, tLeft };
+						}
+						else
+						{
+							stack[stackSize++] = { node.offset, tLeft };
+							stack[stackSize++] = { node.offset + 1, tRight };
+						}
+					}
+					else if (hitLeft)
+					{
+						stack[stackSize++] = { node.offset, tLeft };
+					}
+					else if (hitRight)
+					{
+						stack[stackSize++] = { node.offset + 1, tRight };
+					}
+				}
+			}
+
+			return hit;
 		}
 
 	private:
-		AABB BuildChildBox(uint index, const AABB& parentBox) const override
+		static constexpr uint INVALID_NODE = 0xFFFFFFFF;
+		static constexpr uint INVALID_OBJECT = 0xFFFFFFFF;
+		static const uint MAX_LEAF_SIZE = 4;
+		static const uint SAH_BIN_COUNT = 12;
+		static const uint MIN_UPDATES_BEFORE_REBUILD = 64;
+		static const uint MAX_SAH_DEPTH = 64;
+		static const uint MAX_STACK_SIZE = 128;
+
+		enum BoundsComponent
 		{
-			glm::vec3 signs;
-			signs.x = (index & 1) ? 1.0f : -1.0f;
-			signs.y = (index & 2) ? 1.0f : -1.0f;
-			signs.z = (index & 4) ? 1.0f : -1.0f;
-
-			glm::vec3 step = parentBox.GetExtent() * 0.5f;
-			glm::vec3 center = parentBox.GetCenter() + step * signs;
+			MIN_X,
+			MIN_Y,
+			MIN_Z,
+			MAX_X,
+			MAX_Y,
+			MAX_Z,
+		};
 
-			return AABB(center - step, center + step);
-		}
-	};
+		//leaves have a count and offset into _nodeObjects (INVALID_OBJECT for removed objects), inner nodes have count 0 and offset is the left child (right child follows it)
+		struct Node
+		{
+			uint offset;
+			uint count;
+			uint parent;
+		};
 
-	template<typename T>
-	class QuadTree : public IBoxTree<T>
-	{
-	public:
-		QuadTree() : IBoxTree(4)
+		struct BuildObject
 		{
+			AABB box;
+			glm::vec3 center;
+			uint index;
+		};
 
-		}
+		struct BuildTask
+		{
+			uint node;
+			uint depth;
+			AABB bounds;
+			AABB centerBounds;
+		};
 
-		void ComputeHeights(void(*GetMinMaxHeightFunc)(const T& object, float&, float&))
+		//returns false if the range should become a leaf, otherwise partitions the range around mid and fills in the bounds of both halves
+		bool FindSplit(Vector<BuildObject>& objects, uint begin, uint end, const BuildTask& task, uint& mid, BuildTask children[2]) const
 		{
-			for (uint i = 0; i < _nodeCount; i++)
+			uint count = end - begin;
+			if (count <= MAX_LEAF_SIZE)
+				return false;
+
+			const AABB& centerBounds = task.centerBounds;
+			glm::vec3 centerExtent = centerBounds.Max - centerBounds.Min;
+			BuildObject* pBegin = &objects[begin];
+			BuildObject* pEnd = pBegin + count;
+
+			//very uneven splits can make the tree deep, past a certain depth fall back to median splits to bound the traversal stack.
+			//when every center is in the same spot the range is split in half as well so the leaves stay small
+			if (task.depth >= MAX_SAH_DEPTH || (centerExtent.x <= 0.0f && centerExtent.y <= 0.0f && centerExtent.z <= 0.0f))
 			{
-				_nodes[i].box.Min.y = FLT_MAX;
-				_nodes[i].box.Max.y = -FLT_MAX;
+				uint medianAxis = centerExtent.x > centerExtent.y ? (centerExtent.x > centerExtent.z ? 0 : 2) : (centerExtent.y > centerExtent.z ? 1 : 2);
+				mid = begin + count / 2;
+				std::nth_element(pBegin, &objects[mid], pEnd, [medianAxis](const BuildObject& lhs, const BuildObject& rhs) -> bool {
+					return lhs.center[medianAxis] < rhs.center[medianAxis];
+				});
 
-				for (auto& obj : _nodes[i].objects)
+				for (uint i = begin; i < end; i++)
 				{
-					float oMin, oMax;
-					GetMinMaxHeightFunc(obj, oMin, oMax);
+					BuildTask& child = children[i < mid ? 0 : 1];
+					if (objects[i].box.IsValid())
+						child.bounds.Expand(objects[i].box);
+					child.centerBounds.Expand(objects[i].center);
+				}
+				return true;
+			}
+
+			struct Bin
+			{
+				Bin() { count = 0; }
 
-					_nodes[i].box.Min.y = glm::min(glm::min(_nodes[i].box.Min.y, oMin), oMax);
-					_nodes[i].box.Max.y = glm::max(glm::max(_nodes[i].box.Max.y, oMin), oMax);
+				AABB box;
+				AABB centerBox;
+				uint count;
+			} bins[SAH_BIN_COUNT];
+
+			//only the axis the centers are spread out the most along is binned, the other axes rarely give a better split
+			uint axis = centerExtent.x > centerExtent.y ? (centerExtent.x > centerExtent.z ? 0 : 2) : (centerExtent.y > centerExtent.z ? 1 : 2);
+			float binScale = SAH_BIN_COUNT / centerExtent[axis];
+			float minCenter = centerBounds.Min[axis];
+
+			for (BuildObject* pObject = pBegin; pObject != pEnd; ++pObject)
+			{
+				Bin& bin = bins[glm::min((uint)((pObject->center[axis] - minCenter) * binScale), SAH_BIN_COUNT - 1)];
+				bin.count++;
+				if (pObject->box.IsValid())
+					bin.box.Expand(pObject->box);
+				bin.centerBox.Expand(pObject->center);
+			}
+
+			//sweep from the right to get the area and count of everything right of each split plane
+			float rightArea[SAH_BIN_COUNT];
+			uint rightCount[SAH_BIN_COUNT];
+			AABB rightBox;
+			uint rightTotal = 0;
+			for (uint b = SAH_BIN_COUNT - 1; b > 0; b--)
+			{
+				if (bins[b].box.IsValid())
+					rightBox.Expand(bins[b].box);
+				rightTotal += bins[b].count;
+				rightArea[b] = SurfaceArea(rightBox);
+				rightCount[b] = rightTotal;
+			}
+
+			float bestCost = FLT_MAX;
+			uint bestBin = 0;
+
+			AABB leftBox;
+			uint leftTotal = 0;
+			for (uint b = 0; b < SAH_BIN_COUNT - 1; b++)
+			{
+				if (bins[b].box.IsValid())
+					leftBox.Expand(bins[b].box);
+				leftTotal += bins[b].count;
+
+				if (leftTotal == 0 || rightCount[b + 1] == 0)
+					continue;
+
+				float cost = SurfaceArea(leftBox) * leftTotal + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestBin = b;
 				}
 			}
 
-			ComputeHeights(GetRoot());
+			//splitting isn't worth it when testing every object is cheaper than the expected cost of the children
+			float area = SurfaceArea(task.bounds);
+			if (bestCost == FLT_MAX || (area > 0.0f && bestCost / area >= count && count <= MAX_LEAF_SIZE * 4))
+				return false;
+
+			for (uint b = 0; b < SAH_BIN_COUNT; b++)
+			{
+				BuildTask& child = children[b <= bestBin ? 0 : 1];
+				if (bins[b].box.IsValid())
+					child.bounds.Expand(bins[b].box);
+				if (bins[b].count)
+					child.centerBounds.Expand(bins[b].centerBox);
+			}
+
+			BuildObject* pMid = std::partition(pBegin, pEnd, [=](const BuildObject& object) -> bool {
+				return glm::min((uint)((object.center[axis] - minCenter) * binScale), SAH_BIN_COUNT - 1) <= bestBin;
+			});
+
+			mid = begin + (uint)(pMid - pBegin);
+			return true;
 		}
 
-	private:
-		AABB BuildChildBox(uint index, const AABB& parentBox) const override
+		static float SurfaceArea(const AABB& box)
 		{
-			glm::vec3 signs;
-			signs.x = (index & 1) ? 1.0f : -1.0f;
-			signs.z = (index & 2) ? 1.0f : -1.0f;
-			signs.y = 1.0f;
-
-			glm::vec3 step = parentBox.GetExtent() * 0.5f;
-			glm::vec3 center = parentBox.GetCenter() + step * signs;
-
-			AABB box = AABB(center - step, center + step);
-			box.Min.y = parentBox.Min.y;
-			box.Max.y = parentBox.Max.y;
-			return box;
+			if (!box.IsValid())
+				return 0.0f;
+
+			glm::vec3 size = box.Max - box.Min;
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
 		}
 
-		void CollectHeights(Node* node, float& currMin, float& currMax)
+		void Refit(uint nodeIndex)
 		{
-			if (node->objects.size())
+			const Node& leaf = _nodes[nodeIndex];
+			AABB bounds;
+			for (uint i = leaf.offset; i < leaf.offset + leaf.count; i++)
 			{
-				currMin = glm::min(glm::min(node->box.Min.y, currMin), node->box.Max.y);
-				currMax = glm::max(glm::max(node->box.Min.y, currMax), node->box.Max.y);
+				if (_nodeObjects[i] != INVALID_OBJECT && _objectBoxes[_nodeObjects[i]].IsValid())
+					bounds.Expand(_objectBoxes[_nodeObjects[i]]);
 			}
+			SetNodeBounds(nodeIndex, bounds);
 
-			if (node->children)
+			nodeIndex = leaf.parent;
+			while (nodeIndex != INVALID_NODE)
 			{
-				for (uint i = 0; i < _childCount; i++)
-					CollectHeights(&node->children[i], currMin, currMax);
+				const Node& node = _nodes[nodeIndex];
+				bounds = GetNodeBounds(node.offset);
+				AABB rightBounds = GetNodeBounds(node.offset + 1);
+				if (rightBounds.IsValid())
+					bounds.Expand(rightBounds);
+
+				//nothing above changes if this node's bounds didn't
+				if (bounds == GetNodeBounds(nodeIndex))
+					break;
+
+				SetNodeBounds(nodeIndex, bounds);
+				nodeIndex = node.parent;
 			}
 		}
 
-		void ComputeHeights(Node* node)
+		static AABBBatch GetBatch(const Vector<float> bounds[6], uint offset, uint count)
 		{
-			if (node->children)
-			{
-				for (uint i = 0; i < _childCount; i++)
-					CollectHeights(&node->children[i], node->box.Min.y, node->box.Max.y);
-			}
-			//else
-			//{
-			//	float minH = node->box.Min.y;
-			//	float maxH = node->box.Max.y;
-			//	Node* parent = node->parent;
-			//	while (parent)
-			//	{
-			//		parent->box.Min.y = glm::min(parent->box.Min.y, minH);
-			//		parent->box.Max.y = glm::max(parent->box.Max.y, maxH);
-			//		minH = parent->box.Min.y;
-			//		maxH = parent->box.Max.y;
-			//		parent = parent->parent;
-			//	}
-			//}
+			AABBBatch batch;
+			batch.MinX = bounds[MIN_X].data() + offset;
+			batch.MinY = bounds[MIN_Y].data() + offset;
+			batch.MinZ = bounds[MIN_Z].data() + offset;
+			batch.MaxX = bounds[MAX_X].data() + offset;
+			batch.MaxY = bounds[MAX_Y].data() + offset;
+			batch.MaxZ = bounds[MAX_Z].data() + offset;
+			batch.Count = count;
+			return batch;
+		}
+
+		static void SetBounds(Vector<float> bounds[6], uint index, const AABB& box)
+		{
+			bounds[MIN_X][index] = box.Min.x;
+			bounds[MIN_Y][index] = box.Min.y;
+			bounds[MIN_Z][index] = box.Min.z;
+			bounds[MAX_X][index] = box.Max.x;
+			bounds[MAX_Y][index] = box.Max.y;
+			bounds[MAX_Z][index] = box.Max.z;
+		}
+
+		static AABB GetBounds(const Vector<float> bounds[6], uint index)
+		{
+			return AABB(
+				glm::vec3(bounds[MIN_X][index], bounds[MIN_Y][index], bounds[MIN_Z][index]),
+				glm::vec3(bounds[MAX_X][index], bounds[MAX_Y][index], bounds[MAX_Z][index]));
+		}
+
+		AABB GetNodeBounds(uint nodeIndex) const
+		{
+			return GetBounds(_bounds, nodeIndex);
 		}
-	};
 
+		void SetNodeBounds(uint nodeIndex, const AABB& box)
+		{
+			SetBounds(_bounds, nodeIndex, box);
+		}
+
+		bool RayNodeIntersect(const glm::vec3& origin, const glm::vec3& invDir, uint nodeIndex, float tMax, float& tEntry) const
+		{
+			glm::vec3 min = glm::vec3(_bounds[MIN_X][nodeIndex], _bounds[MIN_Y][nodeIndex], _bounds[MIN_Z][nodeIndex]);
+			glm::vec3 max = glm::vec3(_bounds[MAX_X][nodeIndex], _bounds[MAX_Y][nodeIndex], _bounds[MAX_Z][nodeIndex]);
+			return RayBoxIntersect(origin, invDir, min, max, tMax, tEntry);
+		}
+
+		static bool RayBoxIntersect(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& min, const glm::vec3& max, float tMax, float& tEntry)
+		{
+			glm::vec3 t0 = (min - origin) * invDir;
+			glm::vec3 t1 = (max - origin) * invDir;
+			glm::vec3 tNear = glm::min(t0, t1);
+			glm::vec3 tFar = glm::max(t0, t1);
+
+			tEntry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+			float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+			return tEntry <= tExit;
+		}
+
+		Vector<Node> _nodes;
+		Vector<float> _bounds[6];
+		Vector<uint> _nodeObjects;
+		//copies of the objects in leaf order so queries hand them out without going through _nodeObjects
+		Vector<T> _leafObjects;
+		Vector<float> _objectBounds[6];
+
+		Vector<T> _objects;
+		Vector<AABB> _objectBoxes;
+		Vector<uint> _objectLeaves;
+		Vector<uint> _objectSlots;
+		Map<T, uint> _objectIndices;
+
+		bool _needsBuild;
+		uint _updatesSinceBuild;
+	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "SceneNode.h"
+#include "Scene.h"
 #include "ShaderMgr.h"
 #include "Texture2D.h"
 #include "Texture2DArray.h"
@@ -10,18 +11,154 @@
 #include "FastNoise.h"
 #include "Terrain.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_SSE
+#include <emmintrin.h>
+#endif
+
+//biome heights are smoothed and composited in tiles of samples so the rows a tile works on stay in cache
+#define TERRAIN_TILE_ROWS 32
+#define TERRAIN_TILE_COLUMNS 256
+
 namespace SunEngine
 {
     const String Terrain::Strings::SplatMap = "SplatMap";
     const String Terrain::Strings::SplatSampler = "SplatSampler";
     const String Terrain::Strings::PosToUV = "PosToUV";
     const String Terrain::Strings::TextureTiling = "TextureTiling";
+    const String Terrain::Strings::HeightMap = "HeightMap";
+    const String Terrain::Strings::PackedNormalMap = "PackedNormalMap";
+
+    static void EncodeOctahedral(const glm::vec3& normal, uchar* pEncoded)
+    {
+        //the upper hemisphere is projected onto the octahedron's center diamond, the lower one folds out into the corners
+        glm::vec2 p = glm::vec2(normal.x, normal.z) / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+        if (normal.y < 0.0f)
+            p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+
+        pEncoded[0] = (uchar)glm::round(glm::clamp(p.x * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f);
+        pEncoded[1] = (uchar)glm::round(glm::clamp(p.y * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f);
+    }
+
+    //pDst[i] += pSrc[i]
+    static void AddRow(const float* pSrc, float* pDst, uint count)
+    {
+        uint i = 0;
+#ifdef TERRAIN_SSE
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(pDst + i, _mm_add_ps(_mm_loadu_ps(pDst + i), _mm_loadu_ps(pSrc + i)));
+#endif
+        for (; i < count; i++)
+            pDst[i] += pSrc[i];
+    }
+
+    //pDst[i] = pSrc[i] * scale + offset, pSrc may be pDst
+    static void ScaleRow(const float* pSrc, float* pDst, uint count, float scale, float offset)
+    {
+        uint i = 0;
+#ifdef TERRAIN_SSE
+        __m128 s = _mm_set1_ps(scale);
+        __m128 o = _mm_set1_ps(offset);
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(pDst + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pSrc + i), s), o));
+#endif
+        for (; i < count; i++)
+            pDst[i] = pSrc[i] * scale + offset;
+    }
+
+    static void MultiplyRow(float* pRow, const float* pScales, uint count)
+    {
+        uint i = 0;
+#ifdef TERRAIN_SSE
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(pRow + i, _mm_mul_ps(_mm_loadu_ps(pRow + i), _mm_loadu_ps(pScales + i)));
+#endif
+        for (; i < count; i++)
+            pRow[i] *= pScales[i];
+    }
+
+    //Writes the average of the samples within radius of every sample of [min, max) of a width x height image into pDst,
+    //which is the size of the region. The window is clipped to the image so edges average fewer samples. Tiles are split
+    //across the pool, each filters the rows it needs and then its columns, adding a whole shifted row per tap
+    static void BoxFilter(const float* pSrc, uint width, uint height, int radius, const glm::ivec2& min, const glm::ivec2& max, float* pDst)
+    {
+        int regionWidth = max.x - min.x;
+        int regionHeight = max.y - min.y;
+        if (regionWidth <= 0 || regionHeight <= 0)
+            return;
+
+        radius = glm::max(radius, 0);
+
+        //reciprocals of the clipped window size along each axis
+        Vector<float> invCountX, invCountY;
+        invCountX.resize(regionWidth);
+        invCountY.resize(regionHeight);
+        for (int x = 0; x < regionWidth; x++)
+            invCountX[x] = 1.0f / (glm::min(int(width) - 1, min.x + x + radius) - glm::max(0, min.x + x - radius) + 1);
+        for (int y = 0; y < regionHeight; y++)
+            invCountY[y] = 1.0f / (glm::min(int(height) - 1, min.y + y + radius) - glm::max(0, min.y + y - radius) + 1);
+
+        uint tilesX = (regionWidth + TERRAIN_TILE_COLUMNS - 1) / TERRAIN_TILE_COLUMNS;
+        uint tilesY = (regionHeight + TERRAIN_TILE_ROWS - 1) / TERRAIN_TILE_ROWS;
+
+        PerThreadData<Vector<float>> scratch;
+        ThreadPool::Get().ParallelForRange(0, tilesX * tilesY, 1, [&](uint threadIndex, uint begin, uint end) -> void {
+            Vector<float>& rows = scratch[threadIndex];
+            for (uint t = begin; t < end; t++)
+            {
+                int x0 = min.x + int(t % tilesX) * TERRAIN_TILE_COLUMNS;
+                int x1 = glm::min(max.x, x0 + TERRAIN_TILE_COLUMNS);
+                int y0 = min.y + int(t / tilesX) * TERRAIN_TILE_ROWS;
+                int y1 = glm::min(max.y, y0 + TERRAIN_TILE_ROWS);
+                int rowBegin = glm::max(0, y0 - radius);
+                int rowEnd = glm::min(int(height), y1 + radius);
+                uint tileWidth = x1 - x0;
+
+                rows.resize((rowEnd - rowBegin) * tileWidth);
+                for (int y = rowBegin; y < rowEnd; y++)
+                {
+                    float* pRow = &rows[(y - rowBegin) * tileWidth];
+                    const float* pSrcRow = pSrc + size_t(y) * width;
+                    memset(pRow, 0, sizeof(float) * tileWidth);
+                    for (int j = -radius; j <= radius; j++)
+                    {
+                        int first = glm::max(x0, -j);
+                        int last = glm::min(x1, int(width) - j);
+                        if (first < last)
+                            AddRow(pSrcRow + first + j, pRow + first - x0, last - first);
+                    }
+                    MultiplyRow(pRow, &invCountX[x0 - min.x], tileWidth);
+                }
+
+                for (int y = y0; y < y1; y++)
+                {
+                    float* pOut = pDst + size_t(y - min.y) * regionWidth + (x0 - min.x);
+                    memset(pOut, 0, sizeof(float) * tileWidth);
+                    int first = glm::max(rowBegin, y - radius);
+                    int last = glm::min(rowEnd, y + radius + 1);
+                    for (int r = first; r < last; r++)
+                        AddRow(&rows[(r - rowBegin) * tileWidth], pOut, tileWidth);
+                    ScaleRow(pOut, pOut, tileWidth, invCountY[y - min.y], 0.0f);
+                }
+            }
+        });
+    }
 
     Terrain::Terrain() : RenderObject(RO_TERRAIN)
     {
         _resolution = 2048;
-        _slices = 4;
+        _patchResolution = 32;
+        _patchIndexCount = 0;
+        _quarterIndexCount = 0;
+        _packedNormals = false;
+        _quantizeMin = 0.0f;
+        _quantizeRange = 1.0f;
+        _windowOrigin = glm::ivec2(0);
+        _streamingObserver = glm::vec3(0.0f);
+        ClearDirty();
+        _tiles = UniquePtr<TerrainTileCache>(new TerrainTileCache());
         _mesh = UniquePtr<Mesh>(new Mesh());
+        _heightMap = UniquePtr<Texture2D>(new Texture2D());
         _material = UniquePtr<Material>(new Material());
         _material->SetShader(ShaderMgr::Get().GetShader(DefaultShaders::Terrain));
         _material->RegisterToGPU();
@@ -58,6 +195,7 @@ namespace SunEngine
         setCount += _material->SetSampler(Strings::SplatSampler, ResourceMgr::Get().GetSampler(SE_FM_LINEAR, SE_WM_CLAMP_TO_EDGE));
         setCount += _material->SetMaterialVar(Strings::PosToUV, glm::vec4(1.0f / _resolution, 1.0f / _resolution, 0.5f, 0.5f));
         setCount += _material->SetMaterialVar(Strings::TextureTiling, _textureTiling, sizeof(float) * numTextures);
+        setCount += _material->SetTexture2D(Strings::PackedNormalMap, ResourceMgr::Get().GetTexture2D(DefaultResource::Texture::Black));
 
         BuildMesh();
     }
@@ -70,151 +208,287 @@ namespace SunEngine
     void Terrain::BuildMesh()
     {
         //no change...
-        if (_mesh->GetVertexCount() == (_resolution * _resolution) && _sliceData.size() == (_slices * _slices))
+        if (_heights.size() == (_resolution * _resolution) && _mesh->GetVertexCount() == (_patchResolution + 1) * (_patchResolution + 1))
             return;
 
-        uint halfRef = _resolution / 2;
-        _mesh->AllocVertices(_resolution * _resolution, TerrainVertex::Definition);
-        _splatLookup.resize(_resolution * _resolution);
-        memset(_splatLookup.data(), 0x0, sizeof(Splat) * _splatLookup.size());
-
         _heights.resize(_resolution * _resolution);
         memset(_heights.data(), 0x0, sizeof(float) * _heights.size());
 
-        glm::vec4 offset = -glm::vec4(halfRef, 0, halfRef, 0);
-        float scaleFactor = _resolution / (float)(_resolution - 1);
-        //scaleFactor=1.0f;
+        UpdateBounds();
 
-        TerrainVertex* pVerts = _mesh->GetVertices<TerrainVertex>();
-        for (uint z = 0; z < _resolution; z++)
-        {
-            for (uint x = 0; x < _resolution; x++)
-            {
-                uint vIndex = z * _resolution + x;
+        //a streamed window is filled again as its tiles are requested
+        _windowTilesLoaded.clear();
 
-                pVerts[vIndex].Position = glm::vec4(x, 0, z, 1) * scaleFactor + offset;
-                //printf("%f %f\n", pVerts[vIndex].Position.x, pVerts[vIndex].Position.z);
-            }
+        //the heights are gone, biomes are composited again by the next UpdateBiomes
+        for (auto& kv : _biomes)
+        {
+            kv.second->_changed = true;
+            kv.second->_footprintMin = glm::ivec2(0);
+            kv.second->_footprintMax = glm::ivec2(0);
         }
 
-        //uint testVal = (_resolution - 1) * (_resolution - 1) * 6;
+        BuildPatchMesh();
+        _heightMap->Alloc(_resolution, _resolution, ImageData::SAMPLED_TEXTURE_R16);
+        if (_normalMap)
+            _normalMap->Alloc(_resolution, _resolution, ImageData::SAMPLED_TEXTURE_R8G8);
+        UpdateHeightMap();
+        UpdateSplats(glm::ivec2(0), glm::ivec2(_resolution));
+        _uploads.Submit();
+    }
 
-        uint indexCount = 0;
-        Map<glm::uvec2, Vector<uint>> sliceTypeIndices;
-        BuildSliceIndices(sliceTypeIndices, indexCount);
-        _mesh->AllocIndices(indexCount);
-        
-        Map<glm::uvec2, uint> sliceTypeOffsets;
-        uint indexOffset = 0;
-        for (auto& sliceIndices : sliceTypeIndices)
+    void Terrain::BuildPatchMesh()
+    {
+        //vertex positions are grid coordinates, Terrain.vs scales them by the patch's level and offsets them to the patch
+        uint gridSize = _patchResolution + 1;
+        _mesh->AllocVertices(gridSize * gridSize, TerrainVertex::Definition);
+
+        TerrainVertex* pVerts = _mesh->GetVertices<TerrainVertex>();
+        for (uint z = 0; z < gridSize; z++)
         {
-            _mesh->SetIndices(sliceIndices.second.data(), indexOffset, sliceIndices.second.size());
-            sliceTypeOffsets[sliceIndices.first] = indexOffset;
-            indexOffset += sliceIndices.second.size();
+            for (uint x = 0; x < gridSize; x++)
+                pVerts[z * gridSize + x].Position = glm::vec4(x, 0, z, 1);
         }
-        
-        uint yOffset = 0;
-        uint sliceResolution = _resolution / _slices;
-        _sliceData.resize(_slices * _slices);
-        for (uint sliceY = 0; sliceY < _slices; sliceY++)
+
+        //the full grid is followed by its top left quarter, drawn for nodes of which only a quarter is selected
+        uint halfResolution = _patchResolution / 2;
+        _patchIndexCount = _patchResolution * _patchResolution * 6;
+        _quarterIndexCount = halfResolution * halfResolution * 6;
+
+        Vector<uint> indices;
+        indices.reserve(_patchIndexCount + _quarterIndexCount);
+        for (uint resolution : { _patchResolution, halfResolution })
         {
-            uint xOffset = 0;
-            for (uint sliceX = 0; sliceX < _slices; sliceX++)
+            for (uint y = 0; y < resolution; y++)
             {
-                Slice slice = {};
-                slice.x = sliceX;
-                slice.y = sliceY;
+                for (uint x = 0; x < resolution; x++)
+                {
+                    uint topLeft = y * gridSize + x;
+                    uint topRight = topLeft + 1;
+                    uint bottomLeft = topLeft + gridSize;
+                    uint bottomRight = bottomLeft + 1;
 
-                glm::uvec2 sliceType;
-                sliceType.x = slice.x == _slices - 1 ? 1 : 0;
-                sliceType.y = slice.y == _slices - 1 ? 1 : 0;
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(bottomRight);
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomRight);
+                    indices.push_back(topRight);
+                }
+            }
+        }
 
-                slice.firstIndex = sliceTypeOffsets[sliceType];
-                slice.indexCount = sliceTypeIndices[sliceType].size();
-                slice.vertexOffset = yOffset + xOffset;
+        _mesh->AllocIndices(indices.size());
+        _mesh->SetIndices(indices.data(), 0, indices.size());
+        _mesh->RegisterToGPU();
+    }
 
-                slice.aabb.Min.y = slice.aabb.Max.y = 0.0f;
+    void Terrain::Initialize(SceneNode* pNode, ComponentData* pData)
+    {
+        //a single node covers the terrain for scene culling, the renderer expands it to the patches each view selects
+        CreateRenderNode(pData->As<RenderComponentData>());
 
-                slice.aabb.Min.x = float(sliceX * sliceResolution) - halfRef;
-                slice.aabb.Max.x = slice.aabb.Min.x + sliceResolution;
+        RenderObject::Initialize(pNode, pData);
+    }
 
-                slice.aabb.Min.z = float(sliceY * sliceResolution) - halfRef;
-                slice.aabb.Max.z = slice.aabb.Min.z + sliceResolution;
+    void Terrain::Update(SceneNode* pNode, ComponentData* pData, float dt, float et)
+    {
+        //uploads and the tile cache can't be used from the thread pool, streaming and edits made since the last frame are
+        //handled together in Flush
+        if (IsTiled() || IsDirty())
+            pNode->GetScene()->RequestFlush(this, pData, pNode);
+        else
+            RenderObject::Update(pNode, pData, dt, et);
+    }
+
+    void Terrain::Flush(SceneNode* pNode, ComponentData* pData)
+    {
+        if (IsTiled())
+            UpdateStreaming(pNode);
 
+        UpdateDirtyRegion();
 
-                //printf("(%d,%d), min: (%f,%f,%f), max: (%f,%f,%f)\n", slice.x, slice.y, slice.aabb.Min.x, slice.aabb.Min.y, slice.aabb.Min.z, slice.aabb.Max.x, slice.aabb.Max.y, slice.aabb.Max.z);
+        //the render node picks up the new bounds before the scene refits its BVH
+        RenderObject::Update(pNode, pData, 0.0f, 0.0f);
+    }
 
-                _sliceData[sliceY * _slices + sliceX] = slice;
-                xOffset += sliceResolution;
-            }
-            yOffset += (_resolution * sliceResolution);
+    bool Terrain::OpenTiles(const String& filename)
+    {
+        if (!_tiles->Open(filename))
+            return false;
+
+        const TerrainTileFile::Header& header = _tiles->GetHeader();
+        if (_resolution % header.TileSize != 0)
+        {
+            _tiles->Close();
+            return false;
         }
 
-        _mesh->RegisterToGPU();
-        BuildSplatArray();
+        //the window starts centered on the world, biomes no longer composite into it
+        int windowTiles = _resolution / header.TileSize;
+        _windowOrigin = (glm::ivec2(header.TilesX, header.TilesY) - windowTiles) / 2 * int(header.TileSize);
+        _windowTilesLoaded.clear();
+        memset(_heights.data(), 0x0, sizeof(float) * _heights.size());
+        UpdateBounds();
+        MarkDirty(glm::ivec2(0), glm::ivec2(_resolution));
+        return true;
+    }
+
+    void Terrain::CloseTiles()
+    {
+        if (!IsTiled())
+            return;
+
+        _tiles->Close();
+        _windowOrigin = glm::ivec2(0);
+        _windowTilesLoaded.clear();
+        memset(_heights.data(), 0x0, sizeof(float) * _heights.size());
+        UpdateBounds();
+        MarkDirty(glm::ivec2(0), glm::ivec2(_resolution));
+
+        for (auto& kv : _biomes)
+            kv.second->_changed = true;
     }
 
-    void Terrain::BuildSliceIndices(Map<glm::uvec2, Vector<uint>> &sliceTypeIndices, uint& indexCount) const
+    void Terrain::UpdateStreaming(SceneNode* pNode)
     {
-        uint sliceResolution = _resolution / _slices;
+        _tiles->Update();
+
+        const TerrainTileFile::Header& header = _tiles->GetHeader();
+        int tileSize = header.TileSize;
+        int windowTiles = _resolution / tileSize;
+        if (_resolution % tileSize != 0)
+            return;
 
-        //generate 4 types of mesh indices for possible location of slices on the vertex grid
-        glm::uvec2 sliceTypeResolutions[] =
+        if (_windowTilesLoaded.size() != uint(windowTiles * windowTiles))
+            _windowTilesLoaded.assign(windowTiles * windowTiles, false);
+
+        //the observer in world samples, the inverse of the sample to local mapping in SelectPatches without the window
+        float halfRes = _resolution / 2.0f;
+        float sampleScale = _resolution / (float)(_resolution - 1);
+        glm::vec3 observer = glm::vec3(glm::inverse(pNode->GetWorld()) * glm::vec4(_streamingObserver, 1.0f));
+        glm::ivec2 observerTile = glm::ivec2(glm::floor((glm::vec2(observer.x, observer.z) + halfRes) / (sampleScale * tileSize)));
+
+        //the window is kept inside the world, or centered on a world smaller than it. It only moves once the observer is
+        //more than a quarter of it off center so crossing a tile border back and forth doesn't move it every time
+        glm::ivec2 windowTile = _windowOrigin / tileSize;
+        glm::ivec2 maxTile = glm::ivec2(header.TilesX, header.TilesY) - windowTiles;
+        glm::ivec2 targetTile = observerTile - windowTiles / 2;
+        for (int i = 0; i < 2; i++)
+            targetTile[i] = maxTile[i] >= 0 ? glm::clamp(targetTile[i], 0, maxTile[i]) : maxTile[i] / 2;
+
+        glm::ivec2 offCenter = glm::abs(observerTile - (windowTile + windowTiles / 2));
+        if (targetTile != windowTile && glm::max(offCenter.x, offCenter.y) > windowTiles / 4)
         {
-            glm::uvec2(0, 0), //mesh indices for slice that is not on a exiting boundary
-            glm::uvec2(1, 0), //mesh indices for slice that is on the right boundary
-            glm::uvec2(0, 1), //mesh indices for slice that is on the bottom boundary
-            glm::uvec2(1, 1), //mesh indices for slice that is on the right and bottom boundary
-        };
+            MoveWindow(targetTile * tileSize);
+            windowTile = targetTile;
+        }
 
-        for (uint t = 0; t < SE_ARR_SIZE(sliceTypeResolutions); t++)
+        //window tiles are copied in as they arrive, the ring around the window is requested ahead of it moving there
+        float heightScale = header.HeightRange / 65535.0f;
+        for (int ty = -1; ty <= windowTiles; ty++)
         {
-            uint resX = sliceResolution - sliceTypeResolutions[t].x;
-            uint resY = sliceResolution - sliceTypeResolutions[t].y;
+            for (int tx = -1; tx <= windowTiles; tx++)
+            {
+                glm::ivec2 tile = windowTile + glm::ivec2(tx, ty);
+                bool inWindow = tx >= 0 && ty >= 0 && tx < windowTiles && ty < windowTiles;
+                if (tile.x < 0 || tile.y < 0 || (inWindow && _windowTilesLoaded[ty * windowTiles + tx]))
+                    continue;
 
-            Vector<uint>& indices = sliceTypeIndices[sliceTypeResolutions[t]];
+                const ushort* pTile = _tiles->Request(tile.x, tile.y);
+                if (!pTile || !inWindow)
+                    continue;
 
-            indices.resize(resX * resY * 6);
-            uint idxCounter = 0;
-            for (uint y = 0; y < resY; y++)
-            {
-                for (uint x = 0; x < resX; x++)
+                for (int y = 0; y < tileSize; y++)
                 {
-                    uint topLeft = y * _resolution + x;
-                    uint topRight = topLeft + 1;
-                    uint bottomLeft = topLeft + _resolution;
-                    uint bottomRight = bottomLeft + 1;
-
-                    indices[idxCounter++] = topLeft;
-                    indices[idxCounter++] = bottomLeft;
-                    indices[idxCounter++] = bottomRight;
-                    indices[idxCounter++] = topLeft;
-                    indices[idxCounter++] = bottomRight;
-                    indices[idxCounter++] = topRight;
+                    float* pRow = &_heights[(ty * tileSize + y) * _resolution + tx * tileSize];
+                    for (int x = 0; x < tileSize; x++)
+                        pRow[x] = header.HeightMin + pTile[y * tileSize + x] * heightScale;
                 }
-            }
 
-            indexCount += indices.size();
+                _windowTilesLoaded[ty * windowTiles + tx] = true;
+                glm::ivec2 min = glm::ivec2(tx, ty) * tileSize;
+                MarkDirty(min, min + tileSize);
+            }
         }
     }
 
-    void Terrain::Initialize(SceneNode* pNode, ComponentData* pData)
+    void Terrain::MoveWindow(const glm::ivec2& origin)
     {
-        TerrainComponentData* pRenderData = pData->As<TerrainComponentData>();
-        pRenderData->_sliceNodes.clear();
+        //samples the old and new window share are moved in place, rows are walked so none is overwritten before it is read
+        int resolution = _resolution;
+        glm::ivec2 shift = origin - _windowOrigin;
+        int x0 = glm::clamp(-shift.x, 0, resolution);
+        int x1 = glm::clamp(resolution - shift.x, x0, resolution);
+        for (int i = 0; i < resolution; i++)
+        {
+            int y = shift.y >= 0 ? i : resolution - 1 - i;
+            int srcY = y + shift.y;
+            float* pRow = &_heights[y * resolution];
+            if (srcY < 0 || srcY >= resolution || x0 == x1)
+            {
+                memset(pRow, 0x0, sizeof(float) * resolution);
+                continue;
+            }
+
+            memmove(pRow + x0, &_heights[srcY * resolution + x0 + shift.x], sizeof(float) * (x1 - x0));
+            memset(pRow, 0x0, sizeof(float) * x0);
+            memset(pRow + x1, 0x0, sizeof(float) * (resolution - x1));
+        }
 
-        for (uint i = 0; i < _sliceData.size(); i++)
+        int tileSize = _tiles->GetHeader().TileSize;
+        int windowTiles = resolution / tileSize;
+        glm::ivec2 tileShift = shift / tileSize;
+        Vector<bool> loaded(_windowTilesLoaded.size(), false);
+        for (int y = 0; y < windowTiles; y++)
         {
-            RenderNode* pRenderNode = CreateRenderNode(pRenderData);
-            pRenderData->_sliceNodes[pRenderNode] = i;
+            for (int x = 0; x < windowTiles; x++)
+            {
+                glm::ivec2 src = glm::ivec2(x, y) + tileShift;
+                if (src.x >= 0 && src.y >= 0 && src.x < windowTiles && src.y < windowTiles)
+                    loaded[y * windowTiles + x] = _windowTilesLoaded[src.y * windowTiles + src.x];
+            }
         }
+        _windowTilesLoaded = loaded;
 
-        RenderObject::Initialize(pNode, pData);
+        _windowOrigin = origin;
+        UpdateBounds();
+        MarkDirty(glm::ivec2(0), glm::ivec2(_resolution));
     }
 
-    void Terrain::Update(SceneNode* pNode, ComponentData* pData, float dt, float et)
+    bool Terrain::SaveTiles(const String& filename, uint tileSize) const
     {
-        RenderObject::Update(pNode, pData, dt, et);
+        if (tileSize == 0 || _resolution % tileSize != 0)
+            return false;
+
+        TerrainTileFile::Header header;
+        header.TileSize = tileSize;
+        header.TilesX = _resolution / tileSize;
+        header.TilesY = _resolution / tileSize;
+        header.HeightMin = _lod.GetMinHeight();
+        header.HeightRange = glm::max(_lod.GetMaxHeight() - header.HeightMin, FLT_EPSILON);
+
+        TerrainTileFile::Writer writer;
+        if (!writer.Open(filename, header))
+            return false;
+
+        Vector<float> tile;
+        tile.resize(tileSize * tileSize);
+        for (uint ty = 0; ty < header.TilesY; ty++)
+        {
+            for (uint tx = 0; tx < header.TilesX; tx++)
+            {
+                for (uint y = 0; y < tileSize; y++)
+                    memcpy(&tile[y * tileSize], &_heights[(ty * tileSize + y) * _resolution + tx * tileSize], sizeof(float) * tileSize);
+
+                if (!writer.WriteTile(tile.data()))
+                {
+                    writer.Close();
+                    return false;
+                }
+            }
+        }
+
+        return writer.Close();
     }
 
     Terrain::Biome* Terrain::AddBiome(const String& name)
@@ -232,201 +506,146 @@ namespace SunEngine
 
     void Terrain::UpdateBiomes()
     {
-        memset(_heights.data(), 0x0, sizeof(float) * _heights.size());
+        //a streamed terrain's heights come from its tiles
+        if (IsTiled())
+            return;
+
+        int halfRes = _resolution / 2;
 
-        //Can this be threaded?
+        Vector<float> smoothHeights;
+        Vector<int> columns;
         for (auto& kv : _biomes)
         {
             auto& biome = kv.second;
-            if (biome->_changed && biome->_normalizedTextureHeights.size())
+            if (!biome->_changed)
+                continue;
+
+            //the area the biome covered before the change is composited again along with the one it covers now
+            MarkDirty(biome->_footprintMin, biome->_footprintMax);
+            biome->_footprintMin = glm::ivec2(0);
+            biome->_footprintMax = glm::ivec2(0);
+            biome->_changed = false;
+
+            if (biome->_normalizedTextureHeights.size())
             {
-                int resx = int(biome->_texture->GetWidth() * biome->_resolutionScale);
-                int resy = int(biome->_texture->GetHeight() * biome->_resolutionScale);
+                int width = biome->_texture->GetWidth();
+                int height = biome->_texture->GetHeight();
+                int resx = int(width * biome->_resolutionScale);
+                int resy = int(height * biome->_resolutionScale);
+
+                biome->_footprintMin = glm::ivec2(biome->_center.x + halfRes - resx / 2, biome->_center.y + halfRes - resy / 2);
+                biome->_footprintMax = biome->_footprintMin + glm::ivec2(resx, resy);
+                MarkDirty(biome->_footprintMin, biome->_footprintMax);
 
                 biome->_heights.resize(resx * resy);
 
+                smoothHeights.resize(width * height);
+                BoxFilter(biome->_normalizedTextureHeights.data(), width, height, biome->_smoothKernelSize, glm::ivec2(0), glm::ivec2(width, height), smoothHeights.data());
+
+                //inverting maps h to (1 - h) before the height scale
+                float scale = biome->_invert ? -biome->_heightScale : biome->_heightScale;
+                float offset = biome->_invert ? biome->_heightScale : 0.0f;
                 float invResolution = 1.0f / biome->_resolutionScale;
-                for (int y = 0; y < resy; y++)
-                {
-                    int ty = int(y * invResolution);
-                    for (int x = 0; x < resx; x++)
+                bool scaled = biome->_resolutionScale != 1.0f;
+
+                columns.resize(resx);
+                for (int x = 0; x < resx; x++)
+                    columns[x] = int(x * invResolution);
+
+                ThreadPool::Get().ParallelFor(0, resy, 16, [&](uint, uint y) -> void {
+                    const float* pSmooth = &smoothHeights[int(y * invResolution) * width];
+                    float* pHeights = &biome->_heights[y * resx];
+                    if (scaled)
                     {
-                        int tx = int(x * invResolution);
-
-                        float height = biome->GetSmoothHeight(tx, ty);
-                        if (biome->_invert) height = 1.0f - height;
-                        height *= biome->_heightScale;
-                        //height += biome->_heightOffset;
-                        int index = y * resx + x;
-                        biome->_heights[index] = height;
+                        for (int x = 0; x < resx; x++)
+                            pHeights[x] = pSmooth[columns[x]] * scale + offset;
                     }
-                }
+                    else
+                    {
+                        ScaleRow(pSmooth, pHeights, resx, scale, offset);
+                    }
+                });
             }
         }
 
-        int halfRes = _resolution / 2;
-
-        Vector<Pair<glm::ivec2, float>> smoothLocations;
-        smoothLocations.reserve(halfRes);
+        if (!IsDirty())
+            return;
 
+        Vector<const Biome*> biomes;
         for (auto& kv : _biomes)
         {
-            auto& biome = kv.second;
-            if (biome->_normalizedTextureHeights.size())
-            {
-                int resx = int(biome->_texture->GetWidth() * biome->_resolutionScale);
-                int resy = int(biome->_texture->GetHeight() * biome->_resolutionScale);
-
-                int halfResx = resx / 2;
-                int halfResy = resy / 2;
+            if (kv.second->_normalizedTextureHeights.size())
+                biomes.push_back(kv.second.get());
+        }
 
-                glm::vec2 uvRange = glm::vec2(resx, resy);
-                glm::vec2 halfRange = uvRange / 2.0f;
+        //tiles are disjoint, so each composites every biome in order over its own samples
+        glm::ivec2 dirtySize = _dirtyMax - _dirtyMin;
+        uint tilesX = (dirtySize.x + TERRAIN_TILE_COLUMNS - 1) / TERRAIN_TILE_COLUMNS;
+        uint tilesY = (dirtySize.y + TERRAIN_TILE_ROWS - 1) / TERRAIN_TILE_ROWS;
+        ThreadPool::Get().ParallelFor(0, tilesX * tilesY, 1, [&](uint, uint t) -> void {
+            glm::ivec2 min = _dirtyMin + glm::ivec2(t % tilesX * TERRAIN_TILE_COLUMNS, t / tilesX * TERRAIN_TILE_ROWS);
+            glm::ivec2 max = glm::min(_dirtyMax, min + glm::ivec2(TERRAIN_TILE_COLUMNS, TERRAIN_TILE_ROWS));
 
-                int edgeSteps = 100;
-                float stepFactor = 1.0f / edgeSteps;
+            for (int y = min.y; y < max.y; y++)
+                memset(&_heights[y * _resolution + min.x], 0x0, sizeof(float) * (max.x - min.x));
 
-                for (int y = 0; y < resy; y++)
-                {
-                    int posy = (y - halfResy) + biome->_center.y + halfRes;
-                    if (posy >= 0 && posy < _resolution)
-                    {
-                        for (int x = 0; x < resx; x++)
-                        {
-                            int posx = (x - halfResx) + biome->_center.x + halfRes;
-                            if (posx >= 0 && posx < _resolution)
-                            {
-                                float biomeHeight = biome->_heights[y * resx + x];
-
-                                glm::vec2 v = glm::vec2(x, y);
-
-                                int xEdge = (x >= 0 && x < edgeSteps) ? 1 : ((x >= resx - edgeSteps && x < resx) ? 2 : 0);                                
-                                int yEdge = (y >= 0 && y < edgeSteps) ? 1 : ((y >= resy - edgeSteps && y < resy) ? 2 : 0);
-
-                                if (xEdge || yEdge)
-                                {
-                                    if (xEdge == 2)
-                                        v.x = edgeSteps - (resx - v.x);
-                                    else if (xEdge == 0)
-                                        v.x = 0.0f;
-                                    if (yEdge == 2)
-                                        v.y = edgeSteps - (resy - v.y);
-                                    else if (yEdge == 0)
-                                        v.y = 0.0f;
-
-                                    //if (xEdge)
-                                    //    v.y = 0.0f;
-                                    //else
-                                    //    v.x = 0.0f;
-
-
-                                    //v /= edgeSteps;
-                                    //v = v * 2.0f - 1.0f;
-
-                                    //v /= edgeSteps;
-                                    float t = xEdge ? v.x : v.y;
-                                    t /= edgeSteps;
-                                    t = 1.0f - t;
-                                   // t = t * 2.0f - 1.0f;
-                                   // t = sqrtf(t * t);
-
-
-                                    SetHeight(posx, posy, glm::mix(biomeHeight, GetHeight(posx, posy), t));
-                                }
-                                else
-                                {
-                                    float t = glm::min(1.0f, glm::length(v));
-                                    SetHeight(posx, posy, biomeHeight);
-                                }
-
-
-                                //glm::vec2 vabs = glm::abs(v);
-                                //vabs -= edgeSteps;
-                                //if (vabs.x > 0.0f && vabs.y > 0.0f)
-                                //{
-
-                                //}
-
-
-                                //smoothLocations.push_back({ glm::ivec2(posx, posy), 0.0f });
-
-                                //int xEdge = x == 0 ? -1 : (x == resx - 1 ? 1 : 0);
-                                //int yEdge = y == 0 ? -1 : (y == resy - 1 ? 1 : 0);
-
-                                //if (xEdge || yEdge)
-                                //{
-                                //    for (int ey = 0; ey <= edgeSteps * glm::abs(yEdge); ey++)
-                                //    {
-                                //        for (int ex = 0; ex <= edgeSteps * glm::abs(xEdge); ex++)
-                                //        {
-                                //            int stepx = posx + xEdge * ex;
-                                //            int stepy = posy + yEdge * ey;
-                                //            //int s = glm::max(ey, ex);
-
-                                //            if (stepx >= 0 && stepx < _resolution && stepy >= 0 && stepy < _resolution)
-                                //            {
-                                //                biomeHeight = biome->_heights[(y - yEdge * ey) * resx + (x - xEdge * ex)];
-                                //                float t = glm::min(1.0f, glm::length(glm::vec2(ex * stepFactor, ey * stepFactor)));
-
-                                //                t = 1.0f - t;
-                                //                t = t * t;
-                                //                t = 1.0f - t;
-
-                                //                //t = expf(1.0f - (1.0f / t * t));
-                                //                //float a = 2.0f;
-                                //                ////t = t * 2.0f - 1.0f;
-                                //                ////t = glm::abs(t);
-                                //                //t = glm::sin(t * glm::half_pi<float>());
-                                //                //t = (powf(a, 1.0f-t) - 1) / (a - 1);
-                                //                //t = 1.0f - t;
-                                //                SetHeight(stepx, stepy, glm::mix(biomeHeight, GetHeight(stepx, stepy), t));
-                                //                smoothLocations.push_back({ glm::ivec2(stepx, stepy), 0.0f });
-                                //            }
-                                //        }
-                                //    }
-                                //}
-                            }
-                        }
-                    }
-                }
-            }
-        }
+            for (const Biome* pBiome : biomes)
+                CompositeBiome(pBiome, min, max);
+        });
 
-        for (uint i = 0; i < smoothLocations.size(); i++)
-            smoothLocations[i].second = GetSmoothHeight(smoothLocations[i].first.x, smoothLocations[i].first.y);
+        UpdateDirtyRegion();
+    }
 
-        for (uint i = 0; i < smoothLocations.size(); i++)
-            SetHeight(smoothLocations[i].first.x, smoothLocations[i].first.y, smoothLocations[i].second);
+    void Terrain::CompositeBiome(const Biome* pBiome, const glm::ivec2& min, const glm::ivec2& max)
+    {
+        int halfRes = _resolution / 2;
+        int resx = int(pBiome->_texture->GetWidth() * pBiome->_resolutionScale);
+        int resy = int(pBiome->_texture->GetHeight() * pBiome->_resolutionScale);
 
-        TerrainVertex* pVerts = _mesh->GetVertices<TerrainVertex>();
-        for (uint i = 0; i < _heights.size(); i++)
-        {
-            pVerts[i].Position.y = _heights[i];
-        }
+        int edgeSteps = 100;
 
-        RecalcNormals();
-        _mesh->UpdateVertices();
+        //only the rows and columns inside the region are composited
+        int offsetx = pBiome->_center.x + halfRes - resx / 2;
+        int offsety = pBiome->_center.y + halfRes - resy / 2;
+        int beginx = glm::max(0, min.x - offsetx);
+        int endx = glm::min(resx, max.x - offsetx);
+        int beginy = glm::max(0, min.y - offsety);
+        int endy = glm::min(resy, max.y - offsety);
 
-        for (uint s = 0; s < _sliceData.size(); s++)
+        for (int y = beginy; y < endy; y++)
         {
-            Slice& slice = _sliceData[s];
-            slice.aabb.Min.y = FLT_MAX;
-            slice.aabb.Max.y = -FLT_MAX;
-        }
+            int yEdge = (y < edgeSteps) ? 1 : ((y >= resy - edgeSteps) ? 2 : 0);
+            const float* pBiomeRow = &pBiome->_heights[y * resx];
+            float* pRow = &_heights[(y + offsety) * _resolution];
 
-        uint sliceResolution = _resolution / _slices;
-        for (uint z = 0; z < _resolution; z++)
-        {
-            uint sliceY = z / sliceResolution;
-            for (uint x = 0; x < _resolution; x++)
+            for (int x = beginx; x < endx; x++)
             {
-                uint sliceX = x / sliceResolution;
-                uint sIndex = sliceY * _slices + sliceX;
-                _sliceData[sIndex].aabb.ExpandY(GetHeight(x, z));
+                int xEdge = (x < edgeSteps) ? 1 : ((x >= resx - edgeSteps) ? 2 : 0);
+                if (xEdge || yEdge)
+                {
+                    //within edgeSteps of the border the biome is blended with what was composited before it
+                    glm::vec2 v = glm::vec2(x, y);
+                    if (xEdge == 2)
+                        v.x = edgeSteps - (resx - v.x);
+                    else if (xEdge == 0)
+                        v.x = 0.0f;
+                    if (yEdge == 2)
+                        v.y = edgeSteps - (resy - v.y);
+                    else if (yEdge == 0)
+                        v.y = 0.0f;
+
+                    float t = xEdge ? v.x : v.y;
+                    t /= edgeSteps;
+                    t = 1.0f - t;
+
+                    pRow[x + offsetx] = glm::mix(pBiomeRow[x], pRow[x + offsetx], t);
+                }
+                else
+                {
+                    pRow[x + offsetx] = pBiomeRow[x];
+                }
             }
         }
-
-        BuildSplatArray();
     }
 
     void Terrain::GetBiomes(Vector<Biome*>& biomes) const
@@ -489,189 +708,283 @@ namespace SunEngine
         settings.inputAssembly.topology = SE_PT_TRIANGLE_LIST;
     }
 
-    bool Terrain::RequestData(RenderNode* pNode, RenderComponentData* pData, Mesh*& pMesh, Material*& pMaterial, const glm::mat4*& worldMtx, const AABB*& aabb, uint& idxCount, uint& instanceCount, uint& firstIdx, uint& vtxOffset) const
+    bool Terrain::RequestData(RenderNode* pNode, RenderComponentData* /*pData*/, Mesh*& pMesh, Material*& pMaterial, const glm::mat4*& worldMtx, const AABB*& aabb, uint& idxCount, uint& instanceCount, uint& firstIdx, uint& vtxOffset) const
     {
-        TerrainComponentData* pRenderData = pData->As<TerrainComponentData>();
-
-        auto found = pRenderData->_sliceNodes.find(pNode);
-        assert(found != pRenderData->_sliceNodes.end());
-        if (found == pRenderData->_sliceNodes.end())
-            return false;
-
-        const Slice& slice = _sliceData[(*found).second];
-
         pMesh = _mesh.get();
         pMaterial = _material.get();
         worldMtx = &pNode->GetNode()->GetWorld();
-        aabb = &slice.aabb;
-        firstIdx = slice.firstIndex;
-        idxCount = slice.indexCount;
-        vtxOffset = slice.vertexOffset;
+        aabb = &_bounds;
+        firstIdx = 0;
+        idxCount = _patchIndexCount;
+        vtxOffset = 0;
         instanceCount = 1;
 
         return false;
     }
 
-    void Terrain::RecalcNormals()
+    void Terrain::SelectPatches(const RenderNode* pNode, const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<PatchInstance>& instances) const
     {
-#if 1
-        TerrainVertex* pVerts = _mesh->GetVertices<TerrainVertex>();
+        instances.clear();
+
+        //selection runs in height map samples, the planes and the observer are taken from world space into it
+        float halfRes = _resolution / 2.0f;
+        float sampleScale = _resolution / (float)(_resolution - 1);
+        glm::vec2 windowOffset = glm::vec2(_windowOrigin) * sampleScale - halfRes;
+        glm::mat4 sampleToLocal = glm::translate(Mat4::Identity, glm::vec3(windowOffset.x, 0.0f, windowOffset.y)) * glm::scale(Mat4::Identity, glm::vec3(sampleScale, 1.0f, sampleScale));
+        glm::mat4 sampleToWorld = pNode->GetWorld() * sampleToLocal;
+
+        glm::vec4 planes[6];
+        glm::mat4 planeMtx = glm::transpose(sampleToWorld);
+        for (uint i = 0; i < 6 && pFrustumPlanes; i++)
+            planes[i] = planeMtx * pFrustumPlanes[i];
+
+        glm::vec3 sampleObserver = glm::vec3(glm::inverse(sampleToWorld) * glm::vec4(observer, 1.0f));
+
+        float heightMin, heightRange;
+        GetHeightRange(heightMin, heightRange);
+
+        Vector<TerrainLOD::Patch> patches;
+        _lod.Select(sampleObserver, pFrustumPlanes ? planes : 0, patches);
 
-#if 1
-        ThreadPool& tp = ThreadPool::Get();
-        struct ThreadData
+        instances.resize(patches.size());
+        for (uint i = 0; i < patches.size(); i++)
         {
-            glm::uvec2 ranges[16];
-            uint resolution;
-            TerrainVertex* pVerts;
-        } threadData;
+            const TerrainLOD::Patch& patch = patches[i];
+            uint nodeSize = _lod.GetNodeSize(patch.Level);
 
-        threadData.resolution = _resolution;
-        threadData.pVerts = pVerts;
+            float morphStart, morphEnd;
+            _lod.GetMorphRange(patch.Level, morphStart, morphEnd);
 
-        uint vertsPerThread = _mesh->GetVertexCount() / tp.GetThreadCount();
-        uint vtxStart = 0;
-        for (uint i = 0; i < tp.GetThreadCount(); i++)
+            PatchInstance& instance = instances[i];
+            instance.PatchMatrix[0] = glm::vec4(patch.Origin, nodeSize / (float)_patchResolution, (float)(_resolution - 1));
+            instance.PatchMatrix[1] = glm::vec4(morphStart, morphEnd, sampleScale, -halfRes);
+            instance.PatchMatrix[2] = glm::vec4(sampleObserver, (float)_windowOrigin.x);
+            instance.PatchMatrix[3] = glm::vec4(heightMin, heightRange, _packedNormals ? 1.0f : 0.0f, (float)_windowOrigin.y);
+
+            bool quarter = patch.Size < nodeSize;
+            instance.IndexCount = quarter ? _quarterIndexCount : _patchIndexCount;
+            instance.FirstIndex = quarter ? _patchIndexCount : 0;
+        }
+    }
+
+    bool Terrain::Raycast(const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const
+    {
+        if (_resolution < 2)
+            return false;
+
+        //the inverse of the sample to local mapping in SelectPatches, it is affine so distances along the ray carry over
+        float halfRes = _resolution / 2.0f;
+        float sampleScale = _resolution / (float)(_resolution - 1);
+        Ray sampleRay = ray;
+        sampleRay.Origin.x = (ray.Origin.x + halfRes) / sampleScale - _windowOrigin.x;
+        sampleRay.Origin.z = (ray.Origin.z + halfRes) / sampleScale - _windowOrigin.y;
+        sampleRay.Direction.x = ray.Direction.x / sampleScale;
+        sampleRay.Direction.z = ray.Direction.z / sampleScale;
+
+        glm::vec3 sampleNormal;
+        if (!_lod.Raycast(_heights.data(), sampleRay, tMin, triIndex, weights, sampleNormal))
+            return false;
+
+        normal = glm::normalize(glm::vec3(sampleNormal.x / sampleScale, sampleNormal.y, sampleNormal.z / sampleScale));
+        return true;
+    }
+
+    void Terrain::SetPackedNormals(bool packed)
+    {
+        if (_packedNormals == packed)
+            return;
+
+        _packedNormals = packed;
+        if (_packedNormals)
         {
-            threadData.ranges[i].x = vtxStart;
-            threadData.ranges[i].y = glm::min(vtxStart + vertsPerThread, _mesh->GetVertexCount());
-            tp.AddTask([](uint threadIdx, void* pData) -> void {
-                ThreadData* pThreadData = static_cast<ThreadData*>(pData);
-                TerrainVertex* pVerts = pThreadData->pVerts;
-                uint resolution = pThreadData->resolution;
-                uint resolution2 = resolution * resolution;
-                for (uint v = pThreadData->ranges[threadIdx].x; v < pThreadData->ranges[threadIdx].y; v++)
-                {
-                    uint y = v / resolution;
-                    uint x = v % resolution;
-
-                    uint top = y == 0 ? y : y - 1;
-                    uint bottom = y == resolution - 1 ? y : y + 1;
-                    uint left = x == 0 ? x : x - 1;
-                    uint right = x == resolution - 1 ? x : x + 1;
-
-                    float fLeft = pVerts[y * resolution + left].Position.y;
-                    float fRight = pVerts[y * resolution + right].Position.y;
-                    float fTop = pVerts[top * resolution + x].Position.y;
-                    float fBottom = pVerts[bottom * resolution + x].Position.y;
-
-                    //assert(y * resolution + x < resolution2);
-                    //assert(y * resolution + left < resolution2);
-                    //assert(y * resolution + right < resolution2);
-                    //assert(top * resolution + x < resolution2);
-                    //assert(bottom * resolution + x < resolution2);
-
-                    glm::vec3 normal;
-                    normal.x = (fRight - fLeft);
-                    normal.z = (fBottom - fTop);
-                    normal.y = 2.0f;
-                    pVerts[v].Normal = glm::vec4(glm::normalize(normal), 0.0f);
-                }
-            }, &threadData);
-            vtxStart += vertsPerThread;
+            _normalMap = UniquePtr<Texture2D>(new Texture2D());
+            _normalMap->Alloc(_resolution, _resolution, ImageData::SAMPLED_TEXTURE_R8G8);
+            UpdateNormalTexture(glm::ivec2(0), glm::ivec2(_resolution));
+            _uploads.Submit();
         }
+        else
+        {
+            _material->SetTexture2D(Strings::PackedNormalMap, ResourceMgr::Get().GetTexture2D(DefaultResource::Texture::Black));
+            _normalMap.reset();
+        }
+    }
 
-        tp.Wait();
+    void Terrain::GetHeightRange(float& minHeight, float& range) const
+    {
+        minHeight = _quantizeMin;
+        range = _quantizeRange;
+    }
 
-#else
-        for (uint y = 0; y < _resolution; y++)
+    void Terrain::UpdateBounds()
+    {
+        //the window's samples in object space as mapped by SelectPatches, heights come from the quadtree
+        float halfRes = _resolution / 2.0f;
+        float sampleScale = _resolution / (float)(_resolution - 1);
+        glm::vec2 offset = glm::vec2(_windowOrigin) * sampleScale;
+        _bounds.Min = glm::vec3(offset.x - halfRes, _bounds.Min.y, offset.y - halfRes);
+        _bounds.Max = glm::vec3(offset.x + halfRes, _bounds.Max.y, offset.y + halfRes);
+    }
+
+    void Terrain::Sculpt(const glm::vec3& position, float radius, float strength)
+    {
+        if (_heights.empty() || radius <= 0.0f)
+            return;
+
+        //object space to samples as in Raycast
+        float halfRes = _resolution / 2.0f;
+        float sampleScale = _resolution / (float)(_resolution - 1);
+        glm::vec2 center = (glm::vec2(position.x, position.z) + halfRes) / sampleScale - glm::vec2(_windowOrigin);
+        float sampleRadius = radius / sampleScale;
+
+        glm::ivec2 min = glm::max(glm::ivec2(glm::floor(center - sampleRadius)), glm::ivec2(0));
+        glm::ivec2 max = glm::min(glm::ivec2(glm::ceil(center + sampleRadius)) + 1, glm::ivec2(_resolution));
+        if (min.x >= max.x || min.y >= max.y)
+            return;
+
+        float invRadiusSq = 1.0f / (sampleRadius * sampleRadius);
+        for (int y = min.y; y < max.y; y++)
         {
-            uint top = y == 0 ? y : y - 1;
-            uint bottom = y == _resolution - 1 ? y : y + 1;
-            for (uint x = 0; x < _resolution; x++)
+            for (int x = min.x; x < max.x; x++)
             {
-                uint left = x == 0 ? x : x - 1;
-                uint right = x == _resolution - 1 ? x : x + 1;
-
-                const glm::vec4& vLeft = pVerts[y * _resolution + left].Position;
-                const glm::vec4& vRight = pVerts[y * _resolution + right].Position;
-                const glm::vec4& vTop = pVerts[top * _resolution + x].Position;
-                const glm::vec4& vBottom = pVerts[bottom * _resolution + x].Position;
-
-                glm::vec4 normal;
-                normal.x = (vRight - vLeft).y;
-                normal.z = (vBottom - vTop).y;
-                normal.y = 2.0f;
-                normal.w = 0.0f;
-                pVerts[y * _resolution + x].Normal = glm::normalize(normal);
+                glm::vec2 delta = glm::vec2(x, y) - center;
+                float falloff = glm::max(1.0f - glm::dot(delta, delta) * invRadiusSq, 0.0f);
+                _heights[y * _resolution + x] += strength * falloff * falloff;
             }
         }
-#endif
-#else
-        Vector<glm::vec3> normals;
-        normals.resize(_resolution * _resolution);
-        memset(normals.data(), 0x0, sizeof(glm::vec3)* normals.size());
 
-        TerrainVertex* pVerts = _mesh->GetVertices<TerrainVertex>();
+        MarkDirty(min, max);
+    }
 
-        for (uint y = 0; y < _resolution - 1; y++)
-        {
-            for (uint x = 0; x < _resolution - 1; x++)
-            {
-                uint topLeft = y * _resolution + x;
-                uint topRight = topLeft + 1;
-                uint bottomLeft = topLeft + _resolution;
-                uint bottomRight = topRight + 1;
+    void Terrain::MarkDirty(const glm::ivec2& min, const glm::ivec2& max)
+    {
+        glm::ivec2 clippedMin = glm::max(min, glm::ivec2(0));
+        glm::ivec2 clippedMax = glm::min(max, glm::ivec2(_resolution));
+        if (clippedMin.x >= clippedMax.x || clippedMin.y >= clippedMax.y)
+            return;
 
-                {
-                    glm::vec3 p0 = pVerts[topLeft].Position;
-                    glm::vec3 p1 = pVerts[bottomLeft].Position;
-                    glm::vec3 p2 = pVerts[bottomRight].Position;
-                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
-                    normals[topLeft] += normal;
-                    normals[bottomLeft] += normal;
-                    normals[bottomRight] += normal;
-                }
+        _dirtyMin = glm::min(_dirtyMin, clippedMin);
+        _dirtyMax = glm::max(_dirtyMax, clippedMax);
+    }
 
-                {
-                    glm::vec3 p0 = pVerts[topLeft].Position;
-                    glm::vec3 p1 = pVerts[bottomRight].Position;
-                    glm::vec3 p2 = pVerts[topRight].Position;
-                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
-                    normals[topLeft] += normal;
-                    normals[bottomRight] += normal;
-                    normals[topRight] += normal;
-                }
-            }
-        }
+    void Terrain::ClearDirty()
+    {
+        _dirtyMin = glm::ivec2(_resolution);
+        _dirtyMax = glm::ivec2(0);
+    }
 
-        for (uint i = 0; i < normals.size(); i++)
-        {
-            pVerts->Normal = glm::vec4(glm::normalize(normals[i]), 0.0f);
-        }
-#endif
+    bool Terrain::UpdateHeightMap()
+    {
+        //the quadtree's height range is the quantization range of the height map, flat terrain still needs a range to divide by
+        _lod.Build(_heights.data(), _resolution, _patchResolution);
+        _bounds.Min.y = _lod.GetMinHeight();
+        _bounds.Max.y = _lod.GetMaxHeight();
+        _quantizeMin = _lod.GetMinHeight();
+        _quantizeRange = glm::max(_lod.GetMaxHeight() - _quantizeMin, FLT_EPSILON);
+        ClearDirty();
+
+        glm::ivec2 min = glm::ivec2(0);
+        glm::ivec2 max = glm::ivec2(_resolution);
+        return UpdateHeightTexture(min, max) && UpdateNormalTexture(min, max);
     }
 
-    const Terrain::Splat& Terrain::GetSplat(uint x, uint y) const
+    bool Terrain::UpdateDirtyRegion()
     {
-        return _splatLookup[y * _resolution + x];
+        if (!IsDirty())
+            return true;
+
+        glm::ivec2 min = _dirtyMin;
+        glm::ivec2 max = _dirtyMax;
+        ClearDirty();
+
+        _lod.Update(_heights.data(), min.x, min.y, max.x - 1, max.y - 1);
+        _bounds.Min.y = _lod.GetMinHeight();
+        _bounds.Max.y = _lod.GetMaxHeight();
+
+        //heights outside the quantization range requantize the whole map, with headroom so a brush stroke doesn't do it every frame
+        glm::ivec2 heightMin = min;
+        glm::ivec2 heightMax = max;
+        float quantizeMax = _quantizeMin + _quantizeRange;
+        if (_lod.GetMinHeight() < _quantizeMin || _lod.GetMaxHeight() > quantizeMax)
+        {
+            float headroom = (_lod.GetMaxHeight() - _lod.GetMinHeight()) * 0.125f;
+            _quantizeMin = glm::min(_quantizeMin, _lod.GetMinHeight() - headroom);
+            _quantizeRange = glm::max(quantizeMax, _lod.GetMaxHeight() + headroom) - _quantizeMin;
+            heightMin = glm::ivec2(0);
+            heightMax = glm::ivec2(_resolution);
+        }
+
+        //normals and the splats that depend on them also read the neighbouring heights
+        glm::ivec2 normalMin = glm::max(min - 1, glm::ivec2(0));
+        glm::ivec2 normalMax = glm::min(max + 1, glm::ivec2(_resolution));
+
+        bool updated = UpdateHeightTexture(heightMin, heightMax) && UpdateNormalTexture(normalMin, normalMax) && UpdateSplats(normalMin, normalMax);
+
+        //every texture region of the edit goes through one staging buffer and one submit
+        return _uploads.Submit() && updated;
     }
 
-    float Terrain::GetSplat(uint x, uint y, uint index) const
+    bool Terrain::UpdateHeightTexture(const glm::ivec2& min, const glm::ivec2& max)
     {
-        return GetSplat(x, y).weights[index];
+        const float* pHeights = _heights.data();
+        ushort* pQuantized = static_cast<ushort*>(_heightMap->GetData());
+        uint resolution = _resolution;
+        float heightMin = _quantizeMin;
+        float scale = 65535.0f / _quantizeRange;
+        ThreadPool::Get().ParallelFor(min.y, max.y, 16, [pHeights, pQuantized, resolution, heightMin, scale, min, max](uint, uint y) -> void {
+            for (uint x = min.x; x < (uint)max.x; x++)
+            {
+                uint i = y * resolution + x;
+                pQuantized[i] = (ushort)glm::clamp((pHeights[i] - heightMin) * scale + 0.5f, 0.0f, 65535.0f);
+            }
+        });
+
+        return UploadRegion(_heightMap.get(), Strings::HeightMap, min, max);
     }
 
-    void Terrain::SetSplat(uint x, uint y, uint index, float value)
+    bool Terrain::UpdateNormalTexture(const glm::ivec2& min, const glm::ivec2& max)
     {
-        auto& splat = _splatLookup[y * _resolution + x];
-        splat.weights[index] = glm::max(value, 0.0f);
+        if (!_packedNormals)
+            return true;
+
+        uchar* pEncoded = static_cast<uchar*>(_normalMap->GetData());
+        ThreadPool::Get().ParallelFor(min.y, max.y, 16, [this, pEncoded, min, max](uint, uint y) -> void {
+            for (uint x = min.x; x < (uint)max.x; x++)
+                EncodeOctahedral(GetNormal(x, y), pEncoded + (y * _resolution + x) * 2);
+        });
+
+        return UploadRegion(_normalMap.get(), Strings::PackedNormalMap, min, max);
     }
 
-    void Terrain::IncrementSplat(uint x, uint y, uint index, float value)
+    bool Terrain::UploadRegion(Texture2D* pTexture, const String& name, const glm::ivec2& min, const glm::ivec2& max)
     {
-        auto& splat = _splatLookup[y * _resolution + x];
-        splat.weights[index] += value;
+        //updating in place keeps the texture bound to every material, textures not on the GPU at their size are created instead.
+        //Regions already queued are submitted first since they could be of the texture being recreated
+        if (pTexture->UpdateRegion(min.x, min.y, max.x - min.x, max.y - min.y, _uploads))
+            return true;
+
+        _uploads.Submit();
+        if (!pTexture->RegisterToGPU())
+            return false;
+
+        return _material->SetTexture2D(name, pTexture);
     }
 
-    void Terrain::DecrementSplat(uint x, uint y, uint index, float value)
+    glm::vec3 Terrain::GetNormal(uint x, uint y) const
     {
-        auto& splat = _splatLookup[y * _resolution + x];
-        splat.weights[index] -= value;
-        splat.weights[index] = glm::max(splat.weights[index], 0.0f);
+        //same central differences Terrain.vs uses on the height map
+        uint top = y == 0 ? y : y - 1;
+        uint bottom = y == _resolution - 1 ? y : y + 1;
+        uint left = x == 0 ? x : x - 1;
+        uint right = x == _resolution - 1 ? x : x + 1;
+
+        glm::vec3 normal;
+        normal.x = GetHeight(right, y) - GetHeight(left, y);
+        normal.z = GetHeight(x, bottom) - GetHeight(x, top);
+        normal.y = 2.0f;
+        return glm::normalize(normal);
     }
 
-    bool Terrain::BuildSplatArray()
+    bool Terrain::UpdateSplats(const glm::ivec2& min, const glm::ivec2& max)
     {
         FastNoise noise;
         noise.SetFrequency(noise.GetFrequency() * 4.0f);
@@ -679,37 +992,31 @@ namespace SunEngine
         const float baseGrassValue = 100.0f;
         const float baseRockValue = 400.0f;
 
-        float centerY = _mesh->GetAABB().GetCenter().y;
-        float minY = _mesh->GetAABB().Min.y;
-        float maxY = _mesh->GetAABB().Max.y;
+        uint texCount = EngineInfo::GetRenderer().TerrainTextures();
+        uint splatCount = texCount / 4;
+
+        //samples only write their own splat and pixels, so rows are independent
+        ThreadPool::Get().ParallelFor(min.y, max.y, 16, [&](uint, uint z) -> void {
+            glm::vec4 splatColors[EngineInfo::Renderer::Limits::MaxTerrainTextures / 4];
+            memset(splatColors, 0x0, sizeof(splatColors));
 
-        for (uint z = 0; z < _resolution; z++)
-        {
-            for (uint x = 0; x < _resolution; x++)
+            for (uint x = min.x; x < (uint)max.x; x++)
             {
-                float t = noise.GetPerlinFractal(x, z);
+                //noise is sampled in world samples so a streamed window's splats don't change as it moves
+                float t = noise.GetPerlinFractal(float(int(x) + _windowOrigin.x), float(int(z) + _windowOrigin.y));
                 t = t * 0.5f + 0.5f;
                 assert(t <= 1.0f);
-                SetSplat(x, z, 0, baseGrassValue * t);
-                SetSplat(x, z, 1, baseGrassValue * (1.0f - t));
 
-                uint vIndex = z * _resolution + x;
-                float n = 1.0f - glm::max(_mesh->GetVertexVar(vIndex, TerrainVertex::Definition.NormalIndex).y, 0.0f);
-               // n = n * n;
-                SetSplat(x, z, 2, baseRockValue * n);
-            }
-        }
+                //weights are derived from the heights on the fly, nothing per sample is kept besides the splat map
+                Splat splat;
+                splat.weights[0] = baseGrassValue * t;
+                splat.weights[1] = baseGrassValue * (1.0f - t);
 
-        uint texCount = EngineInfo::GetRenderer().TerrainTextures();
-        uint splatCount = texCount / 4;
-        glm::vec4 splatColors[EngineInfo::Renderer::Limits::MaxTerrainTextures / 4];
-        memset(splatColors, 0x0, sizeof(splatColors));
+                float n = 1.0f - glm::max(GetNormal(x, z).y, 0.0f);
+               // n = n * n;
+                splat.weights[2] = baseRockValue * n;
 
-        for (uint z = 0; z < _resolution; z++)
-        {
-            for (uint x = 0; x < _resolution; x++)
-            {
-                Splat splat = GetSplat(x, z).GetNormalized(texCount);
+                splat = splat.GetNormalized(texCount);
 
                 for (uint i = 0; i < texCount; i++)
                 {
@@ -724,37 +1031,20 @@ namespace SunEngine
                     splatColors[i] = Vec4::Zero;
                 }
             }
-        }
+        });
 
-        _splatMapArray->RegisterToGPU();
-        _material->SetTexture2DArray(Strings::SplatMap, _splatMapArray.get());
-        return true;
-    }
+        bool updated = true;
+        for (uint i = 0; i < splatCount && updated; i++)
+            updated = _splatMapArray->UpdateRegion(i, min.x, min.y, max.x - min.x, max.y - min.y, _uploads);
 
-    float Terrain::GetSmoothHeight(uint x, uint y) const
-    {
-        float height = 0.0f;
-        int samples = 0;
+        if (updated)
+            return true;
 
-        for (int i = -1; i <= 1; i++)
-        {
-            int yi = y + i;
-            if (yi >= 0 && yi < _resolution)
-            {
-                for (int j = -1; j <= 1; j++)
-                {
-                    int xj = x + j;
-                    if (xj >= 0 && xj < _resolution)
-                    {
-                        uint index = yi * _resolution + xj;
-                        height += _heights[index];
-                        ++samples;
-                    }
-                }
-            }
-        }
+        _uploads.Submit();
+        if (!_splatMapArray->RegisterToGPU())
+            return false;
 
-        return height / samples;
+        return _material->SetTexture2DArray(Strings::SplatMap, _splatMapArray.get());
     }
 
     void Terrain::SetHeight(uint x, uint y, float value)
@@ -777,6 +1067,9 @@ namespace SunEngine
         _smoothKernelSize = 1;
         _center = glm::ivec2(0);
         _invert = false;
+        _changed = true;
+        _footprintMin = glm::ivec2(0);
+        _footprintMax = glm::ivec2(0);
     }
 
     void Terrain::Biome::SetTexture(Texture2D* pTexture)
@@ -884,35 +1177,6 @@ namespace SunEngine
         }
     }
 
-    float Terrain::Biome::GetSmoothHeight(int x, int y) const
-    {
-        if (_smoothKernelSize <= 0)
-            return _normalizedTextureHeights[y * _texture->GetWidth() + x];
-
-        float height = 0.0f;
-        int samples = 0;
-
-        for (int i = -_smoothKernelSize; i <= _smoothKernelSize; i++)
-        {
-            int yi = y + i;
-            if (yi >= 0 && yi < _texture->GetHeight())
-            {
-                for (int j = -_smoothKernelSize; j <= _smoothKernelSize; j++)
-                {
-                    int xj = x + j;
-                    if (xj >= 0 && xj < _texture->GetWidth())
-                    {
-                        uint index = yi * _texture->GetWidth() + xj;
-                        height += _normalizedTextureHeights[index];
-                        ++samples;
-                    }
-                }
-            }
-        }
-
-        return height / samples;
-    }
-
     Terrain::Splat::Splat()
     {
         for (uint i = 0; i < EngineInfo::Renderer::Limits::MaxTerrainTextures; i++)
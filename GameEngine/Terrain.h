@@ -1,23 +1,21 @@
 #pragma once
 
 #include "RenderObject.h"
+#include "BaseTexture.h"
 #include "FilePathMgr.h"
+#include "TerrainLOD.h"
+#include "TerrainTileCache.h"
 
 namespace SunEngine
 {
 	class Texture2D;
 	class Texture2DArray;
 
-	class TerrainComponentData : public RenderComponentData
-	{
-	public:
-		TerrainComponentData(Component* pComponent, SceneNode* pNode) : RenderComponentData(pComponent, pNode) { }
-
-	private:
-		friend class Terrain;
-		Map<RenderNode*, uint> _sliceNodes;
-	};
-
+	//Drawn as CDLOD patches selected per view from a quadtree over the height map, every patch shares one grid mesh that
+	//Terrain.vs places and displaces by sampling the height map. The GPU holds 16 bit heights quantized to the terrain's
+	//height range and optionally an octahedral normal in two bytes, so a sample costs 2 or 4 bytes.
+	//A terrain streamed from tiles keeps the same resolution as a window into a larger world, so its memory doesn't grow
+	//with the world.
 	class Terrain : public RenderObject
 	{
 	public:
@@ -28,6 +26,16 @@ namespace SunEngine
 			static const String SplatSampler;
 			static const String PosToUV;
 			static const String TextureTiling;
+			static const String HeightMap;
+			static const String PackedNormalMap;
+		};
+
+		//One patch drawn for a view, PatchMatrix goes in the object buffer's normal matrix where Terrain.vs reads it
+		struct PatchInstance
+		{
+			glm::mat4 PatchMatrix;
+			uint IndexCount;
+			uint FirstIndex;
 		};
 
 		class Biome
@@ -59,8 +67,6 @@ namespace SunEngine
 			const glm::ivec2& GetCenter() const { return _center; }
 
 		private:
-			float GetSmoothHeight(int x, int y) const;
-
 			friend class Terrain;
 
 			String _name;
@@ -72,6 +78,8 @@ namespace SunEngine
 			bool _invert;
 			glm::ivec2 _center;
 			bool _changed;
+			glm::ivec2 _footprintMin; //samples the biome was last composited into
+			glm::ivec2 _footprintMax;
 			Vector<float> _normalizedTextureHeights;
 			Vector<float> _heights;
 		};
@@ -82,19 +90,64 @@ namespace SunEngine
 		void SetResolution(uint resolution) { _resolution = resolution; }
 		uint GetResolution() const { return _resolution; }
 
-		void SetSlices(uint slices) { _slices = slices; }
-		uint GetSlices() const { return _slices; }
+		//Grid quads along a patch side, a power of two
+		void SetPatchResolution(uint resolution) { _patchResolution = resolution; }
+		uint GetPatchResolution() const { return _patchResolution; }
+
+		//Distance in height map samples within which the finest level is drawn, each coarser level doubles it
+		void SetLODDistance(float distance) { _lod.SetLODDistance(distance); }
+		float GetLODDistance() const { return _lod.GetLODDistance(); }
+
+		//Stores normals in a two byte octahedral texture instead of deriving them from four height loads per vertex
+		void SetPackedNormals(bool packed);
+		bool GetPackedNormals() const { return _packedNormals; }
 
 		void BuildMesh();
 
+		//Fills instances with the patches of pNode's terrain seen by a view. LOD distances are measured from the world
+		//position observer, which should be the main camera for every view so shadow casters match what is drawn.
+		//pFrustumPlanes are the world space planes of the view or null, the call only reads the terrain and is thread safe.
+		void SelectPatches(const RenderNode* pNode, const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<PatchInstance>& instances) const;
+
+		//Intersects an object space ray with the full resolution height field, the drawn patch mesh is only a grid template.
+		//triIndex and weights refer to the triangles of the height map grid, normal is in object space.
+		bool Raycast(const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const;
+
+		//Raises the terrain around the object space position by up to strength with a smooth falloff over radius, negative
+		//strength lowers it. Only the edited samples are recomputed and uploaded, when the scene flushes after its next Update.
+		void Sculpt(const glm::vec3& position, float radius, float strength);
+
+		//Streams the heights from a TerrainTileFile instead of compositing biomes. The resolution becomes a window over the
+		//world that moves a tile at a time to follow the streaming observer, it has to be a multiple of the tile size.
+		//Tiles load on the thread pool and are copied into the window when the scene flushes, on the thread updating it. They
+		//stay cached under the memory budget, sculpted heights are lost when their tile leaves the window.
+		bool OpenTiles(const String& filename);
+		void CloseTiles();
+		bool IsTiled() const { return _tiles->IsOpen(); }
+
+		void SetTileMemoryBudget(uint64 bytes) { _tiles->SetMemoryBudget(bytes); }
+		uint64 GetTileMemoryBudget() const { return _tiles->GetMemoryBudget(); }
+		TerrainTileCache::Status GetTileStatus() const { return _tiles->GetStatus(); }
+
+		//World space position the streamed window is centered on, usually the main camera
+		void SetStreamingObserver(const glm::vec3& position) { _streamingObserver = position; }
+
+		//Writes the current heights as a tile file that OpenTiles can stream, the resolution has to be a multiple of tileSize
+		bool SaveTiles(const String& filename, uint tileSize) const;
+
 		void Initialize(SceneNode* pNode, ComponentData* pData) override;
 		void Update(SceneNode* pNode, ComponentData* pData, float dt, float et) override;
+		void Flush(SceneNode* pNode, ComponentData* pData) override;
+		//edits and streaming change the terrain without its node moving
+		bool RequiresUpdate() const override { return true; }
 
 		Material* GetMaterial() const { return _material.get(); }
 		Mesh* GetMesh() const { return _mesh.get(); }
 
 		Biome* AddBiome(const String& name);
 		Biome* GetBiome(const String& name) const;
+		//Composites the biomes changed since the last call into the samples they covered before and after the change, which
+		//replaces sculpted heights there
 		void UpdateBiomes();
 		void GetBiomes(Vector<Biome*>& biomes) const;
 
@@ -105,16 +158,6 @@ namespace SunEngine
 		bool BuildNormalMapArray(bool generateMips);
 
 	private:
-		struct Slice
-		{
-			uint x;
-			uint y;
-			uint firstIndex;
-			uint indexCount;
-			uint vertexOffset;
-			AABB aabb;
-		};
-
 		struct Splat
 		{
 			Splat();
@@ -124,26 +167,45 @@ namespace SunEngine
 			float weights[EngineInfo::Renderer::Limits::MaxTerrainTextures];
 		};
 
-		RenderComponentData* AllocRenderData(SceneNode* pNode) { return new TerrainComponentData(this, pNode); }
+		RenderComponentData* AllocRenderData(SceneNode* pNode) { return new RenderComponentData(this, pNode); }
 		bool RequestData(RenderNode* pNode, RenderComponentData* pData, Mesh*& pMesh, Material*& pMaterial, const glm::mat4*& worldMtx, const AABB*& aabb, uint& idxCount, uint& instanceCount, uint& firstIdx, uint& vtxOffset) const override;
-		void BuildSliceIndices(Map<glm::uvec2, Vector<uint>>& sliceTypeIndices, uint& indexCount) const;
+		void BuildPatchMesh();
 		void BuildPipelineSettings(PipelineSettings& settings) const override;
-		void RecalcNormals();
-
-		const Splat& GetSplat(uint x, uint y) const;
-		float GetSplat(uint x, uint y, uint index) const;
-		void SetSplat(uint x, uint y, uint index, float value);
-		void IncrementSplat(uint x, uint y, uint index, float value);
-		void DecrementSplat(uint x, uint y, uint index, float value);
-		bool BuildSplatArray();
-		float GetSmoothHeight(uint x, uint y) const;
+		bool UpdateHeightMap();
+		bool UpdateDirtyRegion();
+		bool UpdateHeightTexture(const glm::ivec2& min, const glm::ivec2& max);
+		bool UpdateNormalTexture(const glm::ivec2& min, const glm::ivec2& max);
+		bool UploadRegion(Texture2D* pTexture, const String& name, const glm::ivec2& min, const glm::ivec2& max);
+		void GetHeightRange(float& minHeight, float& range) const;
+		void UpdateBounds();
+		void UpdateStreaming(SceneNode* pNode);
+		void MoveWindow(const glm::ivec2& origin);
+		void MarkDirty(const glm::ivec2& min, const glm::ivec2& max);
+		void ClearDirty();
+		bool IsDirty() const { return _dirtyMin.x < _dirtyMax.x && _dirtyMin.y < _dirtyMax.y; }
+		glm::vec3 GetNormal(uint x, uint y) const;
+
+		bool UpdateSplats(const glm::ivec2& min, const glm::ivec2& max);
+		void CompositeBiome(const Biome* pBiome, const glm::ivec2& min, const glm::ivec2& max);
 		void SetHeight(uint x, uint y, float value);
 		float GetHeight(uint x, uint y) const;
 
 
 		uint _resolution;
-		uint _slices;
-		Vector<Slice> _sliceData;
+		uint _patchResolution;
+		uint _patchIndexCount;
+		uint _quarterIndexCount;
+		bool _packedNormals;
+		TerrainLOD _lod;
+		AABB _bounds;
+		float _quantizeMin;
+		float _quantizeRange;
+		glm::ivec2 _dirtyMin; //samples changed since the last upload, max is exclusive
+		glm::ivec2 _dirtyMax;
+		UniquePtr<TerrainTileCache> _tiles;
+		glm::ivec2 _windowOrigin; //world sample at the window's first sample, zero unless streamed
+		glm::vec3 _streamingObserver;
+		Vector<bool> _windowTilesLoaded;
 
 		UniquePtr<Mesh> _mesh;
 		UniquePtr<Material> _material;
@@ -151,9 +213,11 @@ namespace SunEngine
 		UniquePtr<Texture2DArray> _diffuseMapArray;
 		UniquePtr<Texture2DArray> _normalMapArray;
 		UniquePtr<Texture2DArray> _splatMapArray;
+		UniquePtr<Texture2D> _heightMap;
+		UniquePtr<Texture2D> _normalMap;
 		Vector<float> _heights;
+		TextureUploadBatch _uploads; //regions of the height, normal and splat maps waiting for the next submit
 
-		Vector<Splat> _splatLookup;
 		float _textureTiling[EngineInfo::Renderer::Limits::MaxTerrainTextures];
 	};
 }
\ No newline at end of file
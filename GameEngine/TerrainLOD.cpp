@@ -0,0 +1,336 @@
+#include "ThreadPool.h"
+#include "TerrainLOD.h"
+
+namespace SunEngine
+{
+	static bool InRange(const AABB& box, const glm::vec3& observer, float range)
+	{
+		glm::vec3 delta = observer - glm::clamp(observer, box.Min, box.Max);
+		return glm::dot(delta, delta) <= range * range;
+	}
+
+	static bool RayBoxEntry(const Ray& ray, const AABB& box, float tMax, float& tEnter)
+	{
+		//slab test clipped to [0, tMax], axes the ray runs parallel to only need the origin inside the slab
+		float t0 = 0.0f;
+		float t1 = tMax;
+		for (uint i = 0; i < 3; i++)
+		{
+			if (ray.Direction[i] == 0.0f)
+			{
+				if (ray.Origin[i] < box.Min[i] || ray.Origin[i] > box.Max[i])
+					return false;
+				continue;
+			}
+
+			float inv = 1.0f / ray.Direction[i];
+			float tNear = (box.Min[i] - ray.Origin[i]) * inv;
+			float tFar = (box.Max[i] - ray.Origin[i]) * inv;
+			if (tNear > tFar) std::swap(tNear, tFar);
+
+			t0 = glm::max(t0, tNear);
+			t1 = glm::min(t1, tFar);
+			if (t0 > t1)
+				return false;
+		}
+
+		tEnter = t0;
+		return true;
+	}
+
+	TerrainLOD::TerrainLOD()
+	{
+		_resolution = 0;
+		_patchResolution = 0;
+		_lodDistance = 128.0f;
+		_morphStart = 0.7f;
+		_minHeight = 0.0f;
+		_maxHeight = 0.0f;
+	}
+
+	void TerrainLOD::Build(const float* pHeights, uint resolution, uint patchResolution, uint levelCount)
+	{
+		_resolution = resolution;
+		_patchResolution = patchResolution;
+		_minHeight = 0.0f;
+		_maxHeight = 0.0f;
+		_levels.clear();
+
+		if (resolution < 2 || patchResolution == 0)
+			return;
+
+		uint extent = resolution - 1;
+		if (levelCount == 0)
+		{
+			levelCount = 1;
+			while ((patchResolution << (levelCount - 1)) < extent)
+				levelCount++;
+		}
+
+		//smaller level counts than needed for one root tile the grid with several
+		uint rootSize = patchResolution << (levelCount - 1);
+		uint rootsPerSide = (extent + rootSize - 1) / rootSize;
+
+		_levels.resize(levelCount);
+		for (uint l = 0; l < levelCount; l++)
+		{
+			_levels[l].NodesPerSide = rootsPerSide << (levelCount - 1 - l);
+			_levels[l].MinMax.resize(_levels[l].NodesPerSide * _levels[l].NodesPerSide);
+		}
+
+		uint last = _levels[0].NodesPerSide - 1;
+		UpdateNodes(pHeights, 0, 0, last, last);
+	}
+
+	void TerrainLOD::Update(const float* pHeights, uint x0, uint z0, uint x1, uint z1)
+	{
+		if (_levels.empty())
+			return;
+
+		//leaves include the samples on their far edges, so a sample on a leaf border also changes the leaf before it
+		uint last = _levels[0].NodesPerSide - 1;
+		uint leafX0 = x0 ? (x0 - 1) / _patchResolution : 0;
+		uint leafZ0 = z0 ? (z0 - 1) / _patchResolution : 0;
+		UpdateNodes(pHeights, leafX0, leafZ0, glm::min(x1 / _patchResolution, last), glm::min(z1 / _patchResolution, last));
+	}
+
+	void TerrainLOD::UpdateNodes(const float* pHeights, uint x0, uint z0, uint x1, uint z1)
+	{
+		//leaves include the samples on their far edges, those are shared with the neighbouring leaves
+		uint extent = _resolution - 1;
+		uint patchResolution = _patchResolution;
+		Level& leaves = _levels[0];
+		ThreadPool::Get().ParallelFor(z0, z1 + 1, 1, [&](uint, uint z) -> void {
+			uint sz0 = z * patchResolution;
+			uint sz1 = glm::min(sz0 + patchResolution, extent);
+			for (uint x = x0; x <= x1; x++)
+			{
+				uint sx0 = x * patchResolution;
+				uint sx1 = glm::min(sx0 + patchResolution, extent);
+
+				//nodes past the edge of the grid keep an empty range and are never selected
+				glm::vec2 minMax = glm::vec2(FLT_MAX, -FLT_MAX);
+				if (sx0 < extent && sz0 < extent)
+				{
+					for (uint sz = sz0; sz <= sz1; sz++)
+					{
+						const float* pRow = pHeights + sz * _resolution;
+						for (uint sx = sx0; sx <= sx1; sx++)
+						{
+							minMax.x = glm::min(minMax.x, pRow[sx]);
+							minMax.y = glm::max(minMax.y, pRow[sx]);
+						}
+					}
+				}
+				leaves.MinMax[z * leaves.NodesPerSide + x] = minMax;
+			}
+		});
+
+		for (uint l = 1; l < _levels.size(); l++)
+		{
+			const Level& children = _levels[l - 1];
+			Level& parents = _levels[l];
+			x0 /= 2;
+			z0 /= 2;
+			x1 /= 2;
+			z1 /= 2;
+			for (uint z = z0; z <= z1; z++)
+			{
+				for (uint x = x0; x <= x1; x++)
+				{
+					const glm::vec2* pChildren = &children.MinMax[(z * 2) * children.NodesPerSide + x * 2];
+					glm::vec2 minMax;
+					minMax.x = glm::min(glm::min(pChildren[0].x, pChildren[1].x), glm::min(pChildren[children.NodesPerSide].x, pChildren[children.NodesPerSide + 1].x));
+					minMax.y = glm::max(glm::max(pChildren[0].y, pChildren[1].y), glm::max(pChildren[children.NodesPerSide].y, pChildren[children.NodesPerSide + 1].y));
+					parents.MinMax[z * parents.NodesPerSide + x] = minMax;
+				}
+			}
+		}
+
+		_minHeight = FLT_MAX;
+		_maxHeight = -FLT_MAX;
+		for (const glm::vec2& minMax : _levels.back().MinMax)
+		{
+			if (minMax.x <= minMax.y)
+			{
+				_minHeight = glm::min(_minHeight, minMax.x);
+				_maxHeight = glm::max(_maxHeight, minMax.y);
+			}
+		}
+	}
+
+	void TerrainLOD::Select(const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<Patch>& patches) const
+	{
+		if (_levels.empty())
+			return;
+
+		uint top = _levels.size() - 1;
+		uint size = GetNodeSize(top);
+		for (uint z = 0; z < _levels[top].NodesPerSide; z++)
+		{
+			for (uint x = 0; x < _levels[top].NodesPerSide; x++)
+			{
+				if (!SelectNode(top, x, z, observer, pFrustumPlanes, patches))
+				{
+					Patch patch = { glm::vec2(x * size, z * size), (float)size, top };
+					patches.push_back(patch);
+				}
+			}
+		}
+	}
+
+	bool TerrainLOD::SelectNode(uint level, uint x, uint z, const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<Patch>& patches) const
+	{
+		//returns false if the node is out of its range and has to be drawn by the parent, culled nodes count as drawn
+		const glm::vec2& minMax = _levels[level].MinMax[z * _levels[level].NodesPerSide + x];
+		if (minMax.x > minMax.y)
+			return true;
+
+		float size = (float)GetNodeSize(level);
+		AABB box;
+		GetNodeBox(level, x, z, box);
+		if (pFrustumPlanes && !FrustumAABBIntersect(pFrustumPlanes, box))
+			return true;
+
+		if (!InRange(box, observer, GetRange(level)))
+			return false;
+
+		Patch patch = { glm::vec2(x * size, z * size), size, level };
+		if (level == 0 || !InRange(box, observer, GetRange(level - 1)))
+		{
+			patches.push_back(patch);
+			return true;
+		}
+
+		//children that are out of their own range are drawn as quarters of this node at this level
+		patch.Size = size * 0.5f;
+		for (uint i = 0; i < 4; i++)
+		{
+			uint cx = x * 2 + (i & 1);
+			uint cz = z * 2 + (i >> 1);
+			if (!SelectNode(level - 1, cx, cz, observer, pFrustumPlanes, patches))
+			{
+				patch.Origin = glm::vec2(cx * patch.Size, cz * patch.Size);
+				patches.push_back(patch);
+			}
+		}
+
+		return true;
+	}
+
+	bool TerrainLOD::GetNodeBox(uint level, uint x, uint z, AABB& box) const
+	{
+		//returns false for nodes past the edge of the grid
+		const glm::vec2& minMax = _levels[level].MinMax[z * _levels[level].NodesPerSide + x];
+		float size = (float)GetNodeSize(level);
+		float limit = float(_resolution - 1);
+		box = AABB(glm::vec3(x * size, minMax.x, z * size), glm::vec3(glm::min((x + 1) * size, limit), minMax.y, glm::min((z + 1) * size, limit)));
+		return minMax.x <= minMax.y;
+	}
+
+	bool TerrainLOD::Raycast(const float* pHeights, const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const
+	{
+		if (_levels.empty())
+			return false;
+
+		bool hit = false;
+		uint top = _levels.size() - 1;
+		for (uint z = 0; z < _levels[top].NodesPerSide; z++)
+		{
+			for (uint x = 0; x < _levels[top].NodesPerSide; x++)
+				hit |= RaycastNode(top, x, z, pHeights, ray, tMin, triIndex, weights, normal);
+		}
+		return hit;
+	}
+
+	bool TerrainLOD::RaycastNode(uint level, uint x, uint z, const float* pHeights, const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const
+	{
+		AABB box;
+		float tEnter;
+		if (!GetNodeBox(level, x, z, box) || !RayBoxEntry(ray, box, tMin, tEnter))
+			return false;
+
+		if (level != 0)
+		{
+			//children are visited nearest first so the farther ones are usually skipped by the closer hit
+			float childEnter[4];
+			uint order[4];
+			uint childCount = 0;
+			for (uint i = 0; i < 4; i++)
+			{
+				uint cx = x * 2 + (i & 1);
+				uint cz = z * 2 + (i >> 1);
+				AABB childBox;
+				float t;
+				if (GetNodeBox(level - 1, cx, cz, childBox) && RayBoxEntry(ray, childBox, tMin, t))
+				{
+					uint j = childCount++;
+					for (; j > 0 && childEnter[j - 1] > t; j--)
+					{
+						childEnter[j] = childEnter[j - 1];
+						order[j] = order[j - 1];
+					}
+					childEnter[j] = t;
+					order[j] = i;
+				}
+			}
+
+			bool hit = false;
+			for (uint i = 0; i < childCount; i++)
+			{
+				if (childEnter[i] > tMin)
+					break;
+				hit |= RaycastNode(level - 1, x * 2 + (order[i] & 1), z * 2 + (order[i] >> 1), pHeights, ray, tMin, triIndex, weights, normal);
+			}
+			return hit;
+		}
+
+		//same triangulation as the patch grid, every quad is split from its top left to its bottom right corner
+		bool hit = false;
+		uint extent = _resolution - 1;
+		uint x0 = (uint)box.Min.x;
+		uint z0 = (uint)box.Min.z;
+		uint x1 = (uint)box.Max.x;
+		uint z1 = (uint)box.Max.z;
+		for (uint sz = z0; sz < z1; sz++)
+		{
+			for (uint sx = x0; sx < x1; sx++)
+			{
+				glm::vec3 topLeft = glm::vec3(sx, pHeights[sz * _resolution + sx], sz);
+				glm::vec3 topRight = glm::vec3(sx + 1, pHeights[sz * _resolution + sx + 1], sz);
+				glm::vec3 bottomLeft = glm::vec3(sx, pHeights[(sz + 1) * _resolution + sx], sz + 1);
+				glm::vec3 bottomRight = glm::vec3(sx + 1, pHeights[(sz + 1) * _resolution + sx + 1], sz + 1);
+
+				if (RayTriangleIntersect(ray, topLeft, bottomLeft, bottomRight, tMin, weights))
+				{
+					triIndex = (sz * extent + sx) * 2;
+					normal = glm::cross(bottomLeft - topLeft, bottomRight - topLeft);
+					hit = true;
+				}
+
+				if (RayTriangleIntersect(ray, topLeft, bottomRight, topRight, tMin, weights))
+				{
+					triIndex = (sz * extent + sx) * 2 + 1;
+					normal = glm::cross(bottomRight - topLeft, topRight - topLeft);
+					hit = true;
+				}
+			}
+		}
+		return hit;
+	}
+
+	void TerrainLOD::GetMorphRange(uint level, float& start, float& end) const
+	{
+		//the coarsest level has nothing to morph into
+		if (level + 1 >= _levels.size())
+		{
+			start = FLT_MAX * 0.5f;
+			end = FLT_MAX;
+			return;
+		}
+
+		float previous = level ? GetRange(level - 1) : 0.0f;
+		end = GetRange(level);
+		start = previous + (end - previous) * _morphStart;
+	}
+}
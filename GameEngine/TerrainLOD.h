@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MathHelper.h"
+
+namespace SunEngine
+{
+	//Quadtree of min/max heights over a square height grid for continuous distance based LOD (CDLOD). Each level covers
+	//twice the distance of the finer one and every node is drawn with the same patch grid, so the triangle count depends
+	//on the LOD distance and not on the grid resolution. Selection only reads the tree and can run on any thread.
+	//Positions are in samples on x/z and heights on y, the node at level 0 spans PatchResolution samples.
+	class TerrainLOD
+	{
+	public:
+		struct Patch
+		{
+			glm::vec2 Origin; //sample the patch starts at on x/z
+			float Size; //samples covered, half the node size when only a quarter of the node is drawn
+			uint Level; //0 is the finest, the grid spacing is GetNodeSize(Level) / GetPatchResolution()
+		};
+
+		TerrainLOD();
+
+		//patchResolution is the number of grid quads along a patch side and must be a power of two, levelCount 0 uses as
+		//many levels as it takes for a single root node to cover the grid
+		void Build(const float* pHeights, uint resolution, uint patchResolution, uint levelCount = 0);
+
+		//Recomputes the nodes covering the samples x0..x1, z0..z1 (inclusive) after they changed in pHeights, which is the
+		//grid the tree was built from
+		void Update(const float* pHeights, uint x0, uint z0, uint x1, uint z1);
+
+		//Distance from the observer the finest level is drawn within, each following level doubles it
+		void SetLODDistance(float distance) { _lodDistance = distance; }
+		float GetLODDistance() const { return _lodDistance; }
+
+		//Fraction of a level's range after which its vertices start morphing into the next coarser level
+		void SetMorphStart(float ratio) { _morphStart = ratio; }
+		float GetMorphStart() const { return _morphStart; }
+
+		//Appends the patches that cover the grid for the observer, pFrustumPlanes are the 6 planes of the view in the
+		//same space or null to skip culling. Nodes past the largest range are drawn at the coarsest level.
+		void Select(const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<Patch>& patches) const;
+
+		//Observer distances over which the vertices of a patch of the level blend into the next coarser grid
+		void GetMorphRange(uint level, float& start, float& end) const;
+
+		//Intersects a ray in sample space with the full resolution triangles of pHeights, which must be the grid the tree
+		//was built from. Only leaves whose box the ray enters before tMin are tested. triIndex is the triangle in the grid
+		//of resolution - 1 quads with two triangles each and normal is the unnormalized normal of that triangle.
+		bool Raycast(const float* pHeights, const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const;
+
+		uint GetResolution() const { return _resolution; }
+		uint GetPatchResolution() const { return _patchResolution; }
+		uint GetLevelCount() const { return _levels.size(); }
+		uint GetNodeSize(uint level) const { return _patchResolution << level; }
+		float GetMinHeight() const { return _minHeight; }
+		float GetMaxHeight() const { return _maxHeight; }
+
+	private:
+		struct Level
+		{
+			uint NodesPerSide;
+			Vector<glm::vec2> MinMax; //height range of each node, rows of NodesPerSide
+		};
+
+		void UpdateNodes(const float* pHeights, uint x0, uint z0, uint x1, uint z1);
+		bool SelectNode(uint level, uint x, uint z, const glm::vec3& observer, const glm::vec4* pFrustumPlanes, Vector<Patch>& patches) const;
+		bool RaycastNode(uint level, uint x, uint z, const float* pHeights, const Ray& ray, float& tMin, uint& triIndex, float weights[3], glm::vec3& normal) const;
+		bool GetNodeBox(uint level, uint x, uint z, AABB& box) const;
+		float GetRange(uint level) const { return _lodDistance * float(1u << level); }
+
+		uint _resolution;
+		uint _patchResolution;
+		float _lodDistance;
+		float _morphStart;
+		float _minHeight;
+		float _maxHeight;
+		Vector<Level> _levels;
+	};
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include "TerrainTileCache.h"
+
+namespace SunEngine
+{
+	TerrainTileCache::TerrainTileCache()
+	{
+		_memoryBudget = 256ull * 1024ull * 1024ull;
+		_frame = 0;
+
+		//the pool has to be constructed first so it is still alive when the destructor waits on it
+		ThreadPool::Get();
+	}
+
+	TerrainTileCache::~TerrainTileCache()
+	{
+		Close();
+	}
+
+	bool TerrainTileCache::Open(const String& filename)
+	{
+		Close();
+		return _file.Open(filename);
+	}
+
+	void TerrainTileCache::Close()
+	{
+		for (auto& tile : _tiles)
+			ThreadPool::Get().Wait(tile.second->TaskCounter);
+
+		_tiles.clear();
+		_file.Close();
+	}
+
+	const ushort* TerrainTileCache::Request(uint x, uint y)
+	{
+		const TerrainTileFile::Header& header = _file.GetHeader();
+		if (x >= header.TilesX || y >= header.TilesY)
+			return 0;
+
+		UniquePtr<Tile>& entry = _tiles[y * header.TilesX + x];
+		if (entry)
+		{
+			entry->LastUsedFrame = _frame;
+			return entry->CurrentState == STATE_RESIDENT ? entry->Heights.data() : 0;
+		}
+
+		Tile* pTile = new Tile();
+		pTile->pFile = &_file;
+		pTile->X = x;
+		pTile->Y = y;
+		pTile->CurrentState = STATE_LOADING;
+		pTile->Loaded = false;
+		pTile->LastUsedFrame = _frame;
+		pTile->Heights.resize(header.TileSize * header.TileSize);
+		entry = UniquePtr<Tile>(pTile);
+
+		ThreadPool::Get().AddTask([](uint, void* pData) -> void {
+			Tile* pTile = static_cast<Tile*>(pData);
+			pTile->Loaded = pTile->pFile->ReadTile(pTile->X, pTile->Y, pTile->Heights.data());
+		}, pTile, &pTile->TaskCounter);
+
+		return 0;
+	}
+
+	void TerrainTileCache::Update()
+	{
+		//without worker threads queued loads only run while someone waits, finish them all since tiles are small
+		bool singleThreaded = ThreadPool::Get().GetThreadCount() == 1;
+
+		uint64 residentBytes = 0;
+		Vector<Tile*> unused;
+		Vector<uint> failed;
+		for (auto& kv : _tiles)
+		{
+			Tile* pTile = kv.second.get();
+			if (pTile->CurrentState == STATE_LOADING)
+			{
+				if (singleThreaded)
+					ThreadPool::Get().Wait(pTile->TaskCounter);
+
+				if (pTile->TaskCounter.Done())
+				{
+					pTile->CurrentState = pTile->Loaded ? STATE_RESIDENT : STATE_FAILED;
+					if (!pTile->Loaded)
+						pTile->Heights = Vector<ushort>();
+				}
+			}
+
+			//failed tiles are forgotten once unused so they are read again when next requested
+			if (pTile->CurrentState == STATE_FAILED && pTile->LastUsedFrame != _frame)
+				failed.push_back(kv.first);
+
+			residentBytes += pTile->Heights.size() * sizeof(ushort);
+			if (pTile->CurrentState == STATE_RESIDENT && pTile->LastUsedFrame != _frame)
+				unused.push_back(pTile);
+		}
+
+		for (uint key : failed)
+			_tiles.erase(key);
+
+		//least recently requested first
+		std::sort(unused.begin(), unused.end(), [](const Tile* pLeft, const Tile* pRight) -> bool {
+			return pLeft->LastUsedFrame < pRight->LastUsedFrame;
+		});
+
+		const TerrainTileFile::Header& header = _file.GetHeader();
+		for (uint i = 0; i < unused.size() && residentBytes > _memoryBudget; i++)
+		{
+			residentBytes -= unused[i]->Heights.size() * sizeof(ushort);
+			_tiles.erase(unused[i]->Y * header.TilesX + unused[i]->X);
+		}
+
+		++_frame;
+	}
+
+	TerrainTileCache::Status TerrainTileCache::GetStatus() const
+	{
+		Status status = {};
+		status.MemoryBudget = _memoryBudget;
+		for (auto& kv : _tiles)
+		{
+			const Tile* pTile = kv.second.get();
+			status.Resident += pTile->CurrentState == STATE_RESIDENT;
+			status.Loading += pTile->CurrentState == STATE_LOADING;
+			status.Failed += pTile->CurrentState == STATE_FAILED;
+			status.ResidentBytes += pTile->Heights.size() * sizeof(ushort);
+		}
+		return status;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "TerrainTileFile.h"
+
+namespace SunEngine
+{
+	//Keeps tiles of a TerrainTileFile in memory. Tiles load on the thread pool the first time they are requested and the
+	//least recently requested ones are dropped while the cache is over its memory budget. Tiles requested since the last
+	//Update are never dropped, so the budget is exceeded rather than evicting what is in use.
+	class TerrainTileCache
+	{
+	public:
+		struct Status
+		{
+			uint Resident;
+			uint Loading;
+			uint Failed;
+			uint64 ResidentBytes; //includes the buffers of tiles being loaded
+			uint64 MemoryBudget;
+		};
+
+		TerrainTileCache();
+		~TerrainTileCache();
+
+		bool Open(const String& filename);
+		//Waits on loads in flight and drops every tile
+		void Close();
+		bool IsOpen() const { return _file.IsOpen(); }
+
+		const TerrainTileFile::Header& GetHeader() const { return _file.GetHeader(); }
+
+		void SetMemoryBudget(uint64 bytes) { _memoryBudget = bytes; }
+		uint64 GetMemoryBudget() const { return _memoryBudget; }
+
+		//The quantized heights of tile (x, y) when resident, otherwise starts loading it and returns null
+		const ushort* Request(uint x, uint y);
+
+		//Call once per frame from the main thread, finishes loads then evicts down to the budget
+		void Update();
+
+		Status GetStatus() const;
+
+	private:
+		enum State
+		{
+			STATE_LOADING,
+			STATE_RESIDENT,
+			STATE_FAILED,
+		};
+
+		struct Tile
+		{
+			const TerrainTileFile* pFile;
+			uint X;
+			uint Y;
+			State CurrentState;
+			bool Loaded;
+			uint LastUsedFrame;
+			Vector<ushort> Heights;
+			ThreadPool::Counter TaskCounter;
+		};
+
+		TerrainTileFile _file;
+		uint64 _memoryBudget;
+		uint _frame;
+		Map<uint, UniquePtr<Tile>> _tiles;
+	};
+}
@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "MathHelper.h"
+#include "TerrainTileFile.h"
+
+namespace SunEngine
+{
+	const char* TerrainTileFile::Extension = ".sterrain";
+
+	TerrainTileFile::Writer::Writer()
+	{
+		_header = {};
+		_tilesWritten = 0;
+	}
+
+	bool TerrainTileFile::Writer::Open(const String& filename, const Header& header)
+	{
+		if (header.TileSize == 0 || header.TilesX == 0 || header.TilesY == 0 || header.HeightRange <= 0.0f)
+			return false;
+
+		if (!_file.OpenForWrite(filename.c_str()))
+			return false;
+
+		_header = header;
+		_tilesWritten = 0;
+		_quantized.resize(header.TileSize * header.TileSize);
+
+		//the magic is left zero until every tile is written so a partially written file never opens
+		uint pendingMagic = 0;
+		if (!_file.Write(pendingMagic)) return false;
+		if (!_file.Write(Version)) return false;
+		if (!_file.Write(_header.TileSize)) return false;
+		if (!_file.Write(_header.TilesX)) return false;
+		if (!_file.Write(_header.TilesY)) return false;
+		if (!_file.Write(_header.HeightMin)) return false;
+		if (!_file.Write(_header.HeightRange)) return false;
+		return true;
+	}
+
+	bool TerrainTileFile::Writer::WriteTile(const float* pHeights)
+	{
+		if (_tilesWritten == _header.TilesX * _header.TilesY)
+			return false;
+
+		float scale = 65535.0f / _header.HeightRange;
+		for (uint i = 0; i < _quantized.size(); i++)
+			_quantized[i] = (ushort)glm::clamp((pHeights[i] - _header.HeightMin) * scale + 0.5f, 0.0f, 65535.0f);
+
+		if (!_file.Write(_quantized.data(), sizeof(ushort) * _quantized.size()))
+			return false;
+
+		++_tilesWritten;
+		return true;
+	}
+
+	bool TerrainTileFile::Writer::Close()
+	{
+		bool complete = _tilesWritten == _header.TilesX * _header.TilesY;
+
+		StreamBase& stream = _file;
+		if (complete && stream.Seek(0, StreamBase::START))
+			complete = _file.Write(Magic);
+
+		return _file.Close() && complete;
+	}
+
+	TerrainTileFile::TerrainTileFile()
+	{
+		_header = {};
+	}
+
+	bool TerrainTileFile::Open(const String& filename)
+	{
+		if (!_file.Open(filename.c_str()))
+			return false;
+
+		uint magic, version;
+		bool valid = _file.Read(magic) && magic == Magic;
+		valid = valid && _file.Read(version) && version == Version;
+		valid = valid && _file.Read(_header.TileSize) && _file.Read(_header.TilesX) && _file.Read(_header.TilesY);
+		valid = valid && _file.Read(_header.HeightMin) && _file.Read(_header.HeightRange);
+		valid = valid && _header.TileSize && _file.GetSize() >= HeaderSize + GetTileBytes() * _header.TilesX * _header.TilesY;
+		if (!valid)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool TerrainTileFile::Close()
+	{
+		_header = {};
+		return _file.Close();
+	}
+
+	bool TerrainTileFile::ReadTile(uint x, uint y, ushort* pHeights) const
+	{
+		if (x >= _header.TilesX || y >= _header.TilesY)
+			return false;
+
+		//the copy is what pages the tile in from disk
+		usize tileBytes = GetTileBytes();
+		memcpy(pHeights, _file.GetData() + HeaderSize + (usize(y) * _header.TilesX + x) * tileBytes, tileBytes);
+		return true;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "FileBase.h"
+#include "MappedFileStream.h"
+
+namespace SunEngine
+{
+	//Paged height field for terrains larger than memory. A header is followed by square tiles of 16 bit heights quantized
+	//to the world's height range, stored row major so any tile is found at a fixed offset and read without the others
+	class TerrainTileFile
+	{
+	public:
+		static const char* Extension;
+
+		struct Header
+		{
+			uint TileSize; //samples along a tile side
+			uint TilesX;
+			uint TilesY;
+			float HeightMin;
+			float HeightRange;
+		};
+
+		//Writes tiles one at a time in row major order, so a world can be generated without ever being held at once
+		class Writer
+		{
+		public:
+			Writer();
+
+			bool Open(const String& filename, const Header& header);
+			//TileSize squared heights, clamped to the header's range
+			bool WriteTile(const float* pHeights);
+			//Fails when fewer tiles than the header declares were written
+			bool Close();
+
+		private:
+			FileStream _file;
+			Header _header;
+			uint _tilesWritten;
+			Vector<ushort> _quantized;
+		};
+
+		TerrainTileFile();
+
+		bool Open(const String& filename);
+		bool Close();
+		bool IsOpen() const { return _file.GetData() != 0; }
+
+		const Header& GetHeader() const { return _header; }
+		usize GetTileBytes() const { return usize(_header.TileSize) * _header.TileSize * sizeof(ushort); }
+
+		//Copies the quantized heights of tile (x, y), only reads the mapping so tiles can be read from several threads at once
+		bool ReadTile(uint x, uint y, ushort* pHeights) const;
+
+		static float Dequantize(const Header& header, ushort value) { return header.HeightMin + value * (header.HeightRange / 65535.0f); }
+
+	private:
+		static const uint Magic = 0x4E525453; //STRN
+		static const uint Version = 1;
+		static const usize HeaderSize = sizeof(uint) * 5 + sizeof(float) * 2;
+
+		MappedFileStream _file;
+		Header _header;
+	};
+}
@@ -1,5 +1,6 @@
 #include "MipMapGenerator.h"
-#include "FileBase.h"
+#include "TextureFile.h"
+#include "PixelKernels.h"
 #include "Texture2D.h"
 
 namespace SunEngine
@@ -14,14 +15,45 @@ namespace SunEngine
 
 	bool Texture2D::RegisterToGPU()
 	{
+		return RegisterToGPU(0);
+	}
+
+	bool Texture2D::RegisterToGPU(uint firstLevel)
+	{
+		if (firstLevel > _mips.size())
+			return false;
+
 		if (!_gpuObject.Destroy())
 			return false;
 
+		return CreateGPUObject(firstLevel, _gpuObject);
+	}
+
+	bool Texture2D::RegisterToGPU(uint firstLevel, BaseTexture* pRetired)
+	{
+		if (firstLevel > _mips.size() || pRetired->GetAPIHandle())
+			return false;
+
+		BaseTexture texture;
+		if (!CreateGPUObject(firstLevel, texture))
+		{
+			texture.Destroy();
+			return false;
+		}
+
+		_gpuObject.Swap(texture);
+		pRetired->Swap(texture);
+		return true;
+	}
+
+	bool Texture2D::CreateGPUObject(uint firstLevel, BaseTexture& texture)
+	{
 		BaseTexture::CreateInfo::TextureData texData = {};
-		texData.image = _img.ImageData();
+		texData.image = GetLevelImageData(firstLevel);
+		texData.image.Flags |= _img.GetFlags();
 
 		Vector<ImageData> mipData;
-		for (uint i = 0; i < _mips.size(); i++)
+		for (uint i = firstLevel; i < _mips.size(); i++)
 		{
 			ImageData mipImage = _mips[i]->ImageData();
 			mipImage.Flags |= _img.GetFlags();
@@ -34,15 +66,25 @@ namespace SunEngine
 		BaseTexture::CreateInfo info;
 		info.numImages = 1;
 		info.pImages = &texData;
-		if (!_gpuObject.Create(info))
+		if (!texture.Create(info))
 			return false;
 
 		return true;
 	}
 
-	bool Texture2D::Alloc(uint width, uint height)
+	bool Texture2D::UpdateRegion(uint x, uint y, uint width, uint height)
 	{
-		if (!_img.Allocate(width, height))
+		return _gpuObject.UpdateRegion(_img.ImageData(), x, y, width, height);
+	}
+
+	bool Texture2D::UpdateRegion(uint x, uint y, uint width, uint height, TextureUploadBatch& batch)
+	{
+		return batch.Add(&_gpuObject, _img.ImageData(), x, y, width, height);
+	}
+
+	bool Texture2D::Alloc(uint width, uint height, uint format)
+	{
+		if (!_img.Allocate(width, height, 0, format))
 			return false;
 
 		_filename.clear();
@@ -60,6 +102,16 @@ namespace SunEngine
 		return true;
 	}
 
+	bool Texture2D::LoadFromContainer(const String& filename, uint64 sourceHash)
+	{
+		return TextureFile::Load(filename, sourceHash, _mapping, _img, _mips);
+	}
+
+	bool Texture2D::SaveToContainer(const String& filename, uint64 sourceHash, const TextureFile::SourceStamp& source)
+	{
+		return TextureFile::Save(filename, sourceHash, source, _img, _mips);
+	}
+
 	bool Texture2D::LoadFromRAW()
 	{
 		return LoadRAWInternal(1);
@@ -77,24 +129,20 @@ namespace SunEngine
 
 	bool Texture2D::LoadRAWInternal(uint byteDivider)
 	{
-		FileStream file;
-		if (!file.OpenForRead(_filename.c_str()))
+		//the samples are converted straight out of the mapped file
+		MappedFileStream file;
+		if (!file.Open(_filename.c_str()))
 			return false;
-		
-		MemBuffer buffer;
-		if(!file.ReadBuffer(buffer))
-			return false;
-		file.Close();
 
-		uint resolutionSquared = buffer.GetSize() / byteDivider;
+		uint resolutionSquared = (uint)file.GetSize() / byteDivider;
 		uint resolution = uint(sqrtf((float)resolutionSquared));
 
 		if (!Alloc(resolution, resolution))
 			return false;
 
-		uchar* p_uchar = (uchar*)buffer.GetData();
-		ushort* p_ushort = (ushort*)buffer.GetData();
-		float* p_float = (float*)buffer.GetData();
+		const uchar* p_uchar = file.GetData();
+		const ushort* p_ushort = (const ushort*)file.GetData();
+		const float* p_float = (const float*)file.GetData();
 
 		for (uint y = 0; y < resolution; y++)
 		{
@@ -102,7 +150,7 @@ namespace SunEngine
 			{
 				uint index = y * resolution + x;
 				float value = 0.0f;
-				if (byteDivider == 0) value = (float)p_uchar[index];
+				if (byteDivider == 1) value = (float)p_uchar[index];
 				else if (byteDivider == 2) value = (float)p_ushort[index];
 				else if (byteDivider == 4) value = (float)p_float[index];
 				SetPixel(x, y, reinterpret_cast<Pixel&>(value));
@@ -113,7 +161,7 @@ namespace SunEngine
 		return true;
 	}
 
-	bool Texture2D::GenerateMips(bool threaded)
+	bool Texture2D::GenerateMips(bool threaded, const MipMapGenerator::Options& options)
 	{
 		if (_mips.size())
 			_mips.clear();
@@ -121,8 +169,12 @@ namespace SunEngine
 		if (_img.IsCompressed())
 			return true;
 
+		MipMapGenerator::Options mipOptions = options;
+		if (_img.GetFlags() & ImageData::SRGB)
+			mipOptions.Modes |= MipMapGenerator::MODE_SRGB;
+
 		MipMapGenerator mipGen;
-		if (!mipGen.Create(_img.ImageData(), threaded))
+		if (!mipGen.Create(_img.ImageData(), threaded, mipOptions))
 			return false;
 
 		//Pixel Test[] =
@@ -155,7 +207,7 @@ namespace SunEngine
 		return  true;
 	}
 
-	bool Texture2D::Resize(uint width, uint height)
+	bool Texture2D::Resize(uint width, uint height, ImageResampler::Filter filter, bool threaded)
 	{
 		if (_mips.size())
 			return true;
@@ -163,50 +215,31 @@ namespace SunEngine
 		if (_img.IsCompressed())
 			return true;
 
-		return _img.Resize(width, height);
+		return _img.Resize(width, height, filter, threaded);
 	}
 
-	bool Texture2D::Compress()
+	bool Texture2D::Compress(bool threaded, BlockCompressor::Quality quality, uint format)
 	{
-		if (_img.IsCompressed())
+		if (_img.IsCompressed() || _img.IsFloat())
 			return true;
 
-		if (!_img.Compress())
-			return false;
-
+		Vector<Image*> chain;
+		chain.push_back(&_img);
 		for (uint i = 0; i < _mips.size(); i++)
-		{
-			if (!_mips[i]->Compress())
-				return false;
-		}
+			chain.push_back(_mips[i].get());
 
-		return true;
+		return Image::CompressChain(chain.data(), chain.size(), quality, threaded, format);
 	}
 
 	void Texture2D::FillColor(const glm::vec4& color)
 	{
 		Pixel p(color.r, color.g, color.b, color.a);
-
-		for (uint i = 0; i < _img.Width(); i++)
-		{
-			for (uint j = 0; j < _img.Height(); j++)
-			{
-				_img.SetPixel(i, j, p);
-			}
-		}
+		PixelKernels::Fill(_img.Pixels(), _img.Width() * _img.Height(), p);
 	}
 
 	void Texture2D::Invert()
 	{
-		for (uint i = 0; i < _img.Width(); i++)
-		{
-			for (uint j = 0; j < _img.Height(); j++)
-			{
-				Pixel p = _img.GetPixel(i, j);
-				p.Invert();
-				_img.SetPixel(i, j, p);
-			}
-		}
+		PixelKernels::Invert(_img.Pixels(), _img.Width() * _img.Height());
 	}
 
 	void Texture2D::SetPixel(uint x, uint y, const glm::vec4& color)
@@ -238,28 +271,12 @@ namespace SunEngine
 
 	void Texture2D::GetAveragePixel(uint x, uint y, int kernelSize, glm::vec4& color) const
 	{
-		int samples = 0;
-		color = Vec4::Zero;
-
-		glm::vec4 tmp;
-		for (int i = -kernelSize; i <= kernelSize; i++)
-		{
-			int yi = (int)y + i;
-			if (yi >= 0 && yi < (int)GetHeight())
-			{
-				for (int j = -kernelSize; j <= kernelSize; j++)
-				{
-					int xj = (int)x + j;
-					if (xj >= 0 && xj < (int)GetWidth())
-					{
-						GetPixel(xj, yi, tmp);
-						color += tmp;
-						++samples;
-					}
-				}
-			}
-		}
+		//the kernel is clipped to the image, rows of the remaining box are summed in integers
+		uint x0 = (uint)glm::clamp((int)x - kernelSize, 0, (int)GetWidth());
+		uint y0 = (uint)glm::clamp((int)y - kernelSize, 0, (int)GetHeight());
+		uint x1 = (uint)glm::clamp((int)x + kernelSize + 1, (int)x0, (int)GetWidth());
+		uint y1 = (uint)glm::clamp((int)y + kernelSize + 1, (int)y0, (int)GetHeight());
 
-		color /= (float)samples;
+		PixelKernels::BoxAverage(_img.Pixels(), GetWidth(), x0, y0, x1, y1, &color.x);
 	}
 }
\ No newline at end of file
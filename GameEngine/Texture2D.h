@@ -3,6 +3,9 @@
 #include "BaseTexture.h"
 #include "GPUResource.h"
 #include "Image.h"
+#include "MappedFileStream.h"
+#include "TextureFile.h"
+#include "MipMapGenerator.h"
 
 namespace SunEngine
 {
@@ -13,11 +16,23 @@ namespace SunEngine
 		~Texture2D();
 
 		bool RegisterToGPU() override;
+		//Uploads the chain starting at mip level firstLevel, level 0 being the base image, so the top levels can stay on the CPU
+		bool RegisterToGPU(uint firstLevel);
+		//Like RegisterToGPU(firstLevel) but builds the chain before releasing the current one, which is handed to pRetired
+		//instead of being destroyed so the caller can keep it alive until frames still sampling it have finished
+		bool RegisterToGPU(uint firstLevel, BaseTexture* pRetired);
+		//Uploads a rectangle of the base image changed since RegisterToGPU, fails if the GPU texture doesn't start at the base image
+		bool UpdateRegion(uint x, uint y, uint width, uint height);
+		//Queues the region in batch instead, the image has to stay unchanged until the batch is submitted
+		bool UpdateRegion(uint x, uint y, uint width, uint height, TextureUploadBatch& batch);
 
-		bool Alloc(uint width, uint height);
-		bool GenerateMips(bool threaded);
-		bool Resize(uint width, uint height);
-		bool Compress();
+		//format is an uncompressed ImageData format, 0 being RGBA8. Texels of formats smaller than a Pixel are written through GetData
+		bool Alloc(uint width, uint height, uint format = 0);
+		//SRGB images are always filtered in linear space on top of the modes in options
+		bool GenerateMips(bool threaded, const MipMapGenerator::Options& options = MipMapGenerator::Options::Default);
+		bool Resize(uint width, uint height, ImageResampler::Filter filter = ImageResampler::FILTER_LANCZOS3, bool threaded = true);
+		//format 0 picks BC1 or BC3 from the alpha of the base image, float images are left as they are
+		bool Compress(bool threaded = true, BlockCompressor::Quality quality = BlockCompressor::QUALITY_HIGH, uint format = 0);
 
 		void FillColor(const glm::vec4& color);
 		void Invert();
@@ -35,6 +50,7 @@ namespace SunEngine
 		void SetSingleFloatTexture() { _img.SetFlags(ImageData::SAMPLED_TEXTURE_R32F); }
 
 		uint GetImageFlags() const { return _img.GetFlags(); }
+		void* GetData() const { return _img.Pixels(); }
 
 		void SetFilename(const String& filename) { _filename = filename; }
 		const String& GetFilename() const { return _filename; }
@@ -43,14 +59,22 @@ namespace SunEngine
 		bool LoadFromRAW16();
 		bool LoadFromRAWF32();
 
+		//Texture containers hold the final, usually compressed, mip chain and load without decoding
+		bool LoadFromContainer(const String& filename, uint64 sourceHash);
+		bool SaveToContainer(const String& filename, uint64 sourceHash, const TextureFile::SourceStamp& source);
+
 		ImageData GetImageData() const { return _img.ImageData(); }
 		ImageData GetMipImageData(uint index) const { return _mips[index]->ImageData(); }
 		uint GetMipCount() const { return _mips.size(); }
+		ImageData GetLevelImageData(uint level) const { return level ? GetMipImageData(level - 1) : GetImageData(); }
 
 	private:
 		bool LoadRAWInternal(uint byteDivider);
+		bool CreateGPUObject(uint firstLevel, BaseTexture& texture);
 
 		String _filename;
+		//Images loaded from a container view their pixels in this mapping until they are reallocated
+		MappedFileStream _mapping;
 		Image _img;
 		Vector<UniquePtr<Image>> _mips;
 	};
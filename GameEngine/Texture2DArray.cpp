@@ -51,6 +51,22 @@ namespace SunEngine
 		return true;
 	}
 
+	bool Texture2DArray::UpdateRegion(uint i, uint x, uint y, uint width, uint height)
+	{
+		if (i >= _textures.size())
+			return false;
+
+		return _gpuObject.UpdateRegion(_textures[i]->texture.GetImageData(), x, y, width, height, i);
+	}
+
+	bool Texture2DArray::UpdateRegion(uint i, uint x, uint y, uint width, uint height, TextureUploadBatch& batch)
+	{
+		if (i >= _textures.size())
+			return false;
+
+		return batch.Add(&_gpuObject, _textures[i]->texture.GetImageData(), x, y, width, height, i);
+	}
+
 	bool Texture2DArray::AddTexture(Texture2D* pTexture)
 	{
 		if (_width == 0 || _height == 0)
@@ -108,11 +124,10 @@ namespace SunEngine
 
 	bool Texture2DArray::GenerateMips(bool threaded)
 	{
-		//handle threading with ThreadPool...
-
+		//the tiles of each level are spread over the thread pool
 		for (auto& tex : _textures)
 		{
-			if (!tex->texture.GenerateMips(false))
+			if (!tex->texture.GenerateMips(threaded))
 				return false;
 		}
 
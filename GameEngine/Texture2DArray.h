@@ -12,6 +12,9 @@ namespace SunEngine
 		~Texture2DArray();
 
 		bool RegisterToGPU() override;
+		//Uploads a rectangle of texture i changed through SetPixel since RegisterToGPU
+		bool UpdateRegion(uint i, uint x, uint y, uint width, uint height);
+		bool UpdateRegion(uint i, uint x, uint y, uint width, uint height, TextureUploadBatch& batch);
 
 		void SetWidth(uint width) { _width = width; }
 		uint GetWidth() const { return _width; }
@@ -18,11 +18,21 @@ namespace SunEngine
 
 		BaseTexture::CreateInfo info = {};
 		BaseTexture::CreateInfo::TextureData texData[6];
+		Vector<ImageData> mipData[6];
 		for (uint i = 0; i < 6; i++)
 		{
 			texData[i] = {};
 			texData[i].image = _images[i].ImageData();
 			texData[i].image.Flags |= ImageData::CUBEMAP;
+
+			for (uint j = 0; j < _mips[i].size(); j++)
+			{
+				ImageData mipImage = _mips[i][j]->ImageData();
+				mipImage.Flags |= texData[i].image.Flags;
+				mipData[i].push_back(mipImage);
+			}
+			texData[i].mipLevels = mipData[i].size();
+			texData[i].pMips = mipData[i].data();
 		}
 
 		info.numImages = 6;
@@ -45,6 +55,35 @@ namespace SunEngine
 			{
 				return false;
 			}
+			_mips[i].clear();
+		}
+		return true;
+	}
+
+	bool TextureCube::GenerateMips(bool threaded)
+	{
+		for (uint i = 0; i < 6; i++)
+		{
+			_mips[i].clear();
+			if (_images[i].IsCompressed())
+				continue;
+
+			MipMapGenerator::Options options = MipMapGenerator::Options::Default;
+			if (_images[i].GetFlags() & ImageData::SRGB)
+				options.Modes |= MipMapGenerator::MODE_SRGB;
+
+			MipMapGenerator mipGen;
+			if (!mipGen.Create(_images[i].ImageData(), threaded, options))
+				return false;
+
+			for (uint j = 0; j < mipGen.GetMipLevels(); j++)
+			{
+				Image* pMip = new Image();
+				if (!pMip->TransferFrom(mipGen.GetMipMaps()[j]))
+					return false;
+
+				_mips[i].push_back(UniquePtr<Image>(pMip));
+			}
 		}
 		return true;
 	}
@@ -14,7 +14,10 @@ namespace SunEngine
 
 		bool RegisterToGPU() override;
 		bool LoadFromFile(const String& path, const Vector<String>& sideNames);
+		//Every side gets a full chain, HDR sides are filtered as floats
+		bool GenerateMips(bool threaded = true);
 	private:
 		Image _images[6];
+		Vector<UniquePtr<Image>> _mips[6];
 	};
 }
\ No newline at end of file
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include "Material.h"
+#include "TextureStreamer.h"
+
+namespace SunEngine
+{
+	TextureStreamer::Options MakeDefaultStreamerOptions()
+	{
+		TextureStreamer::Options opt;
+		opt.MemoryBudget = 512ull * 1024ull * 1024ull;
+		opt.TailSize = 64;
+		opt.MaxUploadsPerUpdate = 4;
+		opt.EvictFrames = 120;
+		opt.TexelsPerPixel = 1.0f;
+		opt.RetireFrames = 4;
+
+		return opt;
+	}
+
+	const TextureStreamer::Options TextureStreamer::Options::Default = MakeDefaultStreamerOptions();
+
+	TextureStreamer& TextureStreamer::Get()
+	{
+		static TextureStreamer streamer;
+		return streamer;
+	}
+
+	TextureStreamer::TextureStreamer()
+	{
+		_options = Options::Default;
+		_frame = 0;
+
+		//the pool has to be constructed first so it is still alive when the destructor waits on it
+		ThreadPool::Get();
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		//like resident chains, replaced ones left at exit go with the device rather than being destroyed after it
+		Clear();
+	}
+
+	bool TextureStreamer::Request(Job* pJob)
+	{
+		//two jobs filling the same texture at once would race
+		for (Texture2D* pTexture : pJob->Textures)
+		{
+			if (GetState(pTexture) == STATE_LOADING)
+			{
+				delete pJob;
+				return false;
+			}
+		}
+
+		PendingJob* pPending = new PendingJob();
+		pPending->pJob = UniquePtr<Job>(pJob);
+		pPending->Loaded = false;
+		_jobs.push_back(UniquePtr<PendingJob>(pPending));
+
+		for (Texture2D* pTexture : pJob->Textures)
+		{
+			//materials hold pointers to existing entries, so they are reused and keep their current chain until the reload
+			UniquePtr<StreamedTexture>& entry = _textures[pTexture];
+			if (!entry)
+			{
+				entry = UniquePtr<StreamedTexture>(new StreamedTexture());
+				entry->pTexture = pTexture;
+				entry->ResidentLevel = 0;
+				entry->WantedLevel = 0;
+				entry->TailLevel = 0;
+				entry->ScreenSize = 0.0f;
+			}
+
+			entry->CurrentState = STATE_LOADING;
+			entry->LastSeenFrame = _frame;
+		}
+
+		ThreadPool::Get().AddTask([](uint, void* pData) -> void {
+			PendingJob* pPending = static_cast<PendingJob*>(pData);
+			pPending->Loaded = pPending->pJob->Load();
+		}, pPending, &pPending->TaskCounter);
+
+		return true;
+	}
+
+	void TextureStreamer::Bind(Material* pMaterial, const String& name, Texture2D* pTexture)
+	{
+		auto found = _textures.find(pTexture);
+		if (found == _textures.end())
+			return;
+
+		StreamedTexture* pStreamed = (*found).second.get();
+		Binding binding;
+		binding.pMaterial = pMaterial;
+		binding.Name = name;
+		pStreamed->Bindings.push_back(binding);
+
+		Vector<StreamedTexture*>& materialTextures = _materials[pMaterial];
+		if (std::find(materialTextures.begin(), materialTextures.end(), pStreamed) == materialTextures.end())
+			materialTextures.push_back(pStreamed);
+
+		if (pStreamed->CurrentState == STATE_STREAMING || pStreamed->CurrentState == STATE_RESIDENT)
+			pMaterial->SetTexture2D(name, pTexture);
+	}
+
+	void TextureStreamer::SetScreenSize(const Material* pMaterial, float pixels)
+	{
+		auto found = _materials.find(pMaterial);
+		if (found == _materials.end())
+			return;
+
+		for (StreamedTexture* pStreamed : (*found).second)
+		{
+			if (pStreamed->LastSeenFrame != _frame)
+			{
+				pStreamed->ScreenSize = pixels;
+				pStreamed->LastSeenFrame = _frame;
+			}
+			else
+			{
+				pStreamed->ScreenSize = glm::max(pStreamed->ScreenSize, pixels);
+			}
+		}
+	}
+
+	void TextureStreamer::Update()
+	{
+		//without worker threads queued loads only run while someone waits, take the newest one each frame
+		if (ThreadPool::Get().GetThreadCount() == 1 && !_jobs.empty())
+			ThreadPool::Get().Wait(_jobs.back()->TaskCounter);
+
+		DestroyRetired();
+
+		for (auto iter = _jobs.begin(); iter != _jobs.end();)
+		{
+			PendingJob* pPending = (*iter).get();
+			if (pPending->TaskCounter.Done())
+			{
+				for (Texture2D* pTexture : pPending->pJob->Textures)
+					FinishLoad(*_textures.at(pTexture), pPending->Loaded);
+				iter = _jobs.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+
+		//sizes were recorded while the last frame was rendered
+		Vector<StreamedTexture*> streamed;
+		Vector<PlanEntry> entries;
+		uint64 residentBytes = 0;
+		for (auto& tex : _textures)
+		{
+			StreamedTexture* pStreamed = tex.second.get();
+			if (pStreamed->CurrentState != STATE_STREAMING && pStreamed->CurrentState != STATE_RESIDENT)
+				continue;
+
+			float pixels = _frame - pStreamed->LastSeenFrame <= _options.EvictFrames ? pStreamed->ScreenSize : 0.0f;
+
+			PlanEntry entry;
+			entry.pLevelSizes = pStreamed->LevelSizes.data();
+			entry.LevelCount = pStreamed->LevelSizes.size();
+			entry.Width = pStreamed->pTexture->GetWidth();
+			entry.TailLevel = pStreamed->TailLevel;
+			entry.WantedLevel = GetWantedLevel(entry.Width, entry.LevelCount, pixels * _options.TexelsPerPixel);
+			entry.ScreenSize = pixels;
+			entries.push_back(entry);
+			streamed.push_back(pStreamed);
+
+			pStreamed->WantedLevel = entry.WantedLevel;
+			residentBytes += GetResidentBytes(*pStreamed);
+		}
+
+		Vector<uint> firstLevels;
+		PlanResidency(entries.data(), entries.size(), _options.MemoryBudget, firstLevels);
+
+		//shrinking chains first frees the memory the growing ones need, growing ones go most blurry first
+		Vector<uint> shrink, grow;
+		for (uint i = 0; i < streamed.size(); i++)
+		{
+			if (firstLevels[i] > streamed[i]->ResidentLevel)
+				shrink.push_back(i);
+			else if (firstLevels[i] < streamed[i]->ResidentLevel)
+				grow.push_back(i);
+		}
+
+		std::sort(grow.begin(), grow.end(), [&](uint lhs, uint rhs) -> bool {
+			return entries[lhs].ScreenSize / glm::max(entries[lhs].Width >> streamed[lhs]->ResidentLevel, 1u) >
+				entries[rhs].ScreenSize / glm::max(entries[rhs].Width >> streamed[rhs]->ResidentLevel, 1u);
+		});
+
+		uint uploads = 0;
+		for (uint i : shrink)
+		{
+			if (uploads == _options.MaxUploadsPerUpdate)
+				break;
+
+			uint64 before = GetResidentBytes(*streamed[i]);
+			if (Upload(*streamed[i], firstLevels[i]))
+				residentBytes -= before - GetResidentBytes(*streamed[i]);
+			uploads++;
+		}
+
+		for (uint i : grow)
+		{
+			if (uploads == _options.MaxUploadsPerUpdate)
+				break;
+
+			//shrinks still waiting for an upload slot haven't freed their memory yet
+			uint64 before = GetResidentBytes(*streamed[i]);
+			uint64 after = 0;
+			for (uint level = firstLevels[i]; level < streamed[i]->LevelSizes.size(); level++)
+				after += streamed[i]->LevelSizes[level];
+
+			if (residentBytes - before + after > _options.MemoryBudget)
+				continue;
+
+			if (Upload(*streamed[i], firstLevels[i]))
+				residentBytes += after - before;
+			uploads++;
+		}
+
+		for (StreamedTexture* pStreamed : streamed)
+		{
+			if (pStreamed->CurrentState != STATE_FAILED)
+				pStreamed->CurrentState = pStreamed->ResidentLevel <= pStreamed->WantedLevel ? STATE_RESIDENT : STATE_STREAMING;
+		}
+
+		_frame++;
+	}
+
+	TextureStreamer::Status TextureStreamer::GetStatus() const
+	{
+		Status status = {};
+		status.MemoryBudget = _options.MemoryBudget;
+
+		for (auto& tex : _textures)
+		{
+			const StreamedTexture* pStreamed = tex.second.get();
+			switch (pStreamed->CurrentState)
+			{
+			case STATE_LOADING:
+				status.Loading++;
+				break;
+			case STATE_STREAMING:
+				status.Streaming++;
+				break;
+			case STATE_RESIDENT:
+				status.Resident++;
+				break;
+			case STATE_FAILED:
+				status.Failed++;
+				break;
+			default:
+				break;
+			}
+
+			if (pStreamed->CurrentState == STATE_STREAMING || pStreamed->CurrentState == STATE_RESIDENT)
+			{
+				status.ResidentBytes += GetResidentBytes(*pStreamed);
+				for (uint level = pStreamed->WantedLevel; level < pStreamed->LevelSizes.size(); level++)
+					status.WantedBytes += pStreamed->LevelSizes[level];
+			}
+		}
+
+		return status;
+	}
+
+	TextureStreamer::State TextureStreamer::GetState(const Texture2D* pTexture) const
+	{
+		auto found = _textures.find(pTexture);
+		return found != _textures.end() ? (*found).second->CurrentState : STATE_UNKNOWN;
+	}
+
+	void TextureStreamer::Clear()
+	{
+		for (auto& job : _jobs)
+			ThreadPool::Get().Wait(job->TaskCounter);
+
+		_jobs.clear();
+		_textures.clear();
+		_materials.clear();
+	}
+
+	uint64 TextureStreamer::PlanResidency(const PlanEntry* pEntries, uint count, uint64 budget, Vector<uint>& firstLevels)
+	{
+		firstLevels.resize(count);
+
+		uint64 usedBytes = 0;
+		for (uint i = 0; i < count; i++)
+		{
+			const PlanEntry& entry = pEntries[i];
+			firstLevels[i] = glm::min(entry.TailLevel, entry.LevelCount - 1);
+			for (uint level = firstLevels[i]; level < entry.LevelCount; level++)
+				usedBytes += entry.pLevelSizes[level];
+		}
+
+		struct Candidate
+		{
+			float PixelsPerTexel;
+			uint Index;
+
+			bool operator < (const Candidate& rhs) const
+			{
+				return PixelsPerTexel != rhs.PixelsPerTexel ? PixelsPerTexel < rhs.PixelsPerTexel : Index > rhs.Index;
+			}
+		};
+
+		auto makeCandidate = [&](uint index) -> Candidate {
+			Candidate candidate;
+			candidate.PixelsPerTexel = pEntries[index].ScreenSize / (float)glm::max(pEntries[index].Width >> firstLevels[index], 1u);
+			candidate.Index = index;
+			return candidate;
+		};
+
+		std::priority_queue<Candidate> candidates;
+		for (uint i = 0; i < count; i++)
+		{
+			if (firstLevels[i] > pEntries[i].WantedLevel)
+				candidates.push(makeCandidate(i));
+		}
+
+		while (!candidates.empty())
+		{
+			uint index = candidates.top().Index;
+			candidates.pop();
+
+			//each level is four times the one below it, once one doesn't fit this entry is done
+			uint64 levelBytes = pEntries[index].pLevelSizes[firstLevels[index] - 1];
+			if (usedBytes + levelBytes > budget)
+				continue;
+
+			usedBytes += levelBytes;
+			firstLevels[index]--;
+			if (firstLevels[index] > pEntries[index].WantedLevel)
+				candidates.push(makeCandidate(index));
+		}
+
+		return usedBytes;
+	}
+
+	uint TextureStreamer::GetWantedLevel(uint width, uint levelCount, float pixels)
+	{
+		if (levelCount == 0)
+			return 0;
+
+		if (pixels < 1.0f)
+			return levelCount - 1;
+
+		//the smallest level still at least as wide as the pixels it covers
+		uint level = 0;
+		while (level + 1 < levelCount && (float)(width >> (level + 1)) >= pixels)
+			level++;
+
+		return level;
+	}
+
+	void TextureStreamer::FinishLoad(StreamedTexture& texture, bool loaded)
+	{
+		if (!loaded)
+		{
+			texture.CurrentState = STATE_FAILED;
+			return;
+		}
+
+		Texture2D* pTexture = texture.pTexture;
+		uint levelCount = pTexture->GetMipCount() + 1;
+		texture.LevelSizes.resize(levelCount);
+		texture.TailLevel = levelCount - 1;
+		for (uint level = 0; level < levelCount; level++)
+		{
+			ImageData data = pTexture->GetLevelImageData(level);
+			texture.LevelSizes[level] = data.GetImageSize();
+			if (level < texture.TailLevel && glm::max(data.Width, data.Height) <= _options.TailSize)
+				texture.TailLevel = level;
+		}
+
+		//the resident level starts past the end so the tail upload counts as growing
+		texture.ResidentLevel = levelCount;
+		texture.WantedLevel = texture.TailLevel;
+		texture.CurrentState = Upload(texture, texture.TailLevel) ? STATE_RESIDENT : STATE_FAILED;
+	}
+
+	bool TextureStreamer::Upload(StreamedTexture& texture, uint firstLevel)
+	{
+		//frames still in flight may sample the chain being replaced, it is destroyed RetireFrames Updates later
+		RetiredTexture retired;
+		retired.pTexture = UniquePtr<BaseTexture>(new BaseTexture());
+		retired.RetiredFrame = _frame;
+		if (!texture.pTexture->RegisterToGPU(firstLevel, retired.pTexture.get()))
+		{
+			texture.CurrentState = STATE_FAILED;
+			return false;
+		}
+
+		if (retired.pTexture->GetAPIHandle())
+			_retired.push_back(std::move(retired));
+
+		texture.ResidentLevel = firstLevel;
+		for (const Binding& binding : texture.Bindings)
+			binding.pMaterial->SetTexture2D(binding.Name, texture.pTexture);
+
+		return true;
+	}
+
+	void TextureStreamer::DestroyRetired()
+	{
+		while (!_retired.empty() && _frame - _retired.front().RetiredFrame >= _options.RetireFrames)
+		{
+			_retired.front().pTexture->Destroy();
+			_retired.pop_front();
+		}
+	}
+
+	uint64 TextureStreamer::GetResidentBytes(const StreamedTexture& texture) const
+	{
+		uint64 bytes = 0;
+		for (uint level = texture.ResidentLevel; level < texture.LevelSizes.size(); level++)
+			bytes += texture.LevelSizes[level];
+
+		return bytes;
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "Texture2D.h"
+
+namespace SunEngine
+{
+	class Material;
+
+	//Loads textures on the thread pool and keeps only as many of their top mip levels on the GPU as the screen needs.
+	//The small tail of every chain is uploaded as soon as it is loaded, larger levels follow by screen coverage under a
+	//memory budget. Materials show a placeholder until the tail is resident.
+	class TextureStreamer
+	{
+	public:
+		struct Options
+		{
+			uint64 MemoryBudget; //bytes of GPU memory for every streamed chain, tails are always resident even over budget
+			uint TailSize; //levels no larger than this are the tail
+			uint MaxUploadsPerUpdate; //chains recreated per Update, tails of finished loads aren't counted
+			uint EvictFrames; //frames a texture keeps its last screen size after it was last seen
+			float TexelsPerPixel; //resolution wanted for each pixel an object covers on screen
+			uint RetireFrames; //Updates a replaced chain stays alive for, more than the frames the renderer keeps in flight
+
+			static const Options Default;
+		};
+
+		enum State
+		{
+			STATE_UNKNOWN,
+			STATE_LOADING,
+			STATE_STREAMING, //resident below the resolution the screen wants
+			STATE_RESIDENT, //resident at the resolution the screen wants
+			STATE_FAILED,
+		};
+
+		struct Status
+		{
+			uint Loading;
+			uint Streaming;
+			uint Resident;
+			uint Failed;
+			uint64 ResidentBytes;
+			uint64 WantedBytes; //memory the current screen coverage would use without a budget
+			uint64 MemoryBudget;
+		};
+
+		//Fills the full CPU mip chain of every texture in Textures, runs on a pool thread
+		class Job
+		{
+		public:
+			virtual ~Job() {}
+			virtual bool Load() = 0;
+
+			Vector<Texture2D*> Textures;
+		};
+
+		//One texture as seen by PlanResidency, levels are counted from the base image
+		struct PlanEntry
+		{
+			const uint64* pLevelSizes;
+			uint LevelCount;
+			uint Width;
+			uint TailLevel;
+			uint WantedLevel;
+			float ScreenSize;
+		};
+
+		static TextureStreamer& Get();
+
+		void SetOptions(const Options& options) { _options = options; }
+		const Options& GetOptions() const { return _options; }
+
+		//Takes ownership of the job, its textures must not be used until they leave STATE_LOADING. Textures already known
+		//are reloaded in place and keep their bindings, the job is deleted and rejected when one of them is still loading
+		bool Request(Job* pJob);
+
+		//pMaterial keeps its current texture until the tail of pTexture is resident and is rebound whenever the chain changes
+		void Bind(Material* pMaterial, const String& name, Texture2D* pTexture);
+
+		//Pixels covered on screen by an object drawn with pMaterial, the largest size each frame is kept
+		void SetScreenSize(const Material* pMaterial, float pixels);
+
+		//Call once per frame from the main thread, finishes loads and moves resident chains toward the plan
+		void Update();
+
+		Status GetStatus() const;
+		State GetState(const Texture2D* pTexture) const;
+
+		//Waits on loads in flight and forgets every texture, resident chains stay on the GPU and replaced ones are still
+		//destroyed by later Updates
+		void Clear();
+
+		//Picks the first resident level of every entry. Tails always fit, the remaining budget goes one level at a time
+		//to the entry with the most screen pixels per resident texel. Doesn't touch the GPU
+		static uint64 PlanResidency(const PlanEntry* pEntries, uint count, uint64 budget, Vector<uint>& firstLevels);
+
+		//Level of a width texel wide chain that best covers pixels on screen, clamped to [0, levelCount - 1]
+		static uint GetWantedLevel(uint width, uint levelCount, float pixels);
+
+	private:
+		struct Binding
+		{
+			Material* pMaterial;
+			String Name;
+		};
+
+		struct StreamedTexture
+		{
+			Texture2D* pTexture;
+			State CurrentState;
+			uint ResidentLevel;
+			uint WantedLevel;
+			uint TailLevel;
+			Vector<uint64> LevelSizes;
+			Vector<Binding> Bindings;
+			float ScreenSize;
+			uint LastSeenFrame;
+		};
+
+		struct PendingJob
+		{
+			UniquePtr<Job> pJob;
+			bool Loaded;
+			ThreadPool::Counter TaskCounter;
+		};
+
+		struct RetiredTexture
+		{
+			UniquePtr<BaseTexture> pTexture;
+			uint RetiredFrame;
+		};
+
+		TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator = (const TextureStreamer&) = delete;
+		~TextureStreamer();
+
+		void FinishLoad(StreamedTexture& texture, bool loaded);
+		void DestroyRetired();
+		bool Upload(StreamedTexture& texture, uint firstLevel);
+		uint64 GetResidentBytes(const StreamedTexture& texture) const;
+
+		Options _options;
+		uint _frame;
+		LinkedList<UniquePtr<PendingJob>> _jobs;
+		LinkedList<RetiredTexture> _retired;
+		Map<const Texture2D*, UniquePtr<StreamedTexture>> _textures;
+		Map<const Material*, Vector<StreamedTexture*>> _materials;
+	};
+}
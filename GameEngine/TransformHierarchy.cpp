@@ -0,0 +1,219 @@
+#include "MathHelper.h"
+#include "TransformHierarchy.h"
+
+#define INVALID_PARENT 0xFFFFFFFF
+#define LEVEL_GRAIN_SIZE 64
+#define BATCH_GRAIN_SIZE 256
+
+namespace SunEngine
+{
+	TransformHierarchy::TransformHierarchy()
+	{
+		_structureDirty = true;
+	}
+
+	TransformHierarchy::~TransformHierarchy()
+	{
+	}
+
+	void TransformHierarchy::Update(SceneNode* pRoot, Vector<SceneNode*>* pUpdatedNodes)
+	{
+		_roots.clear();
+		if (_structureDirty || _nodes.empty() || _nodes[0] != pRoot)
+		{
+			//queued nodes may have left the tree, every node is loaded again instead
+			Rebuild(pRoot);
+			for (auto& list : _dirtyRoots)
+				list.clear();
+
+			_roots.resize(_nodes.size());
+			for (uint i = 0; i < _nodes.size(); i++)
+				_roots[i] = i;
+		}
+		else
+		{
+			GatherRoots();
+		}
+
+		_updated.clear();
+		if (_roots.empty())
+			return;
+
+		//roots are sorted so neighbouring nodes are built from the arrays as one batch
+		ThreadPool::Get().ParallelForRange(0, _roots.size(), BATCH_GRAIN_SIZE, [&](uint, uint begin, uint end) -> void {
+			uint runBegin = begin;
+			for (uint i = begin; i < end; i++)
+			{
+				LoadTransform(_roots[i]);
+				if (i + 1 == end || _roots[i + 1] != _roots[i] + 1)
+				{
+					BuildLocalMatrices(_roots[runBegin], _roots[i] + 1);
+					runBegin = i + 1;
+				}
+			}
+		});
+
+		uint nextRoot = 0;
+		uint prevBegin = 0;
+		for (uint l = 0; l < _levels.size() - 1; l++)
+		{
+			uint levelBegin = _updated.size();
+
+			//children of the previous level's nodes come out sorted since children are stored in the order of their parents
+			for (uint i = prevBegin; i < levelBegin; i++)
+			{
+				uint parent = _updated[i];
+				for (uint c = _firstChild[parent]; c < _firstChild[parent] + _childCount[parent]; c++)
+				{
+					_dirty[c] = 1;
+					_updated.push_back(c);
+				}
+			}
+
+			uint childEnd = _updated.size();
+			for (; nextRoot < _roots.size() && _roots[nextRoot] < _levels[l + 1]; nextRoot++)
+			{
+				uint root = _roots[nextRoot];
+				if (!_dirty[root])
+				{
+					_dirty[root] = 1;
+					_updated.push_back(root);
+				}
+			}
+			std::inplace_merge(_updated.begin() + levelBegin, _updated.begin() + childEnd, _updated.end());
+
+			if (_updated.size() == levelBegin && nextRoot == _roots.size())
+				break;
+
+			//parents are all finished before the next level starts, nodes within a level only write their own entries
+			ThreadPool::Get().ParallelForRange(levelBegin, _updated.size(), LEVEL_GRAIN_SIZE, [&](uint, uint begin, uint end) -> void {
+				for (uint i = begin; i < end; i++)
+					UpdateNode(_updated[i]);
+			});
+			prevBegin = levelBegin;
+		}
+
+		for (uint i = 0; i < _updated.size(); i++)
+			_dirty[_updated[i]] = 0;
+
+		if (pUpdatedNodes)
+		{
+			for (uint i = 0; i < _updated.size(); i++)
+				pUpdatedNodes->push_back(_nodes[_updated[i]]);
+		}
+	}
+
+	void TransformHierarchy::Rebuild(SceneNode* pRoot)
+	{
+		_nodes.clear();
+		_parents.clear();
+		_firstChild.clear();
+		_childCount.clear();
+		_levels.clear();
+
+		//breadth first so each level is a contiguous range and the children of a node are next to each other
+		_nodes.push_back(pRoot);
+		_parents.push_back(INVALID_PARENT);
+		_levels.push_back(0);
+
+		uint levelBegin = 0;
+		while (levelBegin < _nodes.size())
+		{
+			uint levelEnd = _nodes.size();
+			for (uint i = levelBegin; i < levelEnd; i++)
+			{
+				_firstChild.push_back(_nodes.size());
+				for (auto iter = _nodes[i]->_children.begin(); iter != _nodes[i]->_children.end(); ++iter)
+				{
+					_nodes.push_back(static_cast<SceneNode*>(*iter));
+					_parents.push_back(i);
+				}
+				_childCount.push_back(_nodes.size() - _firstChild[i]);
+			}
+
+			_levels.push_back(levelEnd);
+			levelBegin = levelEnd;
+		}
+
+		for (uint i = 0; i < _nodes.size(); i++)
+			_nodes[i]->_hierarchyIndex = i;
+
+		uint count = _nodes.size();
+		_posX.resize(count); _posY.resize(count); _posZ.resize(count);
+		_scaleX.resize(count); _scaleY.resize(count); _scaleZ.resize(count);
+		_rotX.resize(count); _rotY.resize(count); _rotZ.resize(count); _rotW.resize(count);
+
+		_localMatrices.resize(count);
+		_worldMatrices.resize(count);
+		_dirty.assign(count, 0);
+		_structureDirty = false;
+	}
+
+	void TransformHierarchy::GatherRoots()
+	{
+		for (auto& list : _dirtyRoots)
+		{
+			for (uint i = 0; i < list.size(); i++)
+			{
+				//a node set from several threads in the same frame can be queued more than once
+				SceneNode* pNode = list[i];
+				if (pNode->_transformDirty)
+				{
+					pNode->_transformDirty = false;
+					_roots.push_back(pNode->_hierarchyIndex);
+				}
+			}
+			list.clear();
+		}
+
+		std::sort(_roots.begin(), _roots.end());
+	}
+
+	void TransformHierarchy::LoadTransform(uint index)
+	{
+		SceneNode* pNode = _nodes[index];
+		pNode->_transformDirty = false;
+
+		glm::quat rot = pNode->_orientation.GetQuat();
+		_posX[index] = pNode->_position.x;
+		_posY[index] = pNode->_position.y;
+		_posZ[index] = pNode->_position.z;
+		_scaleX[index] = pNode->_scale.x;
+		_scaleY[index] = pNode->_scale.y;
+		_scaleZ[index] = pNode->_scale.z;
+		_rotX[index] = rot.x;
+		_rotY[index] = rot.y;
+		_rotZ[index] = rot.z;
+		_rotW[index] = rot.w;
+	}
+
+	void TransformHierarchy::BuildLocalMatrices(uint begin, uint end)
+	{
+		TransformBatch batch;
+		batch.PosX = &_posX[begin];
+		batch.PosY = &_posY[begin];
+		batch.PosZ = &_posZ[begin];
+		batch.ScaleX = &_scaleX[begin];
+		batch.ScaleY = &_scaleY[begin];
+		batch.ScaleZ = &_scaleZ[begin];
+		batch.RotX = &_rotX[begin];
+		batch.RotY = &_rotY[begin];
+		batch.RotZ = &_rotZ[begin];
+		batch.RotW = &_rotW[begin];
+		batch.Count = end - begin;
+		BuildTransformMatrices(batch, &_localMatrices[begin]);
+	}
+
+	void TransformHierarchy::UpdateNode(uint index)
+	{
+		uint parent = _parents[index];
+		if (parent != INVALID_PARENT)
+			MultiplyMatrix(_worldMatrices[parent], _localMatrices[index], _worldMatrices[index]);
+		else
+			_worldMatrices[index] = _localMatrices[index];
+
+		SceneNode* pNode = _nodes[index];
+		pNode->_localMatrix = _localMatrices[index];
+		pNode->_worldMatrix = _worldMatrices[index];
+	}
+}
\ No newline at end of file
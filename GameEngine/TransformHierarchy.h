@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "SceneNode.h"
+
+namespace SunEngine
+{
+	//Flattened copy of a scene's node tree, sorted by depth so every parent comes before its children.
+	//Nodes queue themselves when a transform setter is called, each Update only rebuilds those nodes and their descendants one level at a time on the thread pool.
+	class TransformHierarchy
+	{
+	public:
+		TransformHierarchy();
+		~TransformHierarchy();
+
+		//Forces the flattened arrays to be rebuilt from the node tree in the next Update, call when nodes are added, removed or reparented
+		void MarkStructureDirty() { _structureDirty = true; }
+
+		//Queues a node whose local transform was set, safe to call from any thread
+		void MarkDirty(SceneNode* pNode) { _dirtyRoots[ThreadPool::Get().GetCurrentThreadIndex()].push_back(pNode); }
+
+		//Appends the nodes whose world matrix was rebuilt to pUpdatedNodes when it's set
+		void Update(SceneNode* pRoot, Vector<SceneNode*>* pUpdatedNodes = 0);
+
+		uint GetNodeCount() const { return _nodes.size(); }
+
+	private:
+		void Rebuild(SceneNode* pRoot);
+		void GatherRoots();
+		void LoadTransform(uint index);
+		void BuildLocalMatrices(uint begin, uint end);
+		void UpdateNode(uint index);
+
+		Vector<SceneNode*> _nodes;
+		Vector<uint> _parents;
+		Vector<uint> _firstChild;
+		Vector<uint> _childCount;
+		Vector<uint> _levels;
+
+		//local position, scale and rotation in the same order as _nodes so runs of dirty nodes go through BuildTransformMatrices as one batch
+		Vector<float> _posX, _posY, _posZ;
+		Vector<float> _scaleX, _scaleY, _scaleZ;
+		Vector<float> _rotX, _rotY, _rotZ, _rotW;
+
+		Vector<glm::mat4> _localMatrices;
+		Vector<glm::mat4> _worldMatrices;
+		Vector<uchar> _dirty;
+
+		PerThreadData<Vector<SceneNode*>> _dirtyRoots;
+		Vector<uint> _roots;
+		Vector<uint> _updated;
+		bool _structureDirty;
+	};
+}
\ No newline at end of file
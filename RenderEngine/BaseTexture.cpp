@@ -3,6 +3,19 @@
 
 namespace SunEngine
 {
+	static uint GetTexelSize(uint flags)
+	{
+		switch (GetImageFormat(flags))
+		{
+		case ImageData::NONE: return sizeof(Pixel);
+		case ImageData::SAMPLED_TEXTURE_R32G32B32A32F: return sizeof(float) * 4;
+		case ImageData::SAMPLED_TEXTURE_R16G16B16A16F: return sizeof(ushort) * 4;
+		case ImageData::SAMPLED_TEXTURE_R16: return sizeof(ushort);
+		case ImageData::SAMPLED_TEXTURE_R8G8: return sizeof(uchar) * 2;
+		default: return 0;
+		}
+	}
+
 	BaseTexture::CreateInfo::CreateInfo()
 	{
 		pImages = 0;
@@ -79,6 +92,80 @@ namespace SunEngine
 		return true;
 	}
 
+	bool BaseTexture::UpdateRegion(const ImageData& image, uint x, uint y, uint width, uint height, uint layer)
+	{
+		ITextureUpdateInfo apiInfo;
+		if (!GetUpdateInfo(image, x, y, width, height, layer, apiInfo))
+			return false;
+
+		if (!_iTexture->Update(apiInfo))
+		{
+			_errStr = "Failed to update API Texture";
+			return false;
+		}
+
+		return true;
+	}
+
+	bool BaseTexture::GetUpdateInfo(const ImageData& image, uint x, uint y, uint width, uint height, uint layer, ITextureUpdateInfo& apiInfo)
+	{
+		if (!_iTexture || !image.Pixels)
+			return false;
+
+		if (image.Width != _width || image.Height != _height || width == 0 || height == 0 || x + width > _width || y + height > _height)
+			return false;
+
+		uint texelSize = GetTexelSize(image.Flags);
+		if (texelSize == 0)
+		{
+			_errStr = "Texture format can't be updated";
+			return false;
+		}
+
+		apiInfo = {};
+		apiInfo.rowPitch = image.Width * texelSize;
+		apiInfo.rowSize = width * texelSize;
+		apiInfo.pData = (const uchar*)image.Pixels + y * apiInfo.rowPitch + x * texelSize;
+		apiInfo.x = x;
+		apiInfo.y = y;
+		apiInfo.width = width;
+		apiInfo.height = height;
+		apiInfo.layer = layer;
+		return true;
+	}
+
+	void BaseTexture::Swap(BaseTexture& other)
+	{
+		std::swap(_iTexture, other._iTexture);
+		std::swap(_width, other._width);
+		std::swap(_height, other._height);
+		std::swap(_errStr, other._errStr);
+	}
+
+	bool TextureUploadBatch::Add(BaseTexture* pTexture, const ImageData& image, uint x, uint y, uint width, uint height, uint layer)
+	{
+		ITextureUpdateInfo apiInfo;
+		if (!pTexture->GetUpdateInfo(image, x, y, width, height, layer, apiInfo))
+			return false;
+
+		_textures.push_back(pTexture->_iTexture);
+		_infos.push_back(apiInfo);
+		return true;
+	}
+
+	bool TextureUploadBatch::Submit()
+	{
+		bool updated = ITexture::UpdateBatch(_textures.data(), _infos.data(), _infos.size());
+		_textures.clear();
+		_infos.clear();
+		return updated;
+	}
+
+	bool TextureUploadBatch::IsEmpty() const
+	{
+		return _infos.empty();
+	}
+
 	IObject* BaseTexture::GetAPIHandle() const
 	{
 		return _iTexture;
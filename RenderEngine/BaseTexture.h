@@ -29,14 +29,42 @@ namespace SunEngine
 		bool Create(const CreateInfo &info);
 		bool Destroy() override;
 
+		//Uploads the width x height rectangle at x, y of image to the base level of layer without recreating the texture, so
+		//bindings stay valid. image is the texture's full size base image, compressed images can't be updated.
+		bool UpdateRegion(const ImageData& image, uint x, uint y, uint width, uint height, uint layer = 0);
+
+		//Exchanges the API textures of both objects, so a texture can be rebuilt next to the one in use and swapped in
+		void Swap(BaseTexture& other);
+
 		IObject* GetAPIHandle() const override;
 
 		uint GetWidth() const;
 		uint GetHeight() const;
 	private:
+		friend class TextureUploadBatch;
+
+		bool GetUpdateInfo(const ImageData& image, uint x, uint y, uint width, uint height, uint layer, ITextureUpdateInfo& info);
+
 		ITexture* _iTexture;
 		uint _width;
 		uint _height;
 	};
 
+	//Region updates of any number of textures that go to the GPU together, on Vulkan through one staging buffer and one
+	//submit. The images given to Add are read by Submit, so they have to stay alive and unchanged until then.
+	class TextureUploadBatch
+	{
+	public:
+		//Fails like BaseTexture::UpdateRegion would, the batch is unchanged then
+		bool Add(BaseTexture* pTexture, const ImageData& image, uint x, uint y, uint width, uint height, uint layer = 0);
+
+		//Uploads every region added since the last Submit and empties the batch, also when the upload fails
+		bool Submit();
+
+		bool IsEmpty() const;
+	private:
+		Vector<ITexture*> _textures;
+		Vector<ITextureUpdateInfo> _infos;
+	};
+
 }
\ No newline at end of file
@@ -94,6 +94,22 @@ namespace SunEngine
 				subDataArray[i].SysMemPitch /= 1;
 			}
 		}
+		else if (flags & ImageData::COMPRESSED_BC4)
+		{
+			texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+			for (uint i = 0; i < subDataArray.size(); i++)
+			{
+				subDataArray[i].SysMemPitch /= 2;
+			}
+		}
+		else if (flags & ImageData::COMPRESSED_BC5)
+		{
+			texDesc.Format = DXGI_FORMAT_BC5_UNORM;
+		}
+		else if (flags & ImageData::COMPRESSED_BC7)
+		{
+			texDesc.Format = DXGI_FORMAT_BC7_UNORM;
+		}
 		else if (flags & ImageData::SAMPLED_TEXTURE_R32F)
 		{
 			texDesc.Format = DXGI_FORMAT_R32_FLOAT;
@@ -106,6 +122,30 @@ namespace SunEngine
 				subDataArray[i].SysMemPitch *= 4;
 			}
 		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R16G16B16A16F)
+		{
+			texDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			for (uint i = 0; i < subDataArray.size(); i++)
+			{
+				subDataArray[i].SysMemPitch *= 2;
+			}
+		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R16)
+		{
+			texDesc.Format = DXGI_FORMAT_R16_UNORM;
+			for (uint i = 0; i < subDataArray.size(); i++)
+			{
+				subDataArray[i].SysMemPitch /= 2;
+			}
+		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R8G8)
+		{
+			texDesc.Format = DXGI_FORMAT_R8G8_UNORM;
+			for (uint i = 0; i < subDataArray.size(); i++)
+			{
+				subDataArray[i].SysMemPitch /= 2;
+			}
+		}
 
 		if (flags & ImageData::WRITABLE)
 			texDesc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
@@ -115,6 +155,7 @@ namespace SunEngine
 			if (texDesc.Format == DXGI_FORMAT_R8G8B8A8_UNORM) texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 			else if (texDesc.Format == DXGI_FORMAT_BC1_UNORM) texDesc.Format = DXGI_FORMAT_BC1_UNORM_SRGB;
 			else if (texDesc.Format == DXGI_FORMAT_BC3_UNORM) texDesc.Format = DXGI_FORMAT_BC3_UNORM_SRGB;
+			else if (texDesc.Format == DXGI_FORMAT_BC7_UNORM) texDesc.Format = DXGI_FORMAT_BC7_UNORM_SRGB;
 		}
 
 		if (flags & ImageData::MULTI_SAMPLES_2) _device->FillSampleDesc(texDesc.Format, 2, texDesc.SampleDesc);
@@ -203,6 +244,23 @@ namespace SunEngine
 		return true;
 	}
 
+	bool D3D11Texture::Update(const ITextureUpdateInfo& info)
+	{
+		if (_external)
+			return false;
+
+		D3D11_TEXTURE2D_DESC desc;
+		_texture->GetDesc(&desc);
+
+		D3D11_BOX box = {};
+		box.left = info.x;
+		box.top = info.y;
+		box.right = info.x + info.width;
+		box.bottom = info.y + info.height;
+		box.back = 1;
+		return _device->UpdateSubresource(_texture, D3D11CalcSubresource(0, info.layer, desc.MipLevels), &box, info.pData, info.rowPitch, 0);
+	}
+
 	void D3D11Texture::Bind(ICommandBuffer * cmdBuffer, IBindState*)
 	{
 		(void)cmdBuffer;
@@ -13,6 +13,7 @@ namespace SunEngine
 		~D3D11Texture();
 
 		bool Create(const ITextureCreateInfo& info) override;
+		bool Update(const ITextureUpdateInfo& info) override;
 		void Bind(ICommandBuffer* cmdBuffer, IBindState* pBindState) override;
 		void Unbind(ICommandBuffer* cmdBuffer) override;
 		void BindToShader(D3D11CommandBuffer* cmdBuffer, D3D11Shader* pShader, const String& name, uint binding, IBindState* pBindState) override;
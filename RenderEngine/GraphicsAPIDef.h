@@ -153,6 +153,18 @@ namespace SunEngine
 		uint numImages;
 	};
 
+	struct ITextureUpdateInfo
+	{
+		const void* pData; //first texel of the region
+		uint rowPitch; //bytes between the rows in pData
+		uint rowSize; //bytes of one row of the region
+		uint x;
+		uint y;
+		uint width;
+		uint height;
+		uint layer;
+	};
+
 	enum ShaderResourceType
 	{
 		SRT_UNDEFINED,
@@ -27,4 +27,21 @@ namespace SunEngine
 		}
 	}
 
+	bool ITexture::UpdateBatch(ITexture* const* ppTextures, const ITextureUpdateInfo* pInfos, uint count)
+	{
+		switch (GetGraphicsAPI())
+		{
+		case SunEngine::SE_GFX_VULKAN:
+			return VulkanTexture::UpdateBatch(ppTextures, pInfos, count);
+		default:
+			//the D3D11 immediate context queues the copies itself
+			for (uint i = 0; i < count; i++)
+			{
+				if (!ppTextures[i]->Update(pInfos[i]))
+					return false;
+			}
+			return true;
+		}
+	}
+
 }
\ No newline at end of file
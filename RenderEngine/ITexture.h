@@ -11,7 +11,11 @@ namespace SunEngine
 		virtual ~ITexture();
 
 		virtual bool Create(const ITextureCreateInfo& info) = 0;
+		virtual bool Update(const ITextureUpdateInfo& info) = 0;
 
 		static ITexture* Allocate(GraphicsAPI api);
+
+		//Uploads pInfos[i] to ppTextures[i] for every i, with as few submits as the current API allows
+		static bool UpdateBatch(ITexture* const* ppTextures, const ITextureUpdateInfo* pInfos, uint count);
 	};
 }
\ No newline at end of file
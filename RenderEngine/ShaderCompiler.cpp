@@ -4,6 +4,7 @@
 #include <assert.h>
 #include "GraphicsAPIDef.h"
 #include "FileBase.h"
+#include "MappedFileStream.h"
 #include "StringUtil.h"
 #include "BaseShader.h"
 
@@ -689,16 +690,19 @@ namespace SunEngine
 		stream.Close();
 		return false;
 	}
+
+	bool CloseStreamFunc(MappedFileStream& stream)
+	{
+		stream.Close();
+		return false;
+	}
 #define CLOSE_AND_RETURN return CloseStreamFunc(stream)
 
 	bool ShaderCompiler::MatchesCachedFile(const String& path, uint stageFlags)
 	{
-		FileStream stream;
-		if (!stream.OpenForRead(path.c_str()))
-		{
-			stream.Close();
+		MappedFileStream stream;
+		if (!stream.Open(path.c_str()))
 			return false;
-		}
 
 		uint version;
 		if (!stream.Read(version))
@@ -726,15 +730,20 @@ namespace SunEngine
 			if (!stream.Read(currStage))
 				CLOSE_AND_RETURN;
 
-			String currText;
-			if (!stream.Read(currText))
+			//the cached text is compared in place in the mapping
+			uint textLength;
+			if (!stream.Read(textLength))
+				CLOSE_AND_RETURN;
+
+			const char* pText = (const char*)stream.ReadView(textLength);
+			if (textLength && !pText)
 				CLOSE_AND_RETURN;
 
 			auto found = _hlslShaderText.find(ShaderStage(currStage));
 			if (found == _hlslShaderText.end())
 				CLOSE_AND_RETURN;
 
-			if (currText != (*found).second)
+			if ((*found).second.compare(0, String::npos, pText, textLength) != 0)
 				CLOSE_AND_RETURN;
 		}
 
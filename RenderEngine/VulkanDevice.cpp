@@ -857,6 +857,102 @@ namespace SunEngine
 		return true;
 	}
 
+	bool VulkanDevice::TransferImageRegions(const VkImage* pImages, const VkImageLayout* pLayouts, const ITextureUpdateInfo* pInfos, uint count)
+	{
+		if (count == 0)
+			return true;
+
+		//every region gets its own range of one staging buffer, offsets are multiples of four texels so they suit both the
+		//texel size and the four byte alignment copies need
+		Vector<VkDeviceSize> offsets(count);
+		VkDeviceSize size = 0;
+		for (uint i = 0; i < count; i++)
+		{
+			VkDeviceSize alignment = (pInfos[i].rowSize / pInfos[i].width) * 4;
+			offsets[i] = ((size + alignment - 1) / alignment) * alignment;
+			size = offsets[i] + pInfos[i].rowSize * pInfos[i].height;
+		}
+
+		VkCommandBufferBeginInfo cmdInfo = {};
+		cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VkBuffer transferSrc;
+		MemoryHandle transferMem;
+		VkBufferCreateInfo transferInfo = {};
+		transferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		transferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		transferInfo.size = size;
+		transferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		if (!CreateBuffer(transferInfo, &transferSrc)) return false;
+		if (!AllocBufferMemory(transferSrc, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &transferMem)) return false;
+
+		//the rows of a region are packed, the source rows are strided by the width of the whole image
+		void* deviceMem = 0;
+		MapMemory(transferMem, 0, size, 0, &deviceMem);
+		for (uint i = 0; i < count; i++)
+		{
+			const ITextureUpdateInfo& info = pInfos[i];
+			uchar* pDst = (uchar*)deviceMem + offsets[i];
+			for (uint y = 0; y < info.height; y++)
+				memcpy(pDst + y * info.rowSize, (const uchar*)info.pData + y * info.rowPitch, info.rowSize);
+		}
+		UnmapMemory(transferMem);
+
+		CheckVkResult(vkBeginCommandBuffer(_utilCmd, &cmdInfo));
+		for (uint i = 0; i < count; i++)
+		{
+			const ITextureUpdateInfo& info = pInfos[i];
+
+			//the image keeps its contents outside the region, so the barriers start from its current layout instead of undefined.
+			//Earlier frames reading the image are finished before the copy by the all commands source stage. Each region
+			//transitions on its own so the same layer can appear more than once in a batch
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.image = pImages[i];
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseArrayLayer = info.layer;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.subresourceRange.levelCount = 1;
+
+			barrier.oldLayout = pLayouts[i];
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(_utilCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+			VkBufferImageCopy buffCopy = {};
+			buffCopy.bufferOffset = offsets[i];
+			buffCopy.imageOffset.x = info.x;
+			buffCopy.imageOffset.y = info.y;
+			buffCopy.imageExtent.width = info.width;
+			buffCopy.imageExtent.height = info.height;
+			buffCopy.imageExtent.depth = 1;
+			buffCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			buffCopy.imageSubresource.layerCount = 1;
+			buffCopy.imageSubresource.baseArrayLayer = info.layer;
+			vkCmdCopyBufferToImage(_utilCmd, transferSrc, pImages[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &buffCopy);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = pLayouts[i];
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(_utilCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+		}
+		CheckVkResult(vkEndCommandBuffer(_utilCmd));
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &_utilCmd;
+		CheckVkResult(vkQueueSubmit(_queue._queue, 1, &submitInfo, _utilFence));
+		if (!ProcessFences(&_utilFence, 1, UINT64_MAX, true)) return false;
+
+		FreeMemory(transferMem);
+		DestroyBuffer(transferSrc);
+		return true;
+	}
+
 	void VulkanDevice::FreeMemory(MemoryHandle memory)
 	{
 		_allocator->FreeMemory(memory);
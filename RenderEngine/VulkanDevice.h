@@ -76,6 +76,8 @@ namespace SunEngine
 		void UnmapMemory(MemoryHandle memory);
 		//bool TransferImageData(VkImage image, const ImageData& baseImg, uint mipCount, const ImageData* pMipData);
 		bool TransferImageData(VkImage image, const ImageData* baseImages, uint arrayCount, uint mipCount, VkImageLayout endLayout);
+		//Copies every region to its image through one staging buffer and one submit, pInfos[i] goes to pImages[i]
+		bool TransferImageRegions(const VkImage* pImages, const VkImageLayout* pLayouts, const ITextureUpdateInfo* pInfos, uint count);
 		void FreeMemory(MemoryHandle memory);
 		void FreeCommandBuffer(VkCommandBuffer cmdBuffer);
 		bool SetImageLayout(VkImage image, uint arrayCount, uint mipCount, VkImageLayout oldLayout, VkImageLayout newLayout);
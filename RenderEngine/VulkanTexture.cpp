@@ -103,6 +103,18 @@ namespace SunEngine
 		{
 			imgInfo.format = VK_FORMAT_BC3_UNORM_BLOCK;
 		}
+		else if (flags & ImageData::COMPRESSED_BC4)
+		{
+			imgInfo.format = VK_FORMAT_BC4_UNORM_BLOCK;
+		}
+		else if (flags & ImageData::COMPRESSED_BC5)
+		{
+			imgInfo.format = VK_FORMAT_BC5_UNORM_BLOCK;
+		}
+		else if (flags & ImageData::COMPRESSED_BC7)
+		{
+			imgInfo.format = VK_FORMAT_BC7_UNORM_BLOCK;
+		}
 		else if (flags & ImageData::SAMPLED_TEXTURE_R32F)
 		{
 			imgInfo.format = VK_FORMAT_R32_SFLOAT;
@@ -111,6 +123,18 @@ namespace SunEngine
 		{
 			imgInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT; //TODO: not sure if this needs more work on vulkan side, haven't tested
 		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R16G16B16A16F)
+		{
+			imgInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R16)
+		{
+			imgInfo.format = VK_FORMAT_R16_UNORM;
+		}
+		else if (flags & ImageData::SAMPLED_TEXTURE_R8G8)
+		{
+			imgInfo.format = VK_FORMAT_R8G8_UNORM;
+		}
 
 		if (flags & ImageData::WRITABLE)
 			imgInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
@@ -121,6 +145,7 @@ namespace SunEngine
 			else if (imgInfo.format == VK_FORMAT_B8G8R8A8_UNORM) imgInfo.format = VK_FORMAT_B8G8R8A8_SRGB;
 			else if (imgInfo.format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK) imgInfo.format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
 			else if (imgInfo.format == VK_FORMAT_BC3_UNORM_BLOCK) imgInfo.format = VK_FORMAT_BC3_SRGB_BLOCK;
+			else if (imgInfo.format == VK_FORMAT_BC7_UNORM_BLOCK) imgInfo.format = VK_FORMAT_BC7_SRGB_BLOCK;
 		}
 
 		if (!_device->CreateImage(imgInfo, &_image)) return false;
@@ -180,6 +205,34 @@ namespace SunEngine
 		return true;
 	}
 
+	bool VulkanTexture::Update(const ITextureUpdateInfo& info)
+	{
+		if (_external)
+			return false;
+
+		return _device->TransferImageRegions(&_image, &_layout, &info, 1);
+	}
+
+	bool VulkanTexture::UpdateBatch(ITexture* const* ppTextures, const ITextureUpdateInfo* pInfos, uint count)
+	{
+		if (count == 0)
+			return true;
+
+		Vector<VkImage> images(count);
+		Vector<VkImageLayout> layouts(count);
+		for (uint i = 0; i < count; i++)
+		{
+			VulkanTexture* pTexture = static_cast<VulkanTexture*>(ppTextures[i]);
+			if (pTexture->_external)
+				return false;
+
+			images[i] = pTexture->_image;
+			layouts[i] = pTexture->_layout;
+		}
+
+		return static_cast<VulkanTexture*>(ppTextures[0])->_device->TransferImageRegions(images.data(), layouts.data(), pInfos, count);
+	}
+
 	bool VulkanTexture::Destroy()
 	{
 		_device->DestroyImageView(_view);
@@ -12,8 +12,12 @@ namespace SunEngine
 		~VulkanTexture();
 
 		bool Create(const ITextureCreateInfo& info) override;
+		bool Update(const ITextureUpdateInfo& info) override;
 		bool Destroy() override;
 
+		//Uploads pInfos[i] to ppTextures[i] for every i with one submit, all textures are VulkanTextures of the same device
+		static bool UpdateBatch(ITexture* const* ppTextures, const ITextureUpdateInfo* pInfos, uint count);
+
 		void Bind(ICommandBuffer* cmdBuffer, IBindState*) override;
 		void Unbind(ICommandBuffer* cmdBuffer) override;
 		inline VkImageView GetView() const { return _view; }
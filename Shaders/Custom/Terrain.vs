@@ -1,21 +1,32 @@
 #include "ObjectBuffer.hlsl"
 #include "CameraBuffer.hlsl"
 
+//the object buffer's normal matrix holds the LOD patch being drawn, see Terrain::SelectPatches. Patch positions are in
+//height map samples, the vertex positions are coordinates on the patch grid
+#define PATCH_ORIGIN NormalMatrix[0].xy
+#define PATCH_SPACING NormalMatrix[0].z
+#define SAMPLE_MAX NormalMatrix[0].w
+#define MORPH_RANGE NormalMatrix[1].xy
+#define SAMPLE_TO_LOCAL NormalMatrix[1].zw
+#define LOD_OBSERVER NormalMatrix[2].xyz
+#define HEIGHT_RANGE NormalMatrix[3].xy
+#define PACKED_NORMALS NormalMatrix[3].z
+#define WINDOW_ORIGIN float2(NormalMatrix[2].w, NormalMatrix[3].w)
+
 struct VS_In
 {
 	float4 position : POSITION;
-	float4 normal : NORMAL;
 };
 
 struct PS_In
 {
 	float4 clipPos : SV_POSITION;
-#ifndef DEPTH		
+#ifndef DEPTH
 	float4 position : POSITION;
 	float4 normal : NORMAL;
 	float4 tangent : TANGENT;
-	float2 texCoord : TEXCOORD;
-#endif	
+	float4 texCoord : TEXCOORD;
+#endif
 };
 
 cbuffer MaterialBuffer
@@ -24,17 +35,74 @@ cbuffer MaterialBuffer
 	float4 TextureTiling[MAX_TERRAIN_SPLAT_MAPS];
 };
 
+Texture2D HeightMap;
+Texture2D PackedNormalMap;
+
+//heights are unorm over the terrain's height range
+float LoadHeight(int2 sampleCoord)
+{
+	return HEIGHT_RANGE.x + HeightMap.Load(int3(clamp(sampleCoord, 0, (int)SAMPLE_MAX), 0)).r * HEIGHT_RANGE.y;
+}
+
+float3 DecodeOctahedral(float2 encoded)
+{
+	float2 p = encoded * 2.0 - 1.0;
+	float3 normal = float3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+	if (normal.y < 0.0)
+		normal.xz = (1.0 - abs(normal.zx)) * (normal.xz >= 0.0 ? 1.0 : -1.0);
+	return normalize(normal);
+}
+
+float SampleHeight(float2 samplePos)
+{
+	int2 coord = (int2)floor(samplePos);
+	float2 t = samplePos - coord;
+	float h0 = lerp(LoadHeight(coord), LoadHeight(coord + int2(1, 0)), t.x);
+	float h1 = lerp(LoadHeight(coord + int2(0, 1)), LoadHeight(coord + int2(1, 1)), t.x);
+	return lerp(h0, h1, t.y);
+}
+
 PS_In main(VS_In vIn)
 {
 	PS_In pIn;
-#ifndef DEPTH		
-	pIn.position = mul(mul(vIn.position, WorldMatrix), ViewMatrix);
-	pIn.normal = mul(mul(float4(vIn.normal.xyz, 0.0), WorldMatrix), ViewMatrix);
-	pIn.tangent = mul(mul(float4(vIn.normal.yxz * float3(1,-1,1), 0.0), WorldMatrix), ViewMatrix);
-	pIn.clipPos  = mul(pIn.position, ProjectionMatrix);	
-	pIn.texCoord = vIn.position.xz * PosToUV.xy + PosToUV.zw;
+
+	//odd grid vertices slide onto their even neighbours as the vertex nears the end of the patch's range, so the grid
+	//matches the next coarser level where the patch borders it
+	float2 gridPos = vIn.position.xz;
+	float2 samplePos = PATCH_ORIGIN + gridPos * PATCH_SPACING;
+	float3 observerDelta = float3(samplePos.x, LoadHeight((int2)samplePos), samplePos.y) - LOD_OBSERVER;
+	float morph = saturate((length(observerDelta) - MORPH_RANGE.x) / (MORPH_RANGE.y - MORPH_RANGE.x));
+	gridPos -= frac(gridPos * 0.5) * 2.0 * morph;
+	samplePos = clamp(PATCH_ORIGIN + gridPos * PATCH_SPACING, 0.0, SAMPLE_MAX);
+
+	//a streamed terrain's height map is a window whose first sample is WINDOW_ORIGIN in the world's samples
+	float2 windowPos = samplePos * SAMPLE_TO_LOCAL.x + SAMPLE_TO_LOCAL.y;
+	float2 localPos = windowPos + WINDOW_ORIGIN * SAMPLE_TO_LOCAL.x;
+	float4 position = float4(localPos.x, SampleHeight(samplePos), localPos.y, 1.0);
+
+#ifndef DEPTH
+	int2 coord = (int2)round(samplePos);
+	float3 normal;
+	if (PACKED_NORMALS)
+	{
+		normal = DecodeOctahedral(PackedNormalMap.Load(int3(coord, 0)).rg);
+	}
+	else
+	{
+		normal.x = LoadHeight(coord + int2(1, 0)) - LoadHeight(coord - int2(1, 0));
+		normal.z = LoadHeight(coord + int2(0, 1)) - LoadHeight(coord - int2(0, 1));
+		normal.y = 2.0;
+		normal = normalize(normal);
+	}
+
+	pIn.position = mul(mul(position, WorldMatrix), ViewMatrix);
+	pIn.normal = mul(mul(float4(normal, 0.0), WorldMatrix), ViewMatrix);
+	pIn.tangent = mul(mul(float4(normal.yxz * float3(1,-1,1), 0.0), WorldMatrix), ViewMatrix);
+	pIn.clipPos  = mul(pIn.position, ProjectionMatrix);
+	//splats cover the window, detail textures tile over the world so they stay put when the window moves
+	pIn.texCoord = float4(windowPos * PosToUV.xy + PosToUV.zw, position.xz * PosToUV.xy + PosToUV.zw);
 #else
-	pIn.clipPos = mul(mul(vIn.position, WorldMatrix), ViewProjectionMatrix);
+	pIn.clipPos = mul(mul(position, WorldMatrix), ViewProjectionMatrix);
 #endif
 	return pIn;
 }
\ No newline at end of file
@@ -68,6 +68,15 @@ float3 decodeNormal(float2 enc)
     return n;
 }
 
+//normal maps can be BC5 which only stores xy, z is rebuilt from the unit length
+float3 UnpackNormalMap(float2 xy)
+{
+    float3 n;
+    n.xy = xy*2-1;
+    n.z = sqrt(saturate(1-dot(n.xy,n.xy)));
+    return n;
+}
+
 //from http://diaryofagraphicsprogrammer.blogspot.com/2009/10/bitmasks-packing-data-into-fp-render.html
 float encodeColor(float3 channel)
 {
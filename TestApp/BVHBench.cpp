@@ -0,0 +1,365 @@
+#include <math.h>
+#include "MathHelper.h"
+#include "SpatialVolumes.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	const float WorldSize = 2000.0f;
+	const uint QueryCount = 200;
+	const uint RayCount = 2000;
+
+	//The quadtree the scene used before the BVH, kept as the baseline. Cells are fixed, objects go to the deepest cell that
+	//fully contains them and node bounds only grow as objects are added
+	class BaselineQuadTree
+	{
+	public:
+		struct Node
+		{
+			void Reset()
+			{
+				parent = 0;
+				children = 0;
+				objects.clear();
+				bounds.Reset();
+			}
+
+			AABB box;
+			AABB bounds;
+			Node* parent;
+			Node* children;
+			LinkedList<uint> objects;
+		};
+
+		typedef bool(*TraverseFunc)(const Node& node, void* pData);
+
+		void Create(const AABB& box, uint depth)
+		{
+			uint nodeCount = 0;
+			for (uint i = 0; i <= depth; i++)
+				nodeCount += (uint)powf((float)ChildCount, (float)i);
+
+			_nodes.resize(nodeCount);
+			for (uint i = 0; i < nodeCount; i++)
+				_nodes[i].Reset();
+			_objectEntries.clear();
+
+			uint nodeOffset = 1;
+			Create(&_nodes[0], box, (int)depth, nodeOffset);
+		}
+
+		bool Insert(uint object, const AABB& box)
+		{
+			if (_nodes.empty() || !_nodes[0].box.Contains(box))
+				return false;
+
+			Node* node = &_nodes[0];
+			Node* child = FindChild(node, box);
+			while (child)
+			{
+				node = child;
+				child = FindChild(node, box);
+			}
+
+			node->objects.push_back(object);
+			_objectEntries[object] = node;
+
+			while (node && !node->bounds.Contains(box))
+			{
+				node->bounds.Expand(box);
+				node = node->parent;
+			}
+			return true;
+		}
+
+		void Traverse(TraverseFunc func, void* pData) const
+		{
+			if (_nodes.size())
+				Traverse(&_nodes[0], func, pData);
+		}
+
+	private:
+		static const uint ChildCount = 4;
+
+		AABB BuildChildBox(uint index, const AABB& parentBox) const
+		{
+			glm::vec3 signs;
+			signs.x = (index & 1) ? 1.0f : -1.0f;
+			signs.z = (index & 2) ? 1.0f : -1.0f;
+			signs.y = 1.0f;
+
+			glm::vec3 step = parentBox.GetExtent() * 0.5f;
+			glm::vec3 center = parentBox.GetCenter() + step * signs;
+
+			AABB box = AABB(center - step, center + step);
+			box.Min.y = parentBox.Min.y;
+			box.Max.y = parentBox.Max.y;
+			return box;
+		}
+
+		void Create(Node* node, const AABB& box, int depth, uint& nodeOffset)
+		{
+			node->box = box;
+			if (depth != 0)
+			{
+				node->children = &_nodes[nodeOffset];
+				nodeOffset += ChildCount;
+				for (uint i = 0; i < ChildCount; i++)
+				{
+					node->children[i].parent = node;
+					Create(&node->children[i], BuildChildBox(i, box), depth - 1, nodeOffset);
+				}
+			}
+		}
+
+		Node* FindChild(Node* node, const AABB& box)
+		{
+			if (node->children)
+			{
+				for (uint i = 0; i < ChildCount; i++)
+				{
+					if (node->children[i].box.Contains(box))
+						return &node->children[i];
+				}
+			}
+			return 0;
+		}
+
+		void Traverse(const Node* node, TraverseFunc func, void* pData) const
+		{
+			if (!func(*node, pData))
+				return;
+
+			if (node->children)
+			{
+				for (uint i = 0; i < ChildCount; i++)
+					Traverse(&node->children[i], func, pData);
+			}
+		}
+
+		Vector<Node> _nodes;
+		Map<uint, Node*> _objectEntries;
+	};
+
+	//The depth and padding the scene created the quadtree with
+	const uint QuadTreeDepth = 2;
+	const float QuadTreePadding = 0.25f;
+
+	//Distance along the ray to where it enters the box, the ray starting inside counts as zero
+	bool RayBoxDistance(const Ray& ray, const AABB& box, float tMax, float& t)
+	{
+		glm::vec3 invDir = 1.0f / ray.Direction;
+		glm::vec3 t0 = (box.Min - ray.Origin) * invDir;
+		glm::vec3 t1 = (box.Max - ray.Origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		t = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+		return t <= glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+	}
+
+	struct BoxQuery
+	{
+		const Vector<AABB>* pBoxes;
+		AABB Box;
+		uint Hits;
+	};
+
+	struct RayQuery
+	{
+		const Vector<AABB>* pBoxes;
+		Ray QueryRay;
+		float Nearest;
+		uint NearestObject;
+	};
+
+	uint RunQuadTreeBoxQuery(const BaselineQuadTree& tree, BoxQuery& query)
+	{
+		query.Hits = 0;
+		tree.Traverse([](const BaselineQuadTree::Node& node, void* pData) -> bool {
+			BoxQuery* pQuery = static_cast<BoxQuery*>(pData);
+			if (!node.bounds.IsValid() || !pQuery->Box.Intersects(node.bounds))
+				return false;
+
+			for (uint object : node.objects)
+				pQuery->Hits += pQuery->Box.Intersects((*pQuery->pBoxes)[object]) ? 1 : 0;
+			return true;
+		}, &query);
+		return query.Hits;
+	}
+
+	uint RunBVHBoxQuery(const BVH<uint>& bvh, BoxQuery& query)
+	{
+		query.Hits = 0;
+		bvh.Traverse([](const AABB& box, void* pData) -> bool { return static_cast<BoxQuery*>(pData)->Box.Intersects(box); }, &query,
+			[](const uint& object, void* pData) -> void {
+				BoxQuery* pQuery = static_cast<BoxQuery*>(pData);
+				pQuery->Hits += pQuery->Box.Intersects((*pQuery->pBoxes)[object]) ? 1 : 0;
+			}, &query);
+		return query.Hits;
+	}
+
+	//Gathers every object the ray may hit like the old Scene::Raycast and keeps the nearest box
+	void RunQuadTreeRay(const BaselineQuadTree& tree, RayQuery& query)
+	{
+		query.Nearest = FLT_MAX;
+		query.NearestObject = ~0u;
+		tree.Traverse([](const BaselineQuadTree::Node& node, void* pData) -> bool {
+			RayQuery* pQuery = static_cast<RayQuery*>(pData);
+			if (!node.bounds.IsValid() || !RayAABBIntersect(pQuery->QueryRay, node.bounds.Min, node.bounds.Max))
+				return false;
+
+			for (uint object : node.objects)
+			{
+				float t;
+				if (RayBoxDistance(pQuery->QueryRay, (*pQuery->pBoxes)[object], pQuery->Nearest, t) && t < pQuery->Nearest)
+				{
+					pQuery->Nearest = t;
+					pQuery->NearestObject = object;
+				}
+			}
+			return true;
+		}, &query);
+	}
+
+	void RunBVHRay(const BVH<uint>& bvh, RayQuery& query)
+	{
+		query.Nearest = FLT_MAX;
+		query.NearestObject = ~0u;
+		bvh.Raycast(query.QueryRay, FLT_MAX, [](const uint& object, const Ray& ray, float& tMax, void* pData) -> bool {
+			RayQuery* pQuery = static_cast<RayQuery*>(pData);
+			float t;
+			if (!RayBoxDistance(ray, (*pQuery->pBoxes)[object], tMax, t) || t >= tMax)
+				return false;
+
+			tMax = t;
+			pQuery->Nearest = t;
+			pQuery->NearestObject = object;
+			return true;
+		}, &query);
+	}
+
+	bool RunScene(uint objectCount)
+	{
+		BenchRandom random(4);
+
+		//small objects scattered over a flat world, like props on a terrain
+		Vector<AABB> boxes(objectCount);
+		AABB sceneBounds;
+		for (AABB& box : boxes)
+		{
+			glm::vec3 center = glm::vec3(random.NextFloat(0.0f, WorldSize), random.NextFloat(0.0f, 50.0f), random.NextFloat(0.0f, WorldSize));
+			glm::vec3 extent = glm::vec3(random.NextFloat(0.5f, 10.0f), random.NextFloat(0.5f, 10.0f), random.NextFloat(0.5f, 10.0f));
+			box = AABB(center - extent, center + extent);
+			sceneBounds.Expand(box);
+		}
+
+		Vector<AABB> queryBoxes(QueryCount);
+		for (AABB& box : queryBoxes)
+		{
+			glm::vec3 center = glm::vec3(random.NextFloat(0.0f, WorldSize), random.NextFloat(0.0f, 50.0f), random.NextFloat(0.0f, WorldSize));
+			glm::vec3 extent = glm::vec3(random.NextFloat(10.0f, 100.0f), random.NextFloat(10.0f, 50.0f), random.NextFloat(10.0f, 100.0f));
+			box = AABB(center - extent, center + extent);
+		}
+
+		Vector<Ray> rays(RayCount);
+		for (Ray& ray : rays)
+		{
+			ray.Origin = glm::vec3(random.NextFloat(0.0f, WorldSize), random.NextFloat(20.0f, 200.0f), random.NextFloat(0.0f, WorldSize));
+			ray.Direction = glm::normalize(glm::vec3(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, -0.02f), random.NextFloat(-1.0f, 1.0f)));
+		}
+
+		Timer timer(true);
+		BaselineQuadTree quadTree;
+		AABB treeBounds = sceneBounds;
+		glm::vec3 padding = sceneBounds.GetExtent() * QuadTreePadding;
+		treeBounds.Min -= padding;
+		treeBounds.Max += padding;
+		quadTree.Create(treeBounds, QuadTreeDepth);
+		for (uint i = 0; i < objectCount; i++)
+			quadTree.Insert(i, boxes[i]);
+		double quadBuildTime = timer.Tick();
+
+		BVH<uint> bvh;
+		for (uint i = 0; i < objectCount; i++)
+			bvh.Insert(i, boxes[i]);
+		bvh.Build();
+		double bvhBuildTime = timer.Tick();
+
+		BoxQuery boxQuery;
+		boxQuery.pBoxes = &boxes;
+		Vector<uint> quadHits(QueryCount), bvhHits(QueryCount);
+
+		timer.Tick();
+		for (uint i = 0; i < QueryCount; i++)
+		{
+			boxQuery.Box = queryBoxes[i];
+			quadHits[i] = RunQuadTreeBoxQuery(quadTree, boxQuery);
+		}
+		double quadBoxTime = timer.Tick();
+
+		for (uint i = 0; i < QueryCount; i++)
+		{
+			boxQuery.Box = queryBoxes[i];
+			bvhHits[i] = RunBVHBoxQuery(bvh, boxQuery);
+		}
+		double bvhBoxTime = timer.Tick();
+
+		RayQuery rayQuery;
+		rayQuery.pBoxes = &boxes;
+		Vector<RayQuery> quadRays(RayCount), bvhRays(RayCount);
+
+		timer.Tick();
+		for (uint i = 0; i < RayCount; i++)
+		{
+			rayQuery.QueryRay = rays[i];
+			RunQuadTreeRay(quadTree, rayQuery);
+			quadRays[i] = rayQuery;
+		}
+		double quadRayTime = timer.Tick();
+
+		for (uint i = 0; i < RayCount; i++)
+		{
+			rayQuery.QueryRay = rays[i];
+			RunBVHRay(bvh, rayQuery);
+			bvhRays[i] = rayQuery;
+		}
+		double bvhRayTime = timer.Tick();
+
+		uint boxMismatches = 0, rayMismatches = 0, boxHits = 0, rayHits = 0;
+		for (uint i = 0; i < QueryCount; i++)
+		{
+			boxHits += bvhHits[i];
+			boxMismatches += quadHits[i] != bvhHits[i] ? 1 : 0;
+		}
+
+		for (uint i = 0; i < RayCount; i++)
+		{
+			bool quadHit = quadRays[i].NearestObject != ~0u;
+			bool bvhHit = bvhRays[i].NearestObject != ~0u;
+			rayHits += bvhHit ? 1 : 0;
+			if (quadHit != bvhHit || (bvhHit && fabsf(quadRays[i].Nearest - bvhRays[i].Nearest) > 1e-4f * glm::max(1.0f, quadRays[i].Nearest)))
+				rayMismatches++;
+		}
+
+		printf("%u objects, %u BVH nodes\n", objectCount, bvh.GetNodeCount());
+		printf("  build      quadtree %8.2f ms, BVH %8.2f ms\n", quadBuildTime * 1000.0, bvhBuildTime * 1000.0);
+		printf("  %u boxes  quadtree %8.2f ms, BVH %8.2f ms (%.1fx), %u objects found, %u queries differ\n", QueryCount,
+			quadBoxTime * 1000.0, bvhBoxTime * 1000.0, bvhBoxTime > 0.0 ? quadBoxTime / bvhBoxTime : 0.0, boxHits, boxMismatches);
+		printf("  %u rays  quadtree %8.2f ms, BVH %8.2f ms (%.1fx), %u hit, %u rays differ\n", RayCount,
+			quadRayTime * 1000.0, bvhRayTime * 1000.0, bvhRayTime > 0.0 ? quadRayTime / bvhRayTime : 0.0, rayHits, rayMismatches);
+
+		return boxMismatches == 0 && rayMismatches == 0;
+	}
+}
+
+bool RunBVHBench()
+{
+	bool passed = true;
+	const uint objectCounts[] = { 10000, 100000 };
+	for (uint objectCount : objectCounts)
+		passed &= RunScene(objectCount);
+	return passed;
+}
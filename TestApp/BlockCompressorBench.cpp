@@ -0,0 +1,233 @@
+#include <math.h>
+#include <string.h>
+#include "BlockCompressor.h"
+#include "Image.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	const uint BaseSize = 1024;
+
+	struct Chain
+	{
+		Vector<Vector<Pixel>> Pixels;
+		Vector<BlockCompressor::Level> Levels;
+	};
+
+	//Gradients, a hard edged pattern and noise so every quality tier has something to get wrong
+	void BuildChain(Chain& chain)
+	{
+		BenchRandom random(13);
+
+		chain.Pixels.push_back(Vector<Pixel>(BaseSize * BaseSize));
+		for (uint y = 0; y < BaseSize; y++)
+		{
+			for (uint x = 0; x < BaseSize; x++)
+			{
+				Pixel& p = chain.Pixels[0][y * BaseSize + x];
+				uint noise = random.Next() & 15;
+				p.R = uchar((x * 255) / BaseSize);
+				p.G = uchar(((y * 255) / BaseSize) ^ noise);
+				p.B = uchar(((x / 16) ^ (y / 16)) & 1 ? 220 : 30);
+				p.A = uchar(128 + 127 * sinf((x + y) * 0.01f));
+			}
+		}
+
+		for (uint size = BaseSize / 2; size; size /= 2)
+		{
+			const Vector<Pixel>& src = chain.Pixels.back();
+			Vector<Pixel> dst(size * size);
+			for (uint y = 0; y < size; y++)
+			{
+				for (uint x = 0; x < size; x++)
+				{
+					const Pixel* p00 = &src[(y * 2) * size * 2 + x * 2];
+					const Pixel* p10 = p00 + size * 2;
+					dst[y * size + x].R = uchar((p00[0].R + p00[1].R + p10[0].R + p10[1].R + 2) / 4);
+					dst[y * size + x].G = uchar((p00[0].G + p00[1].G + p10[0].G + p10[1].G + 2) / 4);
+					dst[y * size + x].B = uchar((p00[0].B + p00[1].B + p10[0].B + p10[1].B + 2) / 4);
+					dst[y * size + x].A = uchar((p00[0].A + p00[1].A + p10[0].A + p10[1].A + 2) / 4);
+				}
+			}
+			chain.Pixels.push_back(dst);
+		}
+
+		for (uint i = 0; i < chain.Pixels.size(); i++)
+		{
+			BlockCompressor::Level level = {};
+			level.pPixels = chain.Pixels[i].data();
+			level.Width = BaseSize >> i;
+			level.Height = BaseSize >> i;
+			chain.Levels.push_back(level);
+		}
+	}
+
+	void DecodeColor(const uchar* pBlock, Pixel colors[16])
+	{
+		ushort c0, c1;
+		uint indices;
+		memcpy(&c0, pBlock, sizeof(c0));
+		memcpy(&c1, pBlock + 2, sizeof(c1));
+		memcpy(&indices, pBlock + 4, sizeof(indices));
+
+		int palette[4][3];
+		const ushort endpoints[2] = { c0, c1 };
+		for (uint i = 0; i < 2; i++)
+		{
+			palette[i][0] = ((endpoints[i] >> 11) & 31) * 255 / 31;
+			palette[i][1] = ((endpoints[i] >> 5) & 63) * 255 / 63;
+			palette[i][2] = (endpoints[i] & 31) * 255 / 31;
+		}
+
+		for (uint c = 0; c < 3; c++)
+		{
+			if (c0 > c1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		for (uint i = 0; i < 16; i++)
+		{
+			const int* pColor = palette[(indices >> (i * 2)) & 3];
+			colors[i].R = uchar(pColor[0]);
+			colors[i].G = uchar(pColor[1]);
+			colors[i].B = uchar(pColor[2]);
+		}
+	}
+
+	void DecodeAlpha(const uchar* pBlock, Pixel colors[16])
+	{
+		int palette[8];
+		palette[0] = pBlock[0];
+		palette[1] = pBlock[1];
+		for (int i = 1; i < 7; i++)
+		{
+			if (palette[0] > palette[1])
+				palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+			else
+				palette[i + 1] = i < 5 ? ((5 - i) * palette[0] + i * palette[1]) / 5 : (i == 5 ? 0 : 255);
+		}
+
+		uint64 indices = 0;
+		memcpy(&indices, pBlock + 2, 6);
+		for (uint i = 0; i < 16; i++)
+			colors[i].A = uchar(palette[(indices >> (i * 3)) & 7]);
+	}
+
+	//Root mean square error over RGB, and over A for BC3, of the base level
+	double GetError(const Chain& chain, const Vector<Pixel>& blocks, uint format)
+	{
+		uint blockBytes = format == ImageData::COMPRESSED_BC1 ? 8 : 16;
+		uint blocksPerRow = BaseSize / 4;
+		const uchar* pData = reinterpret_cast<const uchar*>(blocks.data());
+
+		double sum = 0.0;
+		for (uint by = 0; by < blocksPerRow; by++)
+		{
+			for (uint bx = 0; bx < blocksPerRow; bx++)
+			{
+				const uchar* pBlock = pData + (by * blocksPerRow + bx) * blockBytes;
+				Pixel decoded[16];
+				if (format == ImageData::COMPRESSED_BC3)
+				{
+					DecodeAlpha(pBlock, decoded);
+					DecodeColor(pBlock + 8, decoded);
+				}
+				else
+				{
+					DecodeColor(pBlock, decoded);
+				}
+
+				for (uint i = 0; i < 16; i++)
+				{
+					const Pixel& source = chain.Pixels[0][(by * 4 + i / 4) * BaseSize + bx * 4 + i % 4];
+					double dr = double(decoded[i].R) - source.R;
+					double dg = double(decoded[i].G) - source.G;
+					double db = double(decoded[i].B) - source.B;
+					double da = format == ImageData::COMPRESSED_BC3 ? double(decoded[i].A) - source.A : 0.0;
+					sum += dr * dr + dg * dg + db * db + da * da;
+				}
+			}
+		}
+
+		uint channels = format == ImageData::COMPRESSED_BC3 ? 4 : 3;
+		return sqrt(sum / (double(BaseSize) * BaseSize * channels));
+	}
+}
+
+bool RunBlockCompressorBench()
+{
+	Chain chain;
+	BuildChain(chain);
+
+	double chainPixels = 0.0;
+	for (const BlockCompressor::Level& level : chain.Levels)
+		chainPixels += double(level.Width) * level.Height;
+
+	struct Format
+	{
+		uint Flag;
+		const char* Name;
+	};
+
+	const Format formats[] =
+	{
+		{ ImageData::COMPRESSED_BC1, "BC1" },
+		{ ImageData::COMPRESSED_BC3, "BC3" },
+		{ ImageData::COMPRESSED_BC7, "BC7" },
+	};
+
+	const char* qualityNames[] = { "fast", "normal", "high" };
+
+	printf("%ux%u with %u levels, %.2f MPix per chain\n", BaseSize, BaseSize, (uint)chain.Levels.size(), chainPixels / 1000000.0);
+
+	bool passed = true;
+	for (const Format& format : formats)
+	{
+		for (uint quality = BlockCompressor::QUALITY_FAST; quality <= BlockCompressor::QUALITY_HIGH; quality++)
+		{
+			Vector<Vector<Pixel>> serial(chain.Levels.size()), threaded(chain.Levels.size());
+			for (uint i = 0; i < chain.Levels.size(); i++)
+			{
+				uint count = BlockCompressor::GetCompressedPixelCount(format.Flag, chain.Levels[i].Width, chain.Levels[i].Height);
+				serial[i].resize(count);
+				threaded[i].resize(count);
+			}
+
+			Timer timer(true);
+			for (uint i = 0; i < chain.Levels.size(); i++)
+				chain.Levels[i].pBlocks = serial[i].data();
+			bool compressed = BlockCompressor::Compress(chain.Levels.data(), chain.Levels.size(), format.Flag, (BlockCompressor::Quality)quality, false);
+			double serialTime = timer.Tick();
+
+			for (uint i = 0; i < chain.Levels.size(); i++)
+				chain.Levels[i].pBlocks = threaded[i].data();
+			compressed = compressed && BlockCompressor::Compress(chain.Levels.data(), chain.Levels.size(), format.Flag, (BlockCompressor::Quality)quality, true);
+			double threadedTime = timer.Tick();
+
+			bool matches = compressed;
+			for (uint i = 0; i < chain.Levels.size() && matches; i++)
+				matches = memcmp(serial[i].data(), threaded[i].data(), serial[i].size() * sizeof(Pixel)) == 0;
+
+			printf("%s %-6s serial %8.2f MPix/s, threaded %8.2f MPix/s", format.Name, qualityNames[quality],
+				chainPixels / 1000000.0 / serialTime, chainPixels / 1000000.0 / threadedTime);
+			if (format.Flag != ImageData::COMPRESSED_BC7)
+				printf(", rmse %.3f", GetError(chain, serial[0], format.Flag));
+			printf("%s\n", matches ? "" : " - threaded blocks differ from serial ones");
+
+			passed = passed && matches;
+		}
+	}
+
+	return passed;
+}
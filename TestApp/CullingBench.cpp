@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include "MathHelper.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	const uint BoxCount = 100000;
+	const uint FrustumCount = 4;
+	const uint Repeats = 20;
+
+	//Planes of a view projection matrix facing out of the frustum, the way the camera builds them
+	void GetFrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6])
+	{
+		glm::vec4 rows[4];
+		for (uint i = 0; i < 4; i++)
+			rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+		planes[0] = -(rows[3] + rows[0]);
+		planes[1] = -(rows[3] - rows[0]);
+		planes[2] = -(rows[3] + rows[1]);
+		planes[3] = -(rows[3] - rows[1]);
+		planes[4] = -(rows[3] + rows[2]);
+		planes[5] = -(rows[3] - rows[2]);
+	}
+}
+
+bool RunCullingBench()
+{
+	BenchRandom random(5);
+
+	Vector<float> bounds[6];
+	for (uint c = 0; c < 6; c++)
+		bounds[c].resize(BoxCount);
+
+	Vector<AABB> boxes(BoxCount);
+	for (uint i = 0; i < BoxCount; i++)
+	{
+		glm::vec3 center = glm::vec3(random.NextFloat(-200.0f, 200.0f), random.NextFloat(-50.0f, 50.0f), random.NextFloat(-200.0f, 200.0f));
+		glm::vec3 extent = glm::vec3(random.NextFloat(0.25f, 5.0f), random.NextFloat(0.25f, 5.0f), random.NextFloat(0.25f, 5.0f));
+		boxes[i] = AABB(center - extent, center + extent);
+		for (uint c = 0; c < 3; c++)
+		{
+			bounds[c][i] = boxes[i].Min[c];
+			bounds[c + 3][i] = boxes[i].Max[c];
+		}
+	}
+
+	AABBBatch batch;
+	batch.MinX = bounds[0].data();
+	batch.MinY = bounds[1].data();
+	batch.MinZ = bounds[2].data();
+	batch.MaxX = bounds[3].data();
+	batch.MaxY = bounds[4].data();
+	batch.MaxZ = bounds[5].data();
+	batch.Count = BoxCount;
+
+	//a main camera and narrower cascade like views looking different ways
+	glm::vec4 frusta[FrustumCount][6];
+	const glm::vec4* pFrusta[FrustumCount];
+	for (uint f = 0; f < FrustumCount; f++)
+	{
+		float angle = f * 1.3f;
+		glm::vec3 eye = glm::vec3(glm::cos(angle) * 20.0f, 10.0f, glm::sin(angle) * 20.0f);
+		glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 proj = glm::perspective(glm::radians(f == 0 ? 60.0f : 30.0f), 16.0f / 9.0f, 0.1f, 150.0f + f * 50.0f);
+		GetFrustumPlanes(proj * view, frusta[f]);
+		pFrusta[f] = frusta[f];
+	}
+
+	uint maskCount = (BoxCount + 31) / 32;
+	Vector<uint> singleMask(maskCount), scalarMask(maskCount), batchMask(maskCount);
+	Vector<uint> frustumMasks(BoxCount);
+
+	bool passed = true;
+	uint visible = 0;
+	for (uint f = 0; f < FrustumCount && passed; f++)
+	{
+		std::fill(singleMask.begin(), singleMask.end(), 0u);
+		for (uint i = 0; i < BoxCount; i++)
+		{
+			if (FrustumAABBIntersect(frusta[f], boxes[i]))
+				singleMask[i / 32] |= 1u << (i % 32);
+		}
+
+		FrustumAABBIntersectScalar(frusta[f], batch, scalarMask.data());
+		FrustumAABBIntersect(frusta[f], batch, batchMask.data());
+		passed = singleMask == scalarMask && singleMask == batchMask;
+
+		for (uint i = 0; i < BoxCount; i++)
+			visible += (singleMask[i / 32] >> (i % 32)) & 1;
+	}
+
+	if (passed)
+	{
+		FrustumAABBIntersect(pFrusta, (1u << FrustumCount) - 1, batch, frustumMasks.data());
+		for (uint f = 0; f < FrustumCount && passed; f++)
+		{
+			for (uint i = 0; i < BoxCount && passed; i++)
+				passed = (((frustumMasks[i] >> f) & 1) != 0) == FrustumAABBIntersect(frusta[f], boxes[i]);
+		}
+	}
+
+	if (!passed)
+	{
+		printf("batch results differ from FrustumAABBIntersect\n");
+		return false;
+	}
+
+	Timer timer(true);
+	uint checksum = 0;
+	for (uint r = 0; r < Repeats; r++)
+	{
+		for (uint i = 0; i < BoxCount; i++)
+			checksum += FrustumAABBIntersect(frusta[0], boxes[i]);
+	}
+	double singleTime = timer.Tick();
+
+	for (uint r = 0; r < Repeats; r++)
+	{
+		FrustumAABBIntersectScalar(frusta[0], batch, scalarMask.data());
+		checksum += scalarMask[r % maskCount];
+	}
+	double scalarTime = timer.Tick();
+
+	for (uint r = 0; r < Repeats; r++)
+	{
+		FrustumAABBIntersect(frusta[0], batch, batchMask.data());
+		checksum += batchMask[r % maskCount];
+	}
+	double batchTime = timer.Tick();
+
+	for (uint r = 0; r < Repeats; r++)
+	{
+		FrustumAABBIntersect(pFrusta, (1u << FrustumCount) - 1, batch, frustumMasks.data());
+		checksum += frustumMasks[r % BoxCount];
+	}
+	double multiTime = timer.Tick();
+
+	double millions = double(BoxCount) * Repeats / 1000000.0;
+	printf("%u boxes, %u frusta, %u visible in total (checksum %u)\n", BoxCount, FrustumCount, visible, checksum);
+	printf("one box at a time %8.2f Mboxes/s\n", millions / singleTime);
+	printf("scalar batch      %8.2f Mboxes/s\n", millions / scalarTime);
+	printf("SIMD batch        %8.2f Mboxes/s\n", millions / batchTime);
+	printf("SIMD %u frusta     %8.2f Mboxes/s per frustum\n", FrustumCount, millions * FrustumCount / multiTime);
+
+	return true;
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include "PixelKernels.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	//Odd so every path runs its scalar tail, the kernels are handed pixels one past the start of the buffer so loads
+	//are unaligned too
+	const uint Width = 2047;
+	const uint Height = 2049;
+	const uint Count = Width * Height;
+	const uint Repeats = 4;
+
+	struct Result
+	{
+		double ReferenceTime;
+		double KernelTime;
+	};
+
+	//Runs the one pixel at a time reference and the kernel Repeats times each and reports both
+	template<typename ReferenceFunc, typename KernelFunc>
+	Result Time(const ReferenceFunc& reference, const KernelFunc& kernel)
+	{
+		Result result;
+		Timer timer(true);
+		for (uint r = 0; r < Repeats; r++)
+			reference();
+		result.ReferenceTime = timer.Tick();
+		for (uint r = 0; r < Repeats; r++)
+			kernel();
+		result.KernelTime = timer.Tick();
+		return result;
+	}
+
+	bool Report(const char* pName, const Result& result, bool matches)
+	{
+		double pixels = double(Count) * Repeats / 1000000.0;
+		printf("%-16s reference %8.1f MPix/s, kernel %8.1f MPix/s (%.1fx)%s\n", pName, pixels / result.ReferenceTime,
+			pixels / result.KernelTime, result.ReferenceTime / result.KernelTime, matches ? "" : " - results differ");
+		return matches;
+	}
+}
+
+bool RunPixelKernelsBench()
+{
+	BenchRandom random(18);
+	Vector<Pixel> sourceBuffer(Count + 1);
+	for (Pixel& p : sourceBuffer)
+	{
+		uint value = random.Next();
+		memcpy(&p, &value, sizeof(p));
+	}
+
+	const Pixel* pSource = sourceBuffer.data() + 1;
+	Vector<Pixel> expectedBuffer(Count + 1), actualBuffer(Count + 1);
+	Pixel* pExpected = expectedBuffer.data() + 1;
+	Pixel* pActual = actualBuffer.data() + 1;
+	auto pixelsMatch = [&]() -> bool { return memcmp(pExpected, pActual, Count * sizeof(Pixel)) == 0; };
+
+	bool passed = true;
+
+	const uchar bgra[4] = { 2, 1, 0, 3 };
+	Result result = Time([&]() {
+		for (uint i = 0; i < Count; i++)
+		{
+			pExpected[i].R = pSource[i].B;
+			pExpected[i].G = pSource[i].G;
+			pExpected[i].B = pSource[i].R;
+			pExpected[i].A = pSource[i].A;
+		}
+	}, [&]() { PixelKernels::Swizzle(pSource, pActual, Count, bgra); });
+	passed &= Report("Swizzle", result, pixelsMatch());
+
+	const uchar redToGray[4] = { 0, 0, 0, PixelKernels::ChannelOne };
+	result = Time([&]() {
+		for (uint i = 0; i < Count; i++)
+		{
+			pExpected[i].R = pSource[i].R;
+			pExpected[i].G = pSource[i].R;
+			pExpected[i].B = pSource[i].R;
+			pExpected[i].A = 255;
+		}
+	}, [&]() { PixelKernels::Swizzle(pSource, pActual, Count, redToGray); });
+	passed &= Report("Swizzle one", result, pixelsMatch());
+
+	result = Time([&]() {
+		memcpy(pExpected, pSource, Count * sizeof(Pixel));
+		for (uint i = 0; i < Count; i++)
+			pExpected[i].SwapRB();
+	}, [&]() {
+		memcpy(pActual, pSource, Count * sizeof(Pixel));
+		PixelKernels::SwapRB(pActual, Count);
+	});
+	passed &= Report("SwapRB", result, pixelsMatch());
+
+	result = Time([&]() {
+		memcpy(pExpected, pSource, Count * sizeof(Pixel));
+		for (uint i = 0; i < Count; i++)
+			pExpected[i].Invert();
+	}, [&]() {
+		memcpy(pActual, pSource, Count * sizeof(Pixel));
+		PixelKernels::Invert(pActual, Count);
+	});
+	passed &= Report("Invert", result, pixelsMatch());
+
+	Pixel fill;
+	fill.R = 10;
+	fill.G = 20;
+	fill.B = 30;
+	fill.A = 40;
+	result = Time([&]() {
+		for (uint i = 0; i < Count; i++)
+			pExpected[i] = fill;
+	}, [&]() { PixelKernels::Fill(pActual, Count, fill); });
+	passed &= Report("Fill", result, pixelsMatch());
+
+	Vector<uchar> expectedPlanes[4], actualPlanes[4];
+	for (uint c = 0; c < 4; c++)
+	{
+		expectedPlanes[c].resize(Count);
+		actualPlanes[c].resize(Count);
+	}
+
+	result = Time([&]() {
+		for (uint i = 0; i < Count; i++)
+			expectedPlanes[0][i] = pSource[i].Grayscale();
+	}, [&]() { PixelKernels::Grayscale(pSource, actualPlanes[0].data(), Count); });
+	passed &= Report("Grayscale", result, expectedPlanes[0] == actualPlanes[0]);
+
+	//averaged over the four channels
+	bool matches = true;
+	Result channels = {};
+	for (uint c = 0; c < 4; c++)
+	{
+		result = Time([&]() {
+			for (uint i = 0; i < Count; i++)
+				expectedPlanes[c][i] = (&pSource[i].R)[c];
+		}, [&]() { PixelKernels::ExtractChannel(pSource, actualPlanes[c].data(), Count, c); });
+		channels.ReferenceTime += result.ReferenceTime / 4.0;
+		channels.KernelTime += result.KernelTime / 4.0;
+		matches = matches && expectedPlanes[c] == actualPlanes[c];
+	}
+	passed &= Report("ExtractChannel", channels, matches);
+
+	//alpha has no plane and comes out opaque
+	const uchar* planes[4] = { expectedPlanes[0].data(), expectedPlanes[1].data(), expectedPlanes[2].data(), 0 };
+	result = Time([&]() {
+		for (uint i = 0; i < Count; i++)
+		{
+			pExpected[i].R = planes[0][i];
+			pExpected[i].G = planes[1][i];
+			pExpected[i].B = planes[2][i];
+			pExpected[i].A = 255;
+		}
+	}, [&]() { PixelKernels::MergeChannels(planes, pActual, Count); });
+	passed &= Report("MergeChannels", result, pixelsMatch());
+
+	uint64 expectedSums[4] = {}, actualSums[4] = {};
+	result = Time([&]() {
+		for (uint c = 0; c < 4; c++)
+			expectedSums[c] = 0;
+		for (uint i = 0; i < Count; i++)
+		{
+			expectedSums[0] += pSource[i].R;
+			expectedSums[1] += pSource[i].G;
+			expectedSums[2] += pSource[i].B;
+			expectedSums[3] += pSource[i].A;
+		}
+	}, [&]() {
+		for (uint c = 0; c < 4; c++)
+			actualSums[c] = 0;
+		PixelKernels::Sum(pSource, Count, actualSums);
+	});
+	passed &= Report("Sum", result, memcmp(expectedSums, actualSums, sizeof(expectedSums)) == 0);
+
+	//a rect inside the image, the way Texture2D::GetAveragePixel averages a kernel around a texel
+	uint x0 = 3, y0 = 5, x1 = Width - 7, y1 = Height - 2;
+	float expectedAverage[4], actualAverage[4];
+	result = Time([&]() {
+		uint64 sums[4] = {};
+		for (uint y = y0; y < y1; y++)
+		{
+			for (uint x = x0; x < x1; x++)
+			{
+				const Pixel& p = pSource[y * Width + x];
+				sums[0] += p.R;
+				sums[1] += p.G;
+				sums[2] += p.B;
+				sums[3] += p.A;
+			}
+		}
+
+		double count = double(x1 - x0) * double(y1 - y0) * 255.0;
+		for (uint c = 0; c < 4; c++)
+			expectedAverage[c] = (float)(sums[c] / count);
+	}, [&]() { PixelKernels::BoxAverage(pSource, Width, x0, y0, x1, y1, actualAverage); });
+	passed &= Report("BoxAverage", result, memcmp(expectedAverage, actualAverage, sizeof(expectedAverage)) == 0);
+
+	return passed;
+}
@@ -0,0 +1,127 @@
+#include <math.h>
+#include "StringUtil.h"
+#include "RenderObject.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	const uint NodeCount = 20000;
+	const uint FrameCount = 20;
+	const float WorldSize = 1000.0f;
+
+	//Render object with a fixed box and no mesh, so frames only measure the scene's transform and refit work
+	class BenchRenderObject : public RenderObject
+	{
+	public:
+		BenchRenderObject() : RenderObject(RO_MESH_RENDERER) { _box = AABB(glm::vec3(-1.0f), glm::vec3(1.0f)); }
+
+		void Initialize(SceneNode* pNode, ComponentData* pData) override
+		{
+			CreateRenderNode(pData->As<RenderComponentData>());
+			RenderObject::Initialize(pNode, pData);
+		}
+
+	protected:
+		RenderComponentData* AllocRenderData(SceneNode* pNode) override { return new RenderComponentData(this, pNode); }
+
+		bool RequestData(RenderNode* pNode, RenderComponentData*, Mesh*& pMesh, Material*& pMaterial, const glm::mat4*& worldMtx, const AABB*& aabb, uint& idxCount, uint& instanceCount, uint& firstIdx, uint& vtxOffset) const override
+		{
+			pMesh = 0;
+			pMaterial = 0;
+			worldMtx = &pNode->GetNode()->GetWorld();
+			aabb = &_box;
+			idxCount = 0;
+			instanceCount = 1;
+			firstIdx = 0;
+			vtxOffset = 0;
+			return true;
+		}
+
+	private:
+		AABB _box;
+	};
+
+	//Counts nodes whose matrix or render node doesn't match the matrix built by walking up the parents
+	uint CountMismatches(const Vector<SceneNode*>& nodes, const Vector<BenchRenderObject*>& objects)
+	{
+		uint mismatches = 0;
+		for (uint i = 0; i < nodes.size(); i++)
+		{
+			glm::mat4 expected = nodes[i]->BuildWorldMatrix();
+			const RenderNode& renderNode = *nodes[i]->GetComponentData<RenderComponentData>(objects[i])->BeginNode();
+
+			bool matches = true;
+			for (uint c = 0; c < 4 && matches; c++)
+			{
+				for (uint r = 0; r < 4 && matches; r++)
+					matches = fabsf(expected[c][r] - nodes[i]->GetWorld()[c][r]) <= 1e-3f && renderNode.GetWorld()[c][r] == nodes[i]->GetWorld()[c][r];
+			}
+
+			mismatches += matches ? 0 : 1;
+		}
+		return mismatches;
+	}
+}
+
+bool RunSceneUpdateBench()
+{
+	BenchRandom random(11);
+	Scene scene;
+
+	//a quarter of the nodes are parented to an earlier node so moving objects also move the subtrees under them
+	Vector<SceneNode*> nodes(NodeCount);
+	Vector<BenchRenderObject*> objects(NodeCount);
+	for (uint i = 0; i < NodeCount; i++)
+	{
+		nodes[i] = scene.AddNode(StrFormat("Node%u", i));
+		if (i > 0 && (i & 3) == 0)
+			nodes[i]->SetParent(nodes[random.Next() % i]);
+
+		nodes[i]->SetPosition(glm::vec3(random.NextFloat(0.0f, WorldSize), random.NextFloat(0.0f, 50.0f), random.NextFloat(0.0f, WorldSize)));
+		nodes[i]->SetOrientation(glm::vec3(0.0f, random.NextFloat(0.0f, 360.0f), 0.0f), ORIENT_XYZ);
+		objects[i] = static_cast<BenchRenderObject*>(nodes[i]->AddComponent(new BenchRenderObject()));
+		nodes[i]->Initialize();
+	}
+
+	Timer timer(true);
+	scene.Update(0.0f, 0.0f);
+	double firstFrameTime = timer.Tick();
+	uint mismatches = CountMismatches(nodes, objects);
+
+	printf("%u nodes, first frame %.2f ms\n", NodeCount, firstFrameTime * 1000.0);
+
+	const uint movingCounts[] = { 0, 10, 100, 1000, 10000, NodeCount };
+	double allMovingTime = 0.0;
+	Vector<double> frameTimes;
+	for (uint movingCount : movingCounts)
+	{
+		timer.Tick();
+		for (uint frame = 0; frame < FrameCount; frame++)
+		{
+			for (uint i = 0; i < movingCount; i++)
+			{
+				SceneNode* pNode = nodes[(frame * movingCount + i) % NodeCount];
+				pNode->SetPosition(pNode->GetPosition() + glm::vec3(random.NextFloat(-1.0f, 1.0f), 0.0f, random.NextFloat(-1.0f, 1.0f)));
+			}
+			scene.Update(0.0f, 0.0f);
+		}
+		double frameTime = timer.Tick() / FrameCount;
+		frameTimes.push_back(frameTime);
+		allMovingTime = frameTime;
+
+		mismatches += CountMismatches(nodes, objects);
+	}
+
+	for (uint i = 0; i < frameTimes.size(); i++)
+	{
+		printf("  %5u moving  %8.3f ms/frame (%5.1f%% of all moving)\n", movingCounts[i], frameTimes[i] * 1000.0,
+			allMovingTime > 0.0 ? 100.0 * frameTimes[i] / allMovingTime : 0.0);
+	}
+	printf("  %u nodes differ from their parent chain\n", mismatches);
+
+	return mismatches == 0;
+}
@@ -0,0 +1,145 @@
+#include <math.h>
+#include "TerrainLOD.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	const uint PatchResolution = 32;
+	const float LODDistance = 96.0f;
+
+	//Rolling hills with some higher frequency detail, in samples
+	void BuildHeights(uint resolution, Vector<float>& heights)
+	{
+		heights.resize(resolution * resolution);
+		for (uint z = 0; z < resolution; z++)
+		{
+			for (uint x = 0; x < resolution; x++)
+			{
+				float fx = (float)x;
+				float fz = (float)z;
+				heights[z * resolution + x] = 40.0f * sinf(fx * 0.013f) * cosf(fz * 0.011f) + 3.0f * sinf(fx * 0.21f + fz * 0.17f);
+			}
+		}
+	}
+
+	//Without culling every patch sized cell of the grid has to be drawn exactly once, at the resolution of any level
+	bool CoversGridOnce(const TerrainLOD& lod, const Vector<TerrainLOD::Patch>& patches)
+	{
+		uint extent = lod.GetResolution() - 1;
+		uint cellsPerSide = (extent + PatchResolution - 1) / PatchResolution;
+		Vector<uint> coverage(cellsPerSide * cellsPerSide, 0);
+		for (const TerrainLOD::Patch& patch : patches)
+		{
+			uint cx0 = (uint)patch.Origin.x / PatchResolution;
+			uint cz0 = (uint)patch.Origin.y / PatchResolution;
+			uint cells = (uint)patch.Size / PatchResolution;
+			for (uint cz = cz0; cz < glm::min(cz0 + cells, cellsPerSide); cz++)
+			{
+				for (uint cx = cx0; cx < glm::min(cx0 + cells, cellsPerSide); cx++)
+					coverage[cz * cellsPerSide + cx]++;
+			}
+		}
+
+		for (uint count : coverage)
+		{
+			if (count != 1)
+				return false;
+		}
+		return true;
+	}
+
+	//Every triangle of the grid, split the same way as TerrainLOD::Raycast
+	bool RaycastBruteForce(const Vector<float>& heights, uint resolution, const Ray& ray, float& tMin)
+	{
+		bool hit = false;
+		float weights[3];
+		for (uint z = 0; z + 1 < resolution; z++)
+		{
+			for (uint x = 0; x + 1 < resolution; x++)
+			{
+				glm::vec3 topLeft = glm::vec3(x, heights[z * resolution + x], z);
+				glm::vec3 topRight = glm::vec3(x + 1, heights[z * resolution + x + 1], z);
+				glm::vec3 bottomLeft = glm::vec3(x, heights[(z + 1) * resolution + x], z + 1);
+				glm::vec3 bottomRight = glm::vec3(x + 1, heights[(z + 1) * resolution + x + 1], z + 1);
+				hit |= RayTriangleIntersect(ray, topLeft, bottomLeft, bottomRight, tMin, weights);
+				hit |= RayTriangleIntersect(ray, topLeft, bottomRight, topRight, tMin, weights);
+			}
+		}
+		return hit;
+	}
+}
+
+bool RunTerrainLODTest()
+{
+	bool passed = true;
+	Vector<float> heights;
+
+	//the selected triangle count should barely move as the grid grows, the full grid grows with its area
+	const uint resolutions[] = { 1025, 2049, 4097 };
+	for (uint resolution : resolutions)
+	{
+		BuildHeights(resolution, heights);
+
+		TerrainLOD lod;
+		lod.SetLODDistance(LODDistance);
+		lod.Build(heights.data(), resolution, PatchResolution);
+
+		glm::vec3 observer = glm::vec3(resolution * 0.5f, 60.0f, resolution * 0.5f);
+		Vector<TerrainLOD::Patch> patches;
+
+		Timer timer(true);
+		lod.Select(observer, 0, patches);
+		double selectTime = timer.Tick();
+
+		bool covered = CoversGridOnce(lod, patches);
+		passed &= covered;
+
+		uint64 triangles = uint64(patches.size()) * PatchResolution * PatchResolution * 2;
+		uint64 fullTriangles = uint64(resolution - 1) * (resolution - 1) * 2;
+		printf("%5u^2 grid, %u levels: %4u patches, %8llu triangles (full grid %10llu), selected in %.3f ms%s\n", resolution,
+			lod.GetLevelCount(), (uint)patches.size(), (unsigned long long)triangles, (unsigned long long)fullTriangles,
+			selectTime * 1000.0, covered ? "" : " - patches overlap or leave holes");
+	}
+
+	//raycasts through the tree must find the same nearest hit as testing every triangle
+	const uint rayResolution = 257;
+	BuildHeights(rayResolution, heights);
+
+	TerrainLOD lod;
+	lod.Build(heights.data(), rayResolution, PatchResolution);
+
+	BenchRandom random(21);
+	const uint rayCount = 200;
+	uint hits = 0, mismatches = 0;
+	double treeTime = 0.0, bruteTime = 0.0;
+	for (uint i = 0; i < rayCount; i++)
+	{
+		Ray ray;
+		ray.Origin = glm::vec3(random.NextFloat(-20.0f, rayResolution + 20.0f), random.NextFloat(20.0f, 120.0f), random.NextFloat(-20.0f, rayResolution + 20.0f));
+		ray.Direction = glm::normalize(glm::vec3(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, -0.05f), random.NextFloat(-1.0f, 1.0f)));
+
+		Timer timer(true);
+		float treeT = FLT_MAX;
+		uint triIndex;
+		float weights[3];
+		glm::vec3 normal;
+		bool treeHit = lod.Raycast(heights.data(), ray, treeT, triIndex, weights, normal);
+		treeTime += timer.Tick();
+
+		float bruteT = FLT_MAX;
+		bool bruteHit = RaycastBruteForce(heights, rayResolution, ray, bruteT);
+		bruteTime += timer.Tick();
+
+		hits += treeHit;
+		if (treeHit != bruteHit || (treeHit && glm::abs(treeT - bruteT) > 1e-3f * glm::max(1.0f, bruteT)))
+			mismatches++;
+	}
+
+	printf("%u rays against a %u^2 grid, %u hits, %u differ from brute force, tree %.3f ms, brute force %.3f ms\n", rayCount,
+		rayResolution, hits, mismatches, treeTime * 1000.0, bruteTime * 1000.0);
+
+	return passed && mismatches == 0;
+}
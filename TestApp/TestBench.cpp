@@ -0,0 +1,54 @@
+#include <string.h>
+#include "TestBench.h"
+
+struct Harness
+{
+	const char* Name;
+	bool(*Run)();
+};
+
+static const Harness g_Harnesses[] =
+{
+	{ "threadpool", RunThreadPoolBench },
+	{ "culling", RunCullingBench },
+	{ "bc", RunBlockCompressorBench },
+	{ "streamer", RunTextureStreamerTest },
+	{ "pixels", RunPixelKernelsBench },
+	{ "terrain", RunTerrainLODTest },
+	{ "bvh", RunBVHBench },
+	{ "scene", RunSceneUpdateBench },
+};
+
+//Runs the harnesses named on the command line, or all of them, and returns the number that failed
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	bool ranAny = false;
+	for (const Harness& harness : g_Harnesses)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc && !selected; i++)
+			selected = strcmp(argv[i], harness.Name) == 0;
+
+		if (!selected)
+			continue;
+
+		printf("[%s]\n", harness.Name);
+		bool passed = harness.Run();
+		printf("[%s] %s\n\n", harness.Name, passed ? "passed" : "FAILED");
+
+		failed += passed ? 0 : 1;
+		ranAny = true;
+	}
+
+	if (!ranAny)
+	{
+		printf("usage: TestBench [");
+		for (const Harness& harness : g_Harnesses)
+			printf(" %s", harness.Name);
+		printf(" ]\n");
+		return 1;
+	}
+
+	return failed;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+#include "Types.h"
+
+//CPU only harnesses run by TestBench. Each prints what it measured and returns false when a result differs from the
+//reference it is checked against
+bool RunThreadPoolBench();
+bool RunCullingBench();
+bool RunBlockCompressorBench();
+bool RunTextureStreamerTest();
+bool RunPixelKernelsBench();
+bool RunTerrainLODTest();
+bool RunBVHBench();
+bool RunSceneUpdateBench();
+
+//Deterministic values for harness inputs, so runs can be compared with each other
+class BenchRandom
+{
+public:
+	explicit BenchRandom(SunEngine::uint seed) : _state(seed ? seed : 1u) {}
+
+	SunEngine::uint Next()
+	{
+		_state ^= _state << 13;
+		_state ^= _state >> 17;
+		_state ^= _state << 5;
+		return _state;
+	}
+
+	float NextFloat(float min, float max) { return min + (max - min) * ((Next() & 0xFFFFFF) / float(0xFFFFFF)); }
+
+private:
+	SunEngine::uint _state;
+};
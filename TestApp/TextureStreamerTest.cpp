@@ -0,0 +1,164 @@
+#include "TextureStreamer.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	//A square RGBA8 chain that only exists as its level sizes
+	struct FakeTexture
+	{
+		FakeTexture(uint width, uint tailSize)
+		{
+			Width = width;
+			TailLevel = 0;
+			for (uint size = width; size; size /= 2)
+			{
+				if (size > tailSize)
+					TailLevel++;
+				LevelSizes.push_back(uint64(size) * size * 4);
+			}
+		}
+
+		uint64 GetBytes(uint firstLevel) const
+		{
+			uint64 bytes = 0;
+			for (uint level = firstLevel; level < LevelSizes.size(); level++)
+				bytes += LevelSizes[level];
+			return bytes;
+		}
+
+		uint Width;
+		uint TailLevel;
+		Vector<uint64> LevelSizes;
+	};
+
+	TextureStreamer::PlanEntry MakeEntry(const FakeTexture& texture, float pixels)
+	{
+		TextureStreamer::PlanEntry entry;
+		entry.pLevelSizes = texture.LevelSizes.data();
+		entry.LevelCount = texture.LevelSizes.size();
+		entry.Width = texture.Width;
+		entry.TailLevel = texture.TailLevel;
+		entry.WantedLevel = TextureStreamer::GetWantedLevel(texture.Width, entry.LevelCount, pixels);
+		entry.ScreenSize = pixels;
+		return entry;
+	}
+
+	bool Check(bool condition, const char* pDescription)
+	{
+		if (!condition)
+			printf("%s\n", pDescription);
+		return condition;
+	}
+
+	//Every entry lies between its wanted level and its tail, which wins when it is coarser, and the returned size is
+	//what the levels add up to
+	bool IsValidPlan(const Vector<FakeTexture>& textures, const Vector<TextureStreamer::PlanEntry>& entries, const Vector<uint>& firstLevels, uint64 used)
+	{
+		uint64 bytes = 0;
+		for (uint i = 0; i < entries.size(); i++)
+		{
+			if (firstLevels[i] < glm::min(entries[i].WantedLevel, entries[i].TailLevel) || firstLevels[i] > entries[i].TailLevel)
+				return false;
+			bytes += textures[i].GetBytes(firstLevels[i]);
+		}
+		return bytes == used;
+	}
+}
+
+bool RunTextureStreamerTest()
+{
+	const uint TailSize = TextureStreamer::Options::Default.TailSize;
+	bool passed = true;
+
+	passed &= Check(TextureStreamer::GetWantedLevel(1024, 11, 0.5f) == 10, "off screen textures want their last level");
+	passed &= Check(TextureStreamer::GetWantedLevel(1024, 11, 300.0f) == 1, "300 pixels want the 512 wide level");
+	passed &= Check(TextureStreamer::GetWantedLevel(1024, 11, 4096.0f) == 0, "magnified textures want the base level");
+	passed &= Check(TextureStreamer::GetWantedLevel(1024, 0, 300.0f) == 0, "empty chains want level 0");
+
+	Vector<FakeTexture> textures;
+	Vector<TextureStreamer::PlanEntry> entries;
+	const uint sizes[] = { 4096, 2048, 1024, 512, 256, 64, 16 };
+	for (uint i = 0; i < 7; i++)
+		textures.push_back(FakeTexture(sizes[i], TailSize));
+	for (uint i = 0; i < textures.size(); i++)
+		entries.push_back(MakeEntry(textures[i], 100000.0f));
+
+	Vector<uint> firstLevels;
+	uint64 tailBytes = 0, fullBytes = 0;
+	for (const FakeTexture& texture : textures)
+	{
+		tailBytes += texture.GetBytes(texture.TailLevel);
+		fullBytes += texture.GetBytes(0);
+	}
+
+	//tails stay resident even when nothing fits
+	uint64 used = TextureStreamer::PlanResidency(entries.data(), entries.size(), 0, firstLevels);
+	bool tailsOnly = used == tailBytes;
+	for (uint i = 0; i < entries.size(); i++)
+		tailsOnly = tailsOnly && firstLevels[i] == entries[i].TailLevel;
+	passed &= Check(tailsOnly, "a zero budget should keep exactly the tails");
+
+	//a budget that fits everything gives everyone what they want
+	used = TextureStreamer::PlanResidency(entries.data(), entries.size(), fullBytes, firstLevels);
+	bool allWanted = used == fullBytes;
+	for (uint i = 0; i < entries.size(); i++)
+		allWanted = allWanted && firstLevels[i] == entries[i].WantedLevel;
+	passed &= Check(allWanted, "a full budget should make every chain resident at its wanted level");
+
+	//textures never get more than their screen size asks for
+	for (uint i = 0; i < entries.size(); i++)
+		entries[i] = MakeEntry(textures[i], 200.0f);
+	used = TextureStreamer::PlanResidency(entries.data(), entries.size(), fullBytes, firstLevels);
+	passed &= Check(IsValidPlan(textures, entries, firstLevels, used), "small screen sizes should cap the resident levels");
+
+	//with room for one more level of two equal chains, the larger one on screen gets it
+	FakeTexture equal(1024, TailSize);
+	Vector<FakeTexture> pair = { equal, equal };
+	Vector<TextureStreamer::PlanEntry> pairEntries = { MakeEntry(equal, 100.0f), MakeEntry(equal, 800.0f) };
+	uint64 budget = equal.GetBytes(equal.TailLevel) * 2 + equal.LevelSizes[equal.TailLevel - 1];
+	used = TextureStreamer::PlanResidency(pairEntries.data(), pairEntries.size(), budget, firstLevels);
+	passed &= Check(IsValidPlan(pair, pairEntries, firstLevels, used) && used <= budget, "plans for two chains should stay in the budget");
+	passed &= Check(firstLevels[1] < firstLevels[0], "the chain covering more pixels should be sharper");
+
+	//random scenes, the plan holds the budget whenever the tails fit in it
+	BenchRandom random(17);
+	uint scenes = 0;
+	for (uint scene = 0; scene < 200 && passed; scene++)
+	{
+		textures.clear();
+		entries.clear();
+		uint count = 1 + random.Next() % 64;
+		for (uint i = 0; i < count; i++)
+			textures.push_back(FakeTexture(1u << (random.Next() % 13), TailSize));
+
+		tailBytes = 0;
+		for (uint i = 0; i < count; i++)
+		{
+			entries.push_back(MakeEntry(textures[i], random.NextFloat(0.0f, 4096.0f)));
+			tailBytes += textures[i].GetBytes(textures[i].TailLevel);
+		}
+
+		budget = tailBytes + (random.Next() % (64u << 20));
+		used = TextureStreamer::PlanResidency(entries.data(), entries.size(), budget, firstLevels);
+		passed &= Check(IsValidPlan(textures, entries, firstLevels, used) && used <= budget, "random scene planned outside its budget or levels");
+		scenes++;
+	}
+
+	//the size of plan Update makes every frame for a large scene
+	textures.clear();
+	entries.clear();
+	for (uint i = 0; i < 10000; i++)
+		textures.push_back(FakeTexture(1u << (6 + random.Next() % 7), TailSize));
+	for (uint i = 0; i < textures.size(); i++)
+		entries.push_back(MakeEntry(textures[i], random.NextFloat(0.0f, 2048.0f)));
+
+	Timer timer(true);
+	used = TextureStreamer::PlanResidency(entries.data(), entries.size(), 512ull << 20, firstLevels);
+	double planTime = timer.Tick();
+
+	printf("%u random scenes planned, 10000 textures planned in %.3f ms using %.1f MB\n", scenes, planTime * 1000.0, used / (1024.0 * 1024.0));
+	return passed;
+}
@@ -0,0 +1,296 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "TestBench.h"
+
+using namespace SunEngine;
+
+namespace
+{
+	//An unbalanced graph, every eighth root is far heavier than the others and every root spawns children once it ran
+	const uint RootCount = 256;
+	const uint ChildCount = 4;
+	const uint BaseIterations = 20000;
+	const uint HeavyFactor = 32;
+
+	uint GetRootIterations(uint index)
+	{
+		return index % 8 == 0 ? BaseIterations * HeavyFactor : BaseIterations;
+	}
+
+	uint64 Spin(uint seed, uint iterations)
+	{
+		uint64 value = seed * 2654435761ull + 1;
+		for (uint i = 0; i < iterations; i++)
+		{
+			value ^= value << 13;
+			value ^= value >> 7;
+			value ^= value << 17;
+		}
+		return value;
+	}
+
+	uint64 RunRootInline(uint index)
+	{
+		uint64 sum = Spin(index, GetRootIterations(index));
+		for (uint c = 0; c < ChildCount; c++)
+			sum += Spin(index * ChildCount + c + RootCount, BaseIterations);
+		return sum;
+	}
+
+	struct ChildTask
+	{
+		uint Seed;
+		PerThreadData<uint64>* pSums;
+	};
+
+	struct RootTask
+	{
+		uint Index;
+		ThreadPool::Counter* pCounter;
+		PerThreadData<uint64>* pSums;
+		ChildTask Children[ChildCount];
+	};
+
+	void ExecuteChild(uint threadIndex, void* pData)
+	{
+		ChildTask* pChild = static_cast<ChildTask*>(pData);
+		(*pChild->pSums)[threadIndex] += Spin(pChild->Seed, BaseIterations);
+	}
+
+	void ExecuteRoot(uint threadIndex, void* pData)
+	{
+		RootTask* pRoot = static_cast<RootTask*>(pData);
+		(*pRoot->pSums)[threadIndex] += Spin(pRoot->Index, GetRootIterations(pRoot->Index));
+
+		//children go to this thread's queue where idle threads can steal them
+		for (uint c = 0; c < ChildCount; c++)
+		{
+			pRoot->Children[c].Seed = pRoot->Index * ChildCount + c + RootCount;
+			pRoot->Children[c].pSums = pRoot->pSums;
+			ThreadPool::Get().AddTask(ExecuteChild, &pRoot->Children[c], pRoot->pCounter);
+		}
+	}
+
+	//The pool before work stealing, kept as the baseline: tasks are queued until Wait deals them to one worker per hardware
+	//thread in turn, and the calling thread sleeps until every worker is done. The only change is that Destroy sets the
+	//destroyed flag under the lock so the bench can't hang on a missed wake up.
+	class RoundRobinPool
+	{
+	public:
+		typedef void(*TaskCallback)(uint threadIndex, void* pData);
+
+		RoundRobinPool()
+		{
+			_threads.resize(std::thread::hardware_concurrency());
+			for (uint i = 0; i < _threads.size(); i++)
+			{
+				_threads[i] = UniquePtr<WorkerThread>(new WorkerThread(i));
+				_threads[i]->Create();
+			}
+		}
+
+		~RoundRobinPool()
+		{
+			Wait();
+			for (uint i = 0; i < _threads.size(); i++)
+				_threads[i]->Destroy();
+			_threads.clear();
+		}
+
+		void AddTask(TaskCallback callback, void* pData)
+		{
+			_tasks.push_back({ callback, pData });
+		}
+
+		void Wait()
+		{
+			uint t = 0;
+			for (uint i = 0; i < _tasks.size(); i++)
+			{
+				_threads[t]->_tasks.push(_tasks[i]);
+				t = (t + 1) % _threads.size();
+			}
+
+			for (auto& thread : _threads)
+				thread->_condition.notify_one();
+
+			_tasks.clear();
+			for (auto& thread : _threads)
+				thread->Wait();
+		}
+
+		uint GetThreadCount() const { return _threads.size(); }
+
+	private:
+		class WorkerThread
+		{
+		public:
+			WorkerThread(uint index)
+			{
+				_destroyed = false;
+				_index = index;
+			}
+
+			void Create()
+			{
+				_thread = std::thread(&WorkerThread::Run, this);
+			}
+
+			void Destroy()
+			{
+				if (_thread.joinable())
+				{
+					{
+						std::lock_guard<std::mutex> lock(_mtx);
+						_destroyed = true;
+					}
+					_condition.notify_one();
+					_thread.join();
+				}
+			}
+
+			void Run()
+			{
+				while (true)
+				{
+					{
+						std::unique_lock<std::mutex> lock(_mtx);
+						_condition.wait(lock, [this]() -> bool { return !_tasks.empty() || _destroyed; });
+						if (_destroyed)
+							break;
+					}
+
+					while (!_tasks.empty())
+					{
+						auto& t = _tasks.front();
+						t.first(_index, t.second);
+						_tasks.pop();
+					}
+
+					{
+						std::lock_guard<std::mutex> lock(_mtx);
+						_condition.notify_one();
+					}
+				}
+			}
+
+			void Wait()
+			{
+				std::unique_lock<std::mutex> lock(_mtx);
+				_condition.wait(lock, [this]() -> bool { return _tasks.empty(); });
+			}
+
+		private:
+			friend class RoundRobinPool;
+
+			uint _index;
+			bool _destroyed;
+			std::thread _thread;
+			std::mutex _mtx;
+			std::condition_variable _condition;
+			Queue<Pair<TaskCallback, void*>> _tasks;
+		};
+
+		Vector<Pair<TaskCallback, void*>> _tasks;
+		Vector<UniquePtr<WorkerThread>> _threads;
+	};
+
+	struct InlineRootTask
+	{
+		uint Index;
+		Vector<uint64>* pSums;
+	};
+
+	//The old pool couldn't take tasks from inside a task, so a root runs its children itself where it was dealt
+	uint64 RunRoundRobin(RoundRobinPool& pool)
+	{
+		Vector<uint64> sums(pool.GetThreadCount(), 0);
+		Vector<InlineRootTask> roots(RootCount);
+		for (uint i = 0; i < RootCount; i++)
+		{
+			roots[i].Index = i;
+			roots[i].pSums = &sums;
+			pool.AddTask([](uint threadIndex, void* pData) -> void {
+				InlineRootTask* pRoot = static_cast<InlineRootTask*>(pData);
+				(*pRoot->pSums)[threadIndex] += RunRootInline(pRoot->Index);
+			}, &roots[i]);
+		}
+
+		pool.Wait();
+
+		uint64 total = 0;
+		for (uint64 sum : sums)
+			total += sum;
+		return total;
+	}
+
+	uint64 RunWorkStealing()
+	{
+		ThreadPool& pool = ThreadPool::Get();
+		PerThreadData<uint64> sums;
+		ThreadPool::Counter counter;
+
+		Vector<RootTask> roots(RootCount);
+		for (uint i = 0; i < RootCount; i++)
+		{
+			roots[i].Index = i;
+			roots[i].pCounter = &counter;
+			roots[i].pSums = &sums;
+			pool.AddTask(ExecuteRoot, &roots[i], &counter);
+		}
+
+		pool.Wait(counter);
+
+		uint64 total = 0;
+		for (uint64 sum : sums)
+			total += sum;
+		return total;
+	}
+}
+
+bool RunThreadPoolBench()
+{
+	ThreadPool& pool = ThreadPool::Get();
+	uint threadCount = pool.GetThreadCount();
+
+	uint64 reference = 0;
+	for (uint i = 0; i < RootCount; i++)
+		reference += RunRootInline(i);
+
+	//both pools have their threads running before anything is timed
+	RoundRobinPool roundRobinPool;
+
+	Timer timer(true);
+	uint64 roundRobin = RunRoundRobin(roundRobinPool);
+	double roundRobinTime = timer.Tick();
+	uint64 stealing = RunWorkStealing();
+	double stealingTime = timer.Tick();
+
+	//a thread outside the pool waits with its own slot, and loops too small to split run on it with that slot too
+	uint64 external = 0;
+	uint externalSlot = ~0u;
+	std::thread thread([&external, &externalSlot]() -> void {
+		external = RunWorkStealing();
+		ThreadPool::Get().ParallelForRange(0, 1, 1, [&externalSlot](uint threadIndex, uint, uint) -> void { externalSlot = threadIndex; });
+	});
+	thread.join();
+
+	printf("%u roots (every 8th %ux heavier), %u children each\n", RootCount, HeavyFactor, ChildCount);
+	printf("round robin   %8.2f ms, %u workers\n", roundRobinTime * 1000.0, roundRobinPool.GetThreadCount());
+	printf("work stealing %8.2f ms (%.2fx), %u threads\n", stealingTime * 1000.0, stealingTime > 0.0 ? roundRobinTime / stealingTime : 0.0, threadCount);
+
+	bool passed = roundRobin == reference && stealing == reference && external == reference;
+	if (!passed)
+		printf("checksum mismatch\n");
+
+	if (externalSlot >= pool.GetSlotCount())
+	{
+		printf("a serial loop on an external thread got slot %u of %u\n", externalSlot, pool.GetSlotCount());
+		passed = false;
+	}
+
+	return passed;
+}